@@ -0,0 +1,249 @@
+#include "BlockCompress.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t kSize = 512;
+
+	// Something like real content: smooth gradients, hard-edged shapes, fine
+	// noise and an alpha ramp. BC1 gets it fully opaque.
+	std::vector<uint8_t> MakeImage(bool opaque)
+	{
+		std::vector<uint8_t> pixels(size_t(kSize) * kSize * 4);
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int> noise(-6, 6);
+		for (uint32_t y = 0; y < kSize; ++y)
+		{
+			for (uint32_t x = 0; x < kSize; ++x)
+			{
+				const float u = float(x) / kSize;
+				const float v = float(y) / kSize;
+				float color[3] =
+				{
+					255.0f * u,
+					127.5f + 127.5f * std::sin(v * 12.0f + u * 3.0f),
+					255.0f * (1.0f - v) * (0.5f + 0.5f * std::cos(u * 7.0f))
+				};
+				const float dx = u - 0.5f;
+				const float dy = v - 0.5f;
+				if (dx * dx + dy * dy < 0.04f)
+				{
+					color[0] = 230.0f;
+					color[1] = 40.0f;
+					color[2] = 60.0f;
+				}
+				if (((x / 32) + (y / 32)) % 7 == 0)
+				{
+					std::swap(color[0], color[2]);
+				}
+
+				uint8_t* pixel = &pixels[(size_t(y) * kSize + x) * 4];
+				for (int c = 0; c < 3; ++c)
+				{
+					pixel[c] = static_cast<uint8_t>(std::clamp(int(color[c]) + noise(random), 0, 255));
+				}
+				pixel[3] = opaque ? 255 : static_cast<uint8_t>(std::clamp(int(255.0f * v) + noise(random), 0, 255));
+			}
+		}
+		return pixels;
+	}
+
+	// Decoders, matching the palettes the encoder builds
+
+	void DecodeColor(const uint8_t* block, bool four_color_only, uint8_t (&out)[16][4])
+	{
+		uint16_t c0;
+		uint16_t c1;
+		uint32_t bits;
+		std::memcpy(&c0, block, 2);
+		std::memcpy(&c1, block + 2, 2);
+		std::memcpy(&bits, block + 4, 4);
+
+		int palette[4][4];
+		for (int k = 0; k < 2; ++k)
+		{
+			const uint16_t value = k == 0 ? c0 : c1;
+			const int r = value >> 11;
+			const int g = (value >> 5) & 63;
+			const int b = value & 31;
+			palette[k][0] = (r << 3) | (r >> 2);
+			palette[k][1] = (g << 2) | (g >> 4);
+			palette[k][2] = (b << 3) | (b >> 2);
+			palette[k][3] = 255;
+		}
+		const bool four_color = four_color_only || c0 > c1;
+		for (int c = 0; c < 3; ++c)
+		{
+			if (four_color)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = four_color ? 255 : 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = palette[(bits >> (i * 2)) & 3];
+			for (int c = 0; c < 4; ++c)
+			{
+				out[i][c] = static_cast<uint8_t>(color[c]);
+			}
+		}
+	}
+
+	void DecodeBc4(const uint8_t* block, int channel, uint8_t (&out)[16][4])
+	{
+		uint64_t bits;
+		std::memcpy(&bits, block, 8);
+		const int a0 = block[0];
+		const int a1 = block[1];
+		int palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; ++i)
+			{
+				palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+			{
+				palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			out[i][channel] = static_cast<uint8_t>(palette[(bits >> (16 + i * 3)) & 7]);
+		}
+	}
+
+	// Mode 6 only, which is all the encoder writes
+	void DecodeBc7(const uint8_t* block, uint8_t (&out)[16][4])
+	{
+		static constexpr int kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		uint32_t position = 7;
+		const auto read = [&](uint32_t bits)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++position)
+			{
+				value |= uint32_t((block[position / 8] >> (position % 8)) & 1) << i;
+			}
+			return value;
+		};
+
+		int e[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			e[0][c] = int(read(7)) << 1;
+			e[1][c] = int(read(7)) << 1;
+		}
+		const int p0 = int(read(1));
+		const int p1 = int(read(1));
+		for (int c = 0; c < 4; ++c)
+		{
+			e[0][c] |= p0;
+			e[1][c] |= p1;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			const int w = kWeights[read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				out[i][c] = static_cast<uint8_t>(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+			}
+		}
+	}
+
+	// PSNR over the channels the format stores: RGB for BC1, RG for BC5, RGBA otherwise
+	double MeasurePsnr(const std::vector<uint8_t>& image, const std::vector<uint8_t>& blocks, BlockFormat format)
+	{
+		const uint32_t blocks_wide = kSize / 4;
+		const uint32_t block_bytes = GetBlockBytes(format);
+		const int channels = format == BlockFormat::kBC1 ? 3 : format == BlockFormat::kBC5 ? 2 : 4;
+		double squared_error = 0.0;
+		for (uint32_t by = 0; by < kSize / 4; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocks_wide; ++bx)
+			{
+				const uint8_t* block = &blocks[(size_t(by) * blocks_wide + bx) * block_bytes];
+				uint8_t decoded[16][4] = {};
+				switch (format)
+				{
+					case BlockFormat::kBC1: DecodeColor(block, false, decoded); break;
+					case BlockFormat::kBC3: DecodeColor(block + 8, true, decoded); DecodeBc4(block, 3, decoded); break;
+					case BlockFormat::kBC5: DecodeBc4(block, 0, decoded); DecodeBc4(block + 8, 1, decoded); break;
+					case BlockFormat::kBC7: DecodeBc7(block, decoded); break;
+				}
+
+				for (int i = 0; i < 16; ++i)
+				{
+					const uint8_t* pixel = &image[((size_t(by) * 4 + i / 4) * kSize + bx * 4 + i % 4) * 4];
+					for (int c = 0; c < channels; ++c)
+					{
+						const double d = double(pixel[c]) - decoded[i][c];
+						squared_error += d * d;
+					}
+				}
+			}
+		}
+		const double mse = squared_error / (double(kSize) * kSize * channels);
+		return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+	}
+
+	// Args: BlockFormat, BlockQuality. Single-threaded; Mpixels is per second.
+	void BM_CompressImage(benchmark::State& state)
+	{
+		BlockCompressSettings settings;
+		settings.format = static_cast<BlockFormat>(state.range(0));
+		settings.quality = static_cast<BlockQuality>(state.range(1));
+		const std::vector<uint8_t> image = MakeImage(settings.format == BlockFormat::kBC1);
+		std::vector<uint8_t> blocks(size_t(kSize / 4) * (kSize / 4) * GetBlockBytes(settings.format));
+		const size_t block_row_pitch = size_t(kSize / 4) * GetBlockBytes(settings.format);
+
+		for (auto _ : state)
+		{
+			CompressImage(image.data(), size_t(kSize) * 4, kSize, kSize, blocks.data(), block_row_pitch, settings);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * kSize * kSize);
+		state.counters["Mpixels"] = benchmark::Counter(double(state.iterations()) * kSize * kSize / 1e6, benchmark::Counter::kIsRate);
+		state.counters["PSNR"] = MeasurePsnr(image, blocks, settings.format);
+	}
+	BENCHMARK(BM_CompressImage)->ArgsProduct({ { 0, 1, 2, 3 }, { 0, 1, 2 } })->Unit(benchmark::kMillisecond);
+
+	void BM_CompressImageParallel(benchmark::State& state)
+	{
+		BlockCompressSettings settings;
+		settings.format = static_cast<BlockFormat>(state.range(0));
+		const std::vector<uint8_t> image = MakeImage(false);
+		std::vector<uint8_t> blocks(size_t(kSize / 4) * (kSize / 4) * GetBlockBytes(settings.format));
+		ThreadPool pool;
+
+		for (auto _ : state)
+		{
+			CompressImage(image.data(), size_t(kSize) * 4, kSize, kSize, blocks.data(), size_t(kSize / 4) * GetBlockBytes(settings.format), settings, &pool);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * kSize * kSize);
+		state.counters["Mpixels"] = benchmark::Counter(double(state.iterations()) * kSize * kSize / 1e6, benchmark::Counter::kIsRate);
+		state.counters["threads"] = pool.GetThreadCount();
+	}
+	BENCHMARK(BM_CompressImageParallel)->Arg(int(BlockFormat::kBC7))->UseRealTime()->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,219 @@
+#include "Bvh.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr float kWorldSize = 1000.0f;
+
+	// Objects of 0.5 to 4 units scattered through a kWorldSize cube, and the
+	// same objects each moved up to 'jitter' units for refits
+	std::vector<Aabb> MakeBoxes(uint32_t count, uint32_t seed, float jitter = 0.0f)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(0.0f, kWorldSize);
+		std::uniform_real_distribution<float> size(0.25f, 2.0f);
+		std::vector<Aabb> boxes(count);
+		for (Aabb& box : boxes)
+		{
+			const Vec3 center(position(random), position(random), position(random));
+			const Vec3 extent(size(random), size(random), size(random));
+			box = Aabb(center - extent, center + extent);
+		}
+
+		if (jitter > 0.0f)
+		{
+			std::uniform_real_distribution<float> offset(-jitter, jitter);
+			for (Aabb& box : boxes)
+			{
+				const Vec3 move(offset(random), offset(random), offset(random));
+				box = Aabb(box.min + move, box.max + move);
+			}
+		}
+		return boxes;
+	}
+
+	// Rays from random points inside the world towards random directions
+	std::vector<Ray> MakeRays(uint32_t count)
+	{
+		std::mt19937 random(23);
+		std::uniform_real_distribution<float> position(0.0f, kWorldSize);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::vector<Ray> rays(count);
+		for (Ray& ray : rays)
+		{
+			ray.origin = Vec3(position(random), position(random), position(random));
+			ray.direction = Normalize(Vec3(direction(random), direction(random), direction(random)));
+		}
+		return rays;
+	}
+
+	// Slab test, for the brute force comparison
+	float RayBoxDistance(const Ray& ray, const Aabb& box)
+	{
+		const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+		const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+		const float low[3] = { box.min.x, box.min.y, box.min.z };
+		const float high[3] = { box.max.x, box.max.y, box.max.z };
+		float near_t = 0.0f;
+		float far_t = INFINITY;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float inverse = 1.0f / direction[axis];
+			float t0 = (low[axis] - origin[axis]) * inverse;
+			float t1 = (high[axis] - origin[axis]) * inverse;
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			near_t = std::max(near_t, t0);
+			far_t = std::min(far_t, t1);
+		}
+		return near_t <= far_t ? near_t : INFINITY;
+	}
+
+	// Args: object count
+	void Sizes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+	}
+
+	void BM_BvhBuild(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		for (auto _ : state)
+		{
+			Bvh bvh;
+			bvh.Build(boxes.data(), uint32_t(boxes.size()));
+			benchmark::DoNotOptimize(bvh.GetBounds());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_BvhBuild)->Apply(Sizes);
+
+	void BM_BvhRefit(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		const std::vector<Aabb> moved = MakeBoxes(uint32_t(state.range(0)), 1, 5.0f);
+		Bvh bvh;
+		bvh.Build(boxes.data(), uint32_t(boxes.size()));
+		bool flip = false;
+		for (auto _ : state)
+		{
+			bvh.Refit(flip ? boxes.data() : moved.data());
+			flip = !flip;
+			benchmark::DoNotOptimize(bvh.GetBounds());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_BvhRefit)->Apply(Sizes);
+
+	// Rays per second; hit at the object's box
+	void BM_BvhRaycast(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		const std::vector<Ray> rays = MakeRays(1024);
+		Bvh bvh;
+		bvh.Build(boxes.data(), uint32_t(boxes.size()));
+		uint32_t hits = 0;
+		for (auto _ : state)
+		{
+			hits = 0;
+			for (const Ray& ray : rays)
+			{
+				hits += bvh.Raycast(ray).IsHit();
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(rays.size()));
+		state.counters["hit_rate"] = double(hits) / double(rays.size());
+	}
+	BENCHMARK(BM_BvhRaycast)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+	// The same rays after the objects moved and the tree was only refit,
+	// to show how much a loosened tree costs
+	void BM_BvhRaycastAfterRefit(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		const std::vector<Aabb> moved = MakeBoxes(uint32_t(state.range(0)), 1, float(state.range(1)));
+		const std::vector<Ray> rays = MakeRays(1024);
+		Bvh bvh;
+		bvh.Build(boxes.data(), uint32_t(boxes.size()));
+		bvh.Refit(moved.data());
+		for (auto _ : state)
+		{
+			for (const Ray& ray : rays)
+			{
+				benchmark::DoNotOptimize(bvh.Raycast(ray));
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(rays.size()));
+	}
+	BENCHMARK(BM_BvhRaycastAfterRefit)->ArgsProduct({ { 100000 }, { 5, 50 } });
+
+	void BM_BvhRaycastBruteForce(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		const std::vector<Ray> rays = MakeRays(64);
+		for (auto _ : state)
+		{
+			for (const Ray& ray : rays)
+			{
+				float nearest = INFINITY;
+				for (const Aabb& box : boxes)
+				{
+					nearest = std::min(nearest, RayBoxDistance(ray, box));
+				}
+				benchmark::DoNotOptimize(nearest);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(rays.size()));
+	}
+	BENCHMARK(BM_BvhRaycastBruteForce)->Arg(10000)->Arg(100000);
+
+	// 20-unit query boxes, about ten objects each at 1M
+	void BM_BvhQueryOverlaps(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		const std::vector<Ray> centers = MakeRays(1024);
+		Bvh bvh;
+		bvh.Build(boxes.data(), uint32_t(boxes.size()));
+		std::vector<uint32_t> objects;
+		size_t found = 0;
+		for (auto _ : state)
+		{
+			found = 0;
+			for (const Ray& center : centers)
+			{
+				objects.clear();
+				bvh.QueryOverlaps(Aabb(center.origin - Vec3(10.0f), center.origin + Vec3(10.0f)), objects);
+				found += objects.size();
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(centers.size()));
+		state.counters["objects_per_query"] = double(found) / double(centers.size());
+	}
+	BENCHMARK(BM_BvhQueryOverlaps)->Arg(10000)->Arg(100000)->Arg(1000000);
+
+	// A camera in the middle of the world; compare with BM_CullAabbs, which
+	// tests every object
+	void BM_BvhQueryFrustum(benchmark::State& state)
+	{
+		const std::vector<Aabb> boxes = MakeBoxes(uint32_t(state.range(0)), 1);
+		Bvh bvh;
+		bvh.Build(boxes.data(), uint32_t(boxes.size()));
+		const Vec3 eye(kWorldSize * 0.5f);
+		const Mat4 view = LookAtMatrix(eye, eye + Vec3(0.0f, 0.0f, 1.0f), Vec3(0.0f, 1.0f, 0.0f));
+		const Frustum frustum = ExtractFrustum(view * PerspectiveMatrix(ToRadians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f));
+		std::vector<uint32_t> objects;
+		for (auto _ : state)
+		{
+			objects.clear();
+			bvh.QueryFrustum(frustum, objects);
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+		state.counters["visible"] = double(objects.size());
+	}
+	BENCHMARK(BM_BvhQueryFrustum)->Apply(Sizes);
+}
@@ -0,0 +1,113 @@
+#include "DrawQueue.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// A frame's worth of draws: a few passes and pipelines, many materials and
+	// meshes, spread over depth_buckets buckets
+	std::vector<DrawQueue::Packet> MakePackets(size_t count, uint32_t depth_buckets = 1u << DrawKey::kDepthBits)
+	{
+		std::mt19937 random(29);
+		std::vector<DrawQueue::Packet> packets(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			packets[i].key = DrawKey::Make(random() % 4, random() % depth_buckets, random() % 32, random() % 1024, random() % 4096);
+			packets[i].payload = i;
+		}
+		return packets;
+	}
+
+	// Args: draw count. Refilling the queue is timed too, as it is every frame.
+	void Sizes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000);
+	}
+
+	void BM_DrawQueueSort(benchmark::State& state)
+	{
+		const std::vector<DrawQueue::Packet> packets = MakePackets(size_t(state.range(0)));
+		DrawQueue queue;
+		for (auto _ : state)
+		{
+			queue.Reset();
+			queue.Push(packets.data(), uint32_t(packets.size()));
+			queue.Sort();
+			benchmark::DoNotOptimize(queue.GetPackets());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_DrawQueueSort)->Apply(Sizes);
+
+	void BM_DrawQueueSortParallel(benchmark::State& state)
+	{
+		const std::vector<DrawQueue::Packet> packets = MakePackets(size_t(state.range(0)));
+		ThreadPool pool;
+		DrawQueue queue;
+		for (auto _ : state)
+		{
+			queue.Reset();
+			queue.Push(packets.data(), uint32_t(packets.size()));
+			queue.Sort(&pool);
+			benchmark::DoNotOptimize(queue.GetPackets());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+		state.counters["threads"] = pool.GetThreadCount();
+	}
+	BENCHMARK(BM_DrawQueueSortParallel)->Apply(Sizes)->UseRealTime();
+
+	// What the radix sort replaces
+	void BM_DrawQueueStableSort(benchmark::State& state)
+	{
+		const std::vector<DrawQueue::Packet> packets = MakePackets(size_t(state.range(0)));
+		std::vector<DrawQueue::Packet> sorted;
+		for (auto _ : state)
+		{
+			sorted.assign(packets.begin(), packets.end());
+			std::stable_sort(sorted.begin(), sorted.end(), [](const DrawQueue::Packet& a, const DrawQueue::Packet& b)
+			{
+				return a.key < b.key;
+			});
+			benchmark::DoNotOptimize(sorted.data());
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+	}
+	BENCHMARK(BM_DrawQueueStableSort)->Apply(Sizes);
+
+	// Counts the calls, so what is left is Submit()'s own walk
+	class NullSubmitter : public DrawSubmitter
+	{
+	public:
+		void SetPass(uint32_t) override { ++calls; }
+		void SetPipeline(uint32_t) override { ++calls; }
+		void SetMaterial(uint32_t) override { ++calls; }
+		void SetMesh(uint32_t) override { ++calls; }
+		void Draw(uint32_t) override { ++calls; }
+
+		uint64_t calls = 0;
+	};
+
+	// Opaque draws, all in one depth bucket so they group by state
+	void BM_DrawQueueSubmit(benchmark::State& state)
+	{
+		const std::vector<DrawQueue::Packet> packets = MakePackets(size_t(state.range(0)), 1);
+		DrawQueue queue;
+		queue.Push(packets.data(), uint32_t(packets.size()));
+		queue.Sort();
+		NullSubmitter submitter;
+		DrawSubmitStats stats;
+		for (auto _ : state)
+		{
+			stats = queue.Submit(submitter);
+			benchmark::DoNotOptimize(submitter.calls);
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+		state.counters["pipeline_changes"] = stats.pipeline_changes;
+		state.counters["material_changes"] = stats.material_changes;
+		state.counters["mesh_changes"] = stats.mesh_changes;
+	}
+	BENCHMARK(BM_DrawQueueSubmit)->Apply(Sizes);
+}
@@ -0,0 +1,147 @@
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Objects of 0.5 to 4 units scattered through a 1000-unit cube around a
+	// camera at its center, looking down +z with a 60 degree field of view
+	// and a 500-unit far plane; about a tenth of them end up visible
+	struct Objects
+	{
+		explicit Objects(uint32_t object_count)
+			:
+			count(object_count)
+		{
+			std::mt19937 random(17);
+			std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+			std::uniform_real_distribution<float> size(0.25f, 2.0f);
+			std::vector<Aabb> box_list(count);
+			std::vector<Sphere> sphere_list(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const Vec3 center(position(random), position(random), position(random));
+				const Vec3 extent(size(random), size(random), size(random));
+				box_list[i] = Aabb(center - extent, center + extent);
+				sphere_list[i] = BoundingSphere(box_list[i]);
+			}
+			boxes.resize(BatchCount(count));
+			spheres.resize(BatchCount(count));
+			PackAabbs(boxes.data(), box_list.data(), count);
+			PackSpheres(spheres.data(), sphere_list.data(), count);
+			visible.resize(count);
+
+			const Mat4 view = LookAtMatrix(Vec3(0.0f), Vec3(0.0f, 0.0f, 1.0f), Vec3(0.0f, 1.0f, 0.0f));
+			frustum = ExtractFrustum(view * PerspectiveMatrix(ToRadians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f));
+		}
+
+		uint32_t count;
+		std::vector<AabbBatch> boxes;
+		std::vector<SphereBatch> spheres;
+		std::vector<uint32_t> visible;
+		Frustum frustum;
+	};
+
+	// Args: object count, SimdLevel. items_per_second / 1000 is objects per ms.
+	void Shapes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->ArgsProduct({ { 100000, 1000000 }, { int(SimdLevel::kScalar), int(SimdLevel::kSse2), int(SimdLevel::kAvx2) } });
+	}
+
+	bool SkipUnsupported(benchmark::State& state, SimdLevel level)
+	{
+		if (ClampSimdLevel(level) != level)
+		{
+			state.SkipWithError("SIMD level not supported");
+			return true;
+		}
+		return false;
+	}
+
+	void BM_CullAabbs(benchmark::State& state)
+	{
+		const auto level = static_cast<SimdLevel>(state.range(1));
+		if (SkipUnsupported(state, level))
+		{
+			return;
+		}
+		Objects objects(uint32_t(state.range(0)));
+		uint32_t visible = 0;
+		for (auto _ : state)
+		{
+			visible = CullAabbs(objects.frustum, objects.boxes.data(), objects.count, objects.visible.data(), nullptr, level);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * objects.count);
+		state.counters["visible"] = visible;
+	}
+	BENCHMARK(BM_CullAabbs)->Apply(Shapes);
+
+	void BM_CullSpheres(benchmark::State& state)
+	{
+		const auto level = static_cast<SimdLevel>(state.range(1));
+		if (SkipUnsupported(state, level))
+		{
+			return;
+		}
+		Objects objects(uint32_t(state.range(0)));
+		uint32_t visible = 0;
+		for (auto _ : state)
+		{
+			visible = CullSpheres(objects.frustum, objects.spheres.data(), objects.count, objects.visible.data(), nullptr, level);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * objects.count);
+		state.counters["visible"] = visible;
+	}
+	BENCHMARK(BM_CullSpheres)->Apply(Shapes);
+
+	// One Intersects() call per unpacked box, as code without the batches would do
+	void BM_IntersectsEach(benchmark::State& state)
+	{
+		const uint32_t count = uint32_t(state.range(0));
+		Objects objects(count);
+		std::vector<Aabb> boxes(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const AabbBatch& batch = objects.boxes[i / kBatchWidth];
+			const size_t lane = i % kBatchWidth;
+			const Vec3 center(batch.center.x[lane], batch.center.y[lane], batch.center.z[lane]);
+			const Vec3 extent(batch.extent.x[lane], batch.extent.y[lane], batch.extent.z[lane]);
+			boxes[i] = Aabb(center - extent, center + extent);
+		}
+
+		uint32_t visible = 0;
+		for (auto _ : state)
+		{
+			visible = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (Intersects(objects.frustum, boxes[i]))
+				{
+					objects.visible[visible++] = i;
+				}
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * count);
+		state.counters["visible"] = visible;
+	}
+	BENCHMARK(BM_IntersectsEach)->Arg(100000)->Arg(1000000);
+
+	void BM_CullAabbsParallel(benchmark::State& state)
+	{
+		Objects objects(uint32_t(state.range(0)));
+		ThreadPool pool;
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(CullAabbs(objects.frustum, objects.boxes.data(), objects.count, objects.visible.data(), &pool));
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * objects.count);
+		state.counters["threads"] = pool.GetThreadCount();
+	}
+	BENCHMARK(BM_CullAabbsParallel)->Arg(100000)->Arg(1000000)->UseRealTime();
+}
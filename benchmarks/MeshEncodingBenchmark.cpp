@@ -0,0 +1,134 @@
+#include "MeshEncoding.h"
+#include "MeshOptimizer.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// A torus of segments x segments quads run through OptimizeVertexCache and
+	// OptimizeVertexFetch, as meshes are before they are encoded
+	struct Mesh
+	{
+		explicit Mesh(uint32_t segments)
+		{
+			std::vector<MeshVertex> source;
+			for (uint32_t i = 0; i < segments; ++i)
+			{
+				for (uint32_t j = 0; j < segments; ++j)
+				{
+					const float u = 6.2831853f * float(i) / float(segments);
+					const float v = 6.2831853f * float(j) / float(segments);
+					MeshVertex vertex;
+					vertex.position[0] = (1.0f + 0.3f * std::cos(v)) * std::cos(u);
+					vertex.position[1] = (1.0f + 0.3f * std::cos(v)) * std::sin(u);
+					vertex.position[2] = 0.3f * std::sin(v);
+					vertex.normal[0] = std::cos(v) * std::cos(u);
+					vertex.normal[1] = std::cos(v) * std::sin(u);
+					vertex.normal[2] = std::sin(v);
+					vertex.uv[0] = float(i) / float(segments);
+					vertex.uv[1] = float(j) / float(segments);
+					source.push_back(vertex);
+				}
+			}
+
+			std::vector<uint32_t> triangles;
+			for (uint32_t i = 0; i < segments; ++i)
+			{
+				for (uint32_t j = 0; j < segments; ++j)
+				{
+					const uint32_t a = i * segments + j;
+					const uint32_t b = ((i + 1) % segments) * segments + j;
+					const uint32_t c = ((i + 1) % segments) * segments + (j + 1) % segments;
+					const uint32_t d = i * segments + (j + 1) % segments;
+					triangles.insert(triangles.end(), { a, b, c, a, c, d });
+				}
+			}
+
+			indices.resize(triangles.size());
+			OptimizeVertexCache(indices.data(), triangles.data(), triangles.size(), source.size());
+			vertices.resize(source.size());
+			vertices.resize(OptimizeVertexFetch(vertices.data(), indices.data(), indices.size(), source.data(), source.size(), sizeof(MeshVertex)));
+			encoded = EncodeIndexBuffer(indices.data(), indices.size());
+		}
+
+		std::vector<MeshVertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<unsigned char> encoded;
+	};
+
+	// Args: torus segments; 6 * segments^2 indices
+	void Sizes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->Arg(64)->Arg(256)->Arg(1024);
+	}
+
+	void SetIndices(benchmark::State& state, const Mesh& mesh)
+	{
+		state.SetItemsProcessed(state.iterations() * int64_t(mesh.indices.size()));
+		state.SetBytesProcessed(state.iterations() * int64_t(mesh.indices.size() * sizeof(uint32_t)));
+		state.counters["bytes_per_index"] = double(mesh.encoded.size()) / double(mesh.indices.size());
+	}
+
+	void BM_MeshEncodingEncodeIndices(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size()));
+		}
+		SetIndices(state, mesh);
+	}
+	BENCHMARK(BM_MeshEncodingEncodeIndices)->Apply(Sizes);
+
+	// Args: torus segments, SimdLevel
+	void BM_MeshEncodingDecodeIndices(benchmark::State& state)
+	{
+		const auto level = static_cast<SimdLevel>(state.range(1));
+		if (ClampSimdLevel(level) != level)
+		{
+			state.SkipWithError("SIMD level not supported");
+			return;
+		}
+		const Mesh mesh(uint32_t(state.range(0)));
+		std::vector<uint32_t> decoded(mesh.indices.size());
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(DecodeIndexBuffer(decoded.data(), mesh.encoded.data(), mesh.encoded.size(), level));
+			benchmark::ClobberMemory();
+		}
+		SetIndices(state, mesh);
+	}
+	BENCHMARK(BM_MeshEncodingDecodeIndices)->ArgsProduct({ { 64, 256, 1024 }, { int(SimdLevel::kScalar), int(SimdLevel::kAvx2) } });
+
+	// What decoding competes with: reading the raw 32-bit indices
+	void BM_MeshEncodingCopyIndices(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		std::vector<uint32_t> copy(mesh.indices.size());
+		for (auto _ : state)
+		{
+			std::memcpy(copy.data(), mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+			benchmark::ClobberMemory();
+		}
+		SetIndices(state, mesh);
+	}
+	BENCHMARK(BM_MeshEncodingCopyIndices)->Apply(Sizes);
+
+	void BM_MeshEncodingQuantizeVertices(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		const VertexQuantization quantization = ComputeVertexQuantization(mesh.vertices.data(), mesh.vertices.size());
+		std::vector<QuantizedVertex> quantized(mesh.vertices.size());
+		for (auto _ : state)
+		{
+			QuantizeVertices(quantized.data(), mesh.vertices.data(), mesh.vertices.size(), quantization);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(mesh.vertices.size()));
+		state.counters["bytes_before"] = double(mesh.vertices.size() * sizeof(MeshVertex));
+		state.counters["bytes_after"] = double(quantized.size() * sizeof(QuantizedVertex));
+	}
+	BENCHMARK(BM_MeshEncodingQuantizeVertices)->Apply(Sizes);
+}
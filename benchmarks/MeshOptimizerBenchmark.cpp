@@ -0,0 +1,159 @@
+#include "MeshOptimizer.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// A torus of segments x segments quads with its triangles shuffled, so the
+	// input starts at the worst case ACMR of 3
+	struct Mesh
+	{
+		explicit Mesh(uint32_t segments)
+		{
+			for (uint32_t i = 0; i < segments; ++i)
+			{
+				for (uint32_t j = 0; j < segments; ++j)
+				{
+					const float u = 6.2831853f * float(i) / float(segments);
+					const float v = 6.2831853f * float(j) / float(segments);
+					positions.push_back((1.0f + 0.3f * std::cos(v)) * std::cos(u));
+					positions.push_back((1.0f + 0.3f * std::cos(v)) * std::sin(u));
+					positions.push_back(0.3f * std::sin(v));
+				}
+			}
+			vertex_count = size_t(segments) * segments;
+
+			std::vector<uint32_t> triangles;
+			for (uint32_t i = 0; i < segments; ++i)
+			{
+				for (uint32_t j = 0; j < segments; ++j)
+				{
+					const uint32_t a = i * segments + j;
+					const uint32_t b = ((i + 1) % segments) * segments + j;
+					const uint32_t c = ((i + 1) % segments) * segments + (j + 1) % segments;
+					const uint32_t d = i * segments + (j + 1) % segments;
+					triangles.insert(triangles.end(), { a, b, c, a, c, d });
+				}
+			}
+
+			std::vector<uint32_t> order(triangles.size() / 3);
+			for (uint32_t i = 0; i < order.size(); ++i)
+			{
+				order[i] = i;
+			}
+			std::shuffle(order.begin(), order.end(), std::mt19937(3));
+			for (uint32_t triangle : order)
+			{
+				indices.insert(indices.end(), triangles.begin() + triangle * 3, triangles.begin() + triangle * 3 + 3);
+			}
+		}
+
+		float Acmr(const std::vector<uint32_t>& order) const
+		{
+			return AnalyzeVertexCache(order.data(), order.size(), vertex_count).acmr;
+		}
+
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		size_t vertex_count = 0;
+	};
+
+	// Args: torus segments; 2 * segments^2 triangles
+	void Sizes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+	}
+
+	void SetTriangles(benchmark::State& state, const Mesh& mesh)
+	{
+		state.SetItemsProcessed(state.iterations() * int64_t(mesh.indices.size() / 3));
+		state.counters["triangles"] = double(mesh.indices.size() / 3);
+	}
+
+	void BM_AnalyzeVertexCache(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertex_count));
+		}
+		SetTriangles(state, mesh);
+	}
+	BENCHMARK(BM_AnalyzeVertexCache)->Apply(Sizes);
+
+	void BM_OptimizeVertexCache(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		std::vector<uint32_t> optimized(mesh.indices.size());
+		for (auto _ : state)
+		{
+			OptimizeVertexCache(optimized.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+			benchmark::ClobberMemory();
+		}
+		SetTriangles(state, mesh);
+		state.counters["acmr_before"] = mesh.Acmr(mesh.indices);
+		state.counters["acmr_after"] = mesh.Acmr(optimized);
+		state.counters["atvr_after"] = AnalyzeVertexCache(optimized.data(), optimized.size(), mesh.vertex_count).atvr;
+	}
+	BENCHMARK(BM_OptimizeVertexCache)->Apply(Sizes);
+
+	// Args: torus segments, threshold in hundredths
+	void BM_OptimizeOverdraw(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		const float threshold = float(state.range(1)) / 100.0f;
+		std::vector<uint32_t> cache_order(mesh.indices.size());
+		OptimizeVertexCache(cache_order.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+		std::vector<uint32_t> optimized(mesh.indices.size());
+		for (auto _ : state)
+		{
+			OptimizeOverdraw(optimized.data(), cache_order.data(), cache_order.size(), mesh.positions.data(), sizeof(float) * 3, mesh.vertex_count, threshold);
+			benchmark::ClobberMemory();
+		}
+		SetTriangles(state, mesh);
+		state.counters["acmr_before"] = mesh.Acmr(cache_order);
+		state.counters["acmr_after"] = mesh.Acmr(optimized);
+	}
+	BENCHMARK(BM_OptimizeOverdraw)->ArgsProduct({ { 64, 256, 1024 }, { 105, 150 } })->Unit(benchmark::kMillisecond);
+
+	void BM_OptimizeVertexFetch(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		std::vector<uint32_t> cache_order(mesh.indices.size());
+		OptimizeVertexCache(cache_order.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+		std::vector<uint32_t> indices(cache_order.size());
+		std::vector<float> vertices(mesh.positions.size());
+		for (auto _ : state)
+		{
+			// Rewrites the indices in place, so each run starts from the same order
+			std::copy(cache_order.begin(), cache_order.end(), indices.begin());
+			benchmark::DoNotOptimize(OptimizeVertexFetch(vertices.data(), indices.data(), indices.size(), mesh.positions.data(), mesh.vertex_count, sizeof(float) * 3));
+			benchmark::ClobberMemory();
+		}
+		SetTriangles(state, mesh);
+	}
+	BENCHMARK(BM_OptimizeVertexFetch)->Apply(Sizes);
+
+	void BM_BuildMeshlets(benchmark::State& state)
+	{
+		const Mesh mesh(uint32_t(state.range(0)));
+		std::vector<uint32_t> cache_order(mesh.indices.size());
+		OptimizeVertexCache(cache_order.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+		size_t meshlet_count = 0;
+		size_t meshlet_vertices = 0;
+		for (auto _ : state)
+		{
+			const MeshletMesh meshlets = BuildMeshlets(cache_order.data(), cache_order.size(), mesh.positions.data(), sizeof(float) * 3, mesh.vertex_count);
+			meshlet_count = meshlets.meshlets.size();
+			meshlet_vertices = meshlets.vertices.size();
+		}
+		SetTriangles(state, mesh);
+		state.counters["meshlets"] = double(meshlet_count);
+		// Vertices per triangle across meshlets; shared edges between meshlets duplicate vertices
+		state.counters["vertices_per_triangle"] = double(meshlet_vertices) / double(mesh.indices.size() / 3);
+	}
+	BENCHMARK(BM_BuildMeshlets)->Apply(Sizes);
+}
@@ -0,0 +1,68 @@
+#include "RenderGraph.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Each pass writes one new transient and reads a few recent ones, with the
+	// occasional long-lived read, like a frame of post-processing chains
+	void BuildGraph(RenderGraph& graph, uint32_t pass_count)
+	{
+		std::mt19937 rng(3);
+		const RenderGraph::ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+		std::vector<RenderGraph::ResourceId> transients;
+		for (uint32_t p = 0; p < pass_count; ++p)
+		{
+			const RenderGraph::PassId pass = graph.AddPass("pass " + std::to_string(p));
+			const uint32_t reads = transients.empty() ? 0 : 1 + rng() % 3;
+			for (uint32_t i = 0; i < reads; ++i)
+			{
+				const size_t back = rng() % 8 == 0 ? rng() % transients.size() : rng() % std::min<size_t>(transients.size(), 4);
+				graph.Read(pass, transients[transients.size() - 1 - back], RenderGraph::kPixelShaderResource);
+			}
+			const uint64_t size = (uint64_t(1) + rng() % 64) * 64 * 1024;
+			transients.push_back(graph.CreateTransient("t" + std::to_string(p), size, 64 * 1024));
+			graph.Write(pass, transients.back(), rng() % 2 ? RenderGraph::kRenderTarget : RenderGraph::kUnorderedAccess);
+			if (p + 1 == pass_count || rng() % 16 == 0)
+			{
+				graph.Write(pass, back_buffer, RenderGraph::kRenderTarget);
+			}
+		}
+	}
+
+	void BM_RenderGraphCompile(benchmark::State& state)
+	{
+		const uint32_t pass_count = static_cast<uint32_t>(state.range(0));
+		RenderGraph graph;
+		BuildGraph(graph, pass_count);
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(graph.Compile().barriers.data());
+		}
+
+		const RenderGraph::CompiledGraph& compiled = graph.GetCompiled();
+		state.SetItemsProcessed(state.iterations() * pass_count);
+		state.counters["heap_mb"] = static_cast<double>(compiled.transient_heap_size) / (1024.0 * 1024.0);
+		state.counters["barriers"] = static_cast<double>(compiled.barriers.size());
+	}
+	BENCHMARK(BM_RenderGraphCompile)->Arg(1000)->Arg(2000)->Arg(5000)->Arg(20000)->Unit(benchmark::kMillisecond);
+
+	// What a frame pays when the graph is rebuilt from scratch every time
+	void BM_RenderGraphRebuildAndCompile(benchmark::State& state)
+	{
+		const uint32_t pass_count = static_cast<uint32_t>(state.range(0));
+		RenderGraph graph;
+		for (auto _ : state)
+		{
+			graph.Reset();
+			BuildGraph(graph, pass_count);
+			benchmark::DoNotOptimize(graph.Compile().barriers.data());
+		}
+		state.SetItemsProcessed(state.iterations() * pass_count);
+	}
+	BENCHMARK(BM_RenderGraphRebuildAndCompile)->Arg(1000)->Arg(5000)->Unit(benchmark::kMillisecond);
+}
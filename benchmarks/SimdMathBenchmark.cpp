@@ -0,0 +1,317 @@
+#include "SimdMath.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// What the same code looks like with plain floats and no intrinsics, for
+	// comparison. Left to the compiler, which may auto-vectorize the loops.
+	struct NaiveVec3
+	{
+		float x, y, z;
+	};
+
+	struct NaiveQuat
+	{
+		float x, y, z, w;
+	};
+
+	struct NaiveMat4
+	{
+		float m[4][4];
+	};
+
+	NaiveVec3 NaiveTransformPoint(const NaiveVec3& p, const NaiveMat4& m)
+	{
+		return {
+			p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+			p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+			p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2]
+		};
+	}
+
+	NaiveMat4 NaiveMultiply(const NaiveMat4& a, const NaiveMat4& b)
+	{
+		NaiveMat4 result;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				result.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+			}
+		}
+		return result;
+	}
+
+	NaiveVec3 NaiveCross(const NaiveVec3& a, const NaiveVec3& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	NaiveVec3 NaiveNormalize(const NaiveVec3& a)
+	{
+		const float inverse_length = 1.0f / std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+		return { a.x * inverse_length, a.y * inverse_length, a.z * inverse_length };
+	}
+
+	// v + 2w(q x v) + 2(q x (q x v))
+	NaiveVec3 NaiveRotate(const NaiveVec3& v, const NaiveQuat& q)
+	{
+		const NaiveVec3 axis = { q.x, q.y, q.z };
+		const NaiveVec3 t = NaiveCross(axis, v);
+		const NaiveVec3 t2 = { 2.0f * t.x, 2.0f * t.y, 2.0f * t.z };
+		const NaiveVec3 u = NaiveCross(axis, t2);
+		return { v.x + q.w * t2.x + u.x, v.y + q.w * t2.y + u.y, v.z + q.w * t2.z + u.z };
+	}
+
+	constexpr size_t kCount = 4096;
+
+	struct Data
+	{
+		Data()
+		{
+			std::mt19937 random(5);
+			std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				const Vec3 v(value(random), value(random), value(random));
+				points.push_back(v);
+				naive_points.push_back({ v.x, v.y, v.z });
+			}
+			for (size_t i = 0; i < 256; ++i)
+			{
+				const Quat rotation = QuatFromAxisAngle(Normalize(Vec3(value(random), value(random), value(random))), value(random));
+				const Mat4 matrix = ComposeTransform(points[i], rotation, Vec3(1.5f));
+				matrices.push_back(matrix);
+				NaiveMat4 naive;
+				for (int r = 0; r < 4; ++r)
+				{
+					const float* row = &matrix.rows[r].x;
+					for (int c = 0; c < 4; ++c)
+					{
+						naive.m[r][c] = row[c];
+					}
+				}
+				naive_matrices.push_back(naive);
+				rotations.push_back(rotation);
+				naive_rotations.push_back({ rotation.x, rotation.y, rotation.z, rotation.w });
+			}
+		}
+
+		std::vector<Vec3> points;
+		std::vector<NaiveVec3> naive_points;
+		std::vector<Mat4> matrices;
+		std::vector<NaiveMat4> naive_matrices;
+		std::vector<Quat> rotations;
+		std::vector<NaiveQuat> naive_rotations;
+	};
+
+	const Data& GetData()
+	{
+		static const Data data;
+		return data;
+	}
+
+	// Matrix products, as in composing a hierarchy's world matrices
+
+	void BM_MatrixMultiply(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Mat4> results(data.matrices.size());
+		for (auto _ : state)
+		{
+			for (size_t i = 1; i < data.matrices.size(); ++i)
+			{
+				results[i] = data.matrices[i] * data.matrices[i - 1];
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(data.matrices.size() - 1));
+	}
+	BENCHMARK(BM_MatrixMultiply);
+
+	void BM_NaiveMatrixMultiply(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<NaiveMat4> results(data.naive_matrices.size());
+		for (auto _ : state)
+		{
+			for (size_t i = 1; i < data.naive_matrices.size(); ++i)
+			{
+				results[i] = NaiveMultiply(data.naive_matrices[i], data.naive_matrices[i - 1]);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(data.naive_matrices.size() - 1));
+	}
+	BENCHMARK(BM_NaiveMatrixMultiply);
+
+	void BM_MatrixInverse(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Mat4> results(data.matrices.size());
+		for (auto _ : state)
+		{
+			for (size_t i = 0; i < data.matrices.size(); ++i)
+			{
+				results[i] = Inverse(data.matrices[i]);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(data.matrices.size()));
+	}
+	BENCHMARK(BM_MatrixInverse);
+
+	// Points one at a time, then in Vec3x8 batches
+
+	void BM_TransformPoint(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		const Mat4& matrix = data.matrices[0];
+		std::vector<Vec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				results[i] = TransformPoint(data.points[i], matrix);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_TransformPoint);
+
+	void BM_TransformPointsBatched(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Vec3x8> batches(BatchCount(kCount));
+		PackVec3x8(batches.data(), data.points.data(), kCount);
+		std::vector<Vec3x8> results(batches.size());
+		for (auto _ : state)
+		{
+			TransformPoints(results.data(), batches.data(), batches.size(), data.matrices[0]);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_TransformPointsBatched);
+
+	void BM_NaiveTransformPoint(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		const NaiveMat4& matrix = data.naive_matrices[0];
+		std::vector<NaiveVec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				results[i] = NaiveTransformPoint(data.naive_points[i], matrix);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_NaiveTransformPoint);
+
+	// Small vector ops: a normal from neighbouring points, and a rotation
+
+	void BM_CrossNormalize(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Vec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 1; i < kCount; ++i)
+			{
+				results[i] = Normalize(Cross(data.points[i], data.points[i - 1]));
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount - 1));
+	}
+	BENCHMARK(BM_CrossNormalize);
+
+	void BM_NaiveCrossNormalize(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<NaiveVec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 1; i < kCount; ++i)
+			{
+				results[i] = NaiveNormalize(NaiveCross(data.naive_points[i], data.naive_points[i - 1]));
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount - 1));
+	}
+	BENCHMARK(BM_NaiveCrossNormalize);
+
+	void BM_QuatRotate(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Vec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				results[i] = Rotate(data.points[i], data.rotations[i % data.rotations.size()]);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_QuatRotate);
+
+	void BM_NaiveQuatRotate(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<NaiveVec3> results(kCount);
+		for (auto _ : state)
+		{
+			for (size_t i = 0; i < kCount; ++i)
+			{
+				results[i] = NaiveRotate(data.naive_points[i], data.naive_rotations[i % data.naive_rotations.size()]);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_NaiveQuatRotate);
+
+	// Bounds of a point cloud
+
+	void BM_ComputeBounds(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		std::vector<Vec3x8> batches(BatchCount(kCount));
+		PackVec3x8(batches.data(), data.points.data(), kCount);
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(ComputeBounds(batches.data(), kCount));
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_ComputeBounds);
+
+	void BM_NaiveComputeBounds(benchmark::State& state)
+	{
+		const Data& data = GetData();
+		for (auto _ : state)
+		{
+			NaiveVec3 low = { INFINITY, INFINITY, INFINITY };
+			NaiveVec3 high = { -INFINITY, -INFINITY, -INFINITY };
+			for (const NaiveVec3& p : data.naive_points)
+			{
+				low = { p.x < low.x ? p.x : low.x, p.y < low.y ? p.y : low.y, p.z < low.z ? p.z : low.z };
+				high = { p.x > high.x ? p.x : high.x, p.y > high.y ? p.y : high.y, p.z > high.z ? p.z : high.z };
+			}
+			benchmark::DoNotOptimize(low);
+			benchmark::DoNotOptimize(high);
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kCount));
+	}
+	BENCHMARK(BM_NaiveComputeBounds);
+}
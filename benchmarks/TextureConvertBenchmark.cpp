@@ -0,0 +1,113 @@
+#include "TextureConvert.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t kSize = 2048;
+
+	// A kSize x kSize RGBA8 image of noise and a destination of the same size
+	struct Images
+	{
+		Images()
+			:
+			src(size_t(kSize) * kSize * 4),
+			dest(src.size())
+		{
+			std::mt19937 random(1);
+			for (uint8_t& byte : src)
+			{
+				byte = static_cast<uint8_t>(random());
+			}
+		}
+
+		PixelConversion Conversion(uint32_t src_bytes_per_pixel)
+		{
+			PixelConversion conversion;
+			conversion.dest = dest.data();
+			conversion.dest_row_pitch = size_t(kSize) * 4;
+			conversion.src = src.data();
+			conversion.src_row_pitch = size_t(kSize) * src_bytes_per_pixel;
+			conversion.width = kSize;
+			conversion.height = kSize;
+			return conversion;
+		}
+
+		std::vector<uint8_t> src;
+		std::vector<uint8_t> dest;
+	};
+
+	// Args: PixelOp, SimdLevel
+	void Levels(benchmark::internal::Benchmark* benchmark)
+	{
+		for (int op = int(PixelOp::kSwapRedBlue); op <= int(PixelOp::kPremultiplyAlphaSrgb); ++op)
+		{
+			for (int level = int(SimdLevel::kScalar); level <= int(SimdLevel::kAvx2); ++level)
+			{
+				benchmark->Args({ op, level });
+			}
+		}
+	}
+
+	void BM_ConvertPixels(benchmark::State& state)
+	{
+		const auto op = static_cast<PixelOp>(state.range(0));
+		const auto level = static_cast<SimdLevel>(state.range(1));
+		if (ClampSimdLevel(level) != level)
+		{
+			state.SkipWithError("SIMD level not supported");
+			return;
+		}
+
+		Images images;
+		const PixelConversion conversion = images.Conversion(op == PixelOp::kExpandRgb ? 3 : 4);
+		for (auto _ : state)
+		{
+			ConvertPixels(conversion, op, nullptr, level);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * kSize * kSize);
+		state.SetBytesProcessed(state.iterations() * kSize * kSize * 4);
+	}
+	BENCHMARK(BM_ConvertPixels)->Apply(Levels);
+
+	// Args: srgb, SimdLevel. Items are source pixels.
+	void BM_DownsampleMip(benchmark::State& state)
+	{
+		const bool srgb = state.range(0) != 0;
+		const auto level = static_cast<SimdLevel>(state.range(1));
+		if (ClampSimdLevel(level) != level)
+		{
+			state.SkipWithError("SIMD level not supported");
+			return;
+		}
+
+		Images images;
+		PixelConversion conversion = images.Conversion(4);
+		conversion.dest_row_pitch /= 2;
+		for (auto _ : state)
+		{
+			DownsampleMip(conversion, srgb, nullptr, level);
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * kSize * kSize);
+		state.SetBytesProcessed(state.iterations() * kSize * kSize * 4);
+	}
+	BENCHMARK(BM_DownsampleMip)->ArgsProduct({ { 0, 1 }, { int(SimdLevel::kScalar), int(SimdLevel::kSse2), int(SimdLevel::kAvx2) } });
+
+	void BM_GenerateMipChain(benchmark::State& state)
+	{
+		const bool srgb = state.range(0) != 0;
+		Images images;
+		ThreadPool pool;
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(GenerateMipChain(images.src.data(), size_t(kSize) * 4, kSize, kSize, srgb, 0, &pool));
+		}
+		state.SetItemsProcessed(state.iterations() * kSize * kSize);
+		state.counters["threads"] = pool.GetThreadCount();
+	}
+	BENCHMARK(BM_GenerateMipChain)->Arg(0)->Arg(1)->UseRealTime();
+}
@@ -0,0 +1,67 @@
+#include "TlsfAllocator.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t kCapacity = 256ull * 1024 * 1024;
+	constexpr uint64_t kGranularity = 64 * 1024;
+
+	// Steady-state churn: 'live' allocations of 64 KB to 4 MB are kept, and
+	// each iteration frees a random one and allocates a replacement
+	void BM_TlsfChurn(benchmark::State& state)
+	{
+		const size_t live_count = static_cast<size_t>(state.range(0));
+		TlsfAllocator allocator(kCapacity, kGranularity);
+		std::mt19937 rng(42);
+		const auto random_size = [&rng]() { return kGranularity * (1 + rng() % 64); };
+
+		std::vector<TlsfAllocator::Allocation> live;
+		while (live.size() < live_count)
+		{
+			const auto allocation = allocator.Allocate(random_size(), kGranularity);
+			if (!allocation)
+			{
+				break;
+			}
+			live.push_back(*allocation);
+		}
+
+		std::vector<uint32_t> victims(4096);
+		std::vector<uint64_t> sizes(victims.size());
+		for (size_t i = 0; i < victims.size(); ++i)
+		{
+			victims[i] = static_cast<uint32_t>(rng() % live.size());
+			sizes[i] = random_size();
+		}
+
+		size_t failures = 0;
+		size_t step = 0;
+		for (auto _ : state)
+		{
+			const size_t i = step++ % victims.size();
+			TlsfAllocator::Allocation& slot = live[victims[i]];
+			if (slot.block != TlsfAllocator::kInvalidBlock)
+			{
+				allocator.Free(slot);
+			}
+			const auto allocation = allocator.Allocate(sizes[i], kGranularity);
+			if (allocation)
+			{
+				slot = *allocation;
+			}
+			else
+			{
+				slot = {};
+				++failures;
+			}
+		}
+
+		const TlsfAllocator::Statistics stats = allocator.GetStatistics();
+		state.SetItemsProcessed(state.iterations() * 2);
+		state.counters["fragmentation"] = stats.fragmentation;
+		state.counters["failed_allocations"] = static_cast<double>(failures);
+	}
+	BENCHMARK(BM_TlsfChurn)->Arg(16)->Arg(64)->Arg(128);
+}
@@ -0,0 +1,197 @@
+#include "TransformHierarchy.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t kNodeCount = 1000000;
+	constexpr uint32_t kRootCount = 100;
+
+	// kRootCount roots, every other node under a random earlier one: shallow
+	// and bushy near the roots, a few dozen levels at the deepest, like a
+	// scene of many small objects
+	std::vector<uint32_t> MakeParents()
+	{
+		std::mt19937 random(11);
+		std::vector<uint32_t> parents(kNodeCount, UINT32_MAX);
+		for (uint32_t i = kRootCount; i < kNodeCount; ++i)
+		{
+			parents[i] = std::uniform_int_distribution<uint32_t>(0, i - 1)(random);
+		}
+		return parents;
+	}
+
+	LocalTransform MakeLocal(uint32_t i)
+	{
+		LocalTransform local;
+		local.position = Vec3(float(i % 7), float(i % 5), float(i % 3));
+		local.rotation = QuatFromAxisAngle(Vec3(0.0f, 1.0f, 0.0f), float(i % 360) * 0.01f);
+		return local;
+	}
+
+	struct Scene
+	{
+		Scene()
+		{
+			const std::vector<uint32_t> parents = MakeParents();
+			hierarchy.Reserve(kNodeCount);
+			for (uint32_t i = 0; i < kNodeCount; ++i)
+			{
+				nodes.push_back(hierarchy.Create(parents[i] == UINT32_MAX ? TransformHandle() : nodes[parents[i]], MakeLocal(i)));
+			}
+			hierarchy.Update();
+		}
+
+		TransformHierarchy hierarchy;
+		std::vector<TransformHandle> nodes;
+	};
+
+	// Building 1M nodes takes a while, so the benchmarks share one scene
+	Scene& GetScene()
+	{
+		static Scene scene;
+		return scene;
+	}
+
+	// Arg: nodes moved per update, 0 for all of them. A moved node also
+	// rebuilds everything under it. Items are nodes walked.
+	void BM_TransformHierarchyUpdate(benchmark::State& state)
+	{
+		Scene& scene = GetScene();
+		const uint32_t moved = state.range(0) == 0 ? kNodeCount : uint32_t(state.range(0));
+		std::mt19937 random(12);
+		uint64_t updated = 0;
+		for (auto _ : state)
+		{
+			state.PauseTiming();
+			for (uint32_t i = 0; i < moved; ++i)
+			{
+				const uint32_t node = moved == kNodeCount ? i : std::uniform_int_distribution<uint32_t>(0, kNodeCount - 1)(random);
+				scene.hierarchy.SetLocalPosition(scene.nodes[node], Vec3(float(i % 11)));
+			}
+			state.ResumeTiming();
+
+			scene.hierarchy.Update();
+			updated += scene.hierarchy.GetUpdatedCount();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+		state.counters["updated_per_frame"] = double(updated) / double(state.iterations());
+	}
+	BENCHMARK(BM_TransformHierarchyUpdate)->Arg(0)->Arg(1000)->Arg(10)->Unit(benchmark::kMillisecond);
+
+	// Nothing moved: the cost of walking the flags
+	void BM_TransformHierarchyUpdateStatic(benchmark::State& state)
+	{
+		Scene& scene = GetScene();
+		scene.hierarchy.Update();
+		for (auto _ : state)
+		{
+			scene.hierarchy.Update();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+	}
+	BENCHMARK(BM_TransformHierarchyUpdateStatic)->Unit(benchmark::kMillisecond);
+
+	void BM_TransformHierarchyUpdateParallel(benchmark::State& state)
+	{
+		Scene& scene = GetScene();
+		ThreadPool pool;
+		for (auto _ : state)
+		{
+			state.PauseTiming();
+			for (uint32_t i = 0; i < kNodeCount; ++i)
+			{
+				scene.hierarchy.SetLocalPosition(scene.nodes[i], Vec3(float(i % 11)));
+			}
+			state.ResumeTiming();
+
+			scene.hierarchy.Update(&pool);
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+		state.counters["threads"] = pool.GetThreadCount();
+	}
+	BENCHMARK(BM_TransformHierarchyUpdateParallel)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+	// Reparenting a node forces the depth-first order to be rebuilt
+	void BM_TransformHierarchyRebuildOrder(benchmark::State& state)
+	{
+		Scene& scene = GetScene();
+		std::mt19937 random(13);
+		for (auto _ : state)
+		{
+			// A leaf-ish node moved under a root, so no cycle can form
+			const uint32_t node = std::uniform_int_distribution<uint32_t>(kNodeCount / 2, kNodeCount - 1)(random);
+			scene.hierarchy.SetParent(scene.nodes[node], scene.nodes[node % kRootCount]);
+			scene.hierarchy.Update();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+	}
+	BENCHMARK(BM_TransformHierarchyRebuildOrder)->Unit(benchmark::kMillisecond);
+
+	void BM_TransformHierarchyCreate(benchmark::State& state)
+	{
+		const std::vector<uint32_t> parents = MakeParents();
+		for (auto _ : state)
+		{
+			TransformHierarchy hierarchy;
+			std::vector<TransformHandle> nodes;
+			nodes.reserve(kNodeCount);
+			for (uint32_t i = 0; i < kNodeCount; ++i)
+			{
+				nodes.push_back(hierarchy.Create(parents[i] == UINT32_MAX ? TransformHandle() : nodes[parents[i]], MakeLocal(i)));
+			}
+			hierarchy.Update();
+			benchmark::DoNotOptimize(hierarchy.GetWorldMatrix(nodes.back()));
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+	}
+	BENCHMARK(BM_TransformHierarchyCreate)->Unit(benchmark::kMillisecond);
+
+	// The usual alternative for comparison: heap-allocated nodes with child
+	// lists, updated by a recursive walk that recomputes everything
+	struct PointerNode
+	{
+		LocalTransform local;
+		Mat4 world;
+		std::vector<PointerNode*> children;
+	};
+
+	void UpdatePointerNode(PointerNode& node, const Mat4& parent_world)
+	{
+		node.world = ComposeTransform(node.local.position, node.local.rotation, node.local.scale) * parent_world;
+		for (PointerNode* child : node.children)
+		{
+			UpdatePointerNode(*child, node.world);
+		}
+	}
+
+	void BM_TransformHierarchyPointerTreeUpdate(benchmark::State& state)
+	{
+		const std::vector<uint32_t> parents = MakeParents();
+		std::vector<std::unique_ptr<PointerNode>> nodes;
+		nodes.reserve(kNodeCount);
+		for (uint32_t i = 0; i < kNodeCount; ++i)
+		{
+			nodes.push_back(std::make_unique<PointerNode>());
+			nodes.back()->local = MakeLocal(i);
+			if (parents[i] != UINT32_MAX)
+			{
+				nodes[parents[i]]->children.push_back(nodes.back().get());
+			}
+		}
+
+		for (auto _ : state)
+		{
+			for (uint32_t i = 0; i < kRootCount; ++i)
+			{
+				UpdatePointerNode(*nodes[i], kIdentityMatrix);
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(kNodeCount));
+	}
+	BENCHMARK(BM_TransformHierarchyPointerTreeUpdate)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,192 @@
+#include "World.h"
+#include "ThreadPool.h"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	struct Health
+	{
+		float value;
+	};
+
+	struct Frozen
+	{
+		uint32_t ticks;
+	};
+
+	// Args: entity count. A quarter of the entities have no Velocity, so
+	// queries skip whole archetypes.
+	void Sizes(benchmark::internal::Benchmark* benchmark)
+	{
+		benchmark->Arg(10000)->Arg(100000)->Arg(1000000);
+	}
+
+	void Populate(World& world, uint32_t count, std::vector<Entity>* entities = nullptr)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Position position = { float(i), 0.0f, 0.0f };
+			const Entity entity = i % 4 == 0 ?
+				world.Create(position, Health{ 100.0f }) :
+				world.Create(position, Velocity{ 1.0f, 0.5f, 0.25f }, Health{ 100.0f });
+			if (entities)
+			{
+				entities->push_back(entity);
+			}
+		}
+	}
+
+	// Iteration
+
+	void BM_WorldForEach(benchmark::State& state)
+	{
+		World world;
+		Populate(world, uint32_t(state.range(0)));
+		for (auto _ : state)
+		{
+			world.ForEach<Position, const Velocity>([](Position& position, const Velocity& velocity)
+			{
+				position.x += velocity.x * 0.016f;
+				position.y += velocity.y * 0.016f;
+				position.z += velocity.z * 0.016f;
+			});
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0) * 3 / 4);
+	}
+	BENCHMARK(BM_WorldForEach)->Apply(Sizes);
+
+	// The same loop over a plain array of structs, as a floor
+	void BM_WorldArrayOfStructs(benchmark::State& state)
+	{
+		struct Object
+		{
+			Position position;
+			Velocity velocity;
+			Health health;
+		};
+		std::vector<Object> objects(size_t(state.range(0)) * 3 / 4, Object{ {}, { 1.0f, 0.5f, 0.25f }, { 100.0f } });
+		for (auto _ : state)
+		{
+			for (Object& object : objects)
+			{
+				object.position.x += object.velocity.x * 0.016f;
+				object.position.y += object.velocity.y * 0.016f;
+				object.position.z += object.velocity.z * 0.016f;
+			}
+			benchmark::ClobberMemory();
+		}
+		state.SetItemsProcessed(state.iterations() * int64_t(objects.size()));
+	}
+	BENCHMARK(BM_WorldArrayOfStructs)->Apply(Sizes);
+
+	// Three systems, the first two independent, the third after both
+	void BM_WorldRunSystems(benchmark::State& state)
+	{
+		World world;
+		Populate(world, uint32_t(state.range(0)));
+		world.AddSystem<Position, const Velocity>("move", [](Position& position, const Velocity& velocity)
+		{
+			position.x += velocity.x * 0.016f;
+			position.y += velocity.y * 0.016f;
+			position.z += velocity.z * 0.016f;
+		});
+		world.AddSystem<Health>("regenerate", [](Health& health)
+		{
+			health.value = health.value < 100.0f ? health.value + 0.1f : health.value;
+		});
+		world.AddSystem<const Position, Health>("damage", [](const Position& position, Health& health)
+		{
+			health.value -= position.y > 10.0f ? 1.0f : 0.0f;
+		});
+
+		ThreadPool pool;
+		ThreadPool* const used_pool = state.range(1) != 0 ? &pool : nullptr;
+		for (auto _ : state)
+		{
+			world.RunSystems(used_pool);
+		}
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+		state.counters["threads"] = used_pool ? used_pool->GetThreadCount() : 1;
+	}
+	BENCHMARK(BM_WorldRunSystems)->ArgsProduct({ { 100000, 1000000 }, { 0, 1 } })->UseRealTime();
+
+	// Structural changes
+
+	void BM_WorldCreateDestroy(benchmark::State& state)
+	{
+		const uint32_t count = uint32_t(state.range(0));
+		World world;
+		std::vector<Entity> entities;
+		entities.reserve(count);
+		for (auto _ : state)
+		{
+			entities.clear();
+			Populate(world, count, &entities);
+			for (const Entity entity : entities)
+			{
+				world.Destroy(entity);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+	BENCHMARK(BM_WorldCreateDestroy)->Apply(Sizes);
+
+	// Adding and removing a tag moves the entity between archetypes both ways
+	void BM_WorldAddRemoveComponent(benchmark::State& state)
+	{
+		const uint32_t count = uint32_t(state.range(0));
+		World world;
+		std::vector<Entity> entities;
+		Populate(world, count, &entities);
+		for (auto _ : state)
+		{
+			for (const Entity entity : entities)
+			{
+				world.Add(entity, Frozen{ 10 });
+			}
+			for (const Entity entity : entities)
+			{
+				world.Remove<Frozen>(entity);
+			}
+		}
+		state.SetItemsProcessed(state.iterations() * count * 2);
+	}
+	BENCHMARK(BM_WorldAddRemoveComponent)->Apply(Sizes);
+
+	// Random access by handle, as gameplay code looking up its targets does
+	void BM_WorldGet(benchmark::State& state)
+	{
+		const uint32_t count = uint32_t(state.range(0));
+		World world;
+		std::vector<Entity> entities;
+		Populate(world, count, &entities);
+		std::vector<Entity> lookups;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			lookups.push_back(entities[(uint64_t(i) * 2654435761u) % count]);
+		}
+		for (auto _ : state)
+		{
+			float total = 0.0f;
+			for (const Entity entity : lookups)
+			{
+				total += world.Get<Health>(entity)->value;
+			}
+			benchmark::DoNotOptimize(total);
+		}
+		state.SetItemsProcessed(state.iterations() * count);
+	}
+	BENCHMARK(BM_WorldGet)->Apply(Sizes);
+}
@@ -1,6 +1,57 @@
 #include "Window.h"
 #include "App.h"
 
+namespace
+{
+	// Turns the sorted draws into command list calls. Root constant 0 is the
+	// material index and 1 the instance index, which shaders use to read
+	// their data from the bindless heap.
+	class CommandListSubmitter : public DrawSubmitter
+	{
+	public:
+		CommandListSubmitter(
+			ID3D12GraphicsCommandList* command_list,
+			const std::vector<ID3D12PipelineState*>& pipelines,
+			const std::vector<App::MeshBuffers>& meshes)
+			:
+			command_list_(command_list),
+			pipelines_(pipelines),
+			meshes_(meshes)
+		{
+		}
+
+		// All passes draw to the back buffer within the one graph pass
+		void SetPass(uint32_t) override
+		{
+		}
+		void SetPipeline(uint32_t pipeline) override
+		{
+			command_list_->SetPipelineState(pipelines_[pipeline]);
+		}
+		void SetMaterial(uint32_t material) override
+		{
+			command_list_->SetGraphicsRoot32BitConstant(BindlessHeap::kRootConstantsParameter, material, 0);
+		}
+		void SetMesh(uint32_t mesh) override
+		{
+			const App::MeshBuffers& buffers = meshes_[mesh];
+			command_list_->IASetVertexBuffers(0, 1, &buffers.vertices);
+			command_list_->IASetIndexBuffer(&buffers.indices);
+			index_count_ = buffers.index_count;
+		}
+		void Draw(uint32_t instance) override
+		{
+			command_list_->SetGraphicsRoot32BitConstant(BindlessHeap::kRootConstantsParameter, instance, 1);
+			command_list_->DrawIndexedInstanced(index_count_, 1, 0, 0, 0);
+		}
+	private:
+		ID3D12GraphicsCommandList* command_list_;
+		const std::vector<ID3D12PipelineState*>& pipelines_;
+		const std::vector<App::MeshBuffers>& meshes_;
+		UINT index_count_ = 0;
+	};
+}
+
 App::App(Window& window)
 	:
 	window_(window),
@@ -10,17 +61,66 @@ App::App(Window& window)
 
 void App::Run()
 {
+	// Nothing to present to; don't spin on the waitable object either
+	if (window_.IsMinimized())
+	{
+		Sleep(10);
+		return;
+	}
+
+	if (const auto size = window_.ConsumeResize())
+	{
+		gfx_.Resize(static_cast<UINT>(size->first), static_cast<UINT>(size->second));
+	}
+
+	gfx_.BeginFrame();
 	UpdateLogic();
 	ComposeFrame();
-	
+	gfx_.EndFrame();
 }
 
 void App::UpdateLogic()
 {
+	Profiler::CpuScope scope(gfx_.GetProfiler(), "UpdateLogic");
 
+	// Game logic lives in the world's systems and moves scene nodes; world
+	// matrices are settled last
+	world_.RunSystems(&gfx_.GetThreadPool());
+	scene_.Update(&gfx_.GetThreadPool());
 }
 
 void App::ComposeFrame()
 {
-	
+	Profiler::CpuScope scope(gfx_.GetProfiler(), "ComposeFrame");
+
+	// No camera yet, so every draw sits in depth bucket 0 and is ordered by
+	// state alone
+	draw_queue_.Reset();
+	world_.ForEach<const Renderable>([this](const Renderable& renderable)
+	{
+		draw_queue_.Push(
+			DrawKey::Make(renderable.pass, 0, renderable.pipeline, renderable.material, renderable.mesh),
+			renderable.instance);
+	});
+	if (draw_queue_.GetCount() == 0)
+	{
+		return;
+	}
+	draw_queue_.Sort(&gfx_.GetThreadPool());
+
+	RenderGraph& graph = gfx_.GetRenderGraph();
+	const RenderGraph::PassId pass = graph.AddPass("Draws", [this](RenderGraphContext& context)
+	{
+		ID3D12GraphicsCommandList* command_list = context.GetCommandList();
+		const D3D12_CPU_DESCRIPTOR_HANDLE back_buffer = gfx_.CurrentBackBufferView();
+		const D3D12_CPU_DESCRIPTOR_HANDLE depth_stencil = gfx_.DepthStencilView();
+		command_list->OMSetRenderTargets(1, &back_buffer, FALSE, &depth_stencil);
+		gfx_.GetBindlessHeap().Bind(command_list);
+		command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		CommandListSubmitter submitter(command_list, pipelines_, meshes_);
+		draw_queue_.Submit(submitter);
+	});
+	graph.Write(pass, gfx_.GetBackBufferId(), RenderGraph::kRenderTarget);
+	graph.Write(pass, gfx_.GetDepthStencilId(), RenderGraph::kDepthWrite);
 }
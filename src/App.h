@@ -1,7 +1,11 @@
 #ifndef APP_H
 #define APP_H
 
+#include "DrawQueue.h"
 #include "Graphics.h"
+#include "TransformHierarchy.h"
+#include "World.h"
+#include <vector>
 
 class App
 {
@@ -9,12 +13,35 @@ public:
 	App(class Window& window);
 	
 	void Run();
+public:
+	// World component for anything drawn; the indices are into pipelines_,
+	// meshes_ and the material table, instance is passed to the shader as is
+	struct Renderable
+	{
+		uint32_t pass = 0;
+		uint32_t pipeline = 0;
+		uint32_t material = 0;
+		uint32_t mesh = 0;
+		uint32_t instance = 0;
+	};
+	struct MeshBuffers
+	{
+		D3D12_VERTEX_BUFFER_VIEW vertices{};
+		D3D12_INDEX_BUFFER_VIEW indices{};
+		UINT index_count = 0;
+	};
 private:
 	void UpdateLogic();
 	void ComposeFrame();
 private:
 	Window& window_;
 	Graphics gfx_;
+	World world_;
+	TransformHierarchy scene_;
+	DrawQueue draw_queue_;
+	// Owned by the PipelineStateCache
+	std::vector<ID3D12PipelineState*> pipelines_;
+	std::vector<MeshBuffers> meshes_;
 };
 
 #endif // !APP_H
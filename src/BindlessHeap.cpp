@@ -0,0 +1,197 @@
+#include "BindlessHeap.h"
+#include "RootSignatureCache.h"
+#include "ThrowIfFailed.h"
+#include "DirectX12/d3dx12.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Descriptors per table the binding tier allows, UINT_MAX for unbounded
+	UINT MaxSrvRange(D3D12_RESOURCE_BINDING_TIER binding_tier)
+	{
+		return binding_tier == D3D12_RESOURCE_BINDING_TIER_1 ? 128 : UINT_MAX;
+	}
+
+	UINT MaxUavRange(D3D12_RESOURCE_BINDING_TIER binding_tier, D3D_FEATURE_LEVEL feature_level)
+	{
+		if (binding_tier >= D3D12_RESOURCE_BINDING_TIER_3)
+		{
+			return UINT_MAX;
+		}
+		return binding_tier == D3D12_RESOURCE_BINDING_TIER_1 && feature_level < D3D_FEATURE_LEVEL_11_1 ? 8 : 64;
+	}
+
+	// Kept for UAVs; at most half the heap, so other views always have room
+	UINT UavSlotCount(D3D12_RESOURCE_BINDING_TIER binding_tier, D3D_FEATURE_LEVEL feature_level, UINT capacity)
+	{
+		const UINT max_uavs = MaxUavRange(binding_tier, feature_level);
+		return max_uavs == UINT_MAX ? 0 : std::min(max_uavs, capacity / 2);
+	}
+}
+
+BindlessHeap::BindlessHeap(
+	ID3D12Device* device,
+	RootSignatureCache& root_signatures,
+	D3D12_RESOURCE_BINDING_TIER binding_tier,
+	D3D_FEATURE_LEVEL feature_level,
+	UINT capacity)
+	:
+	device_(device),
+	capacity_(std::min(capacity, MaxSrvRange(binding_tier))),
+	uav_slot_count_(UavSlotCount(binding_tier, feature_level, capacity_)),
+	indices_(capacity_ - uav_slot_count_),
+	descriptor_size_(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV))
+{
+	if (uav_slot_count_ > 0)
+	{
+		uav_indices_.emplace(uav_slot_count_);
+	}
+
+	D3D12_DESCRIPTOR_HEAP_DESC heap_desc{};
+	heap_desc.NumDescriptors = capacity_;
+	heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	heap_desc.NodeMask = 0;
+	ThrowIfFailed(device_->CreateDescriptorHeap(&heap_desc, IID_PPV_ARGS(heap_.GetAddressOf())));
+
+	cpu_start_ = heap_->GetCPUDescriptorHandleForHeapStart();
+	gpu_start_ = heap_->GetGPUDescriptorHandleForHeapStart();
+
+	// Bounded ranges must not run past the end of the heap
+	const UINT srv_range_size = MaxSrvRange(binding_tier) == UINT_MAX ? UINT_MAX : capacity_;
+	const UINT uav_range_size = uav_slot_count_ > 0 ? uav_slot_count_ : UINT_MAX;
+	CreateRootSignature(root_signatures, srv_range_size, uav_range_size);
+}
+
+BindlessHeap::Handle BindlessHeap::CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc)
+{
+	const Handle handle = ToHeapHandle(indices_.Allocate());
+	if (!handle.IsNull())
+	{
+		device_->CreateShaderResourceView(resource, desc, GetCpuHandle(handle));
+	}
+	return handle;
+}
+
+BindlessHeap::Handle BindlessHeap::CreateUnorderedAccessView(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc)
+{
+	const Handle handle = uav_indices_ ? uav_indices_->Allocate() : ToHeapHandle(indices_.Allocate());
+	if (!handle.IsNull())
+	{
+		device_->CreateUnorderedAccessView(resource, nullptr, desc, GetCpuHandle(handle));
+	}
+	return handle;
+}
+
+void BindlessHeap::Free(Handle handle)
+{
+	if (IsUavSlot(handle))
+	{
+		uav_indices_->Free(handle);
+	}
+	else
+	{
+		indices_.Free(ToAllocatorHandle(handle));
+	}
+}
+
+bool BindlessHeap::IsValid(Handle handle) const
+{
+	return IsUavSlot(handle) ? uav_indices_->IsValid(handle) : indices_.IsValid(ToAllocatorHandle(handle));
+}
+
+void BindlessHeap::Bind(ID3D12GraphicsCommandList* command_list) const
+{
+	ID3D12DescriptorHeap* heaps[] = { heap_.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+	command_list->SetGraphicsRootSignature(root_signature_);
+	command_list->SetGraphicsRootDescriptorTable(kSrvTableParameter, gpu_start_);
+	command_list->SetGraphicsRootDescriptorTable(kUavTableParameter, gpu_start_);
+}
+
+ID3D12RootSignature* BindlessHeap::GetRootSignature() const
+{
+	return root_signature_;
+}
+
+uint64_t BindlessHeap::GetRootSignatureHash() const
+{
+	return root_signature_hash_;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessHeap::GetCpuHandle(Handle handle) const
+{
+	assert(IsValid(handle) && "Stale bindless handle.");
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(cpu_start_, static_cast<INT>(handle.Index()), descriptor_size_);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessHeap::GetGpuHandle(Handle handle) const
+{
+	assert(IsValid(handle) && "Stale bindless handle.");
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(gpu_start_, static_cast<INT>(handle.Index()), descriptor_size_);
+}
+
+UINT BindlessHeap::GetCapacity() const
+{
+	return capacity_;
+}
+
+UINT BindlessHeap::GetUavCapacity() const
+{
+	return uav_slot_count_ > 0 ? uav_slot_count_ : capacity_;
+}
+
+void BindlessHeap::CreateRootSignature(RootSignatureCache& root_signatures, UINT srv_range_size, UINT uav_range_size)
+{
+	// Slots may be empty or rewritten between frames, so the ranges can't
+	// promise static descriptors or data
+	const D3D12_DESCRIPTOR_RANGE_FLAGS range_flags =
+		D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+
+	const CD3DX12_DESCRIPTOR_RANGE1 srv_range(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, srv_range_size, 0, 1, range_flags, 0);
+	const CD3DX12_DESCRIPTOR_RANGE1 uav_range(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, uav_range_size, 0, 2, range_flags, 0);
+
+	CD3DX12_ROOT_PARAMETER1 parameters[3];
+	parameters[kRootConstantsParameter].InitAsConstants(kRootConstantCount, 0, 0);
+	parameters[kSrvTableParameter].InitAsDescriptorTable(1, &srv_range);
+	parameters[kUavTableParameter].InitAsDescriptorTable(1, &uav_range);
+
+	const CD3DX12_STATIC_SAMPLER_DESC samplers[] =
+	{
+		CD3DX12_STATIC_SAMPLER_DESC(0, D3D12_FILTER_MIN_MAG_MIP_POINT, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP),
+		CD3DX12_STATIC_SAMPLER_DESC(1, D3D12_FILTER_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP),
+		CD3DX12_STATIC_SAMPLER_DESC(2, D3D12_FILTER_ANISOTROPIC, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP, D3D12_TEXTURE_ADDRESS_MODE_WRAP)
+	};
+
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+	desc.Init_1_1(
+		_countof(parameters), parameters,
+		_countof(samplers), samplers,
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+	root_signature_ = root_signatures.GetOrCreate(desc, &root_signature_hash_);
+}
+
+BindlessHeap::Handle BindlessHeap::ToHeapHandle(Handle handle) const
+{
+	if (!handle.IsNull())
+	{
+		handle.value += uav_slot_count_;
+	}
+	return handle;
+}
+
+BindlessHeap::Handle BindlessHeap::ToAllocatorHandle(Handle handle) const
+{
+	if (!handle.IsNull())
+	{
+		handle.value -= uav_slot_count_;
+	}
+	return handle;
+}
+
+bool BindlessHeap::IsUavSlot(Handle handle) const
+{
+	return !handle.IsNull() && handle.Index() < uav_slot_count_;
+}
@@ -0,0 +1,92 @@
+#ifndef BINDLESS_HEAP_H
+#define BINDLESS_HEAP_H
+
+#include "LeanWin32.h"
+#include "DescriptorIndexAllocator.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <optional>
+
+using namespace Microsoft::WRL;
+
+class RootSignatureCache;
+
+// One large shader-visible CBV/SRV/UAV heap shared by every draw. Resources get
+// a stable slot for their whole lifetime and shaders index the heap with it, so
+// materials store 32-bit indices instead of binding descriptor tables per draw.
+//
+// The global root signature is laid out as:
+//   0: kRootConstantCount 32-bit constants at b0, space0 (per-draw indices)
+//   1: SRV table, t0 space1  -> Texture2D textures[] : register(t0, space1)
+//   2: UAV table, u0 space2  -> RWTexture2D rw_textures[] : register(u0, space2)
+// Both tables start at the beginning of the heap, so slot N is visible as
+// textures[N] or rw_textures[N] depending on the view written to it.
+//
+// How much of the heap the tables reach depends on the resource binding tier:
+//   tier 3   both tables unbounded
+//   tier 2   SRVs unbounded, 64 UAVs
+//   tier 1   128 SRVs, 64 UAVs (8 below feature level 11.1)
+// The heap is cut down to what the SRV table reaches, and when the UAV table
+// is bounded its slots are kept for UAVs, so every handle is visible to
+// shaders. There is no CBV table: below tier 3 it could only reach 14 slots,
+// so constant data goes through the root constants or root CBVs instead.
+class BindlessHeap
+{
+public:
+	using Handle = DescriptorIndexAllocator::Handle;
+public:
+	BindlessHeap(
+		ID3D12Device* device,
+		RootSignatureCache& root_signatures,
+		D3D12_RESOURCE_BINDING_TIER binding_tier,
+		D3D_FEATURE_LEVEL feature_level,
+		UINT capacity = kDefaultCapacity);
+	BindlessHeap(const BindlessHeap&) = delete;
+	BindlessHeap& operator=(const BindlessHeap&) = delete;
+
+	// Null handle when the heap is full
+	Handle CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc);
+	Handle CreateUnorderedAccessView(ID3D12Resource* resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* desc);
+	// Only call once the GPU is done with the slot (see Graphics::ReleaseDescriptor)
+	void Free(Handle handle);
+	bool IsValid(Handle handle) const;
+
+	// Sets the heap, the global root signature and both tables
+	void Bind(ID3D12GraphicsCommandList* command_list) const;
+
+	ID3D12RootSignature* GetRootSignature() const;
+	uint64_t GetRootSignatureHash() const;
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(Handle handle) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(Handle handle) const;
+	// Slots shaders can reach through each table
+	UINT GetCapacity() const;
+	UINT GetUavCapacity() const;
+public:
+	static constexpr UINT kDefaultCapacity = 65536;
+	static constexpr UINT kRootConstantCount = 16;
+	static constexpr UINT kRootConstantsParameter = 0;
+	static constexpr UINT kSrvTableParameter = 1;
+	static constexpr UINT kUavTableParameter = 2;
+private:
+	void CreateRootSignature(RootSignatureCache& root_signatures, UINT srv_range_size, UINT uav_range_size);
+	// Handles from uav_indices_ are heap slots as they are; those from
+	// indices_ are shifted past the UAV slots
+	Handle ToHeapHandle(Handle handle) const;
+	Handle ToAllocatorHandle(Handle handle) const;
+	bool IsUavSlot(Handle handle) const;
+private:
+	ID3D12Device* device_;
+	ComPtr<ID3D12DescriptorHeap> heap_;
+	ID3D12RootSignature* root_signature_ = nullptr;	// Owned by the RootSignatureCache
+	uint64_t root_signature_hash_ = 0;
+	UINT capacity_;
+	UINT uav_slot_count_;	// Slots kept for UAVs, 0 when the UAV table reaches the whole heap
+	DescriptorIndexAllocator indices_;
+	std::optional<DescriptorIndexAllocator> uav_indices_;
+	UINT descriptor_size_;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpu_start_;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpu_start_;
+};
+
+#endif // !BINDLESS_HEAP_H
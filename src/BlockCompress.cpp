@@ -0,0 +1,926 @@
+#include "BlockCompress.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if SIMD_X86
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Blocks per ParallelFor chunk, at the least
+	constexpr uint32_t kParallelGrainBlocks = 256;
+
+	constexpr int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct Block
+	{
+		float pixels[16][4];
+	};
+
+	void LoadBlock(const uint8_t* src, size_t pitch, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint8_t* row = src + pitch * std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* pixel = row + size_t(std::min(bx * 4 + x, width - 1)) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					block.pixels[y * 4 + x][c] = pixel[c];
+				}
+			}
+		}
+	}
+
+	inline int Clamp(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	// Least-squares line through 'count' points of N channels: their mean and
+	// the direction of largest variance (power iteration on the covariance)
+	template<int N>
+	void FitLine(const float (*points)[4], const int* selected, int count, float (&mean)[4], float (&axis)[4])
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			mean[c] = 0.0f;
+			axis[c] = 0.0f;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			for (int c = 0; c < N; ++c)
+			{
+				mean[c] += points[selected[i]][c];
+			}
+		}
+		for (int c = 0; c < N; ++c)
+		{
+			mean[c] /= static_cast<float>(count);
+		}
+
+		float covariance[N][N] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			float d[N];
+			for (int c = 0; c < N; ++c)
+			{
+				d[c] = points[selected[i]][c] - mean[c];
+			}
+			for (int a = 0; a < N; ++a)
+			{
+				for (int b = 0; b < N; ++b)
+				{
+					covariance[a][b] += d[a] * d[b];
+				}
+			}
+		}
+
+		// Start from the row of the most varying channel, it's rarely far off
+		int start = 0;
+		for (int c = 1; c < N; ++c)
+		{
+			if (covariance[c][c] > covariance[start][start])
+			{
+				start = c;
+			}
+		}
+		if (covariance[start][start] <= 0.0f)
+		{
+			return;
+		}
+		for (int c = 0; c < N; ++c)
+		{
+			axis[c] = covariance[start][c];
+		}
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[N] = {};
+			float largest = 0.0f;
+			for (int a = 0; a < N; ++a)
+			{
+				for (int b = 0; b < N; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				largest = std::max(largest, std::fabs(next[a]));
+			}
+			if (largest == 0.0f)
+			{
+				break;
+			}
+			for (int c = 0; c < N; ++c)
+			{
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < N; ++c)
+		{
+			length += axis[c] * axis[c];
+		}
+		length = std::sqrt(length);
+		for (int c = 0; c < N; ++c)
+		{
+			axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+		}
+	}
+
+	// Endpoints spanning the points' projections onto the fitted line
+	template<int N>
+	void PrincipalEndpoints(const float (*points)[4], const int* selected, int count, float (&e0)[4], float (&e1)[4])
+	{
+		float mean[4];
+		float axis[4];
+		FitLine<N>(points, selected, count, mean, axis);
+
+		float low = 0.0f;
+		float high = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < N; ++c)
+			{
+				t += (points[selected[i]][c] - mean[c]) * axis[c];
+			}
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + low * axis[c], 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + high * axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	// Per-channel bounding box, with channels that fall while the widest one
+	// rises swapped so the box diagonal follows the colors
+	template<int N>
+	void BoxEndpoints(const float (*points)[4], const int* selected, int count, float (&e0)[4], float (&e1)[4])
+	{
+		float mean[4] = {};
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = 255.0f;
+			e1[c] = 0.0f;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			for (int c = 0; c < N; ++c)
+			{
+				e0[c] = std::min(e0[c], points[selected[i]][c]);
+				e1[c] = std::max(e1[c], points[selected[i]][c]);
+				mean[c] += points[selected[i]][c] / static_cast<float>(count);
+			}
+		}
+
+		int widest = 0;
+		for (int c = 1; c < N; ++c)
+		{
+			if (e1[c] - e0[c] > e1[widest] - e0[widest])
+			{
+				widest = c;
+			}
+		}
+		for (int c = 0; c < N; ++c)
+		{
+			float correlation = 0.0f;
+			for (int i = 0; i < count; ++i)
+			{
+				correlation += (points[selected[i]][widest] - mean[widest]) * (points[selected[i]][c] - mean[c]);
+			}
+			if (correlation < 0.0f)
+			{
+				std::swap(e0[c], e1[c]);
+			}
+		}
+	}
+
+	// Solves for the endpoints that best reproduce the points given each
+	// point's interpolation weight toward e1. False if the system is singular.
+	template<int N>
+	bool RefineEndpoints(const float (*points)[4], const int* selected, int count, const float* weights, float (&e0)[4], float (&e1)[4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			const float w = weights[i];
+			const float v = 1.0f - w;
+			aa += v * v;
+			ab += v * w;
+			bb += w * w;
+			for (int c = 0; c < N; ++c)
+			{
+				ax[c] += v * points[selected[i]][c];
+				bx[c] += w * points[selected[i]][c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		const float inverse = 1.0f / determinant;
+		for (int c = 0; c < N; ++c)
+		{
+			e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) * inverse, 0.0f, 255.0f);
+			e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) * inverse, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// Nearest of 'palette_size' RGB palette entries for each point; returns the
+	// summed squared error. Values are whole numbers, so float sums are exact
+	// and both versions pick the same entries.
+	int NearestColors(const float (*points)[4], const int* selected, int count, const int (*palette)[3], int palette_size, uint8_t* indices)
+	{
+		int error = 0;
+		int i = 0;
+#if SIMD_X86
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 r = _mm_setr_ps(points[selected[i]][0], points[selected[i + 1]][0], points[selected[i + 2]][0], points[selected[i + 3]][0]);
+			const __m128 g = _mm_setr_ps(points[selected[i]][1], points[selected[i + 1]][1], points[selected[i + 2]][1], points[selected[i + 3]][1]);
+			const __m128 b = _mm_setr_ps(points[selected[i]][2], points[selected[i + 1]][2], points[selected[i + 2]][2], points[selected[i + 3]][2]);
+
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128 best_index = _mm_setzero_ps();
+			for (int k = 0; k < palette_size; ++k)
+			{
+				const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(static_cast<float>(palette[k][0])));
+				const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(static_cast<float>(palette[k][1])));
+				const __m128 db = _mm_sub_ps(b, _mm_set1_ps(static_cast<float>(palette[k][2])));
+				const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				const __m128 closer = _mm_cmplt_ps(d, best);
+				best = _mm_min_ps(d, best);
+				best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, best_index));
+			}
+
+			alignas(16) float distances[4];
+			alignas(16) float nearest[4];
+			_mm_store_ps(distances, best);
+			_mm_store_ps(nearest, best_index);
+			for (int j = 0; j < 4; ++j)
+			{
+				indices[i + j] = static_cast<uint8_t>(nearest[j]);
+				error += static_cast<int>(distances[j]);
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			int best = INT32_MAX;
+			for (int k = 0; k < palette_size; ++k)
+			{
+				int d = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					const int delta = static_cast<int>(points[selected[i]][c]) - palette[k][c];
+					d += delta * delta;
+				}
+				if (d < best)
+				{
+					best = d;
+					indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	// BC1 / BC3 color
+
+	uint16_t To565(const float (&color)[4])
+	{
+		const int r = Clamp(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)), 0, 31);
+		const int g = Clamp(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)), 0, 63);
+		const int b = Clamp(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void From565(uint16_t value, int (&color)[3])
+	{
+		const int r = value >> 11;
+		const int g = (value >> 5) & 63;
+		const int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	struct ColorBlock
+	{
+		uint16_t c0 = 0;
+		uint16_t c1 = 0;
+		uint8_t indices[16] = {};	// Per selected point
+		int error = INT32_MAX;
+	};
+
+	// Quantizes the endpoints and picks indices. 4-color blocks need c0 > c1
+	// (unless BC3, which always decodes 4 colors), 3-color blocks c0 <= c1.
+	ColorBlock EvaluateColors(const Block& block, const int* selected, int count, const float (&e0)[4], const float (&e1)[4], bool three_color)
+	{
+		ColorBlock result;
+		result.c0 = To565(e0);
+		result.c1 = To565(e1);
+		if (three_color ? result.c0 > result.c1 : result.c0 < result.c1)
+		{
+			std::swap(result.c0, result.c1);
+		}
+
+		int palette[4][3];
+		From565(result.c0, palette[0]);
+		From565(result.c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			if (three_color)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+			}
+			else
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+		}
+
+		result.error = NearestColors(block.pixels, selected, count, palette, three_color ? 3 : 4, result.indices);
+		return result;
+	}
+
+	void ColorWeights(const ColorBlock& colors, int count, bool three_color, float* weights)
+	{
+		static constexpr float kFourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static constexpr float kThreeColorWeights[3] = { 0.0f, 1.0f, 0.5f };
+		for (int i = 0; i < count; ++i)
+		{
+			weights[i] = three_color ? kThreeColorWeights[colors.indices[i]] : kFourColorWeights[colors.indices[i]];
+		}
+	}
+
+	ColorBlock FitColors(const Block& block, const int* selected, int count, BlockQuality quality, bool three_color)
+	{
+		float e0[4];
+		float e1[4];
+		if (quality == BlockQuality::kFast)
+		{
+			BoxEndpoints<3>(block.pixels, selected, count, e0, e1);
+		}
+		else
+		{
+			PrincipalEndpoints<3>(block.pixels, selected, count, e0, e1);
+		}
+
+		ColorBlock best = EvaluateColors(block, selected, count, e0, e1, three_color);
+		const int refinements = quality == BlockQuality::kFast ? 0 : (quality == BlockQuality::kNormal ? 1 : 4);
+		for (int i = 0; i < refinements && best.error > 0; ++i)
+		{
+			float weights[16];
+			ColorWeights(best, count, three_color, weights);
+			if (!RefineEndpoints<3>(block.pixels, selected, count, weights, e0, e1))
+			{
+				break;
+			}
+			const ColorBlock refined = EvaluateColors(block, selected, count, e0, e1, three_color);
+			if (refined.error >= best.error)
+			{
+				break;
+			}
+			best = refined;
+		}
+		return best;
+	}
+
+	uint64_t PackColorBlock(const ColorBlock& colors, const int* selected, int count, uint32_t fill_index)
+	{
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= fill_index << (i * 2);
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			bits &= ~(3u << (selected[i] * 2));
+			bits |= uint32_t(colors.indices[i]) << (selected[i] * 2);
+		}
+		return uint64_t(colors.c0) | (uint64_t(colors.c1) << 16) | (uint64_t(bits) << 32);
+	}
+
+	uint64_t EncodeColor(const Block& block, BlockQuality quality, bool punch_through)
+	{
+		int selected[16];
+		int count = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (!punch_through || block.pixels[i][3] >= 128.0f)
+			{
+				selected[count++] = i;
+			}
+		}
+
+		// Fully transparent: 3-color mode with every index on transparent black
+		if (count == 0)
+		{
+			return 0xffffffff00000000ull;
+		}
+
+		// Transparent pixels need the 3-color mode's fourth entry
+		const bool needs_three_color = count < 16;
+		ColorBlock best = FitColors(block, selected, count, quality, needs_three_color);
+		bool three_color = needs_three_color;
+		if (punch_through && !needs_three_color && quality == BlockQuality::kHigh && best.error > 0)
+		{
+			const ColorBlock alternative = FitColors(block, selected, count, quality, true);
+			if (alternative.error < best.error)
+			{
+				best = alternative;
+				three_color = true;
+			}
+		}
+
+		// 4-color with equal endpoints would decode as 3-color; index 0 is
+		// the same color either way
+		if (!three_color && best.c0 == best.c1)
+		{
+			std::fill(std::begin(best.indices), std::end(best.indices), uint8_t(0));
+		}
+		return PackColorBlock(best, selected, count, 3);
+	}
+
+	// BC4 (one channel; BC3 alpha and both halves of BC5)
+
+	int Bc4Palette(int a0, int a1, int (&palette)[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; ++i)
+			{
+				palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; ++i)
+			{
+				palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		return 8;
+	}
+
+	int EvaluateBc4(const int (&values)[16], int a0, int a1, uint8_t (&indices)[16])
+	{
+		int palette[8];
+		Bc4Palette(a0, a1, palette);
+		int error = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = INT32_MAX;
+			for (int k = 0; k < 8; ++k)
+			{
+				const int d = (values[i] - palette[k]) * (values[i] - palette[k]);
+				if (d < best)
+				{
+					best = d;
+					indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			error += best;
+		}
+		return error;
+	}
+
+	uint64_t EncodeBc4(const int (&values)[16], BlockQuality quality)
+	{
+		int low = 255;
+		int high = 0;
+		int inner_low = 255;	// Ignoring 0 and 255, which the 6-value mode has for free
+		int inner_high = 0;
+		for (int v : values)
+		{
+			low = std::min(low, v);
+			high = std::max(high, v);
+			if (v != 0 && v != 255)
+			{
+				inner_low = std::min(inner_low, v);
+				inner_high = std::max(inner_high, v);
+			}
+		}
+		if (low == high)
+		{
+			return uint64_t(low) | (uint64_t(low) << 8);
+		}
+
+		int a0 = high;
+		int a1 = low;
+		uint8_t indices[16];
+		int error = EvaluateBc4(values, a0, a1, indices);
+
+		if (quality == BlockQuality::kHigh)
+		{
+			// Extremes are often outliers; pulling the endpoints in a little
+			// can tighten the palette around the rest
+			for (int d0 = 0; d0 <= 3 && error > 0; ++d0)
+			{
+				for (int d1 = 0; d1 <= 3; ++d1)
+				{
+					const int t0 = high - d0;
+					const int t1 = low + d1;
+					if (t0 <= t1 || (d0 == 0 && d1 == 0))
+					{
+						continue;
+					}
+					uint8_t trial[16];
+					const int trial_error = EvaluateBc4(values, t0, t1, trial);
+					if (trial_error < error)
+					{
+						error = trial_error;
+						a0 = t0;
+						a1 = t1;
+						std::copy(std::begin(trial), std::end(trial), indices);
+					}
+				}
+			}
+
+			if (inner_low <= inner_high && error > 0)
+			{
+				uint8_t trial[16];
+				const int trial_error = EvaluateBc4(values, inner_low, inner_high, trial);
+				if (trial_error < error)
+				{
+					error = trial_error;
+					a0 = inner_low;
+					a1 = inner_high;
+					std::copy(std::begin(trial), std::end(trial), indices);
+				}
+			}
+		}
+
+		uint64_t bits = uint64_t(a0) | (uint64_t(a1) << 8);
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= uint64_t(indices[i]) << (16 + i * 3);
+		}
+		return bits;
+	}
+
+	uint64_t EncodeChannel(const Block& block, int channel, BlockQuality quality)
+	{
+		int values[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = static_cast<int>(block.pixels[i][channel]);
+		}
+		return EncodeBc4(values, quality);
+	}
+
+	// BC7 mode 6
+
+	struct Bc7Block
+	{
+		int e0[4] = {};
+		int e1[4] = {};
+		int p0 = 0;
+		int p1 = 0;
+		uint8_t indices[16] = {};
+		int error = INT32_MAX;
+	};
+
+	int QuantizeBc7(float value, int p_bit)
+	{
+		return Clamp(static_cast<int>(std::lround((value - p_bit) * 0.5f)), 0, 127) * 2 + p_bit;
+	}
+
+	// P-bit whose quantization lands closest to the endpoint
+	int BestPBit(const float (&endpoint)[4])
+	{
+		float errors[2] = {};
+		for (int p = 0; p < 2; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				const float d = endpoint[c] - static_cast<float>(QuantizeBc7(endpoint[c], p));
+				errors[p] += d * d;
+			}
+		}
+		return errors[1] < errors[0] ? 1 : 0;
+	}
+
+	Bc7Block EvaluateBc7(const Block& block, const float (&e0)[4], const float (&e1)[4], int p0, int p1)
+	{
+		Bc7Block result;
+		result.p0 = p0;
+		result.p1 = p1;
+		int palette[16][4];
+		int axis[4];
+		int axis_length = 0;
+		for (int c = 0; c < 4; ++c)
+		{
+			result.e0[c] = QuantizeBc7(e0[c], p0);
+			result.e1[c] = QuantizeBc7(e1[c], p1);
+			axis[c] = result.e1[c] - result.e0[c];
+			axis_length += axis[c] * axis[c];
+			for (int k = 0; k < 16; ++k)
+			{
+				palette[k][c] = ((64 - kBc7Weights[k]) * result.e0[c] + kBc7Weights[k] * result.e1[c] + 32) >> 6;
+			}
+		}
+
+		// Project onto the endpoint axis for a first guess, then settle
+		// between it and its neighbours by exact error
+		float guesses[16];
+		const float scale = axis_length > 0 ? 15.0f / static_cast<float>(axis_length) : 0.0f;
+		int i = 0;
+#if SIMD_X86
+		for (; i < 16; i += 4)
+		{
+			__m128 t = _mm_setzero_ps();
+			for (int c = 0; c < 4; ++c)
+			{
+				const __m128 p = _mm_setr_ps(block.pixels[i][c], block.pixels[i + 1][c], block.pixels[i + 2][c], block.pixels[i + 3][c]);
+				const __m128 d = _mm_sub_ps(p, _mm_set1_ps(static_cast<float>(result.e0[c])));
+				t = _mm_add_ps(t, _mm_mul_ps(d, _mm_set1_ps(static_cast<float>(axis[c]))));
+			}
+			_mm_storeu_ps(guesses + i, _mm_mul_ps(t, _mm_set1_ps(scale)));
+		}
+#endif
+		for (; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				t += (block.pixels[i][c] - static_cast<float>(result.e0[c])) * static_cast<float>(axis[c]);
+			}
+			guesses[i] = t * scale;
+		}
+
+		result.error = 0;
+		for (i = 0; i < 16; ++i)
+		{
+			const int guess = Clamp(static_cast<int>(std::lround(guesses[i])), 0, 15);
+			int best = INT32_MAX;
+			for (int k = std::max(guess - 1, 0); k <= std::min(guess + 1, 15); ++k)
+			{
+				int d = 0;
+				for (int c = 0; c < 4; ++c)
+				{
+					const int delta = static_cast<int>(block.pixels[i][c]) - palette[k][c];
+					d += delta * delta;
+				}
+				if (d < best)
+				{
+					best = d;
+					result.indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			result.error += best;
+		}
+		return result;
+	}
+
+	Bc7Block FitBc7(const Block& block, const float (&e0)[4], const float (&e1)[4], bool all_p_bits)
+	{
+		if (!all_p_bits)
+		{
+			return EvaluateBc7(block, e0, e1, BestPBit(e0), BestPBit(e1));
+		}
+
+		Bc7Block best;
+		for (int p = 0; p < 4; ++p)
+		{
+			const Bc7Block trial = EvaluateBc7(block, e0, e1, p & 1, p >> 1);
+			if (trial.error < best.error)
+			{
+				best = trial;
+			}
+		}
+		return best;
+	}
+
+	struct BitWriter
+	{
+		uint64_t lo = 0;
+		uint64_t hi = 0;
+		uint32_t position = 0;
+
+		void Write(uint32_t value, uint32_t bits)
+		{
+			if (position < 64)
+			{
+				lo |= uint64_t(value) << position;
+				if (position + bits > 64)
+				{
+					hi |= uint64_t(value) >> (64 - position);
+				}
+			}
+			else
+			{
+				hi |= uint64_t(value) << (position - 64);
+			}
+			position += bits;
+		}
+	};
+
+	void EncodeBc7(const Block& block, BlockQuality quality, uint8_t* dest)
+	{
+		static const int kAll[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+		float e0[4];
+		float e1[4];
+		PrincipalEndpoints<4>(block.pixels, kAll, 16, e0, e1);
+
+		const bool all_p_bits = quality == BlockQuality::kHigh;
+		Bc7Block best = FitBc7(block, e0, e1, all_p_bits);
+		const int refinements = quality == BlockQuality::kFast ? 0 : (quality == BlockQuality::kNormal ? 1 : 3);
+		for (int i = 0; i < refinements && best.error > 0; ++i)
+		{
+			float weights[16];
+			for (int k = 0; k < 16; ++k)
+			{
+				weights[k] = static_cast<float>(kBc7Weights[best.indices[k]]) / 64.0f;
+			}
+			if (!RefineEndpoints<4>(block.pixels, kAll, 16, weights, e0, e1))
+			{
+				break;
+			}
+			const Bc7Block refined = FitBc7(block, e0, e1, all_p_bits);
+			if (refined.error >= best.error)
+			{
+				break;
+			}
+			best = refined;
+		}
+
+		// The first index is stored without its top bit, which must be 0
+		if (best.indices[0] & 8)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				std::swap(best.e0[c], best.e1[c]);
+			}
+			std::swap(best.p0, best.p1);
+			for (uint8_t& index : best.indices)
+			{
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		BitWriter writer;
+		writer.Write(1u << 6, 7);	// Mode 6
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(static_cast<uint32_t>(best.e0[c] >> 1), 7);
+			writer.Write(static_cast<uint32_t>(best.e1[c] >> 1), 7);
+		}
+		writer.Write(static_cast<uint32_t>(best.p0), 1);
+		writer.Write(static_cast<uint32_t>(best.p1), 1);
+		writer.Write(best.indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			writer.Write(best.indices[i], 4);
+		}
+
+		std::memcpy(dest, &writer.lo, 8);
+		std::memcpy(dest + 8, &writer.hi, 8);
+	}
+
+	void EncodeBlock(const Block& block, const BlockCompressSettings& settings, uint8_t* dest)
+	{
+		switch (settings.format)
+		{
+			case BlockFormat::kBC1:
+			{
+				const uint64_t color = EncodeColor(block, settings.quality, true);
+				std::memcpy(dest, &color, 8);
+			} break;
+
+			case BlockFormat::kBC3:
+			{
+				const uint64_t alpha = EncodeChannel(block, 3, settings.quality);
+				const uint64_t color = EncodeColor(block, settings.quality, false);
+				std::memcpy(dest, &alpha, 8);
+				std::memcpy(dest + 8, &color, 8);
+			} break;
+
+			case BlockFormat::kBC5:
+			{
+				const uint64_t red = EncodeChannel(block, 0, settings.quality);
+				const uint64_t green = EncodeChannel(block, 1, settings.quality);
+				std::memcpy(dest, &red, 8);
+				std::memcpy(dest + 8, &green, 8);
+			} break;
+
+			case BlockFormat::kBC7:
+			{
+				EncodeBc7(block, settings.quality, dest);
+			} break;
+		}
+	}
+}
+
+uint32_t GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::kBC1 ? 8 : 16;
+}
+
+uint32_t GetBlockDxgiFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+		case BlockFormat::kBC1: return srgb ? 72 : 71;	// DXGI_FORMAT_BC1_UNORM(_SRGB)
+		case BlockFormat::kBC3: return srgb ? 78 : 77;	// DXGI_FORMAT_BC3_UNORM(_SRGB)
+		case BlockFormat::kBC5: return 83;				// DXGI_FORMAT_BC5_UNORM
+		case BlockFormat::kBC7: return srgb ? 99 : 98;	// DXGI_FORMAT_BC7_UNORM(_SRGB)
+	}
+	return 0;
+}
+
+void CompressImage(
+	const void* src,
+	size_t src_row_pitch,
+	uint32_t width,
+	uint32_t height,
+	void* dest,
+	size_t dest_row_pitch,
+	const BlockCompressSettings& settings,
+	ThreadPool* pool)
+{
+	const uint32_t blocks_wide = (width + 3) / 4;
+	const uint32_t blocks_high = (height + 3) / 4;
+	const uint32_t block_bytes = GetBlockBytes(settings.format);
+	auto* source = static_cast<const uint8_t*>(src);
+	auto* output = static_cast<uint8_t*>(dest);
+
+	const auto encode_rows = [&](uint32_t begin, uint32_t end)
+	{
+		Block block;
+		for (uint32_t by = begin; by < end; ++by)
+		{
+			uint8_t* row = output + dest_row_pitch * by;
+			for (uint32_t bx = 0; bx < blocks_wide; ++bx)
+			{
+				LoadBlock(source, src_row_pitch, width, height, bx, by, block);
+				EncodeBlock(block, settings, row + size_t(bx) * block_bytes);
+			}
+		}
+	};
+
+	if (!pool || pool->GetThreadCount() == 1 || uint64_t(blocks_wide) * blocks_high < 2 * kParallelGrainBlocks)
+	{
+		encode_rows(0, blocks_high);
+		return;
+	}
+	pool->ParallelFor(blocks_high, std::max(1u, kParallelGrainBlocks / blocks_wide), encode_rows);
+}
+
+CompressedTexture CompressMipChain(const MipChain& chain, const BlockCompressSettings& settings, ThreadPool* pool)
+{
+	CompressedTexture texture;
+	texture.format = GetBlockDxgiFormat(settings.format, settings.srgb);
+
+	size_t total = 0;
+	for (const MipChain::Level& source : chain.levels)
+	{
+		CompressedTexture::Level level;
+		level.width = source.width;
+		level.height = source.height;
+		level.row_pitch = size_t((source.width + 3) / 4) * GetBlockBytes(settings.format);
+		level.slice_pitch = level.row_pitch * ((source.height + 3) / 4);
+		level.offset = total;
+		total += level.slice_pitch;
+		texture.levels.push_back(level);
+	}
+	texture.data.resize(total);
+
+	for (size_t i = 0; i < chain.levels.size(); ++i)
+	{
+		const MipChain::Level& source = chain.levels[i];
+		const CompressedTexture::Level& level = texture.levels[i];
+		CompressImage(
+			chain.data.data() + source.offset,
+			source.row_pitch,
+			source.width,
+			source.height,
+			texture.data.data() + level.offset,
+			level.row_pitch,
+			settings,
+			pool);
+	}
+
+	return texture;
+}
@@ -0,0 +1,78 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include "TextureConvert.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// CPU encoder from RGBA8 images to BC formats:
+//  - BC1: RGB, or RGB with 1-bit alpha when a pixel has alpha below 128
+//  - BC3: BC1-style color plus interpolated 8-bit alpha
+//  - BC5: the red and green channels as two independent BC4 blocks (normal maps)
+//  - BC7: mode 6 only (single subset, 7.7.7.7 endpoints with p-bits, 4-bit
+//    indices), which does well on most content but loses to a full
+//    multi-partition search on blocks with several distinct colors
+// Endpoints come from the block's principal axis (a bounding box for kFast),
+// refined by least squares on higher presets. The palette searches use SSE2.
+// Rows of 4x4 blocks are spread over the pool.
+enum class BlockFormat
+{
+	kBC1,
+	kBC3,
+	kBC5,
+	kBC7
+};
+
+enum class BlockQuality
+{
+	kFast,		// One fit, no refinement
+	kNormal,	// One least-squares refinement
+	kHigh		// Several refinements plus alternative modes (BC1 3-color, BC4 6-value, BC7 p-bits)
+};
+
+struct BlockCompressSettings
+{
+	BlockFormat format = BlockFormat::kBC7;
+	BlockQuality quality = BlockQuality::kNormal;
+	bool srgb = false;	// Only selects the _SRGB DXGI format; data is encoded as is
+};
+
+// Encoded surfaces laid out like D3D12_SUBRESOURCE_DATA wants them: RowPitch
+// is one row of blocks, SlicePitch all of them
+struct CompressedTexture
+{
+	struct Level
+	{
+		size_t offset = 0;
+		size_t row_pitch = 0;
+		size_t slice_pitch = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	uint32_t format = 0;	// DXGI_FORMAT
+	std::vector<unsigned char> data;
+	std::vector<Level> levels;
+};
+
+uint32_t GetBlockBytes(BlockFormat format);
+uint32_t GetBlockDxgiFormat(BlockFormat format, bool srgb);
+
+// Encodes a width x height RGBA8 image into ceil(width / 4) x ceil(height / 4)
+// blocks; edge blocks repeat the last row/column
+void CompressImage(
+	const void* src,
+	size_t src_row_pitch,
+	uint32_t width,
+	uint32_t height,
+	void* dest,
+	size_t dest_row_pitch,
+	const BlockCompressSettings& settings,
+	ThreadPool* pool = nullptr);
+
+CompressedTexture CompressMipChain(const MipChain& chain, const BlockCompressSettings& settings, ThreadPool* pool = nullptr);
+
+#endif // !BLOCK_COMPRESS_H
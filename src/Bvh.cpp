@@ -0,0 +1,665 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	constexpr uint32_t kMaxLeafObjects = 4;
+	constexpr uint32_t kSahBins = 16;
+	// Past this depth nodes split at the median, so the tree stays under
+	// kMaxSahDepth + 32 levels and query stacks can be fixed arrays
+	constexpr uint32_t kMaxSahDepth = 48;
+	constexpr size_t kStackSize = 3 * (kMaxSahDepth + 32) + 4;
+
+	// Binary tree the four-wide one is collapsed from
+	struct BuildNode
+	{
+		Aabb bounds;
+		uint32_t left = 0;	// The right child follows it
+		uint32_t first = 0;
+		uint32_t count = 0;	// Objects in a leaf, 0 for an inner node
+	};
+
+	struct BuildTask
+	{
+		uint32_t node;
+		uint32_t begin;
+		uint32_t end;
+		uint32_t depth;
+	};
+
+	// Object with its bounds, moved around by the partitioning so the build
+	// reads memory in order
+	struct BuildRef
+	{
+		Aabb box;
+		uint32_t object;
+	};
+
+	// Twice the centroid, which bins the same and saves a multiply
+	SimdFloat4 Centroid2(const BuildRef& ref)
+	{
+		return SimdAdd(SimdLoad(ref.box.min), SimdLoad(ref.box.max));
+	}
+
+	struct SahSplit
+	{
+		int axis = -1;
+		uint32_t bin = 0;	// First bin on the right
+		float cost = INFINITY;
+	};
+
+	// Small nodes get fewer bins; evaluating all of them would cost more
+	// than binning their few objects
+	uint32_t BinCount(uint32_t object_count)
+	{
+		return std::min(object_count, kSahBins);
+	}
+
+	// Boxes kept in registers while binning; Aabb's Merge goes through memory
+	struct SimdBox
+	{
+		SimdFloat4 min = SimdSplat(INFINITY);
+		SimdFloat4 max = SimdSplat(-INFINITY);
+
+		void Merge(SimdFloat4 low, SimdFloat4 high)
+		{
+			min = SimdMin(min, low);
+			max = SimdMax(max, high);
+		}
+
+		// Half the surface area, which ranks splits the same; 0 when empty
+		float HalfArea() const
+		{
+			alignas(16) float size[4];
+			SimdStore(size, SimdMax(SimdSub(max, min), SimdSplat(0.0f)));
+			return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+		}
+	};
+
+	// Bins the (doubled) centroids along all three axes in one pass. Also
+	// returns the bin scale per axis, which the partitioning needs to
+	// reproduce the bins.
+	SahSplit FindSahSplit(const Aabb& centroid_bounds, const BuildRef* refs, uint32_t count, Vec3& bin_scale)
+	{
+		const uint32_t bin_count = BinCount(count);
+		const Vec3 extent = centroid_bounds.max - centroid_bounds.min;
+		const SimdFloat4 low = SimdLoad(centroid_bounds.min);
+		// Flat axes get scale 0, putting everything in bin 0
+		bin_scale = Vec3(
+			extent.x > 0.0f ? bin_count / extent.x : 0.0f,
+			extent.y > 0.0f ? bin_count / extent.y : 0.0f,
+			extent.z > 0.0f ? bin_count / extent.z : 0.0f);
+		const SimdFloat4 scale = SimdLoad(bin_scale);
+
+		SimdBox bins[3][kSahBins];
+		uint32_t bin_counts[3][kSahBins] = {};
+		alignas(16) float positions[4];
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const SimdFloat4 box_min = SimdLoad(refs[i].box.min);
+			const SimdFloat4 box_max = SimdLoad(refs[i].box.max);
+			SimdStore(positions, SimdMul(SimdSub(SimdAdd(box_min, box_max), low), scale));
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const uint32_t bin = std::min(static_cast<uint32_t>(positions[axis]), bin_count - 1);
+				bins[axis][bin].Merge(box_min, box_max);
+				++bin_counts[axis][bin];
+			}
+		}
+
+		SahSplit best;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (!((&extent.x)[axis] > 0.0f))
+			{
+				continue;
+			}
+
+			// Area times count of everything from each bin rightwards
+			float right_costs[kSahBins];
+			SimdBox right;
+			uint32_t right_count = 0;
+			for (uint32_t bin = bin_count; bin-- > 1;)
+			{
+				right.Merge(bins[axis][bin].min, bins[axis][bin].max);
+				right_count += bin_counts[axis][bin];
+				right_costs[bin] = right_count ? 2.0f * right.HalfArea() * right_count : INFINITY;
+			}
+
+			SimdBox left;
+			uint32_t left_count = 0;
+			for (uint32_t bin = 1; bin < bin_count; ++bin)
+			{
+				left.Merge(bins[axis][bin - 1].min, bins[axis][bin - 1].max);
+				left_count += bin_counts[axis][bin - 1];
+				const float cost = left_count ? 2.0f * left.HalfArea() * left_count + right_costs[bin] : INFINITY;
+				if (cost < best.cost)
+				{
+					best = { axis, bin, cost };
+				}
+			}
+		}
+		return best;
+	}
+
+	// Distance to where the ray enters the box (0 from inside), INFINITY if
+	// it misses or enters past max_distance
+	float RayBoxDistance(const Aabb& box, const Vec3& origin, const Vec3& inverse_direction, float max_distance)
+	{
+		float near = 0.0f;
+		float far = max_distance;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float o = (&origin.x)[axis];
+			const float inverse = (&inverse_direction.x)[axis];
+			float t0 = ((&box.min.x)[axis] - o) * inverse;
+			float t1 = ((&box.max.x)[axis] - o) * inverse;
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			// Written so NaNs (ray in the slab's plane) leave the range alone
+			near = t0 > near ? t0 : near;
+			far = t1 < far ? t1 : far;
+		}
+		return near <= far ? near : INFINITY;
+	}
+}
+
+Ray ScreenPointRay(int x, int y, uint32_t width, uint32_t height, const Mat4& view_projection)
+{
+	const Mat4 inverse = Inverse(view_projection);
+	const float ndc_x = 2.0f * (x + 0.5f) / width - 1.0f;
+	const float ndc_y = 1.0f - 2.0f * (y + 0.5f) / height;
+	const Vec4 near = Transform(Vec4(ndc_x, ndc_y, 0.0f, 1.0f), inverse);
+	const Vec4 far = Transform(Vec4(ndc_x, ndc_y, 1.0f, 1.0f), inverse);
+	const Vec3 origin = Vec3(near.x, near.y, near.z) / near.w;
+	return { origin, Normalize(Vec3(far.x, far.y, far.z) / far.w - origin) };
+}
+
+void Bvh::Build(const Aabb* boxes, uint32_t count)
+{
+	nodes_.clear();
+	objects_.clear();
+	boxes_.clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::vector<BuildRef> refs(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		refs[i] = { boxes[i], i };
+	}
+
+	std::vector<BuildNode> binary(1);
+	binary.reserve(2 * size_t(count));
+	std::vector<BuildTask> tasks = { { 0, 0, count, 0 } };
+	while (!tasks.empty())
+	{
+		const BuildTask task = tasks.back();
+		tasks.pop_back();
+		BuildRef* task_refs = refs.data() + task.begin;
+		const uint32_t object_count = task.end - task.begin;
+
+		SimdBox simd_bounds;
+		SimdBox simd_centroid_bounds;
+		for (uint32_t i = 0; i < object_count; ++i)
+		{
+			simd_bounds.Merge(SimdLoad(task_refs[i].box.min), SimdLoad(task_refs[i].box.max));
+			const SimdFloat4 centroid = Centroid2(task_refs[i]);
+			simd_centroid_bounds.Merge(centroid, centroid);
+		}
+		const Aabb bounds(StoreVec3(simd_bounds.min), StoreVec3(simd_bounds.max));
+		const Aabb centroid_bounds(StoreVec3(simd_centroid_bounds.min), StoreVec3(simd_centroid_bounds.max));
+		binary[task.node].bounds = bounds;
+
+		// Small enough sets always become leaves: a four-wide node tests them
+		// as cheaply as it would the children of a split
+		uint32_t middle = 0;
+		if (object_count > kMaxLeafObjects)
+		{
+			Vec3 bin_scale;
+			const SahSplit split = task.depth < kMaxSahDepth ? FindSahSplit(centroid_bounds, task_refs, object_count, bin_scale) : SahSplit();
+			if (split.axis >= 0)
+			{
+				// Same arithmetic as the binning, so objects land on the side
+				// they were counted on
+				const SimdFloat4 low = SimdLoad(centroid_bounds.min);
+				const SimdFloat4 scale = SimdLoad(bin_scale);
+				const uint32_t bin_count = BinCount(object_count);
+				middle = static_cast<uint32_t>(std::partition(task_refs, task_refs + object_count, [&](const BuildRef& ref)
+				{
+					alignas(16) float positions[4];
+					SimdStore(positions, SimdMul(SimdSub(Centroid2(ref), low), scale));
+					return std::min(static_cast<uint32_t>(positions[split.axis]), bin_count - 1) < split.bin;
+				}) - task_refs);
+			}
+			else
+			{
+				// Too deep, or every centroid in one place
+				const Vec3 extent = Extent(centroid_bounds);
+				const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+				middle = object_count / 2;
+				std::nth_element(task_refs, task_refs + middle, task_refs + object_count, [&](const BuildRef& a, const BuildRef& b)
+				{
+					return (&a.box.min.x)[axis] + (&a.box.max.x)[axis] < (&b.box.min.x)[axis] + (&b.box.max.x)[axis];
+				});
+			}
+		}
+
+		if (middle == 0)
+		{
+			binary[task.node].first = task.begin;
+			binary[task.node].count = object_count;
+			continue;
+		}
+		const uint32_t left = static_cast<uint32_t>(binary.size());
+		binary[task.node].left = left;
+		binary.resize(binary.size() + 2);
+		tasks.push_back({ left, task.begin, task.begin + middle, task.depth + 1 });
+		tasks.push_back({ left + 1, task.begin + middle, task.end, task.depth + 1 });
+	}
+
+	// Every four-wide node takes its binary node's children, then keeps
+	// opening the largest inner one until it has four
+	struct CollapseTask
+	{
+		uint32_t binary;
+		uint32_t node;
+	};
+	std::vector<CollapseTask> collapse = { { 0, 0 } };
+	nodes_.emplace_back();
+	while (!collapse.empty())
+	{
+		const CollapseTask task = collapse.back();
+		collapse.pop_back();
+
+		uint32_t entries[4] = { task.binary };
+		uint32_t entry_count = 1;
+		if (binary[task.binary].count == 0)
+		{
+			entries[0] = binary[task.binary].left;
+			entries[1] = binary[task.binary].left + 1;
+			entry_count = 2;
+		}
+		while (entry_count < 4)
+		{
+			int largest = -1;
+			for (uint32_t e = 0; e < entry_count; ++e)
+			{
+				if (binary[entries[e]].count == 0 &&
+					(largest < 0 || SurfaceArea(binary[entries[e]].bounds) > SurfaceArea(binary[entries[largest]].bounds)))
+				{
+					largest = static_cast<int>(e);
+				}
+			}
+			if (largest < 0)
+			{
+				break;
+			}
+			// Opened in place, so children stay in spatial order
+			const uint32_t left = binary[entries[largest]].left;
+			std::copy_backward(entries + largest + 1, entries + entry_count, entries + entry_count + 1);
+			entries[largest] = left;
+			entries[largest + 1] = left + 1;
+			++entry_count;
+		}
+
+		Node node;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const Aabb bounds = c < entry_count ? binary[entries[c]].bounds : Aabb();
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				node.min[axis][c] = (&bounds.min.x)[axis];
+				node.max[axis][c] = (&bounds.max.x)[axis];
+			}
+			node.children[c] = kEmptyChild;
+			node.counts[c] = 0;
+			if (c >= entry_count)
+			{
+				continue;
+			}
+			const BuildNode& entry = binary[entries[c]];
+			if (entry.count > 0)
+			{
+				node.children[c] = entry.first;
+				node.counts[c] = entry.count;
+			}
+			else
+			{
+				node.children[c] = static_cast<uint32_t>(nodes_.size());
+				collapse.push_back({ entries[c], node.children[c] });
+				nodes_.emplace_back();
+			}
+		}
+		nodes_[task.node] = node;
+	}
+
+	objects_.resize(count);
+	boxes_.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		objects_[i] = refs[i].object;
+		boxes_[i] = refs[i].box;
+	}
+}
+
+void Bvh::Refit(const Aabb* boxes)
+{
+	for (size_t i = 0; i < objects_.size(); ++i)
+	{
+		boxes_[i] = boxes[objects_[i]];
+	}
+
+	// Children come after their parents, so walking backwards finishes
+	// every child before the node holding its bounds
+	for (size_t n = nodes_.size(); n-- > 0;)
+	{
+		Node& node = nodes_[n];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			if (node.children[c] == kEmptyChild)
+			{
+				continue;
+			}
+			Aabb bounds;
+			if (node.counts[c] > 0)
+			{
+				for (uint32_t i = node.children[c]; i < node.children[c] + node.counts[c]; ++i)
+				{
+					bounds = Merge(bounds, boxes_[i]);
+				}
+			}
+			else
+			{
+				const Node& child = nodes_[node.children[c]];
+				for (uint32_t g = 0; g < 4; ++g)
+				{
+					bounds = Merge(bounds, Aabb(
+						Vec3(child.min[0][g], child.min[1][g], child.min[2][g]),
+						Vec3(child.max[0][g], child.max[1][g], child.max[2][g])));
+				}
+			}
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				node.min[axis][c] = (&bounds.min.x)[axis];
+				node.max[axis][c] = (&bounds.max.x)[axis];
+			}
+		}
+	}
+}
+
+RayHit Bvh::Raycast(const Ray& ray, float max_distance, const ObjectRayTest& test) const
+{
+	RayHit hit;
+	if (nodes_.empty())
+	{
+		return hit;
+	}
+	hit.distance = max_distance;
+
+	const Vec3 inverse_direction(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+	const SimdFloat4 origin[3] = { SimdSplat(ray.origin.x), SimdSplat(ray.origin.y), SimdSplat(ray.origin.z) };
+	const SimdFloat4 inverse[3] = { SimdSplat(inverse_direction.x), SimdSplat(inverse_direction.y), SimdSplat(inverse_direction.z) };
+	// Per axis, whether a box is entered through its max plane
+	const bool negative[3] = { inverse_direction.x < 0.0f, inverse_direction.y < 0.0f, inverse_direction.z < 0.0f };
+	const SimdFloat4 zero = SimdSplat(0.0f);
+
+	struct Entry
+	{
+		uint32_t child;
+		uint32_t count;
+		float distance;
+	};
+	Entry stack[kStackSize];
+	size_t stack_size = 0;
+	stack[stack_size++] = { 0, 0, 0.0f };
+	while (stack_size > 0)
+	{
+		const Entry entry = stack[--stack_size];
+		if (entry.distance > hit.distance)
+		{
+			continue;
+		}
+
+		if (entry.count > 0)
+		{
+			for (uint32_t i = entry.child; i < entry.child + entry.count; ++i)
+			{
+				float distance = RayBoxDistance(boxes_[i], ray.origin, inverse_direction, hit.distance);
+				if (distance == INFINITY)
+				{
+					continue;
+				}
+				if (test)
+				{
+					distance = test(objects_[i], ray);
+					if (distance == INFINITY || distance > hit.distance)
+					{
+						continue;
+					}
+				}
+				if (!hit.IsHit() || distance < hit.distance)
+				{
+					hit = { objects_[i], distance };
+				}
+			}
+			continue;
+		}
+
+		const Node& node = nodes_[entry.child];
+		SimdFloat4 near = zero;
+		SimdFloat4 far = SimdSplat(hit.distance);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float* near_plane = negative[axis] ? node.max[axis] : node.min[axis];
+			const float* far_plane = negative[axis] ? node.min[axis] : node.max[axis];
+			// The slab value goes first, so a NaN from it is dropped
+			near = SimdMax(SimdMul(SimdSub(SimdLoad(near_plane), origin[axis]), inverse[axis]), near);
+			far = SimdMin(SimdMul(SimdSub(SimdLoad(far_plane), origin[axis]), inverse[axis]), far);
+		}
+		const int mask = SimdLessEqualMask(near, far);
+		if (mask == 0)
+		{
+			continue;
+		}
+		alignas(16) float distances[4];
+		SimdStore(distances, near);
+
+		// Farthest pushed first, so the nearest child is visited next
+		uint32_t order[4];
+		uint32_t order_count = 0;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			if (!(mask & (1 << c)) || node.children[c] == kEmptyChild)
+			{
+				continue;
+			}
+			uint32_t position = order_count++;
+			for (; position > 0 && distances[order[position - 1]] < distances[c]; --position)
+			{
+				order[position] = order[position - 1];
+			}
+			order[position] = c;
+		}
+		assert(stack_size + order_count <= kStackSize && "Bvh is deeper than its query stack.");
+		for (uint32_t o = 0; o < order_count; ++o)
+		{
+			const uint32_t c = order[o];
+			stack[stack_size++] = { node.children[c], node.counts[c], distances[c] };
+		}
+	}
+
+	if (!hit.IsHit())
+	{
+		hit.distance = INFINITY;
+	}
+	return hit;
+}
+
+void Bvh::QueryOverlaps(const Aabb& box, std::vector<uint32_t>& objects) const
+{
+	if (nodes_.empty() || IsEmpty(box))
+	{
+		return;
+	}
+	const SimdFloat4 box_min[3] = { SimdSplat(box.min.x), SimdSplat(box.min.y), SimdSplat(box.min.z) };
+	const SimdFloat4 box_max[3] = { SimdSplat(box.max.x), SimdSplat(box.max.y), SimdSplat(box.max.z) };
+
+	uint32_t stack[kStackSize];
+	size_t stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0)
+	{
+		const Node& node = nodes_[stack[--stack_size]];
+		int mask = 0xF;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			mask &= SimdLessEqualMask(SimdLoad(node.min[axis]), box_max[axis]);
+			mask &= SimdLessEqualMask(box_min[axis], SimdLoad(node.max[axis]));
+		}
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			if (!(mask & (1 << c)) || node.children[c] == kEmptyChild)
+			{
+				continue;
+			}
+			if (node.counts[c] == 0)
+			{
+				assert(stack_size < kStackSize && "Bvh is deeper than its query stack.");
+				stack[stack_size++] = node.children[c];
+				continue;
+			}
+			for (uint32_t i = node.children[c]; i < node.children[c] + node.counts[c]; ++i)
+			{
+				if (Overlaps(boxes_[i], box))
+				{
+					objects.push_back(objects_[i]);
+				}
+			}
+		}
+	}
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& objects) const
+{
+	if (nodes_.empty())
+	{
+		return;
+	}
+	SimdFloat4 normals[Frustum::kPlaneCount][3];
+	SimdFloat4 abs_normals[Frustum::kPlaneCount][3];
+	SimdFloat4 offsets[Frustum::kPlaneCount];
+	for (int p = 0; p < Frustum::kPlaneCount; ++p)
+	{
+		const Vec4& plane = frustum.planes[p];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			normals[p][axis] = SimdSplat((&plane.x)[axis]);
+			abs_normals[p][axis] = SimdAbs(normals[p][axis]);
+		}
+		offsets[p] = SimdSplat(plane.w);
+	}
+	const SimdFloat4 half = SimdSplat(0.5f);
+
+	uint32_t stack[kStackSize];
+	size_t stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0)
+	{
+		const Node& node = nodes_[stack[--stack_size]];
+		SimdFloat4 center[3];
+		SimdFloat4 extent[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const SimdFloat4 low = SimdLoad(node.min[axis]);
+			const SimdFloat4 high = SimdLoad(node.max[axis]);
+			center[axis] = SimdMul(SimdAdd(low, high), half);
+			extent[axis] = SimdMul(SimdSub(high, low), half);
+		}
+
+		// Children touching the frustum, and those entirely inside it
+		int touching = 0xF;
+		int inside = 0xF;
+		for (int p = 0; p < Frustum::kPlaneCount; ++p)
+		{
+			SimdFloat4 distance = SimdMulAdd(center[0], normals[p][0], offsets[p]);
+			distance = SimdMulAdd(center[1], normals[p][1], distance);
+			distance = SimdMulAdd(center[2], normals[p][2], distance);
+			SimdFloat4 reach = SimdMul(extent[0], abs_normals[p][0]);
+			reach = SimdMulAdd(extent[1], abs_normals[p][1], reach);
+			reach = SimdMulAdd(extent[2], abs_normals[p][2], reach);
+			touching &= SimdLessEqualMask(SimdSub(SimdSplat(0.0f), reach), distance);
+			inside &= SimdLessEqualMask(reach, distance);
+		}
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			if (!(touching & (1 << c)) || node.children[c] == kEmptyChild)
+			{
+				continue;
+			}
+			if (inside & (1 << c))
+			{
+				AppendChild(node.children[c], node.counts[c], objects);
+			}
+			else if (node.counts[c] == 0)
+			{
+				assert(stack_size < kStackSize && "Bvh is deeper than its query stack.");
+				stack[stack_size++] = node.children[c];
+			}
+			else
+			{
+				for (uint32_t i = node.children[c]; i < node.children[c] + node.counts[c]; ++i)
+				{
+					if (Intersects(frustum, boxes_[i]))
+					{
+						objects.push_back(objects_[i]);
+					}
+				}
+			}
+		}
+	}
+}
+
+uint32_t Bvh::GetObjectCount() const
+{
+	return static_cast<uint32_t>(objects_.size());
+}
+
+Aabb Bvh::GetBounds() const
+{
+	Aabb bounds;
+	if (!nodes_.empty())
+	{
+		const Node& root = nodes_[0];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			bounds = Merge(bounds, Aabb(
+				Vec3(root.min[0][c], root.min[1][c], root.min[2][c]),
+				Vec3(root.max[0][c], root.max[1][c], root.max[2][c])));
+		}
+	}
+	return bounds;
+}
+
+void Bvh::AppendChild(uint32_t child, uint32_t count, std::vector<uint32_t>& objects) const
+{
+	if (count > 0)
+	{
+		objects.insert(objects.end(), objects_.begin() + child, objects_.begin() + child + count);
+		return;
+	}
+	const Node& node = nodes_[child];
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		if (node.children[c] != kEmptyChild)
+		{
+			AppendChild(node.children[c], node.counts[c], objects);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "FrustumCulling.h"
+#include "SimdMath.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Bounding volume hierarchy over a set of object boxes, for ray picking and
+// broad-phase queries. Objects are identified by their index in the boxes
+// passed to Build().
+//
+// The tree is built binary with the surface area heuristic, then collapsed to
+// four children per node, whose bounds are stored as SoA so a query tests all
+// four in one go with SimdFloat4.
+//
+// Refit() keeps the tree and recomputes its bounds, which is much cheaper than
+// a build but lets the tree loosen as objects move away from where they were
+// built; rebuild once queries slow down.
+
+struct Ray
+{
+	Vec3 origin;
+	Vec3 direction;	// Unit length, so hit distances are in world units
+};
+
+// Ray from the camera through pixel (x, y) of a width x height viewport, e.g.
+// Mouse::GetPos(); starts on the near plane
+Ray ScreenPointRay(int x, int y, uint32_t width, uint32_t height, const Mat4& view_projection);
+
+struct RayHit
+{
+	uint32_t object = UINT32_MAX;
+	float distance = INFINITY;
+
+	bool IsHit() const { return object != UINT32_MAX; }
+};
+
+class Bvh
+{
+public:
+	// Exact distance along the ray to the object, INFINITY for a miss. Called
+	// for objects whose box the ray hits, nearest boxes first.
+	using ObjectRayTest = std::function<float(uint32_t object, const Ray& ray)>;
+public:
+	void Build(const Aabb* boxes, uint32_t count);
+	// Same objects, new boxes
+	void Refit(const Aabb* boxes);
+
+	// Nearest hit within max_distance. Without a test, objects are hit at
+	// their box.
+	RayHit Raycast(const Ray& ray, float max_distance = INFINITY, const ObjectRayTest& test = nullptr) const;
+	// Append the objects whose boxes overlap or are in the frustum
+	void QueryOverlaps(const Aabb& box, std::vector<uint32_t>& objects) const;
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& objects) const;
+
+	uint32_t GetObjectCount() const;
+	Aabb GetBounds() const;
+private:
+	static constexpr uint32_t kEmptyChild = UINT32_MAX;
+
+	// Child bounds by axis, then child
+	struct alignas(16) Node
+	{
+		float min[3][4];
+		float max[3][4];
+		uint32_t children[4];	// Node index, first object of a leaf, or kEmptyChild
+		uint32_t counts[4];		// Objects in a leaf, 0 for a node
+	};
+private:
+	// Adds every object below a child to 'objects'
+	void AppendChild(uint32_t child, uint32_t count, std::vector<uint32_t>& objects) const;
+private:
+	std::vector<Node> nodes_;	// Root first, children after their parents
+	std::vector<uint32_t> objects_;	// Object indices in leaf order
+	std::vector<Aabb> boxes_;	// In leaf order
+};
+
+#endif // !BVH_H
@@ -0,0 +1,48 @@
+#include "CpuFeatures.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	SimdLevel DetectSimdLevel()
+	{
+#if SIMD_X86
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return SimdLevel::kSse2;
+		}
+
+		// AVX needs OSXSAVE and the OS saving XMM and YMM state (XCR0 bits 1, 2)
+		__cpuid(info, 1);
+		const bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+		return os_saves_ymm && avx2 ? SimdLevel::kAvx2 : SimdLevel::kSse2;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? SimdLevel::kAvx2 : SimdLevel::kSse2;
+#endif
+#else
+		return SimdLevel::kScalar;
+#endif
+	}
+}
+
+SimdLevel GetSupportedSimdLevel()
+{
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+SimdLevel ClampSimdLevel(SimdLevel requested)
+{
+	const SimdLevel supported = GetSupportedSimdLevel();
+	return requested < supported ? requested : supported;
+}
@@ -0,0 +1,31 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Instruction sets the CPU kernels can use. SSE2 is part of x64, so it is
+// only missing on other architectures; AVX2 is checked at run time, along
+// with the OS saving the wider registers.
+enum class SimdLevel
+{
+	kScalar,
+	kSse2,
+	kAvx2
+};
+
+SimdLevel GetSupportedSimdLevel();
+
+// Lower of 'requested' and what the CPU supports
+SimdLevel ClampSimdLevel(SimdLevel requested);
+
+// Functions using AVX2 intrinsics are marked with this, so the rest of the
+// file keeps building for the baseline instruction set
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_X86 1
+#endif
+
+#endif // !CPU_FEATURES_H
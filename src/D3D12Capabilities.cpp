@@ -0,0 +1,169 @@
+#include "D3D12Capabilities.h"
+#include <wrl.h>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+	uint64_t LuidToKey(LUID luid)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(luid.HighPart)) << 32) | luid.LowPart;
+	}
+
+	// UMD version of the adapter behind 'device', 0 if it can't be determined
+	uint64_t QueryDriverVersion(ID3D12Device* device, IDXGIFactory4* factory)
+	{
+		ComPtr<IDXGIAdapter> adapter;
+		if (FAILED(factory->EnumAdapterByLuid(device->GetAdapterLuid(), IID_PPV_ARGS(adapter.GetAddressOf()))))
+		{
+			return 0;
+		}
+
+		// The one remaining use of CheckInterfaceSupport: it reports the driver version
+		LARGE_INTEGER umd_version{};
+		if (FAILED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umd_version)))
+		{
+			return 0;
+		}
+		return static_cast<uint64_t>(umd_version.QuadPart);
+	}
+
+	template<typename T>
+	bool Query(ID3D12Device* device, D3D12_FEATURE feature, T& data)
+	{
+		return SUCCEEDED(device->CheckFeatureSupport(feature, &data, sizeof(data)));
+	}
+}
+
+DeviceCapabilities QueryDeviceCapabilities(ID3D12Device* device, IDXGIFactory4* factory)
+{
+	DeviceCapabilities caps;
+	caps.adapter_luid = LuidToKey(device->GetAdapterLuid());
+	caps.driver_version = QueryDriverVersion(device, factory);
+
+	static const D3D_FEATURE_LEVEL kFeatureLevels[] =
+	{
+		D3D_FEATURE_LEVEL_11_0,
+		D3D_FEATURE_LEVEL_11_1,
+		D3D_FEATURE_LEVEL_12_0,
+		D3D_FEATURE_LEVEL_12_1,
+		D3D_FEATURE_LEVEL_12_2
+	};
+	D3D12_FEATURE_DATA_FEATURE_LEVELS feature_levels{};
+	feature_levels.NumFeatureLevels = _countof(kFeatureLevels);
+	feature_levels.pFeatureLevelsRequested = kFeatureLevels;
+	if (Query(device, D3D12_FEATURE_FEATURE_LEVELS, feature_levels))
+	{
+		caps.max_feature_level = feature_levels.MaxSupportedFeatureLevel;
+	}
+
+	// Drivers reject shader models newer than they know, so walk down until one sticks
+	static const D3D_SHADER_MODEL kShaderModels[] =
+	{
+		D3D_SHADER_MODEL_6_7, D3D_SHADER_MODEL_6_6, D3D_SHADER_MODEL_6_5, D3D_SHADER_MODEL_6_4,
+		D3D_SHADER_MODEL_6_3, D3D_SHADER_MODEL_6_2, D3D_SHADER_MODEL_6_1, D3D_SHADER_MODEL_6_0,
+		D3D_SHADER_MODEL_5_1
+	};
+	for (D3D_SHADER_MODEL model : kShaderModels)
+	{
+		D3D12_FEATURE_DATA_SHADER_MODEL shader_model{ model };
+		if (Query(device, D3D12_FEATURE_SHADER_MODEL, shader_model))
+		{
+			caps.highest_shader_model = shader_model.HighestShaderModel;
+			break;
+		}
+	}
+
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE root_signature{ D3D_ROOT_SIGNATURE_VERSION_1_1 };
+	caps.highest_root_signature_version = Query(device, D3D12_FEATURE_ROOT_SIGNATURE, root_signature)
+		? root_signature.HighestVersion
+		: D3D_ROOT_SIGNATURE_VERSION_1_0;
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+	if (Query(device, D3D12_FEATURE_D3D12_OPTIONS, options))
+	{
+		caps.resource_binding_tier = options.ResourceBindingTier;
+		caps.resource_heap_tier = options.ResourceHeapTier;
+		caps.tiled_resources_tier = options.TiledResourcesTier;
+		caps.conservative_rasterization_tier = options.ConservativeRasterizationTier;
+		caps.typed_uav_load_additional_formats = options.TypedUAVLoadAdditionalFormats;
+		caps.rasterizer_ordered_views = options.ROVsSupported;
+	}
+	else
+	{
+		caps.resource_heap_tier = D3D12_RESOURCE_HEAP_TIER_1;
+	}
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS1 options1{};
+	if (Query(device, D3D12_FEATURE_D3D12_OPTIONS1, options1))
+	{
+		caps.wave_ops = options1.WaveOps;
+		caps.wave_lane_count_min = options1.WaveLaneCountMin;
+		caps.wave_lane_count_max = options1.WaveLaneCountMax;
+		caps.total_lane_count = options1.TotalLaneCount;
+	}
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5{};
+	if (Query(device, D3D12_FEATURE_D3D12_OPTIONS5, options5))
+	{
+		caps.raytracing_tier = options5.RaytracingTier;
+	}
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS6 options6{};
+	if (Query(device, D3D12_FEATURE_D3D12_OPTIONS6, options6))
+	{
+		caps.variable_shading_rate_tier = options6.VariableShadingRateTier;
+	}
+
+	D3D12_FEATURE_DATA_D3D12_OPTIONS7 options7{};
+	if (Query(device, D3D12_FEATURE_D3D12_OPTIONS7, options7))
+	{
+		caps.mesh_shader_tier = options7.MeshShaderTier;
+		caps.sampler_feedback_tier = options7.SamplerFeedbackTier;
+	}
+
+	D3D12_FEATURE_DATA_ARCHITECTURE architecture{};
+	if (Query(device, D3D12_FEATURE_ARCHITECTURE, architecture))
+	{
+		caps.uma = architecture.UMA;
+		caps.cache_coherent_uma = architecture.CacheCoherentUMA;
+	}
+
+	for (uint32_t f = 0; f < DeviceCapabilities::kMsaaFormatCount; ++f)
+	{
+		for (uint32_t samples = 2, s = 0; s < DeviceCapabilities::kMsaaSampleCountCount; samples *= 2, ++s)
+		{
+			D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS quality{};
+			quality.Format = static_cast<DXGI_FORMAT>(DeviceCapabilities::kMsaaFormats[f]);
+			quality.SampleCount = samples;
+			quality.Flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE;
+			if (Query(device, D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS, quality))
+			{
+				caps.msaa_quality_levels[f][s] = quality.NumQualityLevels;
+			}
+		}
+	}
+
+	return caps;
+}
+
+DeviceCapabilities LoadOrQueryDeviceCapabilities(ID3D12Device* device, IDXGIFactory4* factory, const std::wstring& cache_path)
+{
+	const uint64_t adapter_luid = LuidToKey(device->GetAdapterLuid());
+	const uint64_t driver_version = QueryDriverVersion(device, factory);
+
+	DeviceCapabilities caps;
+	// Without a driver version there's nothing to tell a driver update apart by
+	if (driver_version != 0 && LoadCapabilities(cache_path, adapter_luid, driver_version, caps))
+	{
+		return caps;
+	}
+
+	caps = QueryDeviceCapabilities(device, factory);
+	if (driver_version != 0)
+	{
+		// Losing the cache only costs the queries on the next launch
+		SaveCapabilities(cache_path, caps);
+	}
+	return caps;
+}
@@ -0,0 +1,18 @@
+#ifndef D3D12_CAPABILITIES_H
+#define D3D12_CAPABILITIES_H
+
+#include "LeanWin32.h"
+#include "DeviceCapabilities.h"
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <string>
+
+// Runs every CheckFeatureSupport query DeviceCapabilities holds. Optional
+// features an older runtime doesn't know stay at 0.
+DeviceCapabilities QueryDeviceCapabilities(ID3D12Device* device, IDXGIFactory4* factory);
+
+// Loads the snapshot from 'cache_path' when it was written for the same
+// adapter and driver; otherwise queries the device and rewrites the file
+DeviceCapabilities LoadOrQueryDeviceCapabilities(ID3D12Device* device, IDXGIFactory4* factory, const std::wstring& cache_path);
+
+#endif // !D3D12_CAPABILITIES_H
@@ -0,0 +1,111 @@
+#include "D3D12Footprints.h"
+#include "TextureFootprint.h"
+#include <vector>
+
+static_assert(kTexturePitchAlignment == D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+static_assert(kTexturePlacementAlignment == D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+namespace
+{
+	bool ToFootprintDesc(const D3D12_RESOURCE_DESC& desc, TextureFootprintDesc& out)
+	{
+		// Multisampled resources can't be copied to buffers at all
+		if (desc.SampleDesc.Count > 1)
+		{
+			return false;
+		}
+
+		switch (desc.Dimension)
+		{
+			case D3D12_RESOURCE_DIMENSION_BUFFER: out.dimension = TextureDimension::kBuffer; break;
+			case D3D12_RESOURCE_DIMENSION_TEXTURE1D: out.dimension = TextureDimension::kTexture1D; break;
+			case D3D12_RESOURCE_DIMENSION_TEXTURE2D: out.dimension = TextureDimension::kTexture2D; break;
+			case D3D12_RESOURCE_DIMENSION_TEXTURE3D: out.dimension = TextureDimension::kTexture3D; break;
+			default: return false;
+		}
+
+		out.format = static_cast<uint32_t>(desc.Format);
+		out.width = desc.Width;
+		out.height = desc.Height;
+		out.depth_or_array_size = desc.DepthOrArraySize;
+		out.mip_levels = desc.MipLevels;
+		return true;
+	}
+}
+
+bool ComputeCopyableFootprints(
+	ID3D12Device* device,
+	const D3D12_RESOURCE_DESC& desc,
+	UINT first_subresource,
+	UINT subresource_count,
+	UINT64 base_offset,
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts,
+	UINT* row_counts,
+	UINT64* row_sizes,
+	UINT64* total_bytes)
+{
+	TextureFootprintDesc footprint_desc;
+	TextureFormatInfo info;
+	const bool known = ToFootprintDesc(desc, footprint_desc) &&
+		(footprint_desc.dimension == TextureDimension::kBuffer || GetTextureFormatInfo(footprint_desc.format, info));
+
+	if (!known)
+	{
+		if (!device)
+		{
+			return false;
+		}
+		device->GetCopyableFootprints(&desc, first_subresource, subresource_count, base_offset, layouts, row_counts, row_sizes, total_bytes);
+		return true;
+	}
+
+	// Small batches (a mip chain) stay on the stack
+	SubresourceFootprint local[16];
+	std::vector<SubresourceFootprint> heap;
+	SubresourceFootprint* footprints = local;
+	if (subresource_count > _countof(local))
+	{
+		heap.resize(subresource_count);
+		footprints = heap.data();
+	}
+
+	ComputeTextureFootprints(footprint_desc, first_subresource, subresource_count, base_offset, footprints, total_bytes);
+
+	for (UINT i = 0; i < subresource_count; ++i)
+	{
+		const SubresourceFootprint& footprint = footprints[i];
+		if (layouts)
+		{
+			layouts[i].Offset = footprint.offset;
+			layouts[i].Footprint.Format = static_cast<DXGI_FORMAT>(footprint.format);
+			layouts[i].Footprint.Width = footprint.width;
+			layouts[i].Footprint.Height = footprint.height;
+			layouts[i].Footprint.Depth = footprint.depth;
+			layouts[i].Footprint.RowPitch = footprint.row_pitch;
+		}
+		if (row_counts)
+		{
+			row_counts[i] = footprint.row_count;
+		}
+		if (row_sizes)
+		{
+			row_sizes[i] = footprint.row_size;
+		}
+	}
+
+	return true;
+}
+
+UINT64 ComputeIntermediateSize(
+	ID3D12Device* device,
+	const D3D12_RESOURCE_DESC& desc,
+	UINT first_subresource,
+	UINT subresource_count)
+{
+	UINT64 total_bytes = 0;
+	if (!ComputeCopyableFootprints(device, desc, first_subresource, subresource_count, 0, nullptr, nullptr, nullptr, &total_bytes))
+	{
+		return 0;
+	}
+	return total_bytes;
+}
@@ -0,0 +1,29 @@
+#ifndef D3D12_FOOTPRINTS_H
+#define D3D12_FOOTPRINTS_H
+
+#include "LeanWin32.h"
+#include <d3d12.h>
+
+// ID3D12Device::GetCopyableFootprints computed on the CPU (see TextureFootprint).
+// Same outputs, any of which may be null. Formats the CPU path doesn't know
+// are passed to 'device'; with a null device they fail and return false.
+bool ComputeCopyableFootprints(
+	ID3D12Device* device,
+	const D3D12_RESOURCE_DESC& desc,
+	UINT first_subresource,
+	UINT subresource_count,
+	UINT64 base_offset,
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts,
+	UINT* row_counts,
+	UINT64* row_sizes,
+	UINT64* total_bytes);
+
+// Upload buffer size for the subresources, like d3dx12's GetRequiredIntermediateSize
+// but without a resource or device round trip; 0 if the format is unknown and no device given
+UINT64 ComputeIntermediateSize(
+	ID3D12Device* device,
+	const D3D12_RESOURCE_DESC& desc,
+	UINT first_subresource,
+	UINT subresource_count);
+
+#endif // !D3D12_FOOTPRINTS_H
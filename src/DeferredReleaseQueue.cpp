@@ -0,0 +1,91 @@
+#include "DeferredReleaseQueue.h"
+#include <cassert>
+
+DeferredReleaseQueue::DeferredReleaseQueue(GpuHeapAllocator& allocator)
+	:
+	allocator_(allocator)
+{ }
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	ReleaseAll();
+}
+
+void DeferredReleaseQueue::Release(ComPtr<IUnknown> object, UINT64 fence_value)
+{
+	Entry entry;
+	entry.fence_value = fence_value;
+	entry.object = std::move(object);
+	Push(std::move(entry));
+}
+
+void DeferredReleaseQueue::Release(GpuAllocation&& allocation, UINT64 fence_value)
+{
+	Entry entry;
+	entry.fence_value = fence_value;
+	entry.allocation = std::move(allocation);
+	allocation = GpuAllocation{};
+	Push(std::move(entry));
+}
+
+void DeferredReleaseQueue::Release(std::function<void()> deleter, UINT64 fence_value)
+{
+	Entry entry;
+	entry.fence_value = fence_value;
+	entry.deleter = std::move(deleter);
+	Push(std::move(entry));
+}
+
+size_t DeferredReleaseQueue::Collect(UINT64 completed_fence_value)
+{
+	size_t count = 0;
+	while (!entries_.empty() && entries_.front().fence_value <= completed_fence_value)
+	{
+		Destroy(entries_.front());
+		entries_.pop_front();
+		++count;
+	}
+	return count;
+}
+
+void DeferredReleaseQueue::ReleaseAll()
+{
+	// Deleters may queue further releases, so destroy from a local copy and
+	// repeat until nothing new was added
+	while (!entries_.empty())
+	{
+		std::deque<Entry> entries;
+		entries.swap(entries_);
+		for (Entry& entry : entries)
+		{
+			Destroy(entry);
+		}
+	}
+}
+
+bool DeferredReleaseQueue::IsEmpty() const
+{
+	return entries_.empty();
+}
+
+UINT64 DeferredReleaseQueue::GetLastFenceValue() const
+{
+	return entries_.empty() ? 0 : entries_.back().fence_value;
+}
+
+void DeferredReleaseQueue::Push(Entry&& entry)
+{
+	assert((entries_.empty() || entries_.back().fence_value <= entry.fence_value) && "Fence values must not decrease.");
+	entries_.push_back(std::move(entry));
+}
+
+void DeferredReleaseQueue::Destroy(Entry& entry)
+{
+	entry.object.Reset();
+	allocator_.Free(entry.allocation);
+	if (entry.deleter)
+	{
+		entry.deleter();
+		entry.deleter = nullptr;
+	}
+}
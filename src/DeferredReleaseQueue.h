@@ -0,0 +1,55 @@
+#ifndef DEFERRED_RELEASE_QUEUE_H
+#define DEFERRED_RELEASE_QUEUE_H
+
+#include "LeanWin32.h"
+#include "GpuHeapAllocator.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <deque>
+#include <functional>
+
+using namespace Microsoft::WRL;
+
+// Parks objects the CPU is done with until the GPU is done with them too.
+// Every entry is tagged with the fence value that will be signalled after the
+// last command list that could reference it; Collect() frees, in bulk, all
+// entries whose value the fence has reached. Fence values handed in must
+// never decrease, which keeps the queue sorted and Collect() a pop-front loop.
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue(GpuHeapAllocator& allocator);
+	DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+	~DeferredReleaseQueue();
+
+	void Release(ComPtr<IUnknown> object, UINT64 fence_value);
+	void Release(GpuAllocation&& allocation, UINT64 fence_value);
+	// For things that are not COM objects, e.g. returning a descriptor slot
+	void Release(std::function<void()> deleter, UINT64 fence_value);
+
+	// Frees everything the GPU has finished with; returns how many entries went
+	size_t Collect(UINT64 completed_fence_value);
+	// Frees everything, only call once the GPU is idle
+	void ReleaseAll();
+
+	bool IsEmpty() const;
+	// Fence value the GPU has to reach before the queue can be fully drained
+	UINT64 GetLastFenceValue() const;
+private:
+	struct Entry
+	{
+		UINT64 fence_value = 0;
+		ComPtr<IUnknown> object;
+		GpuAllocation allocation;
+		std::function<void()> deleter;
+	};
+private:
+	void Push(Entry&& entry);
+	void Destroy(Entry& entry);
+private:
+	GpuHeapAllocator& allocator_;
+	std::deque<Entry> entries_;
+};
+
+#endif // !DEFERRED_RELEASE_QUEUE_H
@@ -0,0 +1,69 @@
+#include "DescriptorIndexAllocator.h"
+#include <cassert>
+
+DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t capacity)
+	:
+	generations_(capacity, 0),
+	in_use_(capacity, false)
+{
+	assert(capacity > 0 && capacity <= kMaxCapacity && "Descriptor table capacity out of range.");
+
+	// Pop from the back, so hand out low indices first
+	free_indices_.reserve(capacity);
+	for (uint32_t i = capacity; i > 0; --i)
+	{
+		free_indices_.push_back(i - 1);
+	}
+}
+
+DescriptorIndexAllocator::Handle DescriptorIndexAllocator::Allocate()
+{
+	if (free_indices_.empty())
+	{
+		return Handle{};
+	}
+
+	const uint32_t index = free_indices_.back();
+	free_indices_.pop_back();
+	in_use_[index] = true;
+
+	Handle handle;
+	handle.value = (static_cast<uint32_t>(generations_[index]) << kIndexBits) | index;
+	// Generation kGenerationMask on the last index would equal the null handle
+	if (handle.IsNull())
+	{
+		generations_[index] = 0;
+		handle.value = index;
+	}
+	return handle;
+}
+
+void DescriptorIndexAllocator::Free(Handle handle)
+{
+	assert(IsValid(handle) && "Freeing a stale or null descriptor handle.");
+
+	const uint32_t index = handle.Index();
+	in_use_[index] = false;
+	generations_[index] = static_cast<uint16_t>((generations_[index] + 1) & kGenerationMask);
+	free_indices_.push_back(index);
+}
+
+bool DescriptorIndexAllocator::IsValid(Handle handle) const
+{
+	if (handle.IsNull())
+	{
+		return false;
+	}
+	const uint32_t index = handle.Index();
+	return index < in_use_.size() && in_use_[index] && generations_[index] == handle.Generation();
+}
+
+uint32_t DescriptorIndexAllocator::GetCapacity() const
+{
+	return static_cast<uint32_t>(in_use_.size());
+}
+
+uint32_t DescriptorIndexAllocator::GetAllocatedCount() const
+{
+	return GetCapacity() - static_cast<uint32_t>(free_indices_.size());
+}
@@ -0,0 +1,49 @@
+#ifndef DESCRIPTOR_INDEX_ALLOCATOR_H
+#define DESCRIPTOR_INDEX_ALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+// Hands out stable slots in a fixed-size descriptor table. Each slot carries a
+// generation that is bumped when it is freed, so a stale handle to a reused
+// slot can be detected instead of silently pointing at someone else's texture.
+// Pure bookkeeping, no GPU objects involved.
+class DescriptorIndexAllocator
+{
+public:
+	// 20 bits of index covers the 1,000,000 descriptor limit of a
+	// shader-visible heap; the remaining 12 bits are the generation
+	static constexpr uint32_t kIndexBits = 20;
+	static constexpr uint32_t kMaxCapacity = 1u << kIndexBits;
+
+	struct Handle
+	{
+		uint32_t value = UINT32_MAX;
+
+		// Slot in the descriptor table; what shaders and materials store
+		uint32_t Index() const { return value & (kMaxCapacity - 1); }
+		uint32_t Generation() const { return value >> kIndexBits; }
+		bool IsNull() const { return value == UINT32_MAX; }
+
+		bool operator==(const Handle& rhs) const { return value == rhs.value; }
+		bool operator!=(const Handle& rhs) const { return value != rhs.value; }
+	};
+public:
+	DescriptorIndexAllocator(uint32_t capacity);
+
+	// Null handle when every slot is in use
+	Handle Allocate();
+	void Free(Handle handle);
+	bool IsValid(Handle handle) const;
+
+	uint32_t GetCapacity() const;
+	uint32_t GetAllocatedCount() const;
+private:
+	static constexpr uint32_t kGenerationMask = (1u << (32 - kIndexBits)) - 1;
+
+	std::vector<uint16_t> generations_;
+	std::vector<uint32_t> free_indices_;
+	std::vector<bool> in_use_;
+};
+
+#endif // !DESCRIPTOR_INDEX_ALLOCATOR_H
@@ -0,0 +1,140 @@
+#include "DeviceCapabilities.h"
+#include "Hash.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<DeviceCapabilities>, "DeviceCapabilities is written to disk byte for byte.");
+static_assert(std::has_unique_object_representations_v<DeviceCapabilities>, "Padding bytes would be hashed uninitialized.");
+
+namespace
+{
+	constexpr uint32_t kMagic = 0x53504143;	// 'CAPS'
+	// Bump whenever DeviceCapabilities changes layout or meaning
+	constexpr uint32_t kVersion = 1;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t size;		// sizeof(DeviceCapabilities) when written
+		uint32_t reserved;
+		uint64_t checksum;	// Hash64 of the struct bytes
+	};
+}
+
+uint32_t DeviceCapabilities::GetMsaaQualityLevels(uint32_t format, uint32_t sample_count) const
+{
+	const int sample_index = MsaaSampleCountIndex(sample_count);
+	if (sample_index < 0)
+	{
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < kMsaaFormatCount; ++i)
+	{
+		if (kMsaaFormats[i] == format)
+		{
+			return msaa_quality_levels[i][sample_index];
+		}
+	}
+	return 0;
+}
+
+int DeviceCapabilities::MsaaSampleCountIndex(uint32_t sample_count)
+{
+	switch (sample_count)
+	{
+		case 2: return 0;
+		case 4: return 1;
+		case 8: return 2;
+	}
+	return -1;
+}
+
+std::vector<unsigned char> SerializeCapabilities(const DeviceCapabilities& capabilities)
+{
+	Header header{};
+	header.magic = kMagic;
+	header.version = kVersion;
+	header.size = sizeof(DeviceCapabilities);
+	header.checksum = Hash64(&capabilities, sizeof(capabilities));
+
+	std::vector<unsigned char> data(sizeof(Header) + sizeof(DeviceCapabilities));
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(Header), &capabilities, sizeof(capabilities));
+	return data;
+}
+
+bool DeserializeCapabilities(
+	const void* data,
+	size_t size,
+	uint64_t adapter_luid,
+	uint64_t driver_version,
+	DeviceCapabilities& capabilities)
+{
+	if (size != sizeof(Header) + sizeof(DeviceCapabilities))
+	{
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != kMagic || header.version != kVersion || header.size != sizeof(DeviceCapabilities))
+	{
+		return false;
+	}
+
+	DeviceCapabilities loaded;
+	std::memcpy(&loaded, static_cast<const unsigned char*>(data) + sizeof(Header), sizeof(loaded));
+	if (Hash64(&loaded, sizeof(loaded)) != header.checksum ||
+		loaded.adapter_luid != adapter_luid ||
+		loaded.driver_version != driver_version)
+	{
+		return false;
+	}
+
+	capabilities = loaded;
+	return true;
+}
+
+bool SaveCapabilities(const std::filesystem::path& path, const DeviceCapabilities& capabilities)
+{
+	const std::vector<unsigned char> data = SerializeCapabilities(capabilities);
+
+	// Write next to the real file and swap, so a crash never leaves half a file
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())) || !file.flush())
+		{
+			file.close();
+			std::error_code ignored;
+			std::filesystem::remove(temp_path, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+	return true;
+}
+
+bool LoadCapabilities(const std::filesystem::path& path, uint64_t adapter_luid, uint64_t driver_version, DeviceCapabilities& capabilities)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	const std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return DeserializeCapabilities(data.data(), data.size(), adapter_luid, driver_version, capabilities);
+}
@@ -0,0 +1,70 @@
+#ifndef DEVICE_CAPABILITIES_H
+#define DEVICE_CAPABILITIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Everything the renderer asks CheckFeatureSupport, captured once per adapter
+// and driver into a flat POD so it can be written to disk as is. Enum fields
+// hold the raw D3D12 values (tiers, shader model, feature level).
+// Serialization is plain bytes plus a checked header; see
+// D3D12Capabilities for filling it from a device.
+struct DeviceCapabilities
+{
+	// Formats whose MSAA quality levels are captured, as DXGI_FORMAT values:
+	// R8G8B8A8_UNORM, B8G8R8A8_UNORM, R16G16B16A16_FLOAT, R11G11B10_FLOAT,
+	// D24_UNORM_S8_UINT, D32_FLOAT
+	static constexpr uint32_t kMsaaFormats[] = { 28, 87, 10, 26, 45, 40 };
+	static constexpr uint32_t kMsaaFormatCount = sizeof(kMsaaFormats) / sizeof(kMsaaFormats[0]);
+	// Sample counts 2, 4 and 8
+	static constexpr uint32_t kMsaaSampleCountCount = 3;
+
+	// Key; a snapshot for another adapter or driver is never used
+	uint64_t adapter_luid = 0;
+	uint64_t driver_version = 0;
+
+	uint32_t max_feature_level = 0;
+	uint32_t highest_shader_model = 0;
+	uint32_t highest_root_signature_version = 0;
+	uint32_t resource_binding_tier = 0;
+	uint32_t resource_heap_tier = 0;
+	uint32_t tiled_resources_tier = 0;
+	uint32_t conservative_rasterization_tier = 0;
+	uint32_t raytracing_tier = 0;
+	uint32_t variable_shading_rate_tier = 0;
+	uint32_t mesh_shader_tier = 0;
+	uint32_t sampler_feedback_tier = 0;
+	uint32_t wave_lane_count_min = 0;
+	uint32_t wave_lane_count_max = 0;
+	uint32_t total_lane_count = 0;
+	uint32_t typed_uav_load_additional_formats = 0;
+	uint32_t rasterizer_ordered_views = 0;
+	uint32_t wave_ops = 0;
+	uint32_t uma = 0;
+	uint32_t cache_coherent_uma = 0;
+	uint32_t reserved = 0;	// Keeps the struct free of padding, which would break the checksum
+	// Quality level counts per kMsaaFormats entry and sample count; 0 = unsupported
+	uint32_t msaa_quality_levels[kMsaaFormatCount][kMsaaSampleCountCount] = {};
+
+	// 0 when the format or sample count wasn't captured
+	uint32_t GetMsaaQualityLevels(uint32_t format, uint32_t sample_count) const;
+	static int MsaaSampleCountIndex(uint32_t sample_count);
+};
+
+// Header + struct bytes + checksum of the struct
+std::vector<unsigned char> SerializeCapabilities(const DeviceCapabilities& capabilities);
+// False if the data is damaged, from another layout version, or for a
+// different adapter LUID or driver version than asked for
+bool DeserializeCapabilities(
+	const void* data,
+	size_t size,
+	uint64_t adapter_luid,
+	uint64_t driver_version,
+	DeviceCapabilities& capabilities);
+
+bool SaveCapabilities(const std::filesystem::path& path, const DeviceCapabilities& capabilities);
+bool LoadCapabilities(const std::filesystem::path& path, uint64_t adapter_luid, uint64_t driver_version, DeviceCapabilities& capabilities);
+
+#endif // !DEVICE_CAPABILITIES_H
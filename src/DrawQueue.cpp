@@ -0,0 +1,224 @@
+#include "DrawQueue.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	// Below this many packets the sort stays on the calling thread
+	constexpr uint32_t kParallelThreshold = 32 * 1024;
+	// Fewest packets a sort block gets
+	constexpr uint32_t kMinBlockSize = 16 * 1024;
+}
+
+uint64_t DrawKey::Make(uint32_t pass, uint32_t depth_bucket, uint32_t pipeline, uint32_t material, uint32_t mesh)
+{
+	assert(pass < (1u << kPassBits) && "Pass out of key range.");
+	assert(depth_bucket < (1u << kDepthBits) && "Depth bucket out of key range.");
+	assert(pipeline < (1u << kPipelineBits) && "Pipeline out of key range.");
+	assert(material < (1u << kMaterialBits) && "Material out of key range.");
+	assert(mesh < (1u << kMeshBits) && "Mesh out of key range.");
+	return uint64_t(pass) << kPassShift |
+		uint64_t(depth_bucket) << kDepthShift |
+		uint64_t(pipeline) << kPipelineShift |
+		uint64_t(material) << kMaterialShift |
+		uint64_t(mesh) << kMeshShift;
+}
+
+uint32_t DrawKey::DepthBucket(float view_depth, float near_z, float far_z, bool back_to_front)
+{
+	assert(near_z > 0.0f && far_z > near_z && "Depth range must be positive and non-empty.");
+	constexpr uint32_t kLastBucket = (1u << kDepthBits) - 1;
+	const float t = std::log(std::max(view_depth, near_z) / near_z) / std::log(far_z / near_z);
+	const uint32_t bucket = uint32_t(std::min(t, 1.0f) * float(kLastBucket));
+	return back_to_front ? kLastBucket - bucket : bucket;
+}
+
+void DrawQueue::Reset()
+{
+	packets_.clear();
+}
+
+void DrawQueue::Reserve(uint32_t count)
+{
+	packets_.reserve(count);
+}
+
+void DrawQueue::Push(uint64_t key, uint32_t payload)
+{
+	packets_.push_back({ key, payload });
+}
+
+void DrawQueue::Push(const Packet* packets, uint32_t count)
+{
+	packets_.insert(packets_.end(), packets, packets + count);
+}
+
+void DrawQueue::Sort(ThreadPool* pool)
+{
+	const uint32_t count = GetCount();
+	if (count < 2)
+	{
+		return;
+	}
+
+	// Bits that differ between any two keys; digits without any are skipped
+	uint64_t all_and = ~uint64_t(0);
+	uint64_t all_or = 0;
+	for (const Packet& packet : packets_)
+	{
+		all_and &= packet.key;
+		all_or |= packet.key;
+	}
+	const uint64_t varying = all_and ^ all_or;
+	if (varying == 0)
+	{
+		return;
+	}
+
+	// Each block counts its digits, then scatters them to the offsets its
+	// earlier neighbours left free, so the sort stays stable across blocks
+	uint32_t block_count = 1;
+	if (pool && count >= kParallelThreshold)
+	{
+		block_count = std::clamp(count / kMinBlockSize, 1u, pool->GetThreadCount());
+	}
+	const uint32_t block_size = (count + block_count - 1) / block_count;
+	block_counts_.resize(block_count);
+	scratch_.resize(count);
+
+	Packet* source = packets_.data();
+	Packet* destination = scratch_.data();
+	for (uint32_t digit = 0; digit < kDigitCount; ++digit)
+	{
+		const uint32_t shift = digit * kDigitBits;
+		if (((varying >> shift) & (kBucketCount - 1)) == 0)
+		{
+			continue;
+		}
+
+		const auto count_block = [&](uint32_t block)
+		{
+			uint32_t* buckets = block_counts_[block].buckets;
+			std::fill(buckets, buckets + kBucketCount, 0u);
+			const uint32_t end = std::min(count, (block + 1) * block_size);
+			for (uint32_t i = block * block_size; i < end; ++i)
+			{
+				++buckets[(source[i].key >> shift) & (kBucketCount - 1)];
+			}
+		};
+		const auto scatter_block = [&](uint32_t block)
+		{
+			uint32_t offsets[kBucketCount];
+			std::copy(block_counts_[block].buckets, block_counts_[block].buckets + kBucketCount, offsets);
+			const uint32_t end = std::min(count, (block + 1) * block_size);
+			for (uint32_t i = block * block_size; i < end; ++i)
+			{
+				destination[offsets[(source[i].key >> shift) & (kBucketCount - 1)]++] = source[i];
+			}
+		};
+
+		if (block_count == 1)
+		{
+			count_block(0);
+		}
+		else
+		{
+			pool->ParallelFor(block_count, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t block = begin; block < end; ++block)
+				{
+					count_block(block);
+				}
+			});
+		}
+
+		// Counts become each block's first offset per bucket
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < kBucketCount; ++bucket)
+		{
+			for (BlockCounts& counts : block_counts_)
+			{
+				const uint32_t bucket_count = counts.buckets[bucket];
+				counts.buckets[bucket] = offset;
+				offset += bucket_count;
+			}
+		}
+
+		if (block_count == 1)
+		{
+			scatter_block(0);
+		}
+		else
+		{
+			pool->ParallelFor(block_count, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t block = begin; block < end; ++block)
+				{
+					scatter_block(block);
+				}
+			});
+		}
+		std::swap(source, destination);
+	}
+
+	if (source != packets_.data())
+	{
+		packets_.swap(scratch_);
+	}
+}
+
+DrawSubmitStats DrawQueue::Submit(DrawSubmitter& submitter) const
+{
+	DrawSubmitStats stats;
+	uint32_t pass = UINT32_MAX;
+	uint32_t pipeline = UINT32_MAX;
+	uint32_t material = UINT32_MAX;
+	uint32_t mesh = UINT32_MAX;
+	for (const Packet& packet : packets_)
+	{
+		const uint64_t key = packet.key;
+		if (DrawKey::GetPass(key) != pass)
+		{
+			pass = DrawKey::GetPass(key);
+			pipeline = UINT32_MAX;
+			material = UINT32_MAX;
+			mesh = UINT32_MAX;
+			submitter.SetPass(pass);
+			++stats.pass_changes;
+		}
+		if (DrawKey::GetPipeline(key) != pipeline)
+		{
+			pipeline = DrawKey::GetPipeline(key);
+			material = UINT32_MAX;
+			submitter.SetPipeline(pipeline);
+			++stats.pipeline_changes;
+		}
+		if (DrawKey::GetMaterial(key) != material)
+		{
+			material = DrawKey::GetMaterial(key);
+			submitter.SetMaterial(material);
+			++stats.material_changes;
+		}
+		if (DrawKey::GetMesh(key) != mesh)
+		{
+			mesh = DrawKey::GetMesh(key);
+			submitter.SetMesh(mesh);
+			++stats.mesh_changes;
+		}
+		submitter.Draw(packet.payload);
+		++stats.draws;
+	}
+	return stats;
+}
+
+const DrawQueue::Packet* DrawQueue::GetPackets() const
+{
+	return packets_.data();
+}
+
+uint32_t DrawQueue::GetCount() const
+{
+	return uint32_t(packets_.size());
+}
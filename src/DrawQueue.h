@@ -0,0 +1,114 @@
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Draws for a frame, each reduced to a 64-bit sort key and the index of its
+// payload (constants, instance data, ...) in some caller-owned array. Sorting
+// the keys groups draws sharing state, so submission only rebinds what
+// actually changes from one draw to the next.
+//
+// Key fields, most significant first:
+//   pass          4 bits   render graph pass, or opaque/transparent/... layer
+//   depth bucket 12 bits   coarse view depth; 0 everywhere to sort purely by state
+//   pipeline     16 bits   PSO index
+//   material     16 bits   root bindings index
+//   mesh         16 bits   vertex/index buffer index
+//
+// Sort() is an LSD radix sort on 8-bit digits, split across the thread pool
+// for large queues. Digits that are the same in every key (e.g. the pass bits
+// when all draws are in one pass) are skipped.
+struct DrawKey
+{
+	static constexpr uint32_t kPassBits = 4;
+	static constexpr uint32_t kDepthBits = 12;
+	static constexpr uint32_t kPipelineBits = 16;
+	static constexpr uint32_t kMaterialBits = 16;
+	static constexpr uint32_t kMeshBits = 16;
+
+	static constexpr uint32_t kMeshShift = 0;
+	static constexpr uint32_t kMaterialShift = kMeshShift + kMeshBits;
+	static constexpr uint32_t kPipelineShift = kMaterialShift + kMaterialBits;
+	static constexpr uint32_t kDepthShift = kPipelineShift + kPipelineBits;
+	static constexpr uint32_t kPassShift = kDepthShift + kDepthBits;
+
+	static uint64_t Make(uint32_t pass, uint32_t depth_bucket, uint32_t pipeline, uint32_t material, uint32_t mesh);
+
+	// Bucket for a view depth between near_z and far_z, spaced by log depth
+	// so buckets near the camera are finer. back_to_front reverses the order,
+	// for blended passes.
+	static uint32_t DepthBucket(float view_depth, float near_z, float far_z, bool back_to_front = false);
+
+	static uint32_t GetPass(uint64_t key) { return uint32_t(key >> kPassShift) & ((1u << kPassBits) - 1); }
+	static uint32_t GetDepthBucket(uint64_t key) { return uint32_t(key >> kDepthShift) & ((1u << kDepthBits) - 1); }
+	static uint32_t GetPipeline(uint64_t key) { return uint32_t(key >> kPipelineShift) & ((1u << kPipelineBits) - 1); }
+	static uint32_t GetMaterial(uint64_t key) { return uint32_t(key >> kMaterialShift) & ((1u << kMaterialBits) - 1); }
+	static uint32_t GetMesh(uint64_t key) { return uint32_t(key >> kMeshShift) & ((1u << kMeshBits) - 1); }
+};
+
+// Receives the sorted draws from DrawQueue::Submit(). Each Set call comes
+// only when its field differs from the previous draw, except that a new pass
+// resets everything below it and a new pipeline (possibly with another root
+// signature) also resets the material.
+class DrawSubmitter
+{
+public:
+	virtual ~DrawSubmitter() = default;
+
+	virtual void SetPass(uint32_t pass) = 0;
+	virtual void SetPipeline(uint32_t pipeline) = 0;
+	virtual void SetMaterial(uint32_t material) = 0;
+	virtual void SetMesh(uint32_t mesh) = 0;
+	virtual void Draw(uint32_t payload) = 0;
+};
+
+struct DrawSubmitStats
+{
+	uint32_t draws = 0;
+	uint32_t pass_changes = 0;
+	uint32_t pipeline_changes = 0;
+	uint32_t material_changes = 0;
+	uint32_t mesh_changes = 0;
+};
+
+class DrawQueue
+{
+public:
+	struct Packet
+	{
+		uint64_t key;
+		uint32_t payload;
+	};
+public:
+	// Keeps the memory for the next frame
+	void Reset();
+	void Reserve(uint32_t count);
+	void Push(uint64_t key, uint32_t payload);
+	void Push(const Packet* packets, uint32_t count);
+
+	// Stable: draws with equal keys keep their push order
+	void Sort(ThreadPool* pool = nullptr);
+	// Walks the packets in order; call after Sort()
+	DrawSubmitStats Submit(DrawSubmitter& submitter) const;
+
+	const Packet* GetPackets() const;
+	uint32_t GetCount() const;
+private:
+	static constexpr uint32_t kDigitBits = 8;
+	static constexpr uint32_t kDigitCount = 64 / kDigitBits;
+	static constexpr uint32_t kBucketCount = 1u << kDigitBits;
+
+	struct BlockCounts
+	{
+		uint32_t buckets[kBucketCount];
+	};
+private:
+	std::vector<Packet> packets_;
+	std::vector<Packet> scratch_;	// Sort ping-pong buffer
+	std::vector<BlockCounts> block_counts_;	// Per sort block
+};
+
+#endif // !DRAW_QUEUE_H
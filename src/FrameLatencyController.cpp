@@ -0,0 +1,82 @@
+#include "FrameLatencyController.h"
+#include "Presenter.h"
+#include <algorithm>
+#include <cassert>
+
+FrameLatencyController::FrameLatencyController()
+	:
+	FrameLatencyController(Settings{})
+{ }
+
+FrameLatencyController::FrameLatencyController(const Settings& settings)
+	:
+	settings_(settings),
+	latency_(std::clamp(settings.initial_latency, settings.min_latency, settings.max_latency))
+{
+	assert(settings_.min_latency >= 1 && settings_.min_latency <= settings_.max_latency && "Invalid latency range.");
+	assert(settings_.window_frames > 0 && "The window needs at least one frame.");
+}
+
+uint32_t FrameLatencyController::OnFrame(double wait_ms, double frame_ms, double refresh_ms)
+{
+	++frames_;
+	wait_sum_ms_ += wait_ms;
+	if (frame_ms > refresh_ms * settings_.miss_factor)
+	{
+		++missed_;
+	}
+
+	if (frames_ < settings_.window_frames)
+	{
+		return latency_;
+	}
+
+	const double miss_rate = static_cast<double>(missed_) / static_cast<double>(frames_);
+	const double average_wait_ms = wait_sum_ms_ / static_cast<double>(frames_);
+
+	if (miss_rate > settings_.miss_tolerance)
+	{
+		if (latency_ < settings_.max_latency)
+		{
+			++latency_;
+		}
+		hold_ = settings_.hold_windows;
+	}
+	else if (hold_ > 0)
+	{
+		--hold_;
+	}
+	else if (missed_ == 0 && average_wait_ms > refresh_ms * settings_.idle_fraction && latency_ > settings_.min_latency)
+	{
+		--latency_;
+	}
+
+	ResetWindow();
+	return latency_;
+}
+
+void FrameLatencyController::Update(Presenter& presenter, double wait_ms, double frame_ms)
+{
+	const uint32_t latency = OnFrame(wait_ms, frame_ms, presenter.GetRefreshIntervalMs());
+	if (latency != presenter.GetMaximumFrameLatency())
+	{
+		presenter.SetMaximumFrameLatency(latency);
+	}
+}
+
+uint32_t FrameLatencyController::GetLatency() const
+{
+	return latency_;
+}
+
+const FrameLatencyController::Settings& FrameLatencyController::GetSettings() const
+{
+	return settings_;
+}
+
+void FrameLatencyController::ResetWindow()
+{
+	frames_ = 0;
+	missed_ = 0;
+	wait_sum_ms_ = 0.0;
+}
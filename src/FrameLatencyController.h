@@ -0,0 +1,51 @@
+#ifndef FRAME_LATENCY_CONTROLLER_H
+#define FRAME_LATENCY_CONTROLLER_H
+
+#include <cstdint>
+
+class Presenter;
+
+// Picks the swap chain's maximum frame latency from how recent frames went.
+// Every window of frames:
+//  - too many frames missed their refresh: queue one more frame, and hold
+//    that for a few windows so the two rules don't fight
+//  - no misses and the CPU spent a good part of each refresh blocked on the
+//    waitable object: the queue is deeper than needed, drop a frame of input lag
+// Pure policy; it only ever sees numbers, so it runs against any Presenter.
+class FrameLatencyController
+{
+public:
+	struct Settings
+	{
+		uint32_t min_latency = 1;
+		uint32_t max_latency = 3;
+		uint32_t initial_latency = 2;
+		uint32_t window_frames = 60;
+		uint32_t hold_windows = 4;		// Windows to stay put after raising the latency
+		double miss_factor = 1.5;		// Frame intervals above this many refreshes count as missed
+		double miss_tolerance = 0.05;	// Fraction of missed frames that raises the latency
+		double idle_fraction = 0.25;	// Average wait, in refreshes, that lowers it
+	};
+public:
+	FrameLatencyController();
+	FrameLatencyController(const Settings& settings);
+
+	// Feeds one frame; returns the latency to use from now on
+	uint32_t OnFrame(double wait_ms, double frame_ms, double refresh_ms);
+	// OnFrame() with the presenter's own numbers, applying any change to it
+	void Update(Presenter& presenter, double wait_ms, double frame_ms);
+
+	uint32_t GetLatency() const;
+	const Settings& GetSettings() const;
+private:
+	void ResetWindow();
+private:
+	Settings settings_;
+	uint32_t latency_;
+	uint32_t frames_ = 0;
+	uint32_t missed_ = 0;
+	double wait_sum_ms_ = 0.0;
+	uint32_t hold_ = 0;
+};
+
+#endif // !FRAME_LATENCY_CONTROLLER_H
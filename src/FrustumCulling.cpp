@@ -0,0 +1,348 @@
+#include "FrustumCulling.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Batches per ParallelFor chunk; each chunk compacts its own results
+	constexpr uint32_t kChunkBatches = 256;
+
+	Vec4 NormalizePlane(const Vec4& plane)
+	{
+		return plane / Length(Vec3(plane.x, plane.y, plane.z));
+	}
+
+	// Bit i set for the lanes of batch 'batch' that hold one of the 'count'
+	// objects
+	uint32_t LaneMask(uint32_t batch, uint32_t count)
+	{
+		const uint32_t lanes = std::min<uint32_t>(count - batch * uint32_t(kBatchWidth), uint32_t(kBatchWidth));
+		return (1u << lanes) - 1;
+	}
+
+	uint32_t AppendLanes(uint32_t bits, uint32_t first_index, uint32_t* visible)
+	{
+		uint32_t written = 0;
+		for (; bits != 0; bits &= bits - 1)
+		{
+			visible[written++] = first_index + static_cast<uint32_t>(std::countr_zero(bits));
+		}
+		return written;
+	}
+
+	// How far the object reaches past its center towards the plane normal
+	float Reach(const AabbBatch& batch, uint32_t lane, const Vec4& plane)
+	{
+		return std::abs(plane.x) * batch.extent.x[lane] +
+			std::abs(plane.y) * batch.extent.y[lane] +
+			std::abs(plane.z) * batch.extent.z[lane];
+	}
+
+	float Reach(const SphereBatch& batch, uint32_t lane, const Vec4&)
+	{
+		return batch.radius[lane];
+	}
+
+	template<typename Batch>
+	uint32_t CullScalar(const Frustum& frustum, const Batch* batches, uint32_t begin, uint32_t end, uint32_t count, uint32_t* visible)
+	{
+		uint32_t written = 0;
+		for (uint32_t b = begin; b < end; ++b)
+		{
+			const Batch& batch = batches[b];
+			uint32_t bits = 0;
+			for (uint32_t lane = 0; lane < kBatchWidth; ++lane)
+			{
+				bool inside = true;
+				for (const Vec4& plane : frustum.planes)
+				{
+					const float distance = plane.x * batch.center.x[lane] + plane.y * batch.center.y[lane] + plane.z * batch.center.z[lane] + plane.w;
+					inside = inside && distance + Reach(batch, lane, plane) >= 0.0f;
+				}
+				bits |= uint32_t(inside) << lane;
+			}
+			written += AppendLanes(bits & LaneMask(b, count), b * uint32_t(kBatchWidth), visible + written);
+		}
+		return written;
+	}
+
+#if SIMD_X86
+	// For each 8-bit lane mask, the set lanes' numbers packed 3 bits apiece,
+	// lowest first
+	constexpr auto kCompactLanes = []
+	{
+		std::array<uint32_t, 256> table = {};
+		for (uint32_t mask = 0; mask < 256; ++mask)
+		{
+			uint32_t written = 0;
+			for (uint32_t lane = 0; lane < 8; ++lane)
+			{
+				if (mask & (1u << lane))
+				{
+					table[mask] |= lane << (3 * written++);
+				}
+			}
+		}
+		return table;
+	}();
+
+	template<typename Batch>
+	uint32_t CullSse2(const Frustum& frustum, const Batch* batches, uint32_t begin, uint32_t end, uint32_t count, uint32_t* visible)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		uint32_t written = 0;
+		for (uint32_t b = begin; b < end; ++b)
+		{
+			const Batch& batch = batches[b];
+			uint32_t bits = 0;
+			for (uint32_t half = 0; half < kBatchWidth; half += 4)
+			{
+				const __m128 x = _mm_load_ps(batch.center.x + half);
+				const __m128 y = _mm_load_ps(batch.center.y + half);
+				const __m128 z = _mm_load_ps(batch.center.z + half);
+				__m128 outside = zero;
+				for (const Vec4& plane : frustum.planes)
+				{
+					__m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+					distance = _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(plane.y)), distance);
+					distance = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), distance);
+					if constexpr (std::is_same_v<Batch, SphereBatch>)
+					{
+						distance = _mm_add_ps(_mm_load_ps(batch.radius + half), distance);
+					}
+					else
+					{
+						distance = _mm_add_ps(_mm_mul_ps(_mm_load_ps(batch.extent.x + half), _mm_set1_ps(std::abs(plane.x))), distance);
+						distance = _mm_add_ps(_mm_mul_ps(_mm_load_ps(batch.extent.y + half), _mm_set1_ps(std::abs(plane.y))), distance);
+						distance = _mm_add_ps(_mm_mul_ps(_mm_load_ps(batch.extent.z + half), _mm_set1_ps(std::abs(plane.z))), distance);
+					}
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+				}
+				bits |= uint32_t(~_mm_movemask_ps(outside) & 0xF) << half;
+			}
+			written += AppendLanes(bits & LaneMask(b, count), b * uint32_t(kBatchWidth), visible + written);
+		}
+		return written;
+	}
+
+	template<typename Batch>
+	SIMD_TARGET_AVX2 uint32_t CullAvx(const Frustum& frustum, const Batch* batches, uint32_t begin, uint32_t end, uint32_t count, uint32_t* visible)
+	{
+		// Splatted once; the loop below reloads them from the stack, which is
+		// as cheap as broadcasting the scalars again
+		__m256 normals[Frustum::kPlaneCount][3];
+		__m256 abs_normals[Frustum::kPlaneCount][3];
+		__m256 offsets[Frustum::kPlaneCount];
+		for (int p = 0; p < Frustum::kPlaneCount; ++p)
+		{
+			const Vec4& plane = frustum.planes[p];
+			normals[p][0] = _mm256_set1_ps(plane.x);
+			normals[p][1] = _mm256_set1_ps(plane.y);
+			normals[p][2] = _mm256_set1_ps(plane.z);
+			abs_normals[p][0] = _mm256_set1_ps(std::abs(plane.x));
+			abs_normals[p][1] = _mm256_set1_ps(std::abs(plane.y));
+			abs_normals[p][2] = _mm256_set1_ps(std::abs(plane.z));
+			offsets[p] = _mm256_set1_ps(plane.w);
+		}
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i lane_shifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const __m256i first_lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i seven = _mm256_set1_epi32(7);
+		uint32_t written = 0;
+		for (uint32_t b = begin; b < end; ++b)
+		{
+			const Batch& batch = batches[b];
+			const __m256 x = _mm256_load_ps(batch.center.x);
+			const __m256 y = _mm256_load_ps(batch.center.y);
+			const __m256 z = _mm256_load_ps(batch.center.z);
+			__m256 outside = zero;
+			for (int p = 0; p < Frustum::kPlaneCount; ++p)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(x, normals[p][0]), offsets[p]);
+				distance = _mm256_add_ps(_mm256_mul_ps(y, normals[p][1]), distance);
+				distance = _mm256_add_ps(_mm256_mul_ps(z, normals[p][2]), distance);
+				if constexpr (std::is_same_v<Batch, SphereBatch>)
+				{
+					distance = _mm256_add_ps(_mm256_load_ps(batch.radius), distance);
+				}
+				else
+				{
+					distance = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(batch.extent.x), abs_normals[p][0]), distance);
+					distance = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(batch.extent.y), abs_normals[p][1]), distance);
+					distance = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(batch.extent.z), abs_normals[p][2]), distance);
+				}
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+			}
+			const uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & LaneMask(b, count);
+			if ((b + 1) * uint32_t(kBatchWidth) > count)
+			{
+				written += AppendLanes(bits, b * uint32_t(kBatchWidth), visible + written);
+				continue;
+			}
+			// Visible indices shuffled to the front and all eight lanes stored,
+			// without a branch per object. The lanes past the visible ones are
+			// overwritten by the next batch; they never pass this batch's end.
+			const __m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(kCompactLanes[bits])), lane_shifts), seven);
+			const __m256i indices = _mm256_add_epi32(_mm256_permutevar8x32_epi32(first_lane, lanes), _mm256_set1_epi32(static_cast<int>(b * kBatchWidth)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + written), indices);
+			written += static_cast<uint32_t>(std::popcount(bits));
+		}
+		return written;
+	}
+#endif
+
+	template<typename Batch>
+	uint32_t CullBatches(SimdLevel level, const Frustum& frustum, const Batch* batches, uint32_t begin, uint32_t end, uint32_t count, uint32_t* visible)
+	{
+#if SIMD_X86
+		if (level == SimdLevel::kAvx2)
+		{
+			return CullAvx(frustum, batches, begin, end, count, visible);
+		}
+		if (level == SimdLevel::kSse2)
+		{
+			return CullSse2(frustum, batches, begin, end, count, visible);
+		}
+#endif
+		return CullScalar(frustum, batches, begin, end, count, visible);
+	}
+
+	template<typename Batch>
+	uint32_t Cull(const Frustum& frustum, const Batch* batches, uint32_t count, uint32_t* visible, ThreadPool* pool, SimdLevel level)
+	{
+		level = ClampSimdLevel(level);
+		const uint32_t batch_count = static_cast<uint32_t>(BatchCount(count));
+		const uint32_t chunk_count = (batch_count + kChunkBatches - 1) / kChunkBatches;
+		if (!pool || pool->GetThreadCount() == 1 || chunk_count < 2)
+		{
+			return CullBatches(level, frustum, batches, 0, batch_count, count, visible);
+		}
+
+		// Every chunk writes at its own first index, where it can't overrun the
+		// next one, then the results are moved down into one list
+		constexpr uint32_t kChunkObjects = kChunkBatches * uint32_t(kBatchWidth);
+		std::vector<uint32_t> chunk_visible(chunk_count);
+		pool->ParallelFor(chunk_count, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t c = begin; c < end; ++c)
+			{
+				const uint32_t batch_end = std::min(batch_count, (c + 1) * kChunkBatches);
+				chunk_visible[c] = CullBatches(level, frustum, batches, c * kChunkBatches, batch_end, count, visible + c * kChunkObjects);
+			}
+		});
+
+		uint32_t written = chunk_visible[0];
+		for (uint32_t c = 1; c < chunk_count; ++c)
+		{
+			std::memmove(visible + written, visible + c * kChunkObjects, chunk_visible[c] * sizeof(uint32_t));
+			written += chunk_visible[c];
+		}
+		return written;
+	}
+}
+
+Frustum ExtractFrustum(const Mat4& view_projection)
+{
+	// Clip coordinates are dot products with the columns; -w <= x <= w,
+	// -w <= y <= w and 0 <= z <= w give the planes (Gribb and Hartmann)
+	const Mat4 columns = Transpose(view_projection);
+	const Vec4& x = columns.rows[0];
+	const Vec4& y = columns.rows[1];
+	const Vec4& z = columns.rows[2];
+	const Vec4& w = columns.rows[3];
+
+	Frustum frustum;
+	frustum.planes[Frustum::kLeft] = NormalizePlane(w + x);
+	frustum.planes[Frustum::kRight] = NormalizePlane(w - x);
+	frustum.planes[Frustum::kBottom] = NormalizePlane(w + y);
+	frustum.planes[Frustum::kTop] = NormalizePlane(w - y);
+	frustum.planes[Frustum::kNear] = NormalizePlane(z);
+	frustum.planes[Frustum::kFar] = NormalizePlane(w - z);
+	return frustum;
+}
+
+bool Intersects(const Frustum& frustum, const Aabb& box)
+{
+	if (IsEmpty(box))
+	{
+		return false;
+	}
+	const Vec3 center = Center(box);
+	const Vec3 extent = Extent(box);
+	for (const Vec4& plane : frustum.planes)
+	{
+		const Vec3 normal(plane.x, plane.y, plane.z);
+		if (Dot(normal, center) + plane.w + Dot(Abs(normal), extent) < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Intersects(const Frustum& frustum, const Sphere& sphere)
+{
+	for (const Vec4& plane : frustum.planes)
+	{
+		if (Dot(Vec3(plane.x, plane.y, plane.z), sphere.center) + plane.w + sphere.radius < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void PackAabbs(AabbBatch* dest, const Aabb* src, size_t count)
+{
+	std::fill(dest, dest + BatchCount(count), AabbBatch());
+	for (size_t i = 0; i < count; ++i)
+	{
+		AabbBatch& batch = dest[i / kBatchWidth];
+		const size_t lane = i % kBatchWidth;
+		// A hugely negative extent fails every plane without making NaNs
+		const Vec3 center = IsEmpty(src[i]) ? Vec3() : Center(src[i]);
+		const Vec3 extent = IsEmpty(src[i]) ? Vec3(-FLT_MAX) : Extent(src[i]);
+		batch.center.x[lane] = center.x;
+		batch.center.y[lane] = center.y;
+		batch.center.z[lane] = center.z;
+		batch.extent.x[lane] = extent.x;
+		batch.extent.y[lane] = extent.y;
+		batch.extent.z[lane] = extent.z;
+	}
+}
+
+void PackSpheres(SphereBatch* dest, const Sphere* src, size_t count)
+{
+	std::fill(dest, dest + BatchCount(count), SphereBatch());
+	for (size_t i = 0; i < count; ++i)
+	{
+		SphereBatch& batch = dest[i / kBatchWidth];
+		const size_t lane = i % kBatchWidth;
+		batch.center.x[lane] = src[i].center.x;
+		batch.center.y[lane] = src[i].center.y;
+		batch.center.z[lane] = src[i].center.z;
+		batch.radius[lane] = src[i].radius;
+	}
+}
+
+uint32_t CullAabbs(const Frustum& frustum, const AabbBatch* boxes, uint32_t count, uint32_t* visible, ThreadPool* pool, SimdLevel level)
+{
+	return Cull(frustum, boxes, count, visible, pool, level);
+}
+
+uint32_t CullSpheres(const Frustum& frustum, const SphereBatch* spheres, uint32_t count, uint32_t* visible, ThreadPool* pool, SimdLevel level)
+{
+	return Cull(frustum, spheres, count, visible, pool, level);
+}
@@ -0,0 +1,76 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include "CpuFeatures.h"
+#include "SimdMath.h"
+#include <cstdint>
+
+class ThreadPool;
+
+// View frustum tests for many objects at once. Bounds are kept in SoA blocks
+// of kBatchWidth, so one pass tests eight of them against a plane (AVX), or
+// four at a time with SSE2. The result is the indices of the visible objects,
+// in ascending order, ready to build draws from.
+//
+// Tests are conservative: objects near a frustum corner can pass although
+// they are outside, never the reverse.
+
+// Inside is where dot(plane.xyz, p) + plane.w >= 0; normals are unit length
+struct Frustum
+{
+	enum Plane
+	{
+		kLeft,
+		kRight,
+		kBottom,
+		kTop,
+		kNear,
+		kFar,
+		kPlaneCount
+	};
+
+	Vec4 planes[kPlaneCount];
+};
+
+// Planes of a view-projection matrix in SimdMath's conventions (row vectors,
+// depth in [0, 1]), in the space the matrix transforms from
+Frustum ExtractFrustum(const Mat4& view_projection);
+
+bool Intersects(const Frustum& frustum, const Aabb& box);
+bool Intersects(const Frustum& frustum, const Sphere& sphere);
+
+struct alignas(32) AabbBatch
+{
+	Vec3x8 center;
+	Vec3x8 extent;
+};
+
+struct alignas(32) SphereBatch
+{
+	Vec3x8 center;
+	float radius[kBatchWidth] = {};
+};
+
+// BatchCount(count) blocks. Empty boxes are packed so they are never visible.
+void PackAabbs(AabbBatch* dest, const Aabb* src, size_t count);
+void PackSpheres(SphereBatch* dest, const Sphere* src, size_t count);
+
+// Writes the indices of the visible objects among the first 'count' to
+// 'visible', which needs room for 'count', and returns how many there are.
+// With a pool, blocks of objects are tested on its threads.
+uint32_t CullAabbs(
+	const Frustum& frustum,
+	const AabbBatch* boxes,
+	uint32_t count,
+	uint32_t* visible,
+	ThreadPool* pool = nullptr,
+	SimdLevel level = GetSupportedSimdLevel());
+uint32_t CullSpheres(
+	const Frustum& frustum,
+	const SphereBatch* spheres,
+	uint32_t count,
+	uint32_t* visible,
+	ThreadPool* pool = nullptr,
+	SimdLevel level = GetSupportedSimdLevel());
+
+#endif // !FRUSTUM_CULLING_H
@@ -0,0 +1,205 @@
+#include "GpuHeapAllocator.h"
+#include "ThrowIfFailed.h"
+#include <cassert>
+
+GpuHeapAllocator::Page::Page(UINT64 capacity)
+	:
+	allocator(capacity, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+{ }
+
+GpuHeapAllocator::GpuHeapAllocator(ID3D12Device* device, D3D12_RESOURCE_HEAP_TIER heap_tier, UINT64 page_size)
+	:
+	device_(device),
+	page_size_(page_size),
+	heap_tier_(heap_tier)
+{
+	assert(page_size_ % D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT == 0 && "Page size must be a multiple of 4 MB.");
+}
+
+GpuAllocation GpuHeapAllocator::CreateResource(
+	D3D12_HEAP_TYPE heap_type,
+	const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initial_state,
+	const D3D12_CLEAR_VALUE* clear_value)
+{
+	// Size and alignment (64 KB, or 4 MB for MSAA) as the driver sees them
+	const D3D12_RESOURCE_ALLOCATION_INFO info = device_->GetResourceAllocationInfo(0, 1, &desc);
+	if (info.SizeInBytes == UINT64_MAX)
+	{
+		throw Window::Exception(__LINE__, __FILE__, "Invalid resource description.");
+	}
+
+	const HeapCategory category = CategoryOf(desc);
+
+	std::optional<TlsfAllocator::Allocation> block;
+	UINT page = UINT_MAX;
+	for (UINT i = 0; i < pages_.size() && !block; ++i)
+	{
+		if (pages_[i] && pages_[i]->heap_type == heap_type && pages_[i]->category == category)
+		{
+			block = pages_[i]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+			page = i;
+		}
+	}
+
+	if (!block)
+	{
+		page = CreatePage(heap_type, category, info.SizeInBytes);
+		block = pages_[page]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+		assert(block && "Fresh heap could not fit the resource.");
+	}
+
+	GpuAllocation allocation;
+	allocation.offset = block->offset;
+	allocation.size = block->size;
+	allocation.page = page;
+	allocation.block = block->block;
+
+	const HRESULT hr = device_->CreatePlacedResource(
+		pages_[page]->heap.Get(),
+		block->offset,
+		&desc,
+		initial_state,
+		clear_value,
+		IID_PPV_ARGS(allocation.resource.GetAddressOf()));
+	if (FAILED(hr))
+	{
+		pages_[page]->allocator.Free(*block);
+		ThrowIfFailed(hr);
+	}
+
+	return allocation;
+}
+
+void GpuHeapAllocator::Free(GpuAllocation& allocation)
+{
+	if (!allocation.IsValid())
+	{
+		return;
+	}
+
+	allocation.resource.Reset();
+
+	Page& page = *pages_[allocation.page];
+	page.allocator.Free(TlsfAllocator::Allocation{ allocation.offset, allocation.size, allocation.block });
+
+	// Regular pages stay reserved for reuse; one-off oversized heaps go away
+	if (page.dedicated && page.allocator.IsEmpty())
+	{
+		pages_[allocation.page].reset();
+	}
+
+	allocation = GpuAllocation{};
+}
+
+TlsfAllocator::Statistics GpuHeapAllocator::GetStatistics(D3D12_HEAP_TYPE heap_type) const
+{
+	TlsfAllocator::Statistics total;
+	for (const auto& page : pages_)
+	{
+		if (!page || page->heap_type != heap_type)
+		{
+			continue;
+		}
+
+		const TlsfAllocator::Statistics stats = page->allocator.GetStatistics();
+		total.capacity += stats.capacity;
+		total.used_bytes += stats.used_bytes;
+		total.free_bytes += stats.free_bytes;
+		total.allocation_count += stats.allocation_count;
+		total.free_block_count += stats.free_block_count;
+		if (stats.largest_free_block > total.largest_free_block)
+		{
+			total.largest_free_block = stats.largest_free_block;
+		}
+	}
+
+	if (total.free_bytes > 0)
+	{
+		total.fragmentation = 1.0f - static_cast<float>(
+			static_cast<double>(total.largest_free_block) / static_cast<double>(total.free_bytes));
+	}
+
+	return total;
+}
+
+GpuHeapAllocator::HeapCategory GpuHeapAllocator::CategoryOf(const D3D12_RESOURCE_DESC& desc) const
+{
+	if (heap_tier_ >= D3D12_RESOURCE_HEAP_TIER_2)
+	{
+		return HeapCategory::kMixed;
+	}
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return HeapCategory::kBuffers;
+	}
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+	{
+		return HeapCategory::kRenderTargets;
+	}
+	return HeapCategory::kTextures;
+}
+
+UINT GpuHeapAllocator::CreatePage(D3D12_HEAP_TYPE heap_type, HeapCategory category, UINT64 min_size)
+{
+	constexpr UINT64 kMsaaAlignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	const bool dedicated = min_size > page_size_;
+	const UINT64 size = dedicated ? (min_size + kMsaaAlignment - 1) & ~(kMsaaAlignment - 1) : page_size_;
+
+	auto page = std::make_unique<Page>(size);
+	page->heap_type = heap_type;
+	page->category = category;
+	page->dedicated = dedicated;
+
+	D3D12_HEAP_DESC heap_desc{};
+	heap_desc.SizeInBytes = size;
+	heap_desc.Properties.Type = heap_type;
+	heap_desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heap_desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heap_desc.Properties.CreationNodeMask = 1;
+	heap_desc.Properties.VisibleNodeMask = 1;
+
+	// Only heaps that can hold render targets and depth buffers can hold MSAA
+	// surfaces, so only those need the larger alignment
+	switch (category)
+	{
+		case HeapCategory::kBuffers:
+		{
+			heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		} break;
+
+		case HeapCategory::kTextures:
+		{
+			heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		} break;
+
+		case HeapCategory::kRenderTargets:
+		{
+			heap_desc.Alignment = kMsaaAlignment;
+			heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		} break;
+
+		case HeapCategory::kMixed:
+		{
+			heap_desc.Alignment = heap_type == D3D12_HEAP_TYPE_DEFAULT ? kMsaaAlignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+		} break;
+	}
+
+	ThrowIfFailed(device_->CreateHeap(&heap_desc, IID_PPV_ARGS(page->heap.GetAddressOf())));
+
+	// Reuse a slot left behind by a released dedicated page
+	for (UINT i = 0; i < pages_.size(); ++i)
+	{
+		if (!pages_[i])
+		{
+			pages_[i] = std::move(page);
+			return i;
+		}
+	}
+
+	pages_.push_back(std::move(page));
+	return static_cast<UINT>(pages_.size() - 1);
+}
@@ -0,0 +1,85 @@
+#ifndef GPU_HEAP_ALLOCATOR_H
+#define GPU_HEAP_ALLOCATOR_H
+
+#include "LeanWin32.h"
+#include "TlsfAllocator.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <climits>
+#include <memory>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+// A placed resource and where it lives inside the allocator's heaps.
+// Hand it back to GpuHeapAllocator::Free() once the GPU is done with it.
+struct GpuAllocation
+{
+	ComPtr<ID3D12Resource> resource;
+	UINT64 offset = 0;	// Offset inside the owning ID3D12Heap
+	UINT64 size = 0;
+	UINT page = UINT_MAX;
+	UINT block = TlsfAllocator::kInvalidBlock;
+
+	ID3D12Resource* Get() const { return resource.Get(); }
+	bool IsValid() const { return page != UINT_MAX; }
+};
+
+// Reserves large ID3D12Heaps per heap type and places resources into them with
+// CreatePlacedResource, instead of giving every resource its own implicit heap
+// through CreateCommittedResource. Placement inside a heap is done by a
+// TlsfAllocator, which respects the 64 KB and 4 MB (MSAA) placement alignments.
+class GpuHeapAllocator
+{
+public:
+	// heap_tier comes from DeviceCapabilities::resource_heap_tier
+	GpuHeapAllocator(ID3D12Device* device, D3D12_RESOURCE_HEAP_TIER heap_tier, UINT64 page_size = kDefaultPageSize);
+	GpuHeapAllocator(const GpuHeapAllocator&) = delete;
+	GpuHeapAllocator& operator=(const GpuHeapAllocator&) = delete;
+
+	GpuAllocation CreateResource(
+		D3D12_HEAP_TYPE heap_type,
+		const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initial_state,
+		const D3D12_CLEAR_VALUE* clear_value = nullptr);
+
+	// Releases the resource and returns its range to the heap. The caller is
+	// responsible for making sure the GPU no longer references it.
+	void Free(GpuAllocation& allocation);
+
+	// Totals over every heap of the given type
+	TlsfAllocator::Statistics GetStatistics(D3D12_HEAP_TYPE heap_type) const;
+public:
+	static constexpr UINT64 kDefaultPageSize = 64ull * 1024 * 1024;
+private:
+	// Resource heap tier 1 hardware can't mix buffers, textures and
+	// render target/depth textures in one heap, so each gets its own pages
+	enum class HeapCategory
+	{
+		kBuffers,
+		kTextures,
+		kRenderTargets,
+		kMixed	// Resource heap tier 2
+	};
+
+	struct Page
+	{
+		Page(UINT64 capacity);
+
+		ComPtr<ID3D12Heap> heap;
+		TlsfAllocator allocator;
+		D3D12_HEAP_TYPE heap_type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapCategory category = HeapCategory::kMixed;
+		bool dedicated = false;	// Oversized page created for a single resource
+	};
+private:
+	HeapCategory CategoryOf(const D3D12_RESOURCE_DESC& desc) const;
+	UINT CreatePage(D3D12_HEAP_TYPE heap_type, HeapCategory category, UINT64 min_size);
+private:
+	ID3D12Device* device_;
+	UINT64 page_size_;
+	D3D12_RESOURCE_HEAP_TIER heap_tier_;
+	std::vector<std::unique_ptr<Page>> pages_;
+};
+
+#endif // !GPU_HEAP_ALLOCATOR_H
@@ -0,0 +1,86 @@
+#include "GpuTimestampSource.h"
+#include "ThrowIfFailed.h"
+#include "DirectX12/d3dx12.h"
+
+GpuTimestampSource::GpuTimestampSource(ID3D12Device* device, ID3D12CommandQueue* queue, UINT query_count)
+	:
+	queue_(queue)
+{
+	D3D12_QUERY_HEAP_DESC heap_desc{};
+	heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heap_desc.Count = query_count;
+	heap_desc.NodeMask = 0;
+	ThrowIfFailed(device->CreateQueryHeap(&heap_desc, IID_PPV_ARGS(query_heap_.GetAddressOf())));
+
+	// A few KB; not worth a page of the GpuHeapAllocator's readback heaps
+	const CD3DX12_HEAP_PROPERTIES heap_properties(D3D12_HEAP_TYPE_READBACK);
+	const CD3DX12_RESOURCE_DESC buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(UINT64(query_count) * sizeof(uint64_t));
+	ThrowIfFailed(device->CreateCommittedResource(
+		&heap_properties,
+		D3D12_HEAP_FLAG_NONE,
+		&buffer_desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(readback_.GetAddressOf())));
+
+	// Readback buffers may stay mapped; the profiler only reads ranges the
+	// fence has already covered
+	void* data = nullptr;
+	ThrowIfFailed(readback_->Map(0, nullptr, &data));
+	results_ = static_cast<const uint64_t*>(data);
+
+	ThrowIfFailed(queue_->GetTimestampFrequency(&frequency_));
+	QueryPerformanceFrequency(&qpc_frequency_);
+}
+
+GpuTimestampSource::~GpuTimestampSource()
+{
+	const D3D12_RANGE written{ 0, 0 };
+	readback_->Unmap(0, &written);
+}
+
+void GpuTimestampSource::SetCommandList(ID3D12GraphicsCommandList* command_list)
+{
+	command_list_ = command_list;
+}
+
+void GpuTimestampSource::WriteTimestamp(uint32_t query)
+{
+	command_list_->EndQuery(query_heap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void GpuTimestampSource::Resolve(uint32_t first, uint32_t count)
+{
+	command_list_->ResolveQueryData(
+		query_heap_.Get(),
+		D3D12_QUERY_TYPE_TIMESTAMP,
+		first,
+		count,
+		readback_.Get(),
+		UINT64(first) * sizeof(uint64_t));
+}
+
+const uint64_t* GpuTimestampSource::ReadResults(uint32_t first)
+{
+	return results_ + first;
+}
+
+uint64_t GpuTimestampSource::GetFrequency()
+{
+	return frequency_;
+}
+
+void GpuTimestampSource::Calibrate(uint64_t& gpu_ticks, Profiler::Clock::time_point& cpu_time)
+{
+	// The CPU half comes back as a QueryPerformanceCounter value; walk it
+	// back from 'now' so the result is in the profiler's clock
+	UINT64 qpc = 0;
+	ThrowIfFailed(queue_->GetClockCalibration(&gpu_ticks, &qpc));
+
+	LARGE_INTEGER qpc_now;
+	QueryPerformanceCounter(&qpc_now);
+	const Profiler::Clock::time_point now = Profiler::Clock::now();
+
+	const double elapsed = static_cast<double>(static_cast<INT64>(qpc_now.QuadPart - qpc)) / static_cast<double>(qpc_frequency_.QuadPart);
+	cpu_time = now - std::chrono::duration_cast<Profiler::Clock::duration>(std::chrono::duration<double>(elapsed));
+}
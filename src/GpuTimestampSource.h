@@ -0,0 +1,39 @@
+#ifndef GPU_TIMESTAMP_SOURCE_H
+#define GPU_TIMESTAMP_SOURCE_H
+
+#include "LeanWin32.h"
+#include "Profiler.h"
+#include <d3d12.h>
+#include <wrl.h>
+
+using namespace Microsoft::WRL;
+
+// Profiler::TimestampSource on a D3D12 timestamp query heap. Queries are
+// resolved into a persistently mapped readback buffer laid out like the heap.
+class GpuTimestampSource : public Profiler::TimestampSource
+{
+public:
+	GpuTimestampSource(ID3D12Device* device, ID3D12CommandQueue* queue, UINT query_count);
+	GpuTimestampSource(const GpuTimestampSource&) = delete;
+	GpuTimestampSource& operator=(const GpuTimestampSource&) = delete;
+	~GpuTimestampSource();
+
+	// Command list the timestamps and resolves are recorded on
+	void SetCommandList(ID3D12GraphicsCommandList* command_list);
+
+	void WriteTimestamp(uint32_t query) override;
+	void Resolve(uint32_t first, uint32_t count) override;
+	const uint64_t* ReadResults(uint32_t first) override;
+	uint64_t GetFrequency() override;
+	void Calibrate(uint64_t& gpu_ticks, Profiler::Clock::time_point& cpu_time) override;
+private:
+	ID3D12CommandQueue* queue_;
+	ID3D12GraphicsCommandList* command_list_ = nullptr;
+	ComPtr<ID3D12QueryHeap> query_heap_;
+	ComPtr<ID3D12Resource> readback_;
+	const uint64_t* results_ = nullptr;
+	uint64_t frequency_ = 0;
+	LARGE_INTEGER qpc_frequency_;
+};
+
+#endif // !GPU_TIMESTAMP_SOURCE_H
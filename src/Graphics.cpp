@@ -10,6 +10,8 @@ Graphics::Graphics(HandleKey& handle_key)
 	:
 	back_buffer_format_(DXGI_FORMAT_R8G8B8A8_UNORM),
 	depth_stencil_format_(DXGI_FORMAT_D24_UNORM_S8_UINT),
+	width_(kScreenWidth),
+	height_(kScreenHeight),
 	current_fence_(0)
 {
 #if defined(DEBUG) || (_DEBUG)
@@ -43,95 +45,71 @@ Graphics::Graphics(HandleKey& handle_key)
 	dsv_descriptor_size_ = device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	cbv_srv_descriptor_size_ = device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	// Every feature query at once, or none at all on a warm start
+	capabilities_ = LoadOrQueryDeviceCapabilities(device_.Get(), factory_.Get(), L"DeviceCaps.bin");
+
 	// Check 4X MSAA quality support 
-	D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS ms_quality_levels;
-	ms_quality_levels.Format = back_buffer_format_;
-	ms_quality_levels.SampleCount = 4;
-	ms_quality_levels.Flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE;
-	ms_quality_levels.NumQualityLevels = 0;
-	ThrowIfFailed(device_->CheckFeatureSupport(D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS, &ms_quality_levels, sizeof(ms_quality_levels)));
-	msaa_quality_ = ms_quality_levels.NumQualityLevels;
+	msaa_quality_ = capabilities_.GetMsaaQualityLevels(back_buffer_format_, 4);
 	assert(msaa_quality_ > 0 && "Unexpected MSAA quality level.");
 
+	thread_pool_ = std::make_unique<ThreadPool>();
+	gpu_allocator_ = std::make_unique<GpuHeapAllocator>(
+		device_.Get(),
+		static_cast<D3D12_RESOURCE_HEAP_TIER>(capabilities_.resource_heap_tier));
+	release_queue_ = std::make_unique<DeferredReleaseQueue>(*gpu_allocator_);
+	pipeline_cache_ = std::make_unique<PipelineStateCache>(device_.Get(), L"PipelineLibrary.bin");
+	root_signature_cache_ = std::make_unique<RootSignatureCache>(
+		device_.Get(),
+		static_cast<D3D_ROOT_SIGNATURE_VERSION>(capabilities_.highest_root_signature_version));
+	shader_cache_ = std::make_unique<ShaderCache>(L"Shaders.pak");
+	bindless_heap_ = std::make_unique<BindlessHeap>(
+		device_.Get(),
+		*root_signature_cache_,
+		static_cast<D3D12_RESOURCE_BINDING_TIER>(capabilities_.resource_binding_tier),
+		static_cast<D3D_FEATURE_LEVEL>(capabilities_.max_feature_level));
+	graph_executor_ = std::make_unique<RenderGraphExecutor>(
+		device_.Get(),
+		static_cast<D3D12_RESOURCE_HEAP_TIER>(capabilities_.resource_heap_tier),
+		*release_queue_);
+
 	CreateCommandObjects();
+
+	// One more profiler slot than frames in flight, so reading back never waits
+	constexpr UINT kProfilerSlots = kFrameCount + 1;
+	gpu_timestamps_ = std::make_unique<GpuTimestampSource>(
+		device_.Get(),
+		command_queue_.Get(),
+		Profiler::QueryCountFor(kProfilerSlots, kMaxGpuScopesPerFrame));
+	gpu_timestamps_->SetCommandList(command_list_.Get());
+	profiler_ = std::make_unique<Profiler>(gpu_timestamps_.get(), kProfilerSlots, kMaxGpuScopesPerFrame);
+	graph_executor_->SetProfiler(profiler_.get());
+
+	// Can't queue more frames than there are frame contexts to record them in
+	FrameLatencyController::Settings latency_settings;
+	latency_settings.max_latency = kFrameCount;
+	latency_settings.initial_latency = kFrameCount;
+	latency_controller_ = FrameLatencyController(latency_settings);
 	
 	CreateSwapChain(handle_key.handle_);
 
 	CreateRtvAndDsvDescriptorHeaps();
 
-	// Create Render Target View
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_heap_handle(rtv_heap_->GetCPUDescriptorHandleForHeapStart());
-
-	for (UINT i = 0; i < kFrameCount; ++i)
-	{
-		// Get the ith buffer in the swap chain
-		ThrowIfFailed(swap_chain_->GetBuffer(i, IID_PPV_ARGS(&swap_chain_buffer_[i])));
-
-		// Create an RTV to it
-		device_->CreateRenderTargetView(swap_chain_buffer_[i].Get(), nullptr, rtv_heap_handle);
-
-		// Next entry in the heap
-		rtv_heap_handle.Offset(1, rtv_descriptor_size_);
-	}
-
-	// Create the depth/stencil buffer and view
-	D3D12_RESOURCE_DESC depth_stencil_desc{};
-	depth_stencil_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	depth_stencil_desc.Alignment = 0;
-	depth_stencil_desc.Width = kScreenWidth;
-	depth_stencil_desc.Height = kScreenHeight;
-	depth_stencil_desc.DepthOrArraySize = 1;
-	depth_stencil_desc.MipLevels = 1;
-	depth_stencil_desc.Format = depth_stencil_format_;
-	depth_stencil_desc.SampleDesc.Count = msaa_state_ ? 4 : 1;
-	depth_stencil_desc.SampleDesc.Quality = msaa_state_ ? (msaa_quality_ - 1) : 0;
-	depth_stencil_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-	depth_stencil_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-	D3D12_CLEAR_VALUE opt_clear{};
-	opt_clear.Format = depth_stencil_format_;
-	opt_clear.DepthStencil.Depth = 1.0f;
-	opt_clear.DepthStencil.Stencil = 0;
-
-	auto heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	ThrowIfFailed(device_->CreateCommittedResource(
-		&heap_properties,
-		D3D12_HEAP_FLAG_NONE,
-		&depth_stencil_desc,
-		D3D12_RESOURCE_STATE_COMMON,
-		&opt_clear,
-		IID_PPV_ARGS(depth_stencil_buffer_.GetAddressOf())));
-
-	// Create descriptor to mip level 0 of entire resource using the format of the resource
-	device_->CreateDepthStencilView(depth_stencil_buffer_.Get(), nullptr, DepthStencilView());
-	// Transition the resource from its initial state to be used as a depth buffer
-	auto state_after = CD3DX12_RESOURCE_BARRIER::Transition(
-		depth_stencil_buffer_.Get(),
-		D3D12_RESOURCE_STATE_COMMON,
-		D3D12_RESOURCE_STATE_DEPTH_WRITE);
-	command_list_->ResourceBarrier(1, &state_after);
-
-	// Set the viewport
-	D3D12_VIEWPORT viewport{};
-	viewport.TopLeftX = 0.0f;
-	viewport.TopLeftY = 0.0f;
-	viewport.Width = static_cast<FLOAT>(kScreenWidth);
-	viewport.Height = static_cast<FLOAT>(kScreenHeight);
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-
-	command_list_->RSSetViewports(1, &viewport);
-
-	// Set the scissor rectangles
-	scissor_rect_ = { 0, 0, kScreenWidth / 2, kScreenHeight / 2 };
-	command_list_->RSSetScissorRects(1, &scissor_rect_);
+	CreateBackBufferViews();
+	CreateDepthStencilBuffer();
+	UpdateViewport();
 }
 
 Graphics::~Graphics()
 {
-	if (device_)
+	if (device_ && fence_)
+	{
+		// Every submission is followed by a fence signal, so waiting on the
+		// last signalled value is enough; no need to push and drain a new one
+		WaitForFence(current_fence_);
+	}
+	if (release_queue_)
 	{
-		FlushCommandQueue();
+		release_queue_->ReleaseAll();
 	}
 }
 
@@ -153,17 +131,20 @@ void Graphics::CreateCommandObjects()
 		IID_PPV_ARGS(&command_queue_))
 	);
 
-	ThrowIfFailed(device_->CreateCommandAllocator(
-		D3D12_COMMAND_LIST_TYPE_DIRECT, 
-		IID_PPV_ARGS(command_list_allocator_.GetAddressOf()))
-	);
+	for (FrameContext& frame : frames_)
+	{
+		ThrowIfFailed(device_->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(frame.allocator.GetAddressOf()))
+		);
+	}
 
 
-	// TODO: Provide valid pipeline state object
+	// No initial pipeline state; pipelines are bound per pass from pipeline_cache_
 	ThrowIfFailed(device_->CreateCommandList(
 		0,
 		D3D12_COMMAND_LIST_TYPE_DIRECT,
-		command_list_allocator_.Get(),	// Associated command allocator
+		frames_[0].allocator.Get(),		// Associated command allocator
 		nullptr,						// Initial PipelineStateObject
 		IID_PPV_ARGS(command_list_.GetAddressOf()))
 	);
@@ -176,35 +157,106 @@ void Graphics::CreateCommandObjects()
 
 void Graphics::CreateSwapChain(HWND& handle)
 {
-	// Desribe and create the swap chain
-	DXGI_SWAP_CHAIN_DESC swap_chain_desc = {};
-	
-	// Buffer description
-	swap_chain_desc.BufferDesc.Height = kScreenHeight;
-	swap_chain_desc.BufferDesc.Width = kScreenWidth;
-	swap_chain_desc.BufferDesc.RefreshRate = refresh_rate_;
-	swap_chain_desc.BufferDesc.Format = back_buffer_format_;
-	swap_chain_desc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-	swap_chain_desc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-	
-	// Sample description
-	swap_chain_desc.SampleDesc.Count = msaa_state_ ? 4 : 1;
-	swap_chain_desc.SampleDesc.Quality = msaa_state_ ? (msaa_quality_ - 1) : 0;
-	
-	// Remainder of swap chain desc
-	swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swap_chain_desc.BufferCount = kFrameCount;
-	swap_chain_desc.OutputWindow = handle;
-	swap_chain_desc.Windowed = TRUE;
-	swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-	swap_chain_desc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
-
-	// Note: Swap chain uses queue to perform flush.
-	ThrowIfFailed(factory_->CreateSwapChain(
+	// Start at the window's actual client size rather than the defaults
+	RECT client_rect{};
+	if (GetClientRect(handle, &client_rect) && client_rect.right > 0 && client_rect.bottom > 0)
+	{
+		width_ = static_cast<UINT>(client_rect.right);
+		height_ = static_cast<UINT>(client_rect.bottom);
+	}
+
+	presenter_ = std::make_unique<SwapChainPresenter>(
+		factory_.Get(),
 		command_queue_.Get(),
-		&swap_chain_desc,
-		swap_chain_.GetAddressOf()
-	));
+		handle,
+		width_,
+		height_,
+		back_buffer_format_,
+		kFrameCount,
+		latency_controller_.GetLatency());
+	current_back_buffer_ = presenter_->GetCurrentBackBufferIndex();
+}
+
+void Graphics::CreateBackBufferViews()
+{
+	// Create Render Target View
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_heap_handle(rtv_heap_->GetCPUDescriptorHandleForHeapStart());
+
+	for (UINT i = 0; i < kFrameCount; ++i)
+	{
+		// Get the ith buffer in the swap chain
+		ThrowIfFailed(presenter_->GetSwapChain()->GetBuffer(i, IID_PPV_ARGS(swap_chain_buffer_[i].ReleaseAndGetAddressOf())));
+
+		// Create an RTV to it
+		device_->CreateRenderTargetView(swap_chain_buffer_[i].Get(), nullptr, rtv_heap_handle);
+
+		// Next entry in the heap
+		rtv_heap_handle.Offset(1, rtv_descriptor_size_);
+	}
+}
+
+void Graphics::CreateDepthStencilBuffer()
+{
+	// Create the depth/stencil buffer and view
+	D3D12_RESOURCE_DESC depth_stencil_desc{};
+	depth_stencil_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	depth_stencil_desc.Alignment = 0;
+	depth_stencil_desc.Width = width_;
+	depth_stencil_desc.Height = height_;
+	depth_stencil_desc.DepthOrArraySize = 1;
+	depth_stencil_desc.MipLevels = 1;
+	depth_stencil_desc.Format = depth_stencil_format_;
+	depth_stencil_desc.SampleDesc.Count = msaa_state_ ? 4 : 1;
+	depth_stencil_desc.SampleDesc.Quality = msaa_state_ ? (msaa_quality_ - 1) : 0;
+	depth_stencil_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	depth_stencil_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+	D3D12_CLEAR_VALUE opt_clear{};
+	opt_clear.Format = depth_stencil_format_;
+	opt_clear.DepthStencil.Depth = 1.0f;
+	opt_clear.DepthStencil.Stencil = 0;
+
+	// Created straight in the state it is used in, so no transition has to be recorded
+	depth_stencil_buffer_ = gpu_allocator_->CreateResource(
+		D3D12_HEAP_TYPE_DEFAULT,
+		depth_stencil_desc,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		&opt_clear);
+
+	// Create descriptor to mip level 0 of entire resource using the format of the resource
+	device_->CreateDepthStencilView(depth_stencil_buffer_.Get(), nullptr, DepthStencilView());
+}
+
+void Graphics::UpdateViewport()
+{
+	// Viewport and scissor rectangle, set on the command list every frame
+	viewport_.TopLeftX = 0.0f;
+	viewport_.TopLeftY = 0.0f;
+	viewport_.Width = static_cast<FLOAT>(width_);
+	viewport_.Height = static_cast<FLOAT>(height_);
+	viewport_.MinDepth = 0.0f;
+	viewport_.MaxDepth = 1.0f;
+
+	scissor_rect_ = { 0, 0, static_cast<LONG>(width_ / 2), static_cast<LONG>(height_ / 2) };
+}
+
+void Graphics::AddClearPass()
+{
+	const RenderGraph::PassId pass = render_graph_.AddPass("Clear", [this](RenderGraphContext& context)
+	{
+		constexpr FLOAT kClearColor[] = { 0.1f, 0.1f, 0.15f, 1.0f };
+		ID3D12GraphicsCommandList* command_list = context.GetCommandList();
+		command_list->ClearRenderTargetView(CurrentBackBufferView(), kClearColor, 0, nullptr);
+		command_list->ClearDepthStencilView(
+			DepthStencilView(),
+			D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+			1.0f,
+			0,
+			0,
+			nullptr);
+	});
+	render_graph_.Write(pass, back_buffer_id_, RenderGraph::kRenderTarget);
+	render_graph_.Write(pass, depth_stencil_id_, RenderGraph::kDepthWrite);
 }
 
 void Graphics::CreateRtvAndDsvDescriptorHeaps()
@@ -227,8 +279,213 @@ void Graphics::CreateRtvAndDsvDescriptorHeaps()
 
 }
 
+void Graphics::BeginFrame()
+{
+	if (!frame_waited_)
+	{
+		frame_wait_ms_ = presenter_->WaitForFrame();
+	}
+	frame_waited_ = false;
+
+	// Normally already passed, since the waitable object holds the CPU back first
+	FrameContext& frame = frames_[frame_index_];
+	WaitForFence(frame.fence_value);
+	CollectReleases();
+	profiler_->BeginFrame(fence_->GetCompletedValue());
+
+	ThrowIfFailed(frame.allocator->Reset());
+	ThrowIfFailed(command_list_->Reset(frame.allocator.Get(), nullptr));
+	command_list_->RSSetViewports(1, &viewport_);
+	command_list_->RSSetScissorRects(1, &scissor_rect_);
+
+	render_graph_.Reset();
+	back_buffer_id_ = render_graph_.Import("BackBuffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	depth_stencil_id_ = render_graph_.Import("DepthStencil", RenderGraph::kDepthWrite, RenderGraph::kDepthWrite);
+	graph_executor_->SetImported(back_buffer_id_, swap_chain_buffer_[current_back_buffer_].Get());
+	graph_executor_->SetImported(depth_stencil_id_, depth_stencil_buffer_.Get());
+	AddClearPass();
+}
+
+void Graphics::EndFrame()
+{
+	// Everything recorded below is covered by the next fence signal
+	const UINT64 fence_value = current_fence_ + 1;
+
+	render_graph_.Compile();
+	graph_executor_->Execute(render_graph_, command_list_.Get(), fence_value);
+	profiler_->EndFrame(fence_value);
+
+	ThrowIfFailed(command_list_->Close());
+	ID3D12CommandList* command_lists[] = { command_list_.Get() };
+	command_queue_->ExecuteCommandLists(1, command_lists);
+
+	const double frame_ms = presenter_->Present();
+	frames_[frame_index_].fence_value = SignalFence();
+
+	frame_index_ = (frame_index_ + 1) % kFrameCount;
+	current_back_buffer_ = presenter_->GetCurrentBackBufferIndex();
+
+	if (late_latch_input_)
+	{
+		frame_wait_ms_ = presenter_->WaitForFrame();
+		frame_waited_ = true;
+	}
+	latency_controller_.Update(*presenter_, frame_wait_ms_, frame_ms);
+}
+
+void Graphics::Resize(UINT width, UINT height)
+{
+	if (width == 0 || height == 0 || (width == width_ && height == height_))
+	{
+		return;
+	}
+
+	// ResizeBuffers needs the GPU to be done with the back buffers, and every
+	// reference to them gone. Waiting also lets the depth buffer go straight
+	// back to its heap instead of through the release queue.
+	FlushCommandQueue();
+	for (ComPtr<ID3D12Resource>& buffer : swap_chain_buffer_)
+	{
+		buffer.Reset();
+	}
+	gpu_allocator_->Free(depth_stencil_buffer_);
+
+	width_ = width;
+	height_ = height;
+	presenter_->Resize(width_, height_);
+	current_back_buffer_ = presenter_->GetCurrentBackBufferIndex();
+
+	// Same RTV and DSV slots as before, and the new depth buffer is placed in
+	// the range the old one just freed whenever it fits
+	CreateBackBufferViews();
+	CreateDepthStencilBuffer();
+	UpdateViewport();
+}
+
+UINT Graphics::GetWidth() const
+{
+	return width_;
+}
+
+UINT Graphics::GetHeight() const
+{
+	return height_;
+}
+
+void Graphics::SetLateLatchInput(bool enabled)
+{
+	late_latch_input_ = enabled;
+}
+
+void Graphics::SetVSync(bool enabled)
+{
+	presenter_->SetVSync(enabled);
+}
+
+void Graphics::DeferRelease(ComPtr<IUnknown> object)
+{
+	// Anything that could reference the object was submitted before the next signal
+	release_queue_->Release(std::move(object), current_fence_ + 1);
+}
+
+void Graphics::DeferRelease(GpuAllocation&& allocation)
+{
+	release_queue_->Release(std::move(allocation), current_fence_ + 1);
+}
+
+void Graphics::DeferRelease(std::function<void()> deleter)
+{
+	release_queue_->Release(std::move(deleter), current_fence_ + 1);
+}
+
+void Graphics::CollectReleases()
+{
+	release_queue_->Collect(fence_->GetCompletedValue());
+}
+
+void Graphics::ReleaseDescriptor(BindlessHeap::Handle handle)
+{
+	BindlessHeap* heap = bindless_heap_.get();
+	DeferRelease([heap, handle]() { heap->Free(handle); });
+}
+
+const DeviceCapabilities& Graphics::GetCapabilities() const
+{
+	return capabilities_;
+}
+
+PipelineStateCache& Graphics::GetPipelineStateCache()
+{
+	return *pipeline_cache_;
+}
+
+RootSignatureCache& Graphics::GetRootSignatureCache()
+{
+	return *root_signature_cache_;
+}
+
+const ShaderCache& Graphics::GetShaderCache() const
+{
+	return *shader_cache_;
+}
+
+BindlessHeap& Graphics::GetBindlessHeap()
+{
+	return *bindless_heap_;
+}
+
+RenderGraph& Graphics::GetRenderGraph()
+{
+	return render_graph_;
+}
+
+RenderGraphExecutor& Graphics::GetRenderGraphExecutor()
+{
+	return *graph_executor_;
+}
+
+Profiler& Graphics::GetProfiler()
+{
+	return *profiler_;
+}
+
+ThreadPool& Graphics::GetThreadPool()
+{
+	return *thread_pool_;
+}
+
+std::unique_ptr<TextureUploadBatch> Graphics::CreateUploadBatch()
+{
+	return std::make_unique<TextureUploadBatch>(device_.Get(), *gpu_allocator_, *thread_pool_);
+}
+
+void Graphics::RecordUpload(TextureUploadBatch& batch)
+{
+	GpuAllocation staging = batch.Record(command_list_.Get());
+	if (staging.IsValid())
+	{
+		DeferRelease(std::move(staging));
+	}
+}
+
+RenderGraph::ResourceId Graphics::GetBackBufferId() const
+{
+	return back_buffer_id_;
+}
+
+RenderGraph::ResourceId Graphics::GetDepthStencilId() const
+{
+	return depth_stencil_id_;
+}
+
 // Source: https://github.com/d3dcoder/d3d12book/blob/master/Common/d3dApp.cpp
 void Graphics::FlushCommandQueue()
+{
+	WaitForFence(SignalFence());
+	release_queue_->Collect(current_fence_);
+}
+
+UINT64 Graphics::SignalFence()
 {
 	// Advance the fence value to mark commands up to this fence point
 	current_fence_++;
@@ -238,13 +495,18 @@ void Graphics::FlushCommandQueue()
 	// processing all the commands prior to this Signal()
 	ThrowIfFailed(command_queue_->Signal(fence_.Get(), current_fence_));
 
+	return current_fence_;
+}
+
+void Graphics::WaitForFence(UINT64 fence_value)
+{
 	// Wait until the GPU has completed commands up to this fence point
-	if (fence_->GetCompletedValue() < current_fence_)
+	if (fence_->GetCompletedValue() < fence_value)
 	{
 		HANDLE event_handle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
 
 		// Fire event when GPU hits current fence
-		ThrowIfFailed(fence_->SetEventOnCompletion(current_fence_, event_handle));
+		ThrowIfFailed(fence_->SetEventOnCompletion(fence_value, event_handle));
 
 		// Wait until the GPU hits current fence event is fired
 		WaitForSingleObject(event_handle, INFINITE);
@@ -2,9 +2,26 @@
 #define GRAPHICS_H
 
 #include "LeanWin32.h"
+#include "GpuHeapAllocator.h"
+#include "DeferredReleaseQueue.h"
+#include "PipelineStateCache.h"
+#include "RootSignatureCache.h"
+#include "ShaderCache.h"
+#include "BindlessHeap.h"
+#include "RenderGraph.h"
+#include "RenderGraphExecutor.h"
+#include "Profiler.h"
+#include "GpuTimestampSource.h"
+#include "SwapChainPresenter.h"
+#include "FrameLatencyController.h"
+#include "ThreadPool.h"
+#include "TextureUploadBatch.h"
+#include "D3D12Capabilities.h"
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <wrl.h>
+#include <functional>
+#include <memory>
 
 using namespace Microsoft::WRL;
 
@@ -18,33 +35,108 @@ public:
 	
 	// TODO: Better handle these exceptions
 	inline void ThrowIfFailed(HRESULT hr);
+
+	// Resets the command list and starts the frame's render graph with a pass
+	// clearing the back and depth buffers; add passes to GetRenderGraph() in between
+	void BeginFrame();
+	// Records the render graph, submits and presents
+	void EndFrame();
+	// Wait on the swap chain right after presenting, so the next frame's input
+	// is read after the wait rather than before it
+	void SetLateLatchInput(bool enabled);
+	// Rebuilds the back buffer views and the depth buffer for a new client size.
+	// Waits for the GPU; call it once per settled size, not per WM_SIZE.
+	void Resize(UINT width, UINT height);
+	UINT GetWidth() const;
+	UINT GetHeight() const;
+	void SetVSync(bool enabled);
+
+	// Hand over objects the GPU may still be using. They are freed by
+	// CollectReleases() once the GPU has passed the next fence signal.
+	void DeferRelease(ComPtr<IUnknown> object);
+	void DeferRelease(GpuAllocation&& allocation);
+	void DeferRelease(std::function<void()> deleter);
+	void CollectReleases();
+	// Returns a bindless slot once the GPU can no longer read it
+	void ReleaseDescriptor(BindlessHeap::Handle handle);
+
+	// Feature support of the device, queried once per adapter and driver
+	const DeviceCapabilities& GetCapabilities() const;
+	PipelineStateCache& GetPipelineStateCache();
+	RootSignatureCache& GetRootSignatureCache();
+	const ShaderCache& GetShaderCache() const;
+	BindlessHeap& GetBindlessHeap();
+	// Rebuilt every frame: Reset(), add passes, Compile(), then record it with the executor
+	RenderGraph& GetRenderGraph();
+	RenderGraphExecutor& GetRenderGraphExecutor();
+	// CPU and GPU scopes of recent frames on one timeline
+	Profiler& GetProfiler();
+	// Workers for CPU-side data-parallel work such as filling upload buffers
+	ThreadPool& GetThreadPool();
+	std::unique_ptr<TextureUploadBatch> CreateUploadBatch();
+	// Records the batch on this frame's command list (between BeginFrame and
+	// EndFrame); the staging buffer is released once the frame has executed
+	void RecordUpload(TextureUploadBatch& batch);
+	RenderGraph::ResourceId GetBackBufferId() const;
+	RenderGraph::ResourceId GetDepthStencilId() const;
+	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
+	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
 	
+private:
+	// Per frame in flight; the allocator can't be reset until the GPU has passed fence_value
+	struct FrameContext
+	{
+		ComPtr<ID3D12CommandAllocator> allocator;
+		UINT64 fence_value = 0;
+	};
 private:
 	void CreateCommandObjects();
 	void CreateSwapChain(HWND& handle);
+	void CreateBackBufferViews();
+	void CreateDepthStencilBuffer();
+	void UpdateViewport();
+	void AddClearPass();
 	void CreateRtvAndDsvDescriptorHeaps();
 	void FlushCommandQueue();
-	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
-	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
+	UINT64 SignalFence();
+	void WaitForFence(UINT64 fence_value);
 public:
+	// Initial client size; the window can be resized afterwards
 	static constexpr int kScreenWidth = 1280;
 	static constexpr int kScreenHeight = 768;
 private:
 	static const UINT kFrameCount = 2;
+	static const UINT kMaxGpuScopesPerFrame = 256;
 	int current_back_buffer_ = 0;
+	UINT frame_index_ = 0;
 
 	// IDXGI objects
 	ComPtr<IDXGIFactory4>				factory_;
 	ComPtr<ID3D12Device>				device_;
+	DeviceCapabilities					capabilities_;
 	ComPtr<ID3D12Fence>					fence_;
 	ComPtr<ID3D12CommandQueue>			command_queue_;
-	ComPtr<ID3D12CommandAllocator>		command_list_allocator_;
+	FrameContext						frames_[kFrameCount];
 	ComPtr<ID3D12GraphicsCommandList>	command_list_;
-	ComPtr<IDXGISwapChain>				swap_chain_;
+	std::unique_ptr<SwapChainPresenter>	presenter_;
+	FrameLatencyController				latency_controller_;
+	std::unique_ptr<ThreadPool>			thread_pool_;
+	std::unique_ptr<GpuHeapAllocator>	gpu_allocator_;	// Placed resource heaps, must outlive the resources below
+	std::unique_ptr<DeferredReleaseQueue> release_queue_;
+	std::unique_ptr<PipelineStateCache>	pipeline_cache_;
+	std::unique_ptr<RootSignatureCache>	root_signature_cache_;
+	std::unique_ptr<ShaderCache>		shader_cache_;
+	std::unique_ptr<BindlessHeap>		bindless_heap_;	// Global shader-visible CBV/SRV/UAV heap
+	RenderGraph							render_graph_;
+	std::unique_ptr<RenderGraphExecutor> graph_executor_;	// Owns the transient heap
+	std::unique_ptr<GpuTimestampSource>	gpu_timestamps_;
+	std::unique_ptr<Profiler>			profiler_;
+	RenderGraph::ResourceId				back_buffer_id_ = RenderGraph::kInvalidId;
+	RenderGraph::ResourceId				depth_stencil_id_ = RenderGraph::kInvalidId;
 	ComPtr<ID3D12DescriptorHeap>		rtv_heap_;	// Render Target View descriptor heap
 	ComPtr<ID3D12DescriptorHeap>		dsv_heap_;	// depth/stencil view descriptor heap
 	ComPtr<ID3D12Resource>				swap_chain_buffer_[kFrameCount];
-	ComPtr<ID3D12Resource>				depth_stencil_buffer_;
+	GpuAllocation						depth_stencil_buffer_;
 
 
 	// Descriptor sizes
@@ -54,11 +146,15 @@ private:
 	UINT msaa_quality_;
 	UINT64 current_fence_;
 	bool msaa_state_ = false;
-
-	DXGI_RATIONAL refresh_rate_ = { 60u, 1u };
+	bool late_latch_input_ = true;
+	bool frame_waited_ = false;	// EndFrame() already waited for the next frame
+	double frame_wait_ms_ = 0.0;
 
 	DXGI_FORMAT back_buffer_format_;
 	DXGI_FORMAT depth_stencil_format_;
+	UINT width_;
+	UINT height_;
+	D3D12_VIEWPORT viewport_;
 	D3D12_RECT scissor_rect_;
 };
 
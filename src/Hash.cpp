@@ -0,0 +1,79 @@
+#include "Hash.h"
+#include <cstring>
+
+namespace
+{
+	constexpr uint64_t kMultiplier = 0xc6a4a7935bd1e995ull;
+	constexpr int kShift = 47;
+
+	uint64_t Mix(uint64_t h)
+	{
+		h ^= h >> kShift;
+		h *= kMultiplier;
+		h ^= h >> kShift;
+		return h;
+	}
+}
+
+// Source: https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.cpp
+uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t h = seed ^ (size * kMultiplier);
+
+	const size_t block_count = size / 8;
+	for (size_t i = 0; i < block_count; ++i)
+	{
+		uint64_t k;
+		std::memcpy(&k, bytes + i * 8, sizeof(k));
+
+		k *= kMultiplier;
+		k ^= k >> kShift;
+		k *= kMultiplier;
+
+		h ^= k;
+		h *= kMultiplier;
+	}
+
+	const unsigned char* tail = bytes + block_count * 8;
+	switch (size & 7)
+	{
+		case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+		case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+		case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+		case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+		case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+		case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+		case 1: h ^= uint64_t(tail[0]);
+			h *= kMultiplier;
+	}
+
+	return Mix(h);
+}
+
+Hasher::Hasher(uint64_t seed)
+	:
+	state_(seed)
+{ }
+
+void Hasher::Add(const void* data, size_t size)
+{
+	state_ = Hash64(data, size, state_);
+}
+
+void Hasher::Add(std::string_view text)
+{
+	// Hash the length too, so ("ab", "c") and ("a", "bc") differ
+	Add(static_cast<uint64_t>(text.size()));
+	Add(text.data(), text.size());
+}
+
+void Hasher::Add(uint64_t value)
+{
+	state_ = HashCombine(state_, value);
+}
+
+uint64_t Hasher::Finish() const
+{
+	return state_;
+}
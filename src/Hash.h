@@ -0,0 +1,45 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Stable 64-bit content hashing (MurmurHash64A). The values end up in files on
+// disk, so the function must never change between builds or machines.
+uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// Folds one value into a running hash; Hasher::Add(uint64_t) in a form that
+// also works in constant expressions
+constexpr uint64_t HashCombine(uint64_t state, uint64_t value)
+{
+	constexpr uint64_t kMultiplier = 0xc6a4a7935bd1e995ull;
+	uint64_t h = (state ^ value) * kMultiplier;
+	h ^= h >> 47;
+	h *= kMultiplier;
+	h ^= h >> 47;
+	return h;
+}
+
+// Accumulates a hash over a sequence of fields
+class Hasher
+{
+public:
+	Hasher(uint64_t seed = 0);
+
+	void Add(const void* data, size_t size);
+	void Add(std::string_view text);
+	void Add(uint64_t value);
+
+	template<typename T>
+	void AddPod(const T& value)
+	{
+		Add(&value, sizeof(T));
+	}
+
+	uint64_t Finish() const;
+private:
+	uint64_t state_;
+};
+
+#endif // !HASH_H
@@ -0,0 +1,53 @@
+#include "LinearArena.h"
+#include <cassert>
+#include <cstdint>
+
+LinearArena::LinearArena(void* buffer, size_t capacity)
+	:
+	buffer_(static_cast<unsigned char*>(buffer)),
+	capacity_(capacity)
+{ }
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+	// Align the address rather than the offset, the buffer itself may be unaligned
+	const uintptr_t base = reinterpret_cast<uintptr_t>(buffer_);
+	const uintptr_t aligned = (base + used_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+	const size_t offset = static_cast<size_t>(aligned - base);
+
+	if (offset > capacity_ || size > capacity_ - offset)
+	{
+		return nullptr;
+	}
+
+	used_ = offset + size;
+	return buffer_ + offset;
+}
+
+size_t LinearArena::GetMarker() const
+{
+	return used_;
+}
+
+void LinearArena::Rewind(size_t marker)
+{
+	assert(marker <= used_ && "Rewinding past the current position.");
+	used_ = marker;
+}
+
+void LinearArena::Reset()
+{
+	used_ = 0;
+}
+
+size_t LinearArena::GetUsed() const
+{
+	return used_;
+}
+
+size_t LinearArena::GetCapacity() const
+{
+	return capacity_;
+}
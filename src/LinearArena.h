@@ -0,0 +1,36 @@
+#ifndef LINEAR_ARENA_H
+#define LINEAR_ARENA_H
+
+#include <cstddef>
+
+// Bump allocator over a caller-provided buffer. Nothing is freed individually;
+// Rewind() to a marker or Reset() to reuse the memory. Allocate() returns
+// nullptr instead of growing when the buffer is exhausted.
+class LinearArena
+{
+public:
+	LinearArena(void* buffer, size_t capacity);
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	size_t GetMarker() const;
+	void Rewind(size_t marker);
+	void Reset();
+
+	size_t GetUsed() const;
+	size_t GetCapacity() const;
+private:
+	unsigned char* buffer_;
+	size_t capacity_;
+	size_t used_ = 0;
+};
+
+#endif // !LINEAR_ARENA_H
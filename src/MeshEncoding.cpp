@@ -0,0 +1,401 @@
+#include "MeshEncoding.h"
+#include "Hash.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t kIndexMagic = 0x42584449;	// 'IDXB'
+	// Bump whenever the encoded layout changes
+	constexpr uint32_t kIndexVersion = 1;
+
+	struct IndexHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t index_count;
+		uint32_t data_size;		// Bytes after the control block
+		uint64_t checksum;		// Hash64 of the control block and data
+	};
+
+	size_t ControlSize(size_t index_count)
+	{
+		return (index_count + 3) / 4;
+	}
+
+	uint32_t ZigZag(uint32_t delta)
+	{
+		return (delta << 1) ^ (0u - (delta >> 31));
+	}
+
+	uint32_t UnZigZag(uint32_t value)
+	{
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+	// Data bytes of each index in a control byte, and the shuffle that moves
+	// them into four 32-bit lanes
+	struct StreamTables
+	{
+		StreamTables()
+		{
+			for (uint32_t control = 0; control < 256; ++control)
+			{
+				uint8_t offset = 0;
+				for (uint32_t lane = 0; lane < 4; ++lane)
+				{
+					const uint32_t length = ((control >> (lane * 2)) & 3) + 1;
+					for (uint32_t byte = 0; byte < 4; ++byte)
+					{
+						shuffles[control][lane * 4 + byte] = static_cast<uint8_t>(byte < length ? offset + byte : 0x80);
+					}
+					offset = static_cast<uint8_t>(offset + length);
+				}
+				lengths[control] = offset;
+			}
+		}
+
+		alignas(16) uint8_t shuffles[256][16];
+		uint8_t lengths[256];
+	};
+
+	const StreamTables& GetStreamTables()
+	{
+		static const StreamTables tables;
+		return tables;
+	}
+
+	// Decodes indices [first, count) one at a time; false if the data runs out
+	bool DecodeIndicesScalar(
+		uint32_t* dest,
+		size_t first,
+		size_t count,
+		const uint8_t* control,
+		const uint8_t* data,
+		size_t& data_position,
+		size_t data_size,
+		uint32_t& previous)
+	{
+		for (size_t i = first; i < count; ++i)
+		{
+			const uint32_t length = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+			if (data_position + length > data_size)
+			{
+				return false;
+			}
+			uint32_t value = 0;
+			for (uint32_t byte = 0; byte < length; ++byte)
+			{
+				value |= uint32_t(data[data_position + byte]) << (byte * 8);
+			}
+			data_position += length;
+			previous += UnZigZag(value);
+			dest[i] = previous;
+		}
+		return true;
+	}
+
+#if SIMD_X86
+	// Four indices per control byte while 16 bytes of data can be loaded;
+	// returns how many indices it decoded
+	SIMD_TARGET_AVX2 size_t DecodeIndicesShuffle(
+		uint32_t* dest,
+		size_t count,
+		const uint8_t* control,
+		const uint8_t* data,
+		size_t& data_position,
+		size_t data_size,
+		uint32_t& previous)
+	{
+		const StreamTables& tables = GetStreamTables();
+		const __m128i one = _mm_set1_epi32(1);
+		__m128i running = _mm_set1_epi32(static_cast<int>(previous));
+		size_t i = 0;
+		for (; i + 4 <= count && data_position + 16 <= data_size; i += 4)
+		{
+			const uint8_t bits = control[i / 4];
+			const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.shuffles[bits]));
+			__m128i values = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + data_position)), shuffle);
+			data_position += tables.lengths[bits];
+
+			values = _mm_xor_si128(_mm_srli_epi32(values, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(values, one)));
+			// Inclusive prefix sum of the deltas, on top of the last index
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+			running = _mm_add_epi32(values, running);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), running);
+			running = _mm_shuffle_epi32(running, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+		previous = static_cast<uint32_t>(_mm_cvtsi128_si32(running));
+		return i;
+	}
+#endif
+
+	float Sign(float value)
+	{
+		return value < 0.0f ? -1.0f : 1.0f;
+	}
+
+	void OctahedralToVector(float x, float y, float (&normal)[3])
+	{
+		const float z = 1.0f - std::fabs(x) - std::fabs(y);
+		if (z < 0.0f)
+		{
+			const float folded_x = (1.0f - std::fabs(y)) * Sign(x);
+			y = (1.0f - std::fabs(x)) * Sign(y);
+			x = folded_x;
+		}
+		const float length = std::sqrt(x * x + y * y + z * z);
+		normal[0] = x / length;
+		normal[1] = y / length;
+		normal[2] = z / length;
+	}
+}
+
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, size_t count)
+{
+	VertexQuantization quantization;
+	if (count == 0)
+	{
+		return quantization;
+	}
+
+	float low[3] = { vertices[0].position[0], vertices[0].position[1], vertices[0].position[2] };
+	float high[3] = { low[0], low[1], low[2] };
+	for (size_t i = 1; i < count; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			low[c] = std::min(low[c], vertices[i].position[c]);
+			high[c] = std::max(high[c], vertices[i].position[c]);
+		}
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		quantization.offset[c] = low[c];
+		quantization.scale[c] = high[c] - low[c];
+	}
+	return quantization;
+}
+
+void QuantizeVertices(QuantizedVertex* dest, const MeshVertex* vertices, size_t count, const VertexQuantization& quantization)
+{
+	float inverse_scale[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		inverse_scale[c] = quantization.scale[c] > 0.0f ? 65535.0f / quantization.scale[c] : 0.0f;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const MeshVertex& vertex = vertices[i];
+		QuantizedVertex& quantized = dest[i];
+		for (int c = 0; c < 3; ++c)
+		{
+			const float unorm = (vertex.position[c] - quantization.offset[c]) * inverse_scale[c];
+			quantized.position[c] = static_cast<uint16_t>(std::lround(std::clamp(unorm, 0.0f, 65535.0f)));
+		}
+		quantized.position[3] = 0;
+		quantized.uv[0] = FloatToHalf(vertex.uv[0]);
+		quantized.uv[1] = FloatToHalf(vertex.uv[1]);
+		EncodeOctahedral(vertex.normal, quantized.normal);
+		quantized.padding = 0;
+	}
+}
+
+void DequantizeVertices(MeshVertex* dest, const QuantizedVertex* vertices, size_t count, const VertexQuantization& quantization)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const QuantizedVertex& quantized = vertices[i];
+		MeshVertex& vertex = dest[i];
+		for (int c = 0; c < 3; ++c)
+		{
+			vertex.position[c] = quantization.offset[c] + float(quantized.position[c]) / 65535.0f * quantization.scale[c];
+		}
+		vertex.uv[0] = HalfToFloat(quantized.uv[0]);
+		vertex.uv[1] = HalfToFloat(quantized.uv[1]);
+		DecodeOctahedral(quantized.normal, vertex.normal);
+	}
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(value);
+	const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	bits &= 0x7fffffff;
+
+	if (bits >= 0x7f800000)
+	{
+		// Infinity stays infinity; NaN keeps a quiet NaN's top mantissa bit
+		return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 : 0);
+	}
+	if (bits >= 0x477ff000)
+	{
+		// 65520 and up round past the largest half, 65504
+		return sign | 0x7c00;
+	}
+	if (bits < 0x38800000)
+	{
+		// Denormal: adding 0.5 lines the half's mantissa up with the float's
+		// low bits, and the FPU does the round to nearest even
+		const float shifted = std::bit_cast<float>(bits) + 0.5f;
+		return sign | static_cast<uint16_t>(std::bit_cast<uint32_t>(shifted) - 0x3f000000);
+	}
+
+	const uint32_t odd = (bits >> 13) & 1;
+	bits += 0xc8000fff + odd;	// Rebias the exponent (-112 << 23), round to nearest even
+	return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t bits = uint32_t(value & 0x7fff) << 13;
+	const uint32_t exponent = bits & 0x0f800000;
+	bits += 0x38000000;	// Rebias the exponent (112 << 23)
+
+	float result;
+	if (exponent == 0x0f800000)
+	{
+		// Infinity or NaN
+		result = std::bit_cast<float>(bits + 0x38000000);
+	}
+	else if (exponent == 0)
+	{
+		// Denormal: renormalize by letting the FPU subtract the implicit one
+		result = std::bit_cast<float>(bits + 0x00800000) - std::bit_cast<float>(0x38800000u);
+	}
+	else
+	{
+		result = std::bit_cast<float>(bits);
+	}
+	return (value & 0x8000) ? -result : result;
+}
+
+void EncodeOctahedral(const float (&normal)[3], int8_t (&encoded)[2])
+{
+	const float l1 = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	if (l1 <= 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = normal[0] / l1;
+	float y = normal[1] / l1;
+	if (normal[2] < 0.0f)
+	{
+		const float folded_x = (1.0f - std::fabs(y)) * Sign(x);
+		y = (1.0f - std::fabs(x)) * Sign(y);
+		x = folded_x;
+	}
+
+	const float base_x = std::floor(x * 127.0f);
+	const float base_y = std::floor(y * 127.0f);
+	float best = -2.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		const float code_x = std::clamp(base_x + float(i & 1), -127.0f, 127.0f);
+		const float code_y = std::clamp(base_y + float(i >> 1), -127.0f, 127.0f);
+		float decoded[3];
+		OctahedralToVector(code_x / 127.0f, code_y / 127.0f, decoded);
+		const float similarity = decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2];
+		if (similarity > best)
+		{
+			best = similarity;
+			encoded[0] = static_cast<int8_t>(code_x);
+			encoded[1] = static_cast<int8_t>(code_y);
+		}
+	}
+}
+
+void DecodeOctahedral(const int8_t (&encoded)[2], float (&normal)[3])
+{
+	// SNORM decodes -128 as -1 too
+	OctahedralToVector(std::max(float(encoded[0]) / 127.0f, -1.0f), std::max(float(encoded[1]) / 127.0f, -1.0f), normal);
+}
+
+std::vector<unsigned char> EncodeIndexBuffer(const uint32_t* indices, size_t index_count)
+{
+	const size_t control_size = ControlSize(index_count);
+	std::vector<unsigned char> encoded(sizeof(IndexHeader) + control_size, 0);
+	encoded.reserve(encoded.size() + index_count * 2);
+
+	uint32_t previous = 0;
+	for (size_t i = 0; i < index_count; ++i)
+	{
+		const uint32_t value = ZigZag(indices[i] - previous);
+		previous = indices[i];
+
+		const uint32_t length = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+		encoded[sizeof(IndexHeader) + i / 4] |= static_cast<unsigned char>((length - 1) << ((i % 4) * 2));
+		for (uint32_t byte = 0; byte < length; ++byte)
+		{
+			encoded.push_back(static_cast<unsigned char>(value >> (byte * 8)));
+		}
+	}
+
+	IndexHeader header = {};
+	header.magic = kIndexMagic;
+	header.version = kIndexVersion;
+	header.index_count = static_cast<uint32_t>(index_count);
+	header.data_size = static_cast<uint32_t>(encoded.size() - sizeof(IndexHeader) - control_size);
+	header.checksum = Hash64(encoded.data() + sizeof(IndexHeader), encoded.size() - sizeof(IndexHeader));
+	std::memcpy(encoded.data(), &header, sizeof(header));
+	return encoded;
+}
+
+size_t GetEncodedIndexCount(const void* data, size_t size)
+{
+	if (size < sizeof(IndexHeader))
+	{
+		return 0;
+	}
+	IndexHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	return header.magic == kIndexMagic && header.version == kIndexVersion ? header.index_count : 0;
+}
+
+bool DecodeIndexBuffer(uint32_t* dest, const void* data, size_t size, SimdLevel level)
+{
+	level = ClampSimdLevel(level);
+	if (size < sizeof(IndexHeader))
+	{
+		return false;
+	}
+	IndexHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	const size_t control_size = ControlSize(header.index_count);
+	if (header.magic != kIndexMagic ||
+		header.version != kIndexVersion ||
+		size != sizeof(IndexHeader) + control_size + header.data_size)
+	{
+		return false;
+	}
+
+	const uint8_t* control = static_cast<const uint8_t*>(data) + sizeof(IndexHeader);
+	if (Hash64(control, control_size + header.data_size) != header.checksum)
+	{
+		return false;
+	}
+	const uint8_t* payload = control + control_size;
+
+	size_t position = 0;
+	uint32_t previous = 0;
+	size_t decoded = 0;
+#if SIMD_X86
+	if (level == SimdLevel::kAvx2)
+	{
+		decoded = DecodeIndicesShuffle(dest, header.index_count, control, payload, position, header.data_size, previous);
+	}
+#endif
+	return DecodeIndicesScalar(dest, decoded, header.index_count, control, payload, position, header.data_size, previous) &&
+		position == header.data_size;
+}
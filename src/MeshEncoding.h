@@ -0,0 +1,82 @@
+#ifndef MESH_ENCODING_H
+#define MESH_ENCODING_H
+
+#include "CpuFeatures.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compact storage for mesh geometry: vertices quantized to half their float
+// size for the GPU to read as is, and index buffers compressed for disk.
+
+enum class VertexFormat
+{
+	kFloat,		// MeshVertex
+	kQuantized	// QuantizedVertex
+};
+
+// 32 bytes
+struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+// 16 bytes; see MeshLayouts.h for the matching input layout
+//  - position: R16G16B16A16_UNORM within the mesh bounds (w is 0), scaled
+//    back by VertexQuantization, which folds into the world matrix
+//  - uv: R16G16_FLOAT
+//  - normal: R8G8_SNORM octahedral, unpacked in the shader with DecodeOctahedral's math
+struct QuantizedVertex
+{
+	uint16_t position[4];
+	uint16_t uv[2];
+	int8_t normal[2];
+	uint16_t padding;
+};
+
+static_assert(sizeof(MeshVertex) == 32 && sizeof(QuantizedVertex) == 16);
+
+// position = offset + unorm_position * scale
+struct VertexQuantization
+{
+	float offset[3] = {};
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+// Bounds of the vertices; positions are then within half a step of 1/65535 of
+// the extent on each axis
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, size_t count);
+
+void QuantizeVertices(QuantizedVertex* dest, const MeshVertex* vertices, size_t count, const VertexQuantization& quantization);
+
+// Inverse of QuantizeVertices, up to its precision
+void DequantizeVertices(MeshVertex* dest, const QuantizedVertex* vertices, size_t count, const VertexQuantization& quantization);
+
+// IEEE half precision with round to nearest even; overflow saturates to infinity
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// Unit vector to the octahedral map, picking whichever neighbouring 8-bit
+// code decodes closest to it (about 0.6 degrees worst case, against ~1 for
+// plain rounding)
+void EncodeOctahedral(const float (&normal)[3], int8_t (&encoded)[2]);
+void DecodeOctahedral(const int8_t (&encoded)[2], float (&normal)[3]);
+
+// Index buffers as zigzag deltas from the previous index in "stream VByte"
+// form: a 2-bit length per index in a control block, then 1-4 data bytes
+// each. Meshes run through OptimizeVertexCache/OptimizeVertexFetch mostly
+// take one data byte per index, so 32-bit indices shrink about 2.5x and 16-bit
+// ones to about 0.6x. Decoding does four indices per control byte with a
+// shuffle where the CPU has AVX2 (which implies the SSSE3 shuffle).
+std::vector<unsigned char> EncodeIndexBuffer(const uint32_t* indices, size_t index_count);
+
+// Index count stored in an encoded buffer, 0 if it isn't one
+size_t GetEncodedIndexCount(const void* data, size_t size);
+
+// Decodes GetEncodedIndexCount() indices into dest. Returns false, with dest
+// contents undefined, when the data is truncated or corrupt.
+bool DecodeIndexBuffer(uint32_t* dest, const void* data, size_t size, SimdLevel level = GetSupportedSimdLevel());
+
+#endif // !MESH_ENCODING_H
@@ -0,0 +1,39 @@
+#ifndef MESH_LAYOUTS_H
+#define MESH_LAYOUTS_H
+
+#include "LeanWin32.h"
+#include "MeshEncoding.h"
+#include <d3d12.h>
+#include <cstddef>
+
+// Input layouts for the vertex formats in MeshEncoding.h, usable directly in
+// a PipelineDesc as PsoInputLayout{ GetVertexLayout(format) }. Both formats
+// bind the same semantics, so vertex shaders only differ in how they scale
+// POSITION (by VertexQuantization) and unpack NORMAL (octahedral float2).
+
+inline constexpr D3D12_INPUT_ELEMENT_DESC kMeshVertexElements[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(MeshVertex, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(MeshVertex, normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(MeshVertex, uv), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+inline constexpr D3D12_INPUT_ELEMENT_DESC kQuantizedVertexElements[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(QuantizedVertex, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R8G8_SNORM, 0, offsetof(QuantizedVertex, normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(QuantizedVertex, uv), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+inline constexpr D3D12_INPUT_LAYOUT_DESC kMeshVertexLayout = { kMeshVertexElements, _countof(kMeshVertexElements) };
+inline constexpr D3D12_INPUT_LAYOUT_DESC kQuantizedVertexLayout = { kQuantizedVertexElements, _countof(kQuantizedVertexElements) };
+
+constexpr D3D12_INPUT_LAYOUT_DESC GetVertexLayout(VertexFormat format)
+{
+	return format == VertexFormat::kQuantized ? kQuantizedVertexLayout : kMeshVertexLayout;
+}
+
+constexpr UINT GetVertexStride(VertexFormat format)
+{
+	return format == VertexFormat::kQuantized ? sizeof(QuantizedVertex) : sizeof(MeshVertex);
+}
+
+#endif // !MESH_LAYOUTS_H
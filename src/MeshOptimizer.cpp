@@ -0,0 +1,642 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Forsyth's scoring; the simulated LRU cache is larger than any real one
+	// so that scores still favour vertices that were used recently
+	constexpr int kScoreCacheSize = 32;
+	constexpr int kScoreMaxValence = 32;
+	constexpr float kCacheDecayPower = 1.5f;
+	constexpr float kLastTriangleScore = 0.75f;
+	constexpr float kValenceBoostScale = 2.0f;
+	constexpr float kValenceBoostPower = 0.5f;
+
+	// FIFO size used to find cluster boundaries for the overdraw pass
+	constexpr uint32_t kOverdrawCacheSize = 16;
+
+	struct ScoreTables
+	{
+		float cache[kScoreCacheSize];
+		float valence[kScoreMaxValence + 1];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < kScoreCacheSize; ++i)
+			{
+				// The last triangle's vertices score the same whichever order they are in
+				cache[i] = i < 3
+					? kLastTriangleScore
+					: std::pow(1.0f - float(i - 3) / float(kScoreCacheSize - 3), kCacheDecayPower);
+			}
+			valence[0] = 0.0f;
+			for (int i = 1; i <= kScoreMaxValence; ++i)
+			{
+				// Boosts vertices with few triangles left, so they get finished off
+				valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+			}
+		}
+	};
+
+	float VertexScore(const ScoreTables& tables, int cache_position, uint32_t live_triangles)
+	{
+		if (live_triangles == 0)
+		{
+			return -1.0f;
+		}
+		const float cache_score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+		return cache_score + tables.valence[std::min<uint32_t>(live_triangles, kScoreMaxValence)];
+	}
+
+	// Triangles using each vertex, as offsets into one flat array
+	struct TriangleAdjacency
+	{
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		TriangleAdjacency(const uint32_t* indices, size_t index_count, size_t vertex_count)
+			: counts(vertex_count, 0), offsets(vertex_count, 0), triangles(index_count)
+		{
+			for (size_t i = 0; i < index_count; ++i)
+			{
+				++counts[indices[i]];
+			}
+			uint32_t offset = 0;
+			for (size_t v = 0; v < vertex_count; ++v)
+			{
+				offsets[v] = offset;
+				offset += counts[v];
+			}
+			std::vector<uint32_t> fill(counts.size(), 0);
+			for (size_t i = 0; i < index_count; ++i)
+			{
+				const uint32_t v = indices[i];
+				triangles[offsets[v] + fill[v]++] = uint32_t(i / 3);
+			}
+		}
+	};
+
+	const float* Position(const float* positions, size_t stride, uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + stride * vertex);
+	}
+
+	void Subtract(const float* a, const float* b, float (&result)[3])
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			result[c] = a[c] - b[c];
+		}
+	}
+
+	void Cross(const float (&a)[3], const float (&b)[3], float (&result)[3])
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	float Dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	// Unnormalized face normal; its length is twice the triangle's area
+	void FaceNormal(const float* p0, const float* p1, const float* p2, float (&normal)[3])
+	{
+		float e1[3];
+		float e2[3];
+		Subtract(p1, p0, e1);
+		Subtract(p2, p0, e2);
+		Cross(e1, e2, normal);
+	}
+
+	bool Normalize(float (&v)[3])
+	{
+		const float length = std::sqrt(Dot(v, v));
+		if (length <= 0.0f)
+		{
+			return false;
+		}
+		for (float& c : v)
+		{
+			c /= length;
+		}
+		return true;
+	}
+
+	// FIFO cache simulated with timestamps: a vertex is cached while fewer than
+	// cache_size misses happened since it was loaded. Bumping the clock past
+	// cache_size empties the cache.
+	struct FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		FifoCache(size_t vertex_count, uint32_t cache_size)
+			: timestamps(vertex_count, 0), time(cache_size + 1), size(cache_size)
+		{}
+
+		uint32_t Triangle(const uint32_t* triangle)
+		{
+			uint32_t misses = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (time - timestamps[triangle[i]] > size)
+				{
+					timestamps[triangle[i]] = time++;
+					++misses;
+				}
+			}
+			return misses;
+		}
+
+		void Flush()
+		{
+			time += size + 1;
+		}
+	};
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size)
+{
+	VertexCacheStatistics statistics;
+	FifoCache cache(vertex_count, cache_size);
+	std::vector<bool> used(vertex_count, false);
+	size_t unique_vertices = 0;
+	for (size_t i = 0; i + 3 <= index_count; i += 3)
+	{
+		statistics.vertices_transformed += cache.Triangle(indices + i);
+		for (size_t k = i; k < i + 3; ++k)
+		{
+			if (!used[indices[k]])
+			{
+				used[indices[k]] = true;
+				++unique_vertices;
+			}
+		}
+	}
+
+	if (index_count >= 3)
+	{
+		statistics.acmr = float(statistics.vertices_transformed) / float(index_count / 3);
+		statistics.atvr = float(statistics.vertices_transformed) / float(unique_vertices);
+	}
+	return statistics;
+}
+
+void OptimizeVertexCache(uint32_t* dest, const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+	static const ScoreTables tables;
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	// dest may alias indices, so the order is built on a copy
+	const std::vector<uint32_t> source(indices, indices + triangle_count * 3);
+	TriangleAdjacency adjacency(source.data(), source.size(), vertex_count);
+
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		vertex_scores[v] = VertexScore(tables, -1, adjacency.counts[v]);
+	}
+	std::vector<float> triangle_scores(triangle_count);
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		triangle_scores[t] = vertex_scores[source[t * 3]] + vertex_scores[source[t * 3 + 1]] + vertex_scores[source[t * 3 + 2]];
+	}
+	std::vector<bool> emitted(triangle_count, false);
+
+	// A triangle's vertices push into the front, so the cache briefly holds 3 extra
+	uint32_t cache[kScoreCacheSize + 3];
+	uint32_t next_cache[kScoreCacheSize + 3];
+	uint32_t cache_count = 0;
+
+	size_t input_cursor = 0;
+	size_t best = 0;
+	for (size_t output = 0; output < triangle_count; ++output)
+	{
+		const uint32_t* triangle = &source[best * 3];
+		std::copy(triangle, triangle + 3, dest + output * 3);
+		emitted[best] = true;
+
+		// Retire the triangle from its vertices' adjacency lists
+		for (int i = 0; i < 3; ++i)
+		{
+			const uint32_t v = triangle[i];
+			uint32_t* list = &adjacency.triangles[adjacency.offsets[v]];
+			uint32_t& count = adjacency.counts[v];
+			for (uint32_t k = 0; k < count; ++k)
+			{
+				if (list[k] == best)
+				{
+					list[k] = list[--count];
+					break;
+				}
+			}
+		}
+
+		uint32_t next_count = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (std::find(triangle, triangle + i, triangle[i]) == triangle + i)
+			{
+				next_cache[next_count++] = triangle[i];
+			}
+		}
+		for (uint32_t i = 0; i < cache_count; ++i)
+		{
+			const uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				next_cache[next_count++] = v;
+			}
+		}
+
+		// Rescore everything that moved in, within or out of the cache and find
+		// the best triangle next to it
+		float best_score = -1.0f;
+		size_t next_best = triangle_count;
+		for (uint32_t i = 0; i < next_count; ++i)
+		{
+			const uint32_t v = next_cache[i];
+			const int position = i < kScoreCacheSize ? int(i) : -1;
+			const float score = VertexScore(tables, position, adjacency.counts[v]);
+			const float delta = score - vertex_scores[v];
+			vertex_scores[v] = score;
+
+			const uint32_t* list = &adjacency.triangles[adjacency.offsets[v]];
+			for (uint32_t k = 0; k < adjacency.counts[v]; ++k)
+			{
+				const uint32_t t = list[k];
+				triangle_scores[t] += delta;
+				if (position >= 0 && triangle_scores[t] > best_score)
+				{
+					best_score = triangle_scores[t];
+					next_best = t;
+				}
+			}
+		}
+		cache_count = std::min<uint32_t>(next_count, kScoreCacheSize);
+		std::copy(next_cache, next_cache + cache_count, cache);
+
+		// Nothing left around the cache: carry on from the input order
+		if (next_best == triangle_count)
+		{
+			while (input_cursor < triangle_count && emitted[input_cursor])
+			{
+				++input_cursor;
+			}
+			next_best = input_cursor;
+		}
+		best = next_best;
+	}
+}
+
+void OptimizeOverdraw(
+	uint32_t* dest,
+	const uint32_t* indices,
+	size_t index_count,
+	const float* positions,
+	size_t position_stride,
+	size_t vertex_count,
+	float threshold)
+{
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	// Hard boundaries: triangles that miss all three vertices start over
+	// anyway, so cutting there costs nothing
+	std::vector<size_t> hard_boundaries;
+	FifoCache cache(vertex_count, kOverdrawCacheSize);
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		if (cache.Triangle(indices + t * 3) == 3)
+		{
+			hard_boundaries.push_back(t);
+		}
+	}
+	hard_boundaries.push_back(triangle_count);
+
+	// Soft boundaries: within a hard cluster, cut once the triangles so far
+	// have reached an ACMR close to the whole cluster's. Every cut empties the
+	// cache, which is what the threshold bounds.
+	std::vector<size_t> boundaries;
+	for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h)
+	{
+		const size_t start = hard_boundaries[h];
+		const size_t end = hard_boundaries[h + 1];
+
+		cache.Flush();
+		uint32_t cluster_misses = 0;
+		for (size_t t = start; t < end; ++t)
+		{
+			cluster_misses += cache.Triangle(indices + t * 3);
+		}
+		const float cluster_threshold = threshold * float(cluster_misses) / float(end - start);
+
+		cache.Flush();
+		size_t cluster_start = start;
+		uint32_t misses = 0;
+		boundaries.push_back(start);
+		for (size_t t = start; t + 1 < end; ++t)
+		{
+			misses += cache.Triangle(indices + t * 3);
+			if (float(misses) <= cluster_threshold * float(t + 1 - cluster_start))
+			{
+				boundaries.push_back(t + 1);
+				cluster_start = t + 1;
+				misses = 0;
+				cache.Flush();
+			}
+		}
+	}
+	boundaries.push_back(triangle_count);
+
+	// Clusters facing away from the mesh center are the ones likely to hide
+	// others, so they go first
+	float mesh_center[3] = {};
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		const float* p = Position(positions, position_stride, uint32_t(v));
+		for (int c = 0; c < 3; ++c)
+		{
+			mesh_center[c] += p[c] / float(vertex_count);
+		}
+	}
+
+	const size_t cluster_count = boundaries.size() - 1;
+	std::vector<float> sort_keys(cluster_count);
+	for (size_t i = 0; i < cluster_count; ++i)
+	{
+		float area = 0.0f;
+		float centroid[3] = {};
+		float normal[3] = {};
+		for (size_t t = boundaries[i]; t < boundaries[i + 1]; ++t)
+		{
+			const float* p0 = Position(positions, position_stride, indices[t * 3]);
+			const float* p1 = Position(positions, position_stride, indices[t * 3 + 1]);
+			const float* p2 = Position(positions, position_stride, indices[t * 3 + 2]);
+			float face[3];
+			FaceNormal(p0, p1, p2, face);
+			const float face_area = std::sqrt(Dot(face, face));
+			for (int c = 0; c < 3; ++c)
+			{
+				centroid[c] += (p0[c] + p1[c] + p2[c]) * face_area / 3.0f;
+				normal[c] += face[c];
+			}
+			area += face_area;
+		}
+
+		float offset[3] = {};
+		if (area > 0.0f)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				offset[c] = centroid[c] / area - mesh_center[c];
+			}
+		}
+		sort_keys[i] = Normalize(normal) ? Dot(offset, normal) : 0.0f;
+	}
+
+	std::vector<uint32_t> order(cluster_count);
+	for (size_t i = 0; i < cluster_count; ++i)
+	{
+		order[i] = uint32_t(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+	{
+		return sort_keys[a] > sort_keys[b];
+	});
+
+	uint32_t* output = dest;
+	for (uint32_t cluster : order)
+	{
+		const uint32_t* begin = indices + boundaries[cluster] * 3;
+		const uint32_t* end = indices + boundaries[cluster + 1] * 3;
+		output = std::copy(begin, end, output);
+	}
+}
+
+size_t OptimizeVertexFetch(
+	void* dest,
+	uint32_t* indices,
+	size_t index_count,
+	const void* vertices,
+	size_t vertex_count,
+	size_t vertex_size)
+{
+	std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+	auto* output = static_cast<unsigned char*>(dest);
+	auto* input = static_cast<const unsigned char*>(vertices);
+	uint32_t next = 0;
+	for (size_t i = 0; i < index_count; ++i)
+	{
+		uint32_t& mapped = remap[indices[i]];
+		if (mapped == UINT32_MAX)
+		{
+			mapped = next++;
+			std::memcpy(output + vertex_size * mapped, input + vertex_size * indices[i], vertex_size);
+		}
+		indices[i] = mapped;
+	}
+	return next;
+}
+
+MeshletMesh BuildMeshlets(
+	const uint32_t* indices,
+	size_t index_count,
+	const float* positions,
+	size_t position_stride,
+	size_t vertex_count,
+	uint32_t max_vertices,
+	uint32_t max_triangles)
+{
+	MeshletMesh mesh;
+	max_vertices = std::clamp(max_vertices, 3u, 256u);
+	max_triangles = std::clamp(max_triangles, 1u, 256u);
+
+	// Local index of each mesh vertex in the meshlet being filled
+	std::vector<uint32_t> local(vertex_count, UINT32_MAX);
+	Meshlet current;
+
+	const auto flush = [&]()
+	{
+		for (uint32_t i = 0; i < current.vertex_count; ++i)
+		{
+			local[mesh.vertices[current.vertex_offset + i]] = UINT32_MAX;
+		}
+		mesh.meshlets.push_back(current);
+		current = Meshlet();
+		current.vertex_offset = uint32_t(mesh.vertices.size());
+		current.triangle_offset = uint32_t(mesh.triangles.size());
+	};
+
+	for (size_t i = 0; i + 3 <= index_count; i += 3)
+	{
+		const uint32_t* triangle = indices + i;
+		uint32_t new_vertices = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (local[triangle[k]] == UINT32_MAX && std::find(triangle, triangle + k, triangle[k]) == triangle + k)
+			{
+				++new_vertices;
+			}
+		}
+		if (current.vertex_count + new_vertices > max_vertices || current.triangle_count == max_triangles)
+		{
+			flush();
+		}
+
+		uint32_t packed = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t& slot = local[triangle[k]];
+			if (slot == UINT32_MAX)
+			{
+				slot = current.vertex_count++;
+				mesh.vertices.push_back(triangle[k]);
+			}
+			packed |= slot << (k * 10);
+		}
+		mesh.triangles.push_back(packed);
+		++current.triangle_count;
+	}
+	if (current.triangle_count > 0)
+	{
+		flush();
+	}
+
+	mesh.bounds.reserve(mesh.meshlets.size());
+	for (const Meshlet& meshlet : mesh.meshlets)
+	{
+		mesh.bounds.push_back(ComputeMeshletBounds(mesh, meshlet, positions, position_stride));
+	}
+	return mesh;
+}
+
+MeshletBounds ComputeMeshletBounds(const MeshletMesh& mesh, const Meshlet& meshlet, const float* positions, size_t position_stride)
+{
+	MeshletBounds bounds;
+	if (meshlet.vertex_count == 0)
+	{
+		return bounds;
+	}
+	const uint32_t* vertices = &mesh.vertices[meshlet.vertex_offset];
+	const auto point = [&](uint32_t local_index)
+	{
+		return Position(positions, position_stride, vertices[local_index]);
+	};
+
+	// Ritter's sphere: start from the most distant pair of axis extremes, then
+	// grow to take in any point left outside
+	uint32_t low[3] = {};
+	uint32_t high[3] = {};
+	for (uint32_t i = 1; i < meshlet.vertex_count; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			low[c] = point(i)[c] < point(low[c])[c] ? i : low[c];
+			high[c] = point(i)[c] > point(high[c])[c] ? i : high[c];
+		}
+	}
+	int widest = 0;
+	float widest_distance = -1.0f;
+	for (int c = 0; c < 3; ++c)
+	{
+		float d[3];
+		Subtract(point(high[c]), point(low[c]), d);
+		if (Dot(d, d) > widest_distance)
+		{
+			widest_distance = Dot(d, d);
+			widest = c;
+		}
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		bounds.center[c] = (point(low[widest])[c] + point(high[widest])[c]) * 0.5f;
+	}
+	bounds.radius = std::sqrt(widest_distance) * 0.5f;
+	for (uint32_t i = 0; i < meshlet.vertex_count; ++i)
+	{
+		float d[3];
+		Subtract(point(i), bounds.center, d);
+		const float distance = std::sqrt(Dot(d, d));
+		if (distance > bounds.radius)
+		{
+			const float grown = (bounds.radius + distance) * 0.5f;
+			for (int c = 0; c < 3; ++c)
+			{
+				bounds.center[c] += d[c] * (grown - bounds.radius) / distance;
+			}
+			bounds.radius = grown;
+		}
+	}
+
+	// Normal cone: the axis is the average normal, the cutoff comes from the
+	// normal furthest from it
+	std::vector<float> normals;
+	std::vector<uint32_t> corners;	// A vertex of each triangle in 'normals'
+	normals.reserve(meshlet.triangle_count * 3);
+	corners.reserve(meshlet.triangle_count);
+	float axis[3] = {};
+	for (uint32_t t = 0; t < meshlet.triangle_count; ++t)
+	{
+		const uint32_t packed = mesh.triangles[meshlet.triangle_offset + t];
+		float normal[3];
+		FaceNormal(point(packed & 1023), point((packed >> 10) & 1023), point((packed >> 20) & 1023), normal);
+		if (!Normalize(normal))
+		{
+			continue;	// Degenerate, faces nowhere
+		}
+		normals.insert(normals.end(), normal, normal + 3);
+		corners.push_back(packed & 1023);
+		for (int c = 0; c < 3; ++c)
+		{
+			axis[c] += normal[c];
+		}
+	}
+	std::copy(bounds.center, bounds.center + 3, bounds.cone_apex);
+	if (!Normalize(axis))
+	{
+		return bounds;
+	}
+	std::copy(axis, axis + 3, bounds.cone_axis);
+
+	float min_dot = 1.0f;
+	for (size_t i = 0; i < normals.size(); i += 3)
+	{
+		min_dot = std::min(min_dot, Dot(&normals[i], axis));
+	}
+	// Past about 84 degrees the cone would hardly ever cull
+	if (min_dot <= 0.1f)
+	{
+		return bounds;
+	}
+
+	// Apex: the point along the axis, behind the center, that is on the back
+	// side of every triangle's plane
+	float max_t = 0.0f;
+	for (size_t i = 0; i < normals.size(); i += 3)
+	{
+		float to_center[3];
+		Subtract(bounds.center, point(corners[i / 3]), to_center);
+		max_t = std::max(max_t, Dot(to_center, &normals[i]) / Dot(axis, &normals[i]));
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		bounds.cone_apex[c] = bounds.center[c] - axis[c] * max_t;
+	}
+	bounds.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	return bounds;
+}
@@ -0,0 +1,109 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reordering passes for indexed triangle lists, in the order they are meant
+// to run:
+//  1. OptimizeVertexCache() - triangle order for post-transform cache hits
+//  2. OptimizeOverdraw() - clusters of (1) sorted so outer surfaces draw first,
+//     trading a bounded amount of cache efficiency for less overdraw
+//  3. OptimizeVertexFetch() - vertex order matching first use, for fetch locality
+//  4. BuildMeshlets() - the result split into meshlets for mesh shaders
+// Each pass keeps the triangles (and their winding) and only changes order, so
+// they can be run offline or at load time. Positions are float3 at the start of
+// each 'position_stride' bytes.
+
+// Transformed vertices of a simulated FIFO post-transform cache, the usual
+// measure of the order's quality. ACMR is per triangle (0.5 at best on a
+// regular grid, 3 at worst); ATVR is per unique vertex (1 at best).
+struct VertexCacheStatistics
+{
+	uint32_t vertices_transformed = 0;
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size = 16);
+
+// Forsyth's linear-speed greedy ordering against a simulated LRU cache.
+// dest may be indices.
+void OptimizeVertexCache(uint32_t* dest, const uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Sander et al.'s cluster sort over a cache-optimized list. Clusters are cut
+// where the cache restarts anyway, and further wherever the local ACMR is
+// within 'threshold' of the cluster's; threshold 1 keeps ACMR about the same,
+// larger values allow more clusters. dest may not be indices.
+void OptimizeOverdraw(
+	uint32_t* dest,
+	const uint32_t* indices,
+	size_t index_count,
+	const float* positions,
+	size_t position_stride,
+	size_t vertex_count,
+	float threshold = 1.05f);
+
+// Renumbers vertices in order of first use and rewrites 'indices' to match.
+// Unreferenced vertices are dropped; returns the vertices left in dest. dest
+// may not be vertices.
+size_t OptimizeVertexFetch(
+	void* dest,
+	uint32_t* indices,
+	size_t index_count,
+	const void* vertices,
+	size_t vertex_count,
+	size_t vertex_size);
+
+// D3D12 mesh shaders allow up to 256 vertices and primitives per group; the
+// defaults suit the usual 128-thread groups
+constexpr uint32_t kDefaultMeshletVertices = 64;
+constexpr uint32_t kDefaultMeshletTriangles = 124;
+
+struct Meshlet
+{
+	uint32_t vertex_offset = 0;		// Into MeshletMesh::vertices
+	uint32_t vertex_count = 0;
+	uint32_t triangle_offset = 0;	// Into MeshletMesh::triangles
+	uint32_t triangle_count = 0;
+};
+
+// Bounding sphere and normal cone. The meshlet faces away from a camera, and
+// can be skipped, when
+//   dot(normalize(cone_apex - camera_position), cone_axis) >= cone_cutoff
+// A cutoff of 1 means the normals spread too far for the test to ever pass.
+struct MeshletBounds
+{
+	float center[3] = {};
+	float radius = 0.0f;
+	float cone_apex[3] = {};
+	float cone_axis[3] = {};
+	float cone_cutoff = 1.0f;
+};
+
+// Meshlets with their buffers, laid out for structured buffers: vertices maps
+// meshlet-local to mesh vertex indices, and each triangle is three local
+// indices packed 10:10:10 (first in the low bits)
+struct MeshletMesh
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	std::vector<uint32_t> vertices;
+	std::vector<uint32_t> triangles;
+};
+
+// Fills meshlets in triangle order, so run it on a cache-optimized list: the
+// cache order already keeps neighbouring triangles together
+MeshletMesh BuildMeshlets(
+	const uint32_t* indices,
+	size_t index_count,
+	const float* positions,
+	size_t position_stride,
+	size_t vertex_count,
+	uint32_t max_vertices = kDefaultMeshletVertices,
+	uint32_t max_triangles = kDefaultMeshletTriangles);
+
+MeshletBounds ComputeMeshletBounds(const MeshletMesh& mesh, const Meshlet& meshlet, const float* positions, size_t position_stride);
+
+#endif // !MESH_OPTIMIZER_H
@@ -0,0 +1,274 @@
+#include "PipelineStateCache.h"
+#include "ThrowIfFailed.h"
+#include <algorithm>
+#include <cwchar>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	PipelineShaderDesc ToShaderDesc(const D3D12_SHADER_BYTECODE& shader)
+	{
+		return PipelineShaderDesc{ shader.pShaderBytecode, shader.BytecodeLength };
+	}
+
+	PipelineStencilOpDesc ToStencilOpDesc(const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		return PipelineStencilOpDesc{ UINT(op.StencilFailOp), UINT(op.StencilDepthFailOp), UINT(op.StencilPassOp), UINT(op.StencilFunc) };
+	}
+
+	// The stream's arrays copied into PipelineStateDesc form, for as long as
+	// the desc that views them is in use
+	struct StreamArrays
+	{
+		PipelineInputElementDesc input_elements[D3D12_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT];
+		std::vector<PipelineStreamOutputEntryDesc> stream_output_entries;
+		uint32_t stream_output_strides[D3D12_SO_BUFFER_SLOT_COUNT];
+		PipelineViewInstanceDesc view_instances[D3D12_MAX_VIEW_INSTANCE_COUNT];
+	};
+
+	// Everything but the root signature, which is keyed by its content hash,
+	// and the cached PSO blob, which never affects the pipeline
+	PipelineStateDesc DescribeStream(const CD3DX12_PIPELINE_STATE_STREAM2& stream, StreamArrays& arrays)
+	{
+		PipelineStateDesc desc;
+		desc.flags = static_cast<const D3D12_PIPELINE_STATE_FLAGS&>(stream.Flags);
+		desc.node_mask = static_cast<const UINT&>(stream.NodeMask);
+
+		desc.cs = ToShaderDesc(stream.CS);
+		desc.as = ToShaderDesc(stream.AS);
+		desc.ms = ToShaderDesc(stream.MS);
+		desc.vs = ToShaderDesc(stream.VS);
+		desc.hs = ToShaderDesc(stream.HS);
+		desc.ds = ToShaderDesc(stream.DS);
+		desc.gs = ToShaderDesc(stream.GS);
+		desc.ps = ToShaderDesc(stream.PS);
+
+		const D3D12_INPUT_LAYOUT_DESC& layout = stream.InputLayout;
+		const UINT element_count = std::min<UINT>(layout.NumElements, D3D12_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT);
+		for (UINT i = 0; i < element_count; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+			arrays.input_elements[i] = PipelineInputElementDesc{ element.SemanticName, element.SemanticIndex, UINT(element.Format),
+				element.InputSlot, element.AlignedByteOffset, UINT(element.InputSlotClass), element.InstanceDataStepRate };
+		}
+		desc.input_elements = { arrays.input_elements, element_count };
+		desc.strip_cut_value = static_cast<const D3D12_INDEX_BUFFER_STRIP_CUT_VALUE&>(stream.IBStripCutValue);
+		desc.primitive_topology_type = static_cast<const D3D12_PRIMITIVE_TOPOLOGY_TYPE&>(stream.PrimitiveTopologyType);
+
+		const D3D12_STREAM_OUTPUT_DESC& stream_output = stream.StreamOutput;
+		arrays.stream_output_entries.resize(stream_output.NumEntries);
+		for (UINT i = 0; i < stream_output.NumEntries; ++i)
+		{
+			const D3D12_SO_DECLARATION_ENTRY& entry = stream_output.pSODeclaration[i];
+			arrays.stream_output_entries[i] = PipelineStreamOutputEntryDesc{ entry.Stream, entry.SemanticName, entry.SemanticIndex,
+				entry.StartComponent, entry.ComponentCount, entry.OutputSlot };
+		}
+		desc.stream_output_entries = arrays.stream_output_entries;
+		const UINT stride_count = std::min<UINT>(stream_output.NumStrides, D3D12_SO_BUFFER_SLOT_COUNT);
+		std::copy(stream_output.pBufferStrides, stream_output.pBufferStrides + stride_count, arrays.stream_output_strides);
+		desc.stream_output_strides = { arrays.stream_output_strides, stride_count };
+		desc.rasterized_stream = stream_output.RasterizedStream;
+
+		const D3D12_RT_FORMAT_ARRAY& rt_formats = stream.RTVFormats;
+		desc.render_target_count = rt_formats.NumRenderTargets;
+		for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		{
+			desc.render_target_formats[i] = rt_formats.RTFormats[i];
+		}
+		desc.depth_stencil_format = static_cast<const DXGI_FORMAT&>(stream.DSVFormat);
+
+		const D3D12_BLEND_DESC& blend = stream.BlendState;
+		desc.alpha_to_coverage_enable = blend.AlphaToCoverageEnable != FALSE;
+		desc.independent_blend_enable = blend.IndependentBlendEnable != FALSE;
+		for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		{
+			const D3D12_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[i];
+			desc.blend[i] = PipelineRenderTargetBlendDesc{ rt.BlendEnable != FALSE, rt.LogicOpEnable != FALSE,
+				UINT(rt.SrcBlend), UINT(rt.DestBlend), UINT(rt.BlendOp),
+				UINT(rt.SrcBlendAlpha), UINT(rt.DestBlendAlpha), UINT(rt.BlendOpAlpha),
+				UINT(rt.LogicOp), rt.RenderTargetWriteMask };
+		}
+
+		const D3D12_DEPTH_STENCIL_DESC1& depth_stencil = stream.DepthStencilState;
+		desc.depth_enable = depth_stencil.DepthEnable != FALSE;
+		desc.depth_write_mask = depth_stencil.DepthWriteMask;
+		desc.depth_func = depth_stencil.DepthFunc;
+		desc.stencil_enable = depth_stencil.StencilEnable != FALSE;
+		desc.stencil_read_mask = depth_stencil.StencilReadMask;
+		desc.stencil_write_mask = depth_stencil.StencilWriteMask;
+		desc.front_face = ToStencilOpDesc(depth_stencil.FrontFace);
+		desc.back_face = ToStencilOpDesc(depth_stencil.BackFace);
+		desc.depth_bounds_test_enable = depth_stencil.DepthBoundsTestEnable != FALSE;
+
+		const D3D12_RASTERIZER_DESC& rasterizer = stream.RasterizerState;
+		desc.fill_mode = rasterizer.FillMode;
+		desc.cull_mode = rasterizer.CullMode;
+		desc.front_counter_clockwise = rasterizer.FrontCounterClockwise != FALSE;
+		desc.depth_bias = rasterizer.DepthBias;
+		desc.depth_bias_clamp = rasterizer.DepthBiasClamp;
+		desc.slope_scaled_depth_bias = rasterizer.SlopeScaledDepthBias;
+		desc.depth_clip_enable = rasterizer.DepthClipEnable != FALSE;
+		desc.multisample_enable = rasterizer.MultisampleEnable != FALSE;
+		desc.antialiased_line_enable = rasterizer.AntialiasedLineEnable != FALSE;
+		desc.forced_sample_count = rasterizer.ForcedSampleCount;
+		desc.conservative_raster = rasterizer.ConservativeRaster;
+
+		const DXGI_SAMPLE_DESC& sample_desc = stream.SampleDesc;
+		desc.sample_count = sample_desc.Count;
+		desc.sample_quality = sample_desc.Quality;
+		desc.sample_mask = static_cast<const UINT&>(stream.SampleMask);
+
+		const D3D12_VIEW_INSTANCING_DESC& view_instancing = stream.ViewInstancingDesc;
+		const UINT view_count = std::min<UINT>(view_instancing.ViewInstanceCount, D3D12_MAX_VIEW_INSTANCE_COUNT);
+		for (UINT i = 0; i < view_count; ++i)
+		{
+			const D3D12_VIEW_INSTANCE_LOCATION& location = view_instancing.pViewInstanceLocations[i];
+			arrays.view_instances[i] = PipelineViewInstanceDesc{ location.ViewportArrayIndex, location.RenderTargetArrayIndex };
+		}
+		desc.view_instances = { arrays.view_instances, view_count };
+		desc.view_instancing_flags = view_instancing.Flags;
+
+		return desc;
+	}
+}
+
+PipelineStateCache::PipelineStateCache(ID3D12Device* device, std::wstring library_path)
+	:
+	library_path_(std::move(library_path))
+{
+	// Pipeline state streams need ID3D12Device2 (Windows 10 1703+)
+	ThrowIfFailed(device->QueryInterface(IID_PPV_ARGS(device_.GetAddressOf())));
+	OpenLibrary();
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+	try
+	{
+		Save();
+	}
+	catch (...)
+	{
+		// Losing the cache only costs compile time on the next launch
+	}
+}
+
+ID3D12PipelineState* PipelineStateCache::GetOrCreate(const CD3DX12_PIPELINE_STATE_STREAM2& stream, uint64_t root_signature_hash)
+{
+	StreamArrays arrays;
+	const PipelineStateKey key = PipelineStateKey::FromDesc(DescribeStream(stream, arrays), root_signature_hash);
+	return GetOrCreate(key, stream);
+}
+
+ID3D12PipelineState* PipelineStateCache::GetOrCreate(PipelineStateKey key, const CD3DX12_PIPELINE_STATE_STREAM2& stream)
+{
+	D3D12_PIPELINE_STATE_STREAM_DESC stream_desc{};
+	stream_desc.SizeInBytes = sizeof(stream);
+	stream_desc.pPipelineStateSubobjectStream = const_cast<CD3DX12_PIPELINE_STATE_STREAM2*>(&stream);
+	return GetOrCreate(key, stream_desc);
+}
+
+ID3D12PipelineState* PipelineStateCache::GetOrCreate(PipelineStateKey key, const D3D12_PIPELINE_STATE_STREAM_DESC& stream_desc)
+{
+	if (ID3D12PipelineState* pipeline = Find(key))
+	{
+		return pipeline;
+	}
+
+	ComPtr<ID3D12PipelineState> pipeline;
+	const std::wstring name = NameOf(key);
+
+	// E_INVALIDARG means the name isn't in the library, or it was stored
+	// from a stream that no longer matches; both fall through to a compile
+	if (!library_ || FAILED(library_->LoadPipeline(name.c_str(), &stream_desc, IID_PPV_ARGS(pipeline.GetAddressOf()))))
+	{
+		ThrowIfFailed(device_->CreatePipelineState(&stream_desc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+
+		if (library_ && SUCCEEDED(library_->StorePipeline(name.c_str(), pipeline.Get())))
+		{
+			is_dirty_ = true;
+		}
+	}
+
+	ID3D12PipelineState* result = pipeline.Get();
+	pipelines_.emplace(key, std::move(pipeline));
+	return result;
+}
+
+ID3D12PipelineState* PipelineStateCache::Find(PipelineStateKey key) const
+{
+	const auto it = pipelines_.find(key);
+	return it != pipelines_.end() ? it->second.Get() : nullptr;
+}
+
+void PipelineStateCache::Save()
+{
+	if (!library_ || !is_dirty_)
+	{
+		return;
+	}
+
+	std::vector<char> blob(library_->GetSerializedSize());
+	ThrowIfFailed(library_->Serialize(blob.data(), blob.size()));
+
+	// Write next to the real file and swap, so a crash never leaves half a library
+	const std::wstring temp_path = library_path_ + L".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.write(blob.data(), static_cast<std::streamsize>(blob.size())))
+		{
+			return;
+		}
+	}
+	if (MoveFileExW(temp_path.c_str(), library_path_.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		is_dirty_ = false;
+	}
+}
+
+void PipelineStateCache::OpenLibrary()
+{
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(device_.As(&device1)))
+	{
+		return;
+	}
+
+	std::ifstream file(library_path_, std::ios::binary | std::ios::ate);
+	if (file)
+	{
+		library_blob_.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		if (!file.read(library_blob_.data(), static_cast<std::streamsize>(library_blob_.size())))
+		{
+			library_blob_.clear();
+		}
+	}
+
+	if (!library_blob_.empty())
+	{
+		// Fails with D3D12_ERROR_DRIVER_VERSION_MISMATCH or
+		// D3D12_ERROR_ADAPTER_NOT_FOUND when the file is from another setup
+		if (SUCCEEDED(device1->CreatePipelineLibrary(library_blob_.data(), library_blob_.size(), IID_PPV_ARGS(library_.GetAddressOf()))))
+		{
+			return;
+		}
+		library_blob_.clear();
+		library_.Reset();
+	}
+
+	// DXGI_ERROR_UNSUPPORTED on drivers without pipeline library support;
+	// the cache then works in memory only
+	if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(library_.GetAddressOf()))))
+	{
+		library_.Reset();
+	}
+}
+
+std::wstring PipelineStateCache::NameOf(PipelineStateKey key)
+{
+	wchar_t name[17];
+	swprintf(name, 17, L"%016llx", static_cast<unsigned long long>(key.value));
+	return name;
+}
@@ -0,0 +1,72 @@
+#ifndef PIPELINE_STATE_CACHE_H
+#define PIPELINE_STATE_CACHE_H
+
+#include "LeanWin32.h"
+#include "DirectX12/d3dx12.h"
+#include "PipelineStateKey.h"
+#include "PipelineStream.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+// Deduplicates pipeline state objects in memory by PipelineStateKey, and keeps
+// them in an ID3D12PipelineLibrary that is written to disk, so later launches
+// load the driver-compiled PSOs instead of compiling them again. If the driver
+// or adapter changed, the library is rebuilt from scratch.
+class PipelineStateCache
+{
+public:
+	PipelineStateCache(ID3D12Device* device, std::wstring library_path);
+	PipelineStateCache(const PipelineStateCache&) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+	~PipelineStateCache();
+
+	ID3D12PipelineState* GetOrCreate(const CD3DX12_PIPELINE_STATE_STREAM2& stream, uint64_t root_signature_hash);
+	ID3D12PipelineState* GetOrCreate(PipelineStateKey key, const CD3DX12_PIPELINE_STATE_STREAM2& stream);
+	ID3D12PipelineState* GetOrCreate(PipelineStateKey key, const D3D12_PIPELINE_STATE_STREAM_DESC& stream_desc);
+
+	// The key of a PipelineDesc is precomputed, so a hit is one hash combine
+	// and a map lookup; the stream is only built on a miss
+	template<typename ShaderSource, typename... Subobjects>
+	ID3D12PipelineState* GetOrCreate(
+		const PipelineDesc<Subobjects...>& desc,
+		ID3D12RootSignature* root_signature,
+		uint64_t root_signature_hash,
+		const ShaderSource& shaders)
+	{
+		const PipelineStateKey key = desc.GetKey(root_signature_hash);
+		if (ID3D12PipelineState* pipeline = Find(key))
+		{
+			return pipeline;
+		}
+
+		const PipelineStream<Subobjects...> stream = desc.Build(root_signature, shaders);
+		return GetOrCreate(key, stream.GetDesc());
+	}
+	ID3D12PipelineState* Find(PipelineStateKey key) const;
+
+	// Writes the library to disk if new pipelines were stored since the last save
+	void Save();
+private:
+	void OpenLibrary();
+	static std::wstring NameOf(PipelineStateKey key);
+private:
+	struct KeyHash
+	{
+		size_t operator()(const PipelineStateKey& key) const { return static_cast<size_t>(key.value); }
+	};
+private:
+	ComPtr<ID3D12Device2> device_;
+	ComPtr<ID3D12PipelineLibrary1> library_;
+	std::wstring library_path_;
+	// The library reads from this blob for its whole lifetime
+	std::vector<char> library_blob_;
+	std::unordered_map<PipelineStateKey, ComPtr<ID3D12PipelineState>, KeyHash> pipelines_;
+	bool is_dirty_ = false;
+};
+
+#endif // !PIPELINE_STATE_CACHE_H
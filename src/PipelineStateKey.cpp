@@ -0,0 +1,213 @@
+#include "PipelineStateKey.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	void AddBool(Hasher& hasher, bool value)
+	{
+		hasher.Add(static_cast<uint64_t>(value ? 1 : 0));
+	}
+
+	void AddFloat(Hasher& hasher, float value)
+	{
+		// -0.0f and 0.0f configure the same state
+		if (value == 0.0f)
+		{
+			value = 0.0f;
+		}
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		hasher.Add(static_cast<uint64_t>(bits));
+	}
+
+	void AddShader(Hasher& hasher, const PipelineShaderDesc& shader)
+	{
+		if (!shader.IsPresent())
+		{
+			hasher.Add(uint64_t(0));
+			return;
+		}
+		hasher.Add(static_cast<uint64_t>(shader.size));
+		hasher.Add(shader.bytecode, shader.size);
+	}
+
+	void AddInputLayout(Hasher& hasher, std::span<const PipelineInputElementDesc> elements)
+	{
+		hasher.Add(static_cast<uint64_t>(elements.size()));
+		for (const PipelineInputElementDesc& element : elements)
+		{
+			hasher.Add(element.semantic_name ? element.semantic_name : "");
+			hasher.Add(static_cast<uint64_t>(element.semantic_index));
+			hasher.Add(static_cast<uint64_t>(element.format));
+			hasher.Add(static_cast<uint64_t>(element.input_slot));
+			hasher.Add(static_cast<uint64_t>(element.aligned_byte_offset));
+			hasher.Add(static_cast<uint64_t>(element.input_slot_class));
+			hasher.Add(static_cast<uint64_t>(element.instance_data_step_rate));
+		}
+	}
+
+	void AddStreamOutput(Hasher& hasher, const PipelineStateDesc& desc)
+	{
+		hasher.Add(static_cast<uint64_t>(desc.stream_output_entries.size()));
+		for (const PipelineStreamOutputEntryDesc& entry : desc.stream_output_entries)
+		{
+			hasher.Add(static_cast<uint64_t>(entry.stream));
+			hasher.Add(entry.semantic_name ? entry.semantic_name : "");
+			hasher.Add(static_cast<uint64_t>(entry.semantic_index));
+			hasher.Add(static_cast<uint64_t>(entry.start_component));
+			hasher.Add(static_cast<uint64_t>(entry.component_count));
+			hasher.Add(static_cast<uint64_t>(entry.output_slot));
+		}
+		hasher.Add(static_cast<uint64_t>(desc.stream_output_strides.size()));
+		for (const uint32_t stride : desc.stream_output_strides)
+		{
+			hasher.Add(static_cast<uint64_t>(stride));
+		}
+		hasher.Add(static_cast<uint64_t>(desc.rasterized_stream));
+	}
+
+	void AddBlend(Hasher& hasher, const PipelineStateDesc& desc)
+	{
+		AddBool(hasher, desc.alpha_to_coverage_enable);
+		AddBool(hasher, desc.independent_blend_enable);
+
+		// Without independent blending only the first entry is used
+		uint32_t count = 1;
+		if (desc.independent_blend_enable && desc.render_target_count > 1)
+		{
+			count = std::min(desc.render_target_count, PipelineStateDesc::kMaxRenderTargets);
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const PipelineRenderTargetBlendDesc& rt = desc.blend[i];
+			AddBool(hasher, rt.blend_enable);
+			AddBool(hasher, rt.logic_op_enable);
+			if (rt.blend_enable)
+			{
+				hasher.Add(static_cast<uint64_t>(rt.src_blend));
+				hasher.Add(static_cast<uint64_t>(rt.dest_blend));
+				hasher.Add(static_cast<uint64_t>(rt.blend_op));
+				hasher.Add(static_cast<uint64_t>(rt.src_blend_alpha));
+				hasher.Add(static_cast<uint64_t>(rt.dest_blend_alpha));
+				hasher.Add(static_cast<uint64_t>(rt.blend_op_alpha));
+			}
+			if (rt.logic_op_enable)
+			{
+				hasher.Add(static_cast<uint64_t>(rt.logic_op));
+			}
+			hasher.Add(static_cast<uint64_t>(rt.write_mask));
+		}
+	}
+
+	void AddStencilOp(Hasher& hasher, const PipelineStencilOpDesc& op)
+	{
+		hasher.Add(static_cast<uint64_t>(op.fail_op));
+		hasher.Add(static_cast<uint64_t>(op.depth_fail_op));
+		hasher.Add(static_cast<uint64_t>(op.pass_op));
+		hasher.Add(static_cast<uint64_t>(op.func));
+	}
+
+	void AddDepthStencil(Hasher& hasher, const PipelineStateDesc& desc)
+	{
+		AddBool(hasher, desc.depth_enable);
+		if (desc.depth_enable)
+		{
+			hasher.Add(static_cast<uint64_t>(desc.depth_write_mask));
+			hasher.Add(static_cast<uint64_t>(desc.depth_func));
+		}
+		AddBool(hasher, desc.stencil_enable);
+		if (desc.stencil_enable)
+		{
+			hasher.Add(static_cast<uint64_t>(desc.stencil_read_mask));
+			hasher.Add(static_cast<uint64_t>(desc.stencil_write_mask));
+			AddStencilOp(hasher, desc.front_face);
+			AddStencilOp(hasher, desc.back_face);
+		}
+		AddBool(hasher, desc.depth_bounds_test_enable);
+	}
+
+	void AddRasterizer(Hasher& hasher, const PipelineStateDesc& desc)
+	{
+		hasher.Add(static_cast<uint64_t>(desc.fill_mode));
+		hasher.Add(static_cast<uint64_t>(desc.cull_mode));
+		AddBool(hasher, desc.front_counter_clockwise);
+		hasher.Add(static_cast<uint64_t>(static_cast<uint32_t>(desc.depth_bias)));
+		AddFloat(hasher, desc.depth_bias_clamp);
+		AddFloat(hasher, desc.slope_scaled_depth_bias);
+		AddBool(hasher, desc.depth_clip_enable);
+		AddBool(hasher, desc.multisample_enable);
+		AddBool(hasher, desc.antialiased_line_enable);
+		hasher.Add(static_cast<uint64_t>(desc.forced_sample_count));
+		hasher.Add(static_cast<uint64_t>(desc.conservative_raster));
+	}
+
+	void AddViewInstancing(Hasher& hasher, const PipelineStateDesc& desc)
+	{
+		hasher.Add(static_cast<uint64_t>(desc.view_instances.size()));
+		for (const PipelineViewInstanceDesc& location : desc.view_instances)
+		{
+			hasher.Add(static_cast<uint64_t>(location.viewport_array_index));
+			hasher.Add(static_cast<uint64_t>(location.render_target_array_index));
+		}
+		hasher.Add(static_cast<uint64_t>(desc.view_instancing_flags));
+	}
+}
+
+PipelineStateKey PipelineStateKey::FromDesc(const PipelineStateDesc& desc, uint64_t root_signature_hash)
+{
+	// Bump when the normalization rules change so old on-disk entries miss
+	constexpr uint64_t kKeyVersion = 1;
+	Hasher hasher(kKeyVersion);
+
+	hasher.Add(static_cast<uint64_t>(desc.flags));
+	hasher.Add(static_cast<uint64_t>(desc.node_mask));
+	hasher.Add(root_signature_hash);
+
+	if (desc.cs.IsPresent())
+	{
+		hasher.Add("compute");
+		AddShader(hasher, desc.cs);
+		return PipelineStateKey{ hasher.Finish() };
+	}
+
+	if (desc.ms.IsPresent())
+	{
+		hasher.Add("mesh");
+		AddShader(hasher, desc.as);
+		AddShader(hasher, desc.ms);
+	}
+	else
+	{
+		hasher.Add("graphics");
+		AddInputLayout(hasher, desc.input_elements);
+		hasher.Add(static_cast<uint64_t>(desc.strip_cut_value));
+		AddShader(hasher, desc.vs);
+		AddShader(hasher, desc.hs);
+		AddShader(hasher, desc.ds);
+		AddShader(hasher, desc.gs);
+		AddStreamOutput(hasher, desc);
+	}
+	hasher.Add(static_cast<uint64_t>(desc.primitive_topology_type));
+	AddShader(hasher, desc.ps);
+
+	hasher.Add(static_cast<uint64_t>(desc.render_target_count));
+	for (uint32_t i = 0; i < desc.render_target_count && i < PipelineStateDesc::kMaxRenderTargets; ++i)
+	{
+		hasher.Add(static_cast<uint64_t>(desc.render_target_formats[i]));
+	}
+
+	AddBlend(hasher, desc);
+	AddDepthStencil(hasher, desc);
+	hasher.Add(static_cast<uint64_t>(desc.depth_stencil_format));
+	AddRasterizer(hasher, desc);
+
+	hasher.Add(static_cast<uint64_t>(desc.sample_count));
+	hasher.Add(static_cast<uint64_t>(desc.sample_quality));
+	hasher.Add(static_cast<uint64_t>(desc.sample_mask));
+	AddViewInstancing(hasher, desc);
+
+	return PipelineStateKey{ hasher.Finish() };
+}
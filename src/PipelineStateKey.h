@@ -0,0 +1,154 @@
+#ifndef PIPELINE_STATE_KEY_H
+#define PIPELINE_STATE_KEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// Pipeline state as plain data, for computing keys. The fields mirror the
+// D3D12 subobjects with enums held as their integer values, so the key layer
+// builds without the Windows headers; PipelineStateCache fills one in from a
+// CD3DX12_PIPELINE_STATE_STREAM2. Arrays are views into storage the caller
+// keeps alive while the key is computed.
+struct PipelineShaderDesc
+{
+	const void* bytecode = nullptr;
+	size_t size = 0;
+
+	bool IsPresent() const { return bytecode != nullptr && size != 0; }
+};
+
+struct PipelineInputElementDesc
+{
+	const char* semantic_name = nullptr;
+	uint32_t semantic_index = 0;
+	uint32_t format = 0;
+	uint32_t input_slot = 0;
+	uint32_t aligned_byte_offset = 0;
+	uint32_t input_slot_class = 0;
+	uint32_t instance_data_step_rate = 0;
+};
+
+struct PipelineStreamOutputEntryDesc
+{
+	uint32_t stream = 0;
+	const char* semantic_name = nullptr;
+	uint32_t semantic_index = 0;
+	uint32_t start_component = 0;
+	uint32_t component_count = 0;
+	uint32_t output_slot = 0;
+};
+
+struct PipelineRenderTargetBlendDesc
+{
+	bool blend_enable = false;
+	bool logic_op_enable = false;
+	uint32_t src_blend = 0;
+	uint32_t dest_blend = 0;
+	uint32_t blend_op = 0;
+	uint32_t src_blend_alpha = 0;
+	uint32_t dest_blend_alpha = 0;
+	uint32_t blend_op_alpha = 0;
+	uint32_t logic_op = 0;
+	uint32_t write_mask = 0;
+};
+
+struct PipelineStencilOpDesc
+{
+	uint32_t fail_op = 0;
+	uint32_t depth_fail_op = 0;
+	uint32_t pass_op = 0;
+	uint32_t func = 0;
+};
+
+struct PipelineViewInstanceDesc
+{
+	uint32_t viewport_array_index = 0;
+	uint32_t render_target_array_index = 0;
+};
+
+struct PipelineStateDesc
+{
+	static constexpr uint32_t kMaxRenderTargets = 8;
+
+	uint32_t flags = 0;
+	uint32_t node_mask = 0;
+
+	PipelineShaderDesc cs;
+	PipelineShaderDesc as;
+	PipelineShaderDesc ms;
+	PipelineShaderDesc vs;
+	PipelineShaderDesc hs;
+	PipelineShaderDesc ds;
+	PipelineShaderDesc gs;
+	PipelineShaderDesc ps;
+
+	std::span<const PipelineInputElementDesc> input_elements;
+	uint32_t strip_cut_value = 0;
+	uint32_t primitive_topology_type = 0;
+
+	std::span<const PipelineStreamOutputEntryDesc> stream_output_entries;
+	std::span<const uint32_t> stream_output_strides;
+	uint32_t rasterized_stream = 0;
+
+	uint32_t render_target_count = 0;
+	uint32_t render_target_formats[kMaxRenderTargets] = {};
+	uint32_t depth_stencil_format = 0;
+
+	bool alpha_to_coverage_enable = false;
+	bool independent_blend_enable = false;
+	PipelineRenderTargetBlendDesc blend[kMaxRenderTargets];
+
+	bool depth_enable = false;
+	uint32_t depth_write_mask = 0;
+	uint32_t depth_func = 0;
+	bool stencil_enable = false;
+	uint32_t stencil_read_mask = 0;
+	uint32_t stencil_write_mask = 0;
+	PipelineStencilOpDesc front_face;
+	PipelineStencilOpDesc back_face;
+	bool depth_bounds_test_enable = false;
+
+	uint32_t fill_mode = 0;
+	uint32_t cull_mode = 0;
+	bool front_counter_clockwise = false;
+	int32_t depth_bias = 0;
+	float depth_bias_clamp = 0.0f;
+	float slope_scaled_depth_bias = 0.0f;
+	bool depth_clip_enable = false;
+	bool multisample_enable = false;
+	bool antialiased_line_enable = false;
+	uint32_t forced_sample_count = 0;
+	uint32_t conservative_raster = 0;
+
+	uint32_t sample_count = 1;
+	uint32_t sample_quality = 0;
+	uint32_t sample_mask = 0;
+
+	std::span<const PipelineViewInstanceDesc> view_instances;
+	uint32_t view_instancing_flags = 0;
+};
+
+// Stable identity of a pipeline state, computed from what a description
+// configures rather than its bytes. Pointers (shader bytecode, semantic names)
+// are replaced by what they point at, and state the pipeline ignores is left
+// out, so two descriptions of the same PSO always produce the same key:
+//  - shader stages with no bytecode are treated as absent
+//  - compute descriptions only hash the compute-relevant fields
+//  - mesh descriptions skip the input assembler, VS/HS/DS/GS and stream output
+//  - depth/stencil and blend operands are skipped when that test/blend is off
+//  - render target formats past render_target_count are ignored
+// The root signature is an opaque COM object, so the caller passes the content
+// hash it was built from (see RootSignatureCache::GetOrCreate).
+struct PipelineStateKey
+{
+	uint64_t value = 0;
+
+	static PipelineStateKey FromDesc(const PipelineStateDesc& desc, uint64_t root_signature_hash);
+
+	bool operator==(const PipelineStateKey& rhs) const { return value == rhs.value; }
+	bool operator!=(const PipelineStateKey& rhs) const { return value != rhs.value; }
+};
+
+#endif // !PIPELINE_STATE_KEY_H
@@ -0,0 +1,483 @@
+#ifndef PIPELINE_STREAM_H
+#define PIPELINE_STREAM_H
+
+#include "LeanWin32.h"
+#include "Hash.h"
+#include "PipelineStateKey.h"
+#include <d3d12.h>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Pipeline state streams assembled from a compile-time list of subobjects.
+//
+//   constexpr PipelineDesc kOpaque{
+//       PsoVS{ kOpaqueVS }, PsoPS{ kOpaquePS },
+//       PsoTopology{ D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE },
+//       PsoRasterizer{ kDefaultRasterizerDesc }, ... };
+//
+// The subobject list is checked with static_asserts (duplicates, compute mixed
+// with graphics state, mesh pipelines with an input assembler, ...). Values are
+// checked when the description is built, which for a constexpr description
+// means at compile time. Shaders are referred to by their ShaderPack key and
+// the root signature is supplied at build time, so the whole description, and
+// its hash, is a constant. GetKey() then only mixes in the root signature hash.
+//
+// Keys follow the same normalization as PipelineStateKey::FromDesc, but
+// hash shader keys instead of bytecode, so a pipeline built both ways is
+// cached twice. Subobjects left out key differently from ones set to their
+// default value.
+
+// One subobject kind. Descriptions store a 'Value'; for shaders that is the
+// ShaderPack key, which becomes bytecode when the stream is built.
+template<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename Inner, typename Value = Inner>
+struct PipelineSubobject
+{
+	static constexpr D3D12_PIPELINE_STATE_SUBOBJECT_TYPE kType = Type;
+	using InnerType = Inner;
+	using ValueType = Value;
+
+	Value value{};
+};
+
+using PsoFlags = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS, D3D12_PIPELINE_STATE_FLAGS>;
+using PsoNodeMask = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK, UINT>;
+using PsoInputLayout = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT, D3D12_INPUT_LAYOUT_DESC>;
+using PsoStripCut = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE, D3D12_INDEX_BUFFER_STRIP_CUT_VALUE>;
+using PsoTopology = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE>;
+using PsoVS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoHS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoDS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoGS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoPS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoAS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoMS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoCS = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS, D3D12_SHADER_BYTECODE, uint64_t>;
+using PsoBlend = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, D3D12_BLEND_DESC>;
+using PsoDepthStencil = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1>;
+using PsoDepthFormat = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT, DXGI_FORMAT>;
+using PsoRasterizer = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC>;
+using PsoRenderTargets = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY>;
+using PsoSampleDesc = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, DXGI_SAMPLE_DESC>;
+using PsoSampleMask = PipelineSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, UINT>;
+
+// The d3dx12 CD3DX12_DEFAULT states, as constants
+inline constexpr D3D12_RASTERIZER_DESC kDefaultRasterizerDesc =
+{
+	D3D12_FILL_MODE_SOLID,
+	D3D12_CULL_MODE_BACK,
+	FALSE,
+	D3D12_DEFAULT_DEPTH_BIAS,
+	D3D12_DEFAULT_DEPTH_BIAS_CLAMP,
+	D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS,
+	TRUE,
+	FALSE,
+	FALSE,
+	0,
+	D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
+};
+
+inline constexpr D3D12_DEPTH_STENCIL_DESC1 kDefaultDepthStencilDesc =
+{
+	TRUE,
+	D3D12_DEPTH_WRITE_MASK_ALL,
+	D3D12_COMPARISON_FUNC_LESS,
+	FALSE,
+	D3D12_DEFAULT_STENCIL_READ_MASK,
+	D3D12_DEFAULT_STENCIL_WRITE_MASK,
+	{ D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS },
+	{ D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS },
+	FALSE
+};
+
+inline constexpr D3D12_BLEND_DESC kDefaultBlendDesc = []
+{
+	D3D12_BLEND_DESC desc{};
+	for (D3D12_RENDER_TARGET_BLEND_DESC& rt : desc.RenderTarget)
+	{
+		rt =
+		{
+			FALSE, FALSE,
+			D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+			D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+			D3D12_LOGIC_OP_NOOP,
+			D3D12_COLOR_WRITE_ENABLE_ALL
+		};
+	}
+	return desc;
+}();
+
+// Deliberately not constexpr: reaching it while a constexpr PipelineDesc is
+// constructed fails the compile, with the message in the diagnostic
+inline void PipelineDescError(const char* message)
+{
+	assert(false && "Invalid pipeline description.");
+	(void)message;
+}
+
+// Questions about a subobject list, outside PipelineDesc so they can be asked
+// in its static_asserts while the class is still incomplete
+template<typename... Subobjects>
+struct PipelineSubobjectList
+{
+	static constexpr int Count(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type)
+	{
+		return ((Subobjects::kType == type ? 1 : 0) + ... + 0);
+	}
+
+	static constexpr bool Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type)
+	{
+		return Count(type) > 0;
+	}
+
+	static constexpr bool IsUnique()
+	{
+		return ((Count(Subobjects::kType) == 1) && ...);
+	}
+
+	static constexpr bool IsComputeOnly()
+	{
+		return ((Subobjects::kType == D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS ||
+			Subobjects::kType == D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS ||
+			Subobjects::kType == D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_NODE_MASK) && ...);
+	}
+};
+
+// Subobject as laid out in a D3D12 stream: the type tag, then the value, the
+// pair padded to pointer alignment (same as CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT)
+template<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename Inner>
+struct alignas(void*) PipelineStreamEntry
+{
+	D3D12_PIPELINE_STATE_SUBOBJECT_TYPE type = Type;
+	Inner inner{};
+};
+
+// Entries back to back in declaration order; std::tuple doesn't promise that
+template<typename... Entries>
+struct PipelineStreamStorage;
+
+template<typename Last>
+struct PipelineStreamStorage<Last>
+{
+	constexpr PipelineStreamStorage(const Last& last)
+		:
+		entry(last)
+	{ }
+
+	Last entry;
+};
+
+template<typename First, typename... Rest>
+struct PipelineStreamStorage<First, Rest...>
+{
+	constexpr PipelineStreamStorage(const First& first, const Rest&... others)
+		:
+		entry(first),
+		rest(others...)
+	{ }
+
+	First entry;
+	PipelineStreamStorage<Rest...> rest;
+};
+
+// Ready-to-create stream: the root signature followed by the description's
+// subobjects with shaders resolved to bytecode
+template<typename... Subobjects>
+class PipelineStream
+{
+public:
+	constexpr PipelineStream(ID3D12RootSignature* root_signature, const typename Subobjects::InnerType&... inners)
+		:
+		storage_(RootEntry{ D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, root_signature },
+			PipelineStreamEntry<Subobjects::kType, typename Subobjects::InnerType>{ Subobjects::kType, inners }...)
+	{ }
+
+	D3D12_PIPELINE_STATE_STREAM_DESC GetDesc() const
+	{
+		D3D12_PIPELINE_STATE_STREAM_DESC desc{};
+		desc.SizeInBytes = sizeof(storage_);
+		desc.pPipelineStateSubobjectStream = const_cast<Storage*>(&storage_);
+		return desc;
+	}
+private:
+	using RootEntry = PipelineStreamEntry<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*>;
+	using Storage = PipelineStreamStorage<RootEntry, PipelineStreamEntry<Subobjects::kType, typename Subobjects::InnerType>...>;
+
+	static_assert(sizeof(Storage) ==
+		(sizeof(RootEntry) + ... + sizeof(PipelineStreamEntry<Subobjects::kType, typename Subobjects::InnerType>)),
+		"The runtime walks the stream assuming no gaps between subobjects.");
+private:
+	Storage storage_;
+};
+
+template<typename... Subobjects>
+class PipelineDesc
+{
+	using List = PipelineSubobjectList<Subobjects...>;
+
+	static_assert(sizeof...(Subobjects) > 0, "A pipeline needs at least one shader.");
+	static_assert(List::IsUnique(), "Each subobject may appear only once.");
+	static_assert(!List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS) || List::IsComputeOnly(),
+		"Compute pipelines take only CS, flags and node mask.");
+	static_assert(List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS),
+		"Graphics pipelines need a vertex or mesh shader.");
+	static_assert(!List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS) || !(
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_GS) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT) ||
+		List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_IB_STRIP_CUT_VALUE)),
+		"Mesh pipelines replace the input assembler and VS/HS/DS/GS.");
+	static_assert(!List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS) || List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS),
+		"An amplification shader needs a mesh shader.");
+	static_assert(List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS) == List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DS),
+		"Hull and domain shaders come as a pair.");
+	static_assert(!List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS) || List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY),
+		"Vertex pipelines need a primitive topology type.");
+public:
+	constexpr PipelineDesc(const Subobjects&... subobjects)
+		:
+		values_(subobjects...),
+		state_hash_(HashSubobjects(subobjects...))
+	{
+		Validate();
+	}
+
+	// Hash of everything but the root signature; a constant for constexpr descriptions
+	constexpr uint64_t GetStateHash() const
+	{
+		return state_hash_;
+	}
+
+	constexpr PipelineStateKey GetKey(uint64_t root_signature_hash) const
+	{
+		return PipelineStateKey{ HashCombine(state_hash_, root_signature_hash) };
+	}
+
+	template<typename Subobject>
+	constexpr const typename Subobject::ValueType& Get() const
+	{
+		return std::get<Subobject>(values_).value;
+	}
+
+	// 'shaders' is anything with Find(uint64_t key) returning the bytecode,
+	// such as ShaderCache
+	template<typename ShaderSource>
+	PipelineStream<Subobjects...> Build(ID3D12RootSignature* root_signature, const ShaderSource& shaders) const
+	{
+		return PipelineStream<Subobjects...>(root_signature, Resolve<Subobjects>(shaders)...);
+	}
+private:
+	template<typename Subobject, typename ShaderSource>
+	typename Subobject::InnerType Resolve(const ShaderSource& shaders) const
+	{
+		if constexpr (std::is_same_v<typename Subobject::InnerType, D3D12_SHADER_BYTECODE>)
+		{
+			return static_cast<D3D12_SHADER_BYTECODE>(shaders.Find(Get<Subobject>()));
+		}
+		else
+		{
+			return Get<Subobject>();
+		}
+	}
+
+	constexpr void Validate() const
+	{
+		// Graphics pipelines without the subobject get D3D12's default, which
+		// has depth testing on
+		D3D12_DEPTH_STENCIL_DESC1 depth_stencil = kDefaultDepthStencilDesc;
+		if constexpr (List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1))
+		{
+			depth_stencil = Get<PsoDepthStencil>();
+		}
+		const bool uses_depth_stencil = !List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS) &&
+			(depth_stencil.DepthEnable || depth_stencil.StencilEnable);
+		if (uses_depth_stencil)
+		{
+			if constexpr (List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT))
+			{
+				if (Get<PsoDepthFormat>() == DXGI_FORMAT_UNKNOWN)
+				{
+					PipelineDescError("Depth/stencil testing needs a depth stencil format.");
+				}
+			}
+			else
+			{
+				PipelineDescError("Depth/stencil testing needs a depth stencil format.");
+			}
+		}
+
+		if constexpr (List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS))
+		{
+			if (Get<PsoRenderTargets>().NumRenderTargets > D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT)
+			{
+				PipelineDescError("Too many render targets.");
+			}
+		}
+
+		if constexpr (List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_HS))
+		{
+			if (Get<PsoTopology>() != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH)
+			{
+				PipelineDescError("Tessellation needs the patch topology type.");
+			}
+		}
+
+		if constexpr (List::Has(D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC))
+		{
+			if (Get<PsoSampleDesc>().Count == 0)
+			{
+				PipelineDescError("Sample count must be at least 1.");
+			}
+		}
+	}
+
+	static constexpr uint64_t HashSubobjects(const Subobjects&... subobjects)
+	{
+		// Bump when the normalization rules change so old on-disk entries miss
+		constexpr uint64_t kKeyVersion = 1;
+		// Summed instead of chained, so the order subobjects are listed in doesn't matter
+		return HashCombine(kKeyVersion,
+			(HashValue(static_cast<uint64_t>(Subobjects::kType), subobjects.value) + ... + 0));
+	}
+
+	template<typename T>
+		requires std::is_integral_v<T> || std::is_enum_v<T>
+	static constexpr uint64_t HashValue(uint64_t state, T value)
+	{
+		return HashCombine(state, static_cast<uint64_t>(value));
+	}
+
+	static constexpr uint64_t HashFloat(uint64_t state, float value)
+	{
+		// -0.0f and 0.0f configure the same state
+		return HashCombine(state, std::bit_cast<uint32_t>(value == 0.0f ? 0.0f : value));
+	}
+
+	static constexpr uint64_t HashText(uint64_t state, const char* text)
+	{
+		const std::string_view view = text ? text : "";
+		state = HashCombine(state, view.size());
+		for (char c : view)
+		{
+			state = HashCombine(state, static_cast<uint64_t>(static_cast<unsigned char>(c)));
+		}
+		return state;
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const D3D12_INPUT_LAYOUT_DESC& layout)
+	{
+		state = HashCombine(state, layout.NumElements);
+		for (UINT i = 0; i < layout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+			state = HashText(state, element.SemanticName);
+			state = HashValue(state, element.SemanticIndex);
+			state = HashValue(state, element.Format);
+			state = HashValue(state, element.InputSlot);
+			state = HashValue(state, element.AlignedByteOffset);
+			state = HashValue(state, element.InputSlotClass);
+			state = HashValue(state, element.InstanceDataStepRate);
+		}
+		return state;
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const D3D12_BLEND_DESC& blend)
+	{
+		state = HashValue(state, blend.AlphaToCoverageEnable ? 1 : 0);
+		state = HashValue(state, blend.IndependentBlendEnable ? 1 : 0);
+
+		// Without independent blending only the first entry is used
+		const UINT count = blend.IndependentBlendEnable ? D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT : 1;
+		for (UINT i = 0; i < count; ++i)
+		{
+			const D3D12_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[i];
+			state = HashValue(state, rt.BlendEnable ? 1 : 0);
+			state = HashValue(state, rt.LogicOpEnable ? 1 : 0);
+			if (rt.BlendEnable)
+			{
+				state = HashValue(state, rt.SrcBlend);
+				state = HashValue(state, rt.DestBlend);
+				state = HashValue(state, rt.BlendOp);
+				state = HashValue(state, rt.SrcBlendAlpha);
+				state = HashValue(state, rt.DestBlendAlpha);
+				state = HashValue(state, rt.BlendOpAlpha);
+			}
+			if (rt.LogicOpEnable)
+			{
+				state = HashValue(state, rt.LogicOp);
+			}
+			state = HashValue(state, rt.RenderTargetWriteMask);
+		}
+		return state;
+	}
+
+	static constexpr uint64_t HashStencilOp(uint64_t state, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		state = HashValue(state, op.StencilFailOp);
+		state = HashValue(state, op.StencilDepthFailOp);
+		state = HashValue(state, op.StencilPassOp);
+		return HashValue(state, op.StencilFunc);
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const D3D12_DEPTH_STENCIL_DESC1& depth_stencil)
+	{
+		state = HashValue(state, depth_stencil.DepthEnable ? 1 : 0);
+		if (depth_stencil.DepthEnable)
+		{
+			state = HashValue(state, depth_stencil.DepthWriteMask);
+			state = HashValue(state, depth_stencil.DepthFunc);
+		}
+		state = HashValue(state, depth_stencil.StencilEnable ? 1 : 0);
+		if (depth_stencil.StencilEnable)
+		{
+			state = HashValue(state, depth_stencil.StencilReadMask);
+			state = HashValue(state, depth_stencil.StencilWriteMask);
+			state = HashStencilOp(state, depth_stencil.FrontFace);
+			state = HashStencilOp(state, depth_stencil.BackFace);
+		}
+		return HashValue(state, depth_stencil.DepthBoundsTestEnable ? 1 : 0);
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const D3D12_RASTERIZER_DESC& rasterizer)
+	{
+		state = HashValue(state, rasterizer.FillMode);
+		state = HashValue(state, rasterizer.CullMode);
+		state = HashValue(state, rasterizer.FrontCounterClockwise ? 1 : 0);
+		state = HashValue(state, static_cast<uint32_t>(rasterizer.DepthBias));
+		state = HashFloat(state, rasterizer.DepthBiasClamp);
+		state = HashFloat(state, rasterizer.SlopeScaledDepthBias);
+		state = HashValue(state, rasterizer.DepthClipEnable ? 1 : 0);
+		state = HashValue(state, rasterizer.MultisampleEnable ? 1 : 0);
+		state = HashValue(state, rasterizer.AntialiasedLineEnable ? 1 : 0);
+		state = HashValue(state, rasterizer.ForcedSampleCount);
+		return HashValue(state, rasterizer.ConservativeRaster);
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const D3D12_RT_FORMAT_ARRAY& formats)
+	{
+		state = HashValue(state, formats.NumRenderTargets);
+		for (UINT i = 0; i < formats.NumRenderTargets && i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		{
+			state = HashValue(state, formats.RTFormats[i]);
+		}
+		return state;
+	}
+
+	static constexpr uint64_t HashValue(uint64_t state, const DXGI_SAMPLE_DESC& sample_desc)
+	{
+		state = HashValue(state, sample_desc.Count);
+		return HashValue(state, sample_desc.Quality);
+	}
+private:
+	std::tuple<Subobjects...> values_;
+	uint64_t state_hash_;
+};
+
+#endif // !PIPELINE_STREAM_H
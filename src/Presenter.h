@@ -0,0 +1,24 @@
+#ifndef PRESENTER_H
+#define PRESENTER_H
+
+#include <cstdint>
+
+// What the frame loop needs from a swap chain. SwapChainPresenter is the DXGI
+// one; anything else (e.g. a simulated display) can stand in to exercise
+// FrameLatencyController without a GPU.
+class Presenter
+{
+public:
+	virtual ~Presenter() = default;
+
+	// Blocks until the swap chain can queue another frame; returns the milliseconds waited
+	virtual double WaitForFrame() = 0;
+	// Queues the back buffer; returns the milliseconds since the previous Present
+	virtual double Present() = 0;
+
+	virtual void SetMaximumFrameLatency(uint32_t latency) = 0;
+	virtual uint32_t GetMaximumFrameLatency() const = 0;
+	virtual double GetRefreshIntervalMs() const = 0;
+};
+
+#endif // !PRESENTER_H
@@ -0,0 +1,174 @@
+#include "Profiler.h"
+#include <cassert>
+
+Profiler::Profiler(TimestampSource* source, uint32_t slot_count, uint32_t max_gpu_scopes_per_frame)
+	:
+	source_(source),
+	max_gpu_scopes_(max_gpu_scopes_per_frame),
+	epoch_(Clock::now()),
+	slots_(slot_count)
+{
+	assert(slot_count > 0 && "The profiler needs at least one slot.");
+}
+
+void Profiler::BeginFrame(uint64_t completed_fence)
+{
+	// The slot about to be reused is the oldest, so this publishes in frame order
+	const uint32_t slot_count = static_cast<uint32_t>(slots_.size());
+	for (uint32_t i = 0; i < slot_count; ++i)
+	{
+		const uint32_t s = (current_slot_ + i) % slot_count;
+		if (slots_[s].pending && slots_[s].fence_value <= completed_fence)
+		{
+			Publish(s);
+		}
+	}
+
+	Slot& slot = slots_[current_slot_];
+
+	// Running this far ahead of the GPU means the slot's queries may still be
+	// written to. Rather than wait, give up on that frame and skip GPU scopes
+	// for this one.
+	slot.pending = false;
+	gpu_enabled_ = source_ && slot.fence_value <= completed_fence;
+
+	slot.frame_index = frame_index_;
+	slot.query_count = 0;
+	slot.begin_ms = ToMilliseconds(Clock::now());
+	slot.cpu_scopes.clear();
+	slot.gpu_scopes.clear();
+	cpu_depth_ = 0;
+	gpu_depth_ = 0;
+}
+
+void Profiler::EndFrame(uint64_t fence_value)
+{
+	Slot& slot = slots_[current_slot_];
+	slot.end_ms = ToMilliseconds(Clock::now());
+	slot.fence_value = fence_value;
+	slot.pending = true;
+
+	if (slot.query_count > 0)
+	{
+		source_->Resolve(current_slot_ * max_gpu_scopes_ * 2, slot.query_count);
+	}
+
+	current_slot_ = (current_slot_ + 1) % static_cast<uint32_t>(slots_.size());
+	++frame_index_;
+}
+
+Profiler::ScopeId Profiler::BeginCpu(const char* name)
+{
+	std::vector<Scope>& scopes = slots_[current_slot_].cpu_scopes;
+	const uint64_t now = static_cast<uint64_t>((Clock::now() - epoch_).count());
+	scopes.push_back(Scope{ name, now, now, cpu_depth_++ });
+	return static_cast<ScopeId>(scopes.size() - 1);
+}
+
+void Profiler::EndCpu(ScopeId scope)
+{
+	slots_[current_slot_].cpu_scopes[scope].end = static_cast<uint64_t>((Clock::now() - epoch_).count());
+	--cpu_depth_;
+}
+
+Profiler::ScopeId Profiler::BeginGpu(const char* name)
+{
+	Slot& slot = slots_[current_slot_];
+	if (!gpu_enabled_ || slot.gpu_scopes.size() == max_gpu_scopes_)
+	{
+		return kInvalidScope;
+	}
+
+	const uint32_t query = current_slot_ * max_gpu_scopes_ * 2 + slot.query_count++;
+	source_->WriteTimestamp(query);
+	slot.gpu_scopes.push_back(Scope{ name, query, query, gpu_depth_++ });
+	return static_cast<ScopeId>(slot.gpu_scopes.size() - 1);
+}
+
+void Profiler::EndGpu(ScopeId scope)
+{
+	if (scope == kInvalidScope)
+	{
+		return;
+	}
+
+	Slot& slot = slots_[current_slot_];
+	const uint32_t query = current_slot_ * max_gpu_scopes_ * 2 + slot.query_count++;
+	source_->WriteTimestamp(query);
+	slot.gpu_scopes[scope].end = query;
+	--gpu_depth_;
+}
+
+const char* Profiler::Intern(std::string_view name)
+{
+	// Called with the same names every frame, so only a new name allocates
+	const auto found = names_.find(name);
+	if (found != names_.end())
+	{
+		return found->c_str();
+	}
+	return names_.emplace(name).first->c_str();
+}
+
+const Profiler::Frame& Profiler::GetLastFrame() const
+{
+	return last_frame_;
+}
+
+double Profiler::ToMilliseconds(Clock::time_point time) const
+{
+	return std::chrono::duration<double, std::milli>(time - epoch_).count();
+}
+
+uint32_t Profiler::GetQueryCount() const
+{
+	return QueryCountFor(static_cast<uint32_t>(slots_.size()), max_gpu_scopes_);
+}
+
+void Profiler::Publish(uint32_t slot_index)
+{
+	Slot& slot = slots_[slot_index];
+	slot.pending = false;
+
+	last_frame_.index = slot.frame_index;
+	last_frame_.begin_ms = slot.begin_ms;
+	last_frame_.end_ms = slot.end_ms;
+	last_frame_.events.clear();
+
+	for (const Scope& scope : slot.cpu_scopes)
+	{
+		last_frame_.events.push_back(Event{
+			scope.name,
+			std::chrono::duration<double, std::milli>(Clock::duration(scope.begin)).count(),
+			std::chrono::duration<double, std::milli>(Clock::duration(scope.end)).count(),
+			scope.depth,
+			Track::kCpu });
+	}
+
+	if (slot.gpu_scopes.empty())
+	{
+		return;
+	}
+
+	// Move GPU ticks onto the CPU timeline through a fresh calibration pair.
+	// The timestamps are older than the pair, hence the signed difference.
+	uint64_t calibration_ticks = 0;
+	Clock::time_point calibration_time;
+	source_->Calibrate(calibration_ticks, calibration_time);
+	const double calibration_ms = ToMilliseconds(calibration_time);
+	const double ms_per_tick = 1000.0 / static_cast<double>(source_->GetFrequency());
+	const uint64_t* results = source_->ReadResults(slot_index * max_gpu_scopes_ * 2);
+	const uint32_t first_query = slot_index * max_gpu_scopes_ * 2;
+
+	for (const Scope& scope : slot.gpu_scopes)
+	{
+		const int64_t begin = static_cast<int64_t>(results[scope.begin - first_query] - calibration_ticks);
+		const int64_t end = static_cast<int64_t>(results[scope.end - first_query] - calibration_ticks);
+		last_frame_.events.push_back(Event{
+			scope.name,
+			calibration_ms + static_cast<double>(begin) * ms_per_tick,
+			calibration_ms + static_cast<double>(end) * ms_per_tick,
+			scope.depth,
+			Track::kGpu });
+	}
+}
@@ -0,0 +1,163 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// CPU and GPU scope markers on one timeline, in milliseconds since the profiler
+// was created. GPU scopes are timestamp queries: each frame's queries are
+// resolved into a readback ring slot at EndFrame() and read back frames later,
+// once the fence says the GPU is done, so the CPU never waits on them. A frame
+// is published (GetLastFrame) when its GPU results arrive, CPU scopes included.
+//
+// The GPU side goes through TimestampSource, so the ring logic has no D3D
+// dependency (see GpuTimestampSource for the real one).
+class Profiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	class TimestampSource
+	{
+	public:
+		virtual ~TimestampSource() = default;
+		// Records the GPU clock into query 'query' on the current command list
+		virtual void WriteTimestamp(uint32_t query) = 0;
+		// Copies queries [first, first + count) to the readback memory of the same index
+		virtual void Resolve(uint32_t first, uint32_t count) = 0;
+		// Readback memory of query 'first'; only valid once the resolve has executed
+		virtual const uint64_t* ReadResults(uint32_t first) = 0;
+		virtual uint64_t GetFrequency() = 0;	// GPU ticks per second
+		// A GPU timestamp and the CPU time taken at the same moment
+		virtual void Calibrate(uint64_t& gpu_ticks, Clock::time_point& cpu_time) = 0;
+	};
+
+	enum class Track : uint8_t
+	{
+		kCpu,
+		kGpu
+	};
+
+	struct Event
+	{
+		const char* name;
+		double begin_ms;
+		double end_ms;
+		uint16_t depth;	// Nesting level within its track
+		Track track;
+	};
+
+	struct Frame
+	{
+		uint64_t index = 0;
+		double begin_ms = 0.0;
+		double end_ms = 0.0;
+		std::vector<Event> events;	// CPU then GPU, each in begin order
+	};
+
+	// Returned by Begin*(); kInvalidScope when the scope isn't recorded
+	using ScopeId = uint32_t;
+	static constexpr ScopeId kInvalidScope = UINT32_MAX;
+
+	class CpuScope
+	{
+	public:
+		CpuScope(Profiler& profiler, const char* name) : profiler_(profiler), id_(profiler.BeginCpu(name)) { }
+		~CpuScope() { profiler_.EndCpu(id_); }
+		CpuScope(const CpuScope&) = delete;
+		CpuScope& operator=(const CpuScope&) = delete;
+	private:
+		Profiler& profiler_;
+		ScopeId id_;
+	};
+
+	class GpuScope
+	{
+	public:
+		GpuScope(Profiler& profiler, const char* name) : profiler_(profiler), id_(profiler.BeginGpu(name)) { }
+		~GpuScope() { profiler_.EndGpu(id_); }
+		GpuScope(const GpuScope&) = delete;
+		GpuScope& operator=(const GpuScope&) = delete;
+	private:
+		Profiler& profiler_;
+		ScopeId id_;
+	};
+public:
+	// 'source' may be null for CPU-only profiling. slot_count frames can be in
+	// flight before GPU scopes start getting dropped.
+	Profiler(TimestampSource* source, uint32_t slot_count, uint32_t max_gpu_scopes_per_frame);
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// completed_fence is the last fence value the GPU has reached
+	void BeginFrame(uint64_t completed_fence);
+	// fence_value is signalled after the frame's last command list
+	void EndFrame(uint64_t fence_value);
+
+	// Names must outlive the frame's results; use Intern() for dynamic ones
+	ScopeId BeginCpu(const char* name);
+	void EndCpu(ScopeId scope);
+	// Recorded on whatever command list the source is writing to
+	ScopeId BeginGpu(const char* name);
+	void EndGpu(ScopeId scope);
+
+	const char* Intern(std::string_view name);
+
+	// Most recent frame whose GPU results are back; empty until the first one
+	const Frame& GetLastFrame() const;
+	double ToMilliseconds(Clock::time_point time) const;
+	uint32_t GetQueryCount() const;	// Queries the source has to provide
+
+	static constexpr uint32_t QueryCountFor(uint32_t slot_count, uint32_t max_gpu_scopes_per_frame)
+	{
+		return slot_count * max_gpu_scopes_per_frame * 2;
+	}
+private:
+	struct Scope
+	{
+		const char* name;
+		uint64_t begin;	// Clock ticks for CPU scopes, query index for GPU scopes
+		uint64_t end;
+		uint16_t depth;
+	};
+
+	// Lets names_ be searched with a string_view without building a string
+	struct NameHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+	};
+
+	struct Slot
+	{
+		uint64_t frame_index = 0;
+		uint64_t fence_value = 0;
+		bool pending = false;	// Resolved and waiting for the GPU
+		uint32_t query_count = 0;
+		double begin_ms = 0.0;
+		double end_ms = 0.0;
+		std::vector<Scope> cpu_scopes;
+		std::vector<Scope> gpu_scopes;
+	};
+private:
+	void Publish(uint32_t slot_index);
+private:
+	TimestampSource* source_;
+	uint32_t max_gpu_scopes_;
+	Clock::time_point epoch_;
+	std::vector<Slot> slots_;
+	uint32_t current_slot_ = 0;
+	uint64_t frame_index_ = 0;
+	bool gpu_enabled_ = false;	// False while the current slot is still in flight
+	uint16_t cpu_depth_ = 0;
+	uint16_t gpu_depth_ = 0;
+	std::unordered_set<std::string, NameHash, std::equal_to<>> names_;
+	Frame last_frame_;
+};
+
+#endif // !PROFILER_H
@@ -0,0 +1,580 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <queue>
+
+RenderGraph::ResourceId RenderGraph::CreateTransient(std::string name, uint64_t size, uint64_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+	Resource resource;
+	resource.name = std::move(name);
+	resource.size = size;
+	resource.alignment = alignment;
+	resources_.push_back(std::move(resource));
+	return static_cast<ResourceId>(resources_.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::Import(std::string name, uint32_t initial_state, uint32_t final_state)
+{
+	Resource resource;
+	resource.name = std::move(name);
+	resource.initial_state = initial_state;
+	resource.final_state = final_state;
+	resource.is_imported = true;
+	resources_.push_back(std::move(resource));
+	return static_cast<ResourceId>(resources_.size() - 1);
+}
+
+void RenderGraph::MarkOutput(ResourceId resource)
+{
+	resources_[resource].is_output = true;
+}
+
+RenderGraph::PassId RenderGraph::AddPass(std::string name, ExecuteFunction execute)
+{
+	// Reuse the slot (and its uses vector capacity) left behind by Reset()
+	if (passes_.size() < passes_.capacity())
+	{
+		passes_.emplace_back();
+	}
+	else
+	{
+		passes_.push_back(Pass{});
+	}
+	Pass& pass = passes_.back();
+	pass.name = std::move(name);
+	pass.execute = std::move(execute);
+	return static_cast<PassId>(passes_.size() - 1);
+}
+
+void RenderGraph::Read(PassId pass, ResourceId resource, uint32_t access)
+{
+	AddUse(pass, resource, access, false);
+}
+
+void RenderGraph::Write(PassId pass, ResourceId resource, uint32_t access)
+{
+	AddUse(pass, resource, access, true);
+}
+
+void RenderGraph::SetSideEffect(PassId pass)
+{
+	passes_[pass].has_side_effect = true;
+}
+
+const RenderGraph::CompiledGraph& RenderGraph::Compile()
+{
+	compiled_.passes.clear();
+	compiled_.barriers.clear();
+	compiled_.final_barriers.clear();
+	compiled_.transient_offsets.assign(resources_.size(), kNotPlaced);
+	compiled_.transient_initial_states.assign(resources_.size(), kCommon);
+	compiled_.transient_heap_size = 0;
+	compiled_.culled_pass_count = 0;
+
+	BuildDependencies();
+	CullPasses();
+	OrderPasses();
+	PlaceTransients();
+	BuildBarriers();
+
+	return compiled_;
+}
+
+void RenderGraph::Reset()
+{
+	passes_.clear();
+	resources_.clear();
+}
+
+const RenderGraph::CompiledGraph& RenderGraph::GetCompiled() const
+{
+	return compiled_;
+}
+
+const std::string& RenderGraph::GetPassName(PassId pass) const
+{
+	return passes_[pass].name;
+}
+
+const std::string& RenderGraph::GetResourceName(ResourceId resource) const
+{
+	return resources_[resource].name;
+}
+
+const RenderGraph::ExecuteFunction& RenderGraph::GetExecuteFunction(PassId pass) const
+{
+	return passes_[pass].execute;
+}
+
+uint32_t RenderGraph::GetPassCount() const
+{
+	return static_cast<uint32_t>(passes_.size());
+}
+
+uint32_t RenderGraph::GetResourceCount() const
+{
+	return static_cast<uint32_t>(resources_.size());
+}
+
+bool RenderGraph::IsWriteAccess(uint32_t access)
+{
+	return (access & (kRenderTarget | kUnorderedAccess | kDepthWrite | kCopyDest)) != 0;
+}
+
+void RenderGraph::AddUse(PassId pass, ResourceId resource, uint32_t access, bool is_write)
+{
+	assert(pass < passes_.size() && resource < resources_.size() && "Unknown pass or resource.");
+
+	// One entry per resource and pass; a second declaration widens the first
+	for (Use& use : passes_[pass].uses)
+	{
+		if (use.resource == resource)
+		{
+			use.access |= access;
+			use.is_write = use.is_write || is_write;
+			return;
+		}
+	}
+	passes_[pass].uses.push_back(Use{ resource, access, is_write });
+}
+
+void RenderGraph::BuildDependencies()
+{
+	const size_t pass_count = passes_.size();
+	producers_.resize(pass_count);
+	predecessors_.resize(pass_count);
+	for (size_t p = 0; p < pass_count; ++p)
+	{
+		producers_[p].clear();
+		predecessors_[p].clear();
+	}
+
+	// Declaration order is submission order, so dependencies always point at
+	// earlier passes. Readers of the current version of each resource are
+	// kept as a linked list in one flat array.
+	last_writer_.assign(resources_.size(), kInvalidId);
+	reader_heads_.assign(resources_.size(), kInvalidId);
+	reader_nodes_.clear();
+
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		for (const Use& use : passes_[p].uses)
+		{
+			const PassId writer = last_writer_[use.resource];
+			if (writer != kInvalidId && writer != p)
+			{
+				producers_[p].push_back(writer);
+				predecessors_[p].push_back(writer);
+			}
+
+			if (use.is_write)
+			{
+				// Write-after-read: every reader of the old contents goes first
+				for (uint32_t node = reader_heads_[use.resource]; node != kInvalidId; node = reader_nodes_[node].next)
+				{
+					if (reader_nodes_[node].pass != p)
+					{
+						predecessors_[p].push_back(reader_nodes_[node].pass);
+					}
+				}
+				last_writer_[use.resource] = p;
+				reader_heads_[use.resource] = kInvalidId;
+			}
+			else
+			{
+				reader_nodes_.push_back(ReaderNode{ p, reader_heads_[use.resource] });
+				reader_heads_[use.resource] = static_cast<uint32_t>(reader_nodes_.size() - 1);
+			}
+		}
+	}
+}
+
+void RenderGraph::CullPasses()
+{
+	const size_t pass_count = passes_.size();
+	is_alive_.assign(pass_count, 0);
+
+	std::vector<PassId> stack;
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		bool is_root = passes_[p].has_side_effect;
+		for (const Use& use : passes_[p].uses)
+		{
+			const Resource& resource = resources_[use.resource];
+			if (use.is_write && (resource.is_output || resource.is_imported))
+			{
+				is_root = true;
+			}
+		}
+		if (is_root)
+		{
+			is_alive_[p] = 1;
+			stack.push_back(p);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const PassId p = stack.back();
+		stack.pop_back();
+		for (PassId producer : producers_[p])
+		{
+			if (!is_alive_[producer])
+			{
+				is_alive_[producer] = 1;
+				stack.push_back(producer);
+			}
+		}
+	}
+
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		if (!is_alive_[p])
+		{
+			++compiled_.culled_pass_count;
+		}
+	}
+}
+
+void RenderGraph::OrderPasses()
+{
+	// Level = longest dependency chain leading to the pass. Passes on the same
+	// level are independent of each other, so grouping them batches their
+	// barriers and leaves room for async compute later.
+	const size_t pass_count = passes_.size();
+	levels_.assign(pass_count, 0);
+	uint32_t level_count = 0;
+
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		if (!is_alive_[p])
+		{
+			continue;
+		}
+		uint32_t level = 0;
+		for (PassId predecessor : predecessors_[p])
+		{
+			if (is_alive_[predecessor])
+			{
+				level = std::max(level, levels_[predecessor] + 1);
+			}
+		}
+		levels_[p] = level;
+		level_count = std::max(level_count, level + 1);
+	}
+
+	// Stable counting sort by level
+	std::vector<uint32_t> level_start(level_count + 1, 0);
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		if (is_alive_[p])
+		{
+			++level_start[levels_[p] + 1];
+		}
+	}
+	for (uint32_t l = 0; l < level_count; ++l)
+	{
+		level_start[l + 1] += level_start[l];
+	}
+
+	compiled_.passes.resize(pass_count - compiled_.culled_pass_count);
+	for (PassId p = 0; p < pass_count; ++p)
+	{
+		if (is_alive_[p])
+		{
+			compiled_.passes[level_start[levels_[p]]++] = CompiledPass{ p, 0, 0 };
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	const size_t resource_count = resources_.size();
+	first_use_.assign(resource_count, kInvalidId);
+	last_use_.assign(resource_count, kInvalidId);
+
+	for (uint32_t position = 0; position < compiled_.passes.size(); ++position)
+	{
+		for (const Use& use : passes_[compiled_.passes[position].pass].uses)
+		{
+			if (first_use_[use.resource] == kInvalidId)
+			{
+				first_use_[use.resource] = position;
+				compiled_.transient_initial_states[use.resource] = use.access;
+			}
+			last_use_[use.resource] = position;
+		}
+	}
+
+	transients_.clear();
+	for (ResourceId r = 0; r < resource_count; ++r)
+	{
+		if (!resources_[r].is_imported && first_use_[r] != kInvalidId)
+		{
+			transients_.push_back(r);
+		}
+	}
+
+	// Sweep over the passes in order: resources whose last use is behind the
+	// one being placed give their memory back, and each resource takes the
+	// smallest free range it fits in. Bigger first among resources starting
+	// together packs better; ties by id keep the layout stable.
+	std::sort(transients_.begin(), transients_.end(), [this](ResourceId a, ResourceId b)
+	{
+		if (first_use_[a] != first_use_[b])
+		{
+			return first_use_[a] < first_use_[b];
+		}
+		if (resources_[a].size != resources_[b].size)
+		{
+			return resources_[a].size > resources_[b].size;
+		}
+		return a < b;
+	});
+
+	free_ranges_.by_offset.clear();
+	free_ranges_.by_size.clear();
+	occupancy_.clear();
+	aliased_previous_.assign(resource_count, kInvalidId);
+	shares_memory_.assign(resource_count, 0);
+
+	// Live resources as (last use, id), soonest to end on top
+	using LiveResource = std::pair<uint32_t, ResourceId>;
+	std::priority_queue<LiveResource, std::vector<LiveResource>, std::greater<LiveResource>> live;
+
+	uint64_t& heap_size = compiled_.transient_heap_size;
+	for (ResourceId r : transients_)
+	{
+		while (!live.empty() && live.top().first < first_use_[r])
+		{
+			const ResourceId done = live.top().second;
+			live.pop();
+			free_ranges_.Insert(compiled_.transient_offsets[done], resources_[done].size);
+		}
+
+		const Resource& resource = resources_[r];
+		const uint64_t mask = resource.alignment - 1;
+		auto AlignUp = [mask](uint64_t value) { return (value + mask) & ~mask; };
+
+		// Best fit; alignment padding can make a big enough range too small,
+		// in which case the next bigger one is tried
+		uint64_t offset = kNotPlaced;
+		auto range = free_ranges_.by_offset.end();
+		for (auto it = free_ranges_.by_size.lower_bound({ resource.size, 0 }); it != free_ranges_.by_size.end(); ++it)
+		{
+			const uint64_t aligned = AlignUp(it->second);
+			if (aligned + resource.size <= it->second + it->first)
+			{
+				offset = aligned;
+				range = free_ranges_.by_offset.find(it->second);
+				break;
+			}
+		}
+
+		if (offset == kNotPlaced)
+		{
+			// Grow the heap, starting in the free range at its top if there is one
+			range = free_ranges_.by_offset.empty() ? free_ranges_.by_offset.end() : std::prev(free_ranges_.by_offset.end());
+			if (range != free_ranges_.by_offset.end() && range->first + range->second == heap_size)
+			{
+				offset = AlignUp(range->first);
+			}
+			else
+			{
+				range = free_ranges_.by_offset.end();
+				offset = AlignUp(heap_size);
+			}
+		}
+
+		if (range != free_ranges_.by_offset.end())
+		{
+			const uint64_t range_begin = range->first;
+			const uint64_t range_end = range->first + range->second;
+			free_ranges_.Erase(range);
+			if (range_begin < offset)
+			{
+				free_ranges_.Insert(range_begin, offset - range_begin);
+			}
+			if (offset + resource.size < range_end)
+			{
+				free_ranges_.Insert(offset + resource.size, range_end - offset - resource.size);
+			}
+		}
+
+		compiled_.transient_offsets[r] = offset;
+		heap_size = std::max(heap_size, offset + resource.size);
+		Occupy(r, offset, offset + resource.size);
+		live.push({ last_use_[r], r });
+	}
+}
+
+void RenderGraph::Occupy(ResourceId resource, uint64_t begin, uint64_t end)
+{
+	// Cut the spans straddling either end, so [begin, end) is covered by whole spans
+	for (uint64_t cut : { begin, end })
+	{
+		auto it = occupancy_.upper_bound(cut);
+		if (it != occupancy_.begin() && cut < std::prev(it)->second.end && std::prev(it)->first < cut)
+		{
+			Occupancy& straddling = std::prev(it)->second;
+			occupancy_.emplace_hint(it, cut, straddling);
+			straddling.end = cut;
+		}
+	}
+
+	// Resources are placed in order of first use into free memory, so every
+	// earlier occupant has finished, and the one finishing last is replaced
+	ResourceId previous = kInvalidId;
+	auto it = occupancy_.lower_bound(begin);
+	while (it != occupancy_.end() && it->first < end)
+	{
+		const ResourceId other = it->second.resource;
+		assert(last_use_[other] < first_use_[resource] && "Transient placed over a live resource.");
+		shares_memory_[other] = 1;
+		shares_memory_[resource] = 1;
+		if (previous == kInvalidId || last_use_[other] > last_use_[previous])
+		{
+			previous = other;
+		}
+		it = occupancy_.erase(it);
+	}
+	if (begin < end)
+	{
+		occupancy_.emplace_hint(it, begin, Occupancy{ end, resource });
+	}
+	aliased_previous_[resource] = previous;
+}
+
+void RenderGraph::FreeRanges::Insert(uint64_t offset, uint64_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	// Coalesce with the neighbours
+	auto next = by_offset.lower_bound(offset);
+	if (next != by_offset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = std::next(next);
+		Erase(std::prev(next));
+	}
+	if (next != by_offset.begin())
+	{
+		const auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			size += prev->second;
+			Erase(prev);
+		}
+	}
+
+	by_offset.emplace_hint(next, offset, size);
+	by_size.emplace(size, offset);
+}
+
+void RenderGraph::FreeRanges::Erase(std::map<uint64_t, uint64_t>::iterator range)
+{
+	by_size.erase({ range->second, range->first });
+	by_offset.erase(range);
+}
+
+void RenderGraph::BuildBarriers()
+{
+	const size_t resource_count = resources_.size();
+	std::vector<uint32_t> states(resource_count);
+	std::vector<uint8_t> was_used(resource_count, 0);
+	for (ResourceId r = 0; r < resource_count; ++r)
+	{
+		states[r] = resources_[r].is_imported ? resources_[r].initial_state : compiled_.transient_initial_states[r];
+	}
+
+	for (uint32_t position = 0; position < compiled_.passes.size(); ++position)
+	{
+		CompiledPass& compiled_pass = compiled_.passes[position];
+		compiled_pass.first_barrier = static_cast<uint32_t>(compiled_.barriers.size());
+
+		for (const Use& use : passes_[compiled_pass.pass].uses)
+		{
+			const ResourceId r = use.resource;
+			if (resources_[r].is_imported || first_use_[r] != position)
+			{
+				continue;
+			}
+
+			// Memory shared with resources that only run later still held one
+			// of them last frame, so it needs an aliasing barrier too
+			if (shares_memory_[r])
+			{
+				Barrier barrier;
+				barrier.type = Barrier::Type::kAliasing;
+				barrier.resource = r;
+				barrier.previous = aliased_previous_[r];
+				compiled_.barriers.push_back(barrier);
+			}
+		}
+
+		for (const Use& use : passes_[compiled_pass.pass].uses)
+		{
+			const ResourceId r = use.resource;
+			const uint32_t current = states[r];
+			const uint32_t wanted = use.access;
+
+			if (current == wanted)
+			{
+				// Back-to-back UAV access needs the writes of the earlier pass to land
+				if ((wanted & kUnorderedAccess) && was_used[r])
+				{
+					Barrier barrier;
+					barrier.type = Barrier::Type::kUav;
+					barrier.resource = r;
+					compiled_.barriers.push_back(barrier);
+				}
+			}
+			else if (wanted != kCommon && !IsWriteAccess(current) && !IsWriteAccess(wanted) && (current & wanted) == wanted)
+			{
+				// Already in a read state that includes what we need
+			}
+			else
+			{
+				Barrier barrier;
+				barrier.type = Barrier::Type::kTransition;
+				barrier.resource = r;
+				barrier.state_before = current;
+				barrier.state_after = wanted;
+				compiled_.barriers.push_back(barrier);
+				states[r] = wanted;
+			}
+			was_used[r] = 1;
+		}
+
+		compiled_pass.barrier_count = static_cast<uint32_t>(compiled_.barriers.size()) - compiled_pass.first_barrier;
+	}
+
+	for (ResourceId r = 0; r < resource_count; ++r)
+	{
+		const Resource& resource = resources_[r];
+		const bool is_live_transient = !resource.is_imported && first_use_[r] != kInvalidId;
+		if (!resource.is_imported && !is_live_transient)
+		{
+			continue;
+		}
+
+		const uint32_t target = resource.is_imported ? resource.final_state : compiled_.transient_initial_states[r];
+		if (states[r] != target)
+		{
+			Barrier barrier;
+			barrier.type = Barrier::Type::kTransition;
+			barrier.resource = r;
+			barrier.state_before = states[r];
+			barrier.state_after = target;
+			compiled_.final_barriers.push_back(barrier);
+		}
+	}
+}
@@ -0,0 +1,195 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Defined by RenderGraphExecutor, which records the compiled graph on D3D12
+class RenderGraphContext;
+
+// Frame graph of render passes. Passes declare which resources they read and
+// write, and Compile():
+//  - orders the passes by dependency level (declaration order within a level)
+//  - culls passes whose results never reach an output or a side effect
+//  - derives the state transitions, UAV and aliasing barriers before each pass
+//  - places transient resources in one heap, letting resources whose
+//    lifetimes don't overlap share memory
+// This class is pure CPU bookkeeping; it never touches a GPU object.
+class RenderGraph
+{
+public:
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+	using ExecuteFunction = std::function<void(RenderGraphContext&)>;
+
+	static constexpr uint32_t kInvalidId = UINT32_MAX;
+	static constexpr uint64_t kNotPlaced = UINT64_MAX;
+
+	// Bit values match D3D12_RESOURCE_STATES, so they can be passed straight through
+	enum Access : uint32_t
+	{
+		kCommon = 0x0,
+		kPresent = 0x0,
+		kRenderTarget = 0x4,
+		kUnorderedAccess = 0x8,
+		kDepthWrite = 0x10,
+		kDepthRead = 0x20,
+		kNonPixelShaderResource = 0x40,
+		kPixelShaderResource = 0x80,
+		kCopyDest = 0x400,
+		kCopySource = 0x800
+	};
+
+	struct Barrier
+	{
+		enum class Type
+		{
+			kTransition,
+			kAliasing,	// 'resource' takes over memory last used by 'previous' (kInvalidId: unknown)
+			kUav
+		};
+
+		Type type = Type::kTransition;
+		ResourceId resource = kInvalidId;
+		ResourceId previous = kInvalidId;
+		uint32_t state_before = kCommon;
+		uint32_t state_after = kCommon;
+	};
+
+	struct CompiledPass
+	{
+		PassId pass;
+		uint32_t first_barrier;	// Barriers to issue before the pass runs
+		uint32_t barrier_count;
+	};
+
+	struct CompiledGraph
+	{
+		std::vector<CompiledPass> passes;
+		std::vector<Barrier> barriers;
+		// Issued after the last pass: imported resources to their final state,
+		// transients back to the state they start the next frame in
+		std::vector<Barrier> final_barriers;
+		// Per resource; kNotPlaced for imported or unused resources
+		std::vector<uint64_t> transient_offsets;
+		// State each transient is expected to be in when the graph starts
+		std::vector<uint32_t> transient_initial_states;
+		uint64_t transient_heap_size = 0;
+		uint32_t culled_pass_count = 0;
+	};
+public:
+	// Memory the graph owns and may alias. size/alignment come from the device.
+	ResourceId CreateTransient(std::string name, uint64_t size, uint64_t alignment);
+	// Memory owned elsewhere (e.g. the back buffer); never aliased, and writes
+	// to it count as outputs
+	ResourceId Import(std::string name, uint32_t initial_state, uint32_t final_state);
+	// Keeps the passes producing this resource alive
+	void MarkOutput(ResourceId resource);
+
+	PassId AddPass(std::string name, ExecuteFunction execute = nullptr);
+	void Read(PassId pass, ResourceId resource, uint32_t access);
+	// Writes preserve the previous contents, so they also depend on the last writer
+	void Write(PassId pass, ResourceId resource, uint32_t access);
+	// Keeps a pass alive even if nothing reads its results (e.g. readbacks)
+	void SetSideEffect(PassId pass);
+
+	const CompiledGraph& Compile();
+	// Drops all passes and resources, keeping allocated capacity
+	void Reset();
+
+	const CompiledGraph& GetCompiled() const;
+	const std::string& GetPassName(PassId pass) const;
+	const std::string& GetResourceName(ResourceId resource) const;
+	const ExecuteFunction& GetExecuteFunction(PassId pass) const;
+	uint32_t GetPassCount() const;
+	uint32_t GetResourceCount() const;
+
+	static bool IsWriteAccess(uint32_t access);
+private:
+	struct Use
+	{
+		ResourceId resource;
+		uint32_t access;
+		bool is_write;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<Use> uses;
+		bool has_side_effect = false;
+	};
+
+	struct ReaderNode
+	{
+		PassId pass;
+		uint32_t next;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		uint64_t size = 0;
+		uint64_t alignment = 1;
+		uint32_t initial_state = kCommon;
+		uint32_t final_state = kCommon;
+		bool is_imported = false;
+		bool is_output = false;
+	};
+
+	// Free heap ranges while placing transients, by offset and by size; Insert coalesces
+	struct FreeRanges
+	{
+		std::map<uint64_t, uint64_t> by_offset;	// Offset to size
+		std::set<std::pair<uint64_t, uint64_t>> by_size;	// (size, offset)
+
+		void Insert(uint64_t offset, uint64_t size);
+		void Erase(std::map<uint64_t, uint64_t>::iterator range);
+	};
+
+	// Span of heap memory and the last transient placed in it
+	struct Occupancy
+	{
+		uint64_t end;
+		ResourceId resource;
+	};
+private:
+	void AddUse(PassId pass, ResourceId resource, uint32_t access, bool is_write);
+	void BuildDependencies();
+	void CullPasses();
+	void OrderPasses();
+	void PlaceTransients();
+	// Records 'resource' as the latest occupant of [begin, end) and notes
+	// which earlier resources it takes memory from
+	void Occupy(ResourceId resource, uint64_t begin, uint64_t end);
+	void BuildBarriers();
+private:
+	std::vector<Pass> passes_;
+	std::vector<Resource> resources_;
+
+	// Compile() scratch, kept between frames to avoid reallocating
+	std::vector<std::vector<PassId>> producers_;	// Passes whose writes a pass consumes
+	std::vector<std::vector<PassId>> predecessors_;	// Every pass that must run before it
+	std::vector<PassId> last_writer_;
+	std::vector<uint32_t> reader_heads_;
+	std::vector<ReaderNode> reader_nodes_;
+	std::vector<uint8_t> is_alive_;
+	std::vector<uint32_t> levels_;
+	std::vector<uint32_t> first_use_;
+	std::vector<uint32_t> last_use_;
+	std::vector<ResourceId> transients_;
+	FreeRanges free_ranges_;
+	std::map<uint64_t, Occupancy> occupancy_;	// By offset, non-overlapping
+	std::vector<ResourceId> aliased_previous_;	// Latest earlier transient in a resource's memory
+	std::vector<uint8_t> shares_memory_;
+
+	CompiledGraph compiled_;
+};
+
+#endif // !RENDER_GRAPH_H
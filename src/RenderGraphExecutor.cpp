@@ -0,0 +1,363 @@
+#include "RenderGraphExecutor.h"
+#include "ThrowIfFailed.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// RenderGraph::Access values are passed to D3D12 as they are
+static_assert(RenderGraph::kRenderTarget == D3D12_RESOURCE_STATE_RENDER_TARGET);
+static_assert(RenderGraph::kUnorderedAccess == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+static_assert(RenderGraph::kDepthWrite == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+static_assert(RenderGraph::kDepthRead == D3D12_RESOURCE_STATE_DEPTH_READ);
+static_assert(RenderGraph::kNonPixelShaderResource == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+static_assert(RenderGraph::kPixelShaderResource == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+static_assert(RenderGraph::kCopyDest == D3D12_RESOURCE_STATE_COPY_DEST);
+static_assert(RenderGraph::kCopySource == D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+RenderGraphContext::RenderGraphContext(const RenderGraphExecutor& executor, ID3D12GraphicsCommandList* command_list)
+	:
+	executor_(executor),
+	command_list_(command_list)
+{ }
+
+ID3D12GraphicsCommandList* RenderGraphContext::GetCommandList() const
+{
+	return command_list_;
+}
+
+ID3D12Resource* RenderGraphContext::GetResource(RenderGraph::ResourceId resource) const
+{
+	return executor_.GetResource(resource);
+}
+
+RenderGraphExecutor::RenderGraphExecutor(ID3D12Device* device, D3D12_RESOURCE_HEAP_TIER heap_tier, DeferredReleaseQueue& release_queue)
+	:
+	device_(device),
+	release_queue_(release_queue),
+	heap_tier_(heap_tier)
+{ }
+
+RenderGraph::ResourceId RenderGraphExecutor::CreateTransient(
+	RenderGraph& graph,
+	std::string name,
+	const D3D12_RESOURCE_DESC& desc,
+	const D3D12_CLEAR_VALUE* clear_value)
+{
+	assert((heap_tier_ >= D3D12_RESOURCE_HEAP_TIER_2 ||
+		(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))) &&
+		"Resource heap tier 1 only takes render target and depth stencil transients.");
+
+	const D3D12_RESOURCE_ALLOCATION_INFO info = device_->GetResourceAllocationInfo(0, 1, &desc);
+	if (info.SizeInBytes == UINT64_MAX)
+	{
+		throw Window::Exception(__LINE__, __FILE__, "Invalid resource description.");
+	}
+
+	const RenderGraph::ResourceId resource = graph.CreateTransient(std::move(name), info.SizeInBytes, info.Alignment);
+
+	Slot& slot = GetSlot(resource);
+	slot.size = info.SizeInBytes;
+	slot.imported = nullptr;
+	slot.has_clear_value = clear_value != nullptr;
+	if (clear_value)
+	{
+		slot.clear_value = *clear_value;
+	}
+	// Same description as the resource placed here last frame keeps it alive
+	if (std::memcmp(&slot.desc, &desc, sizeof(desc)) != 0)
+	{
+		slot.desc = desc;
+		slot.placed_offset = RenderGraph::kNotPlaced;
+	}
+
+	return resource;
+}
+
+void RenderGraphExecutor::SetImported(RenderGraph::ResourceId resource, ID3D12Resource* d3d_resource)
+{
+	GetSlot(resource).imported = d3d_resource;
+}
+
+void RenderGraphExecutor::SetProfiler(Profiler* profiler)
+{
+	profiler_ = profiler;
+}
+
+void RenderGraphExecutor::Execute(const RenderGraph& graph, ID3D12GraphicsCommandList* command_list, UINT64 fence_value)
+{
+	const RenderGraph::CompiledGraph& compiled = graph.GetCompiled();
+	assert(slots_.size() >= graph.GetResourceCount() && "Every resource must come from CreateTransient or SetImported.");
+
+	ReserveHeap(compiled.transient_heap_size, fence_value);
+	PlaceTransients(compiled, fence_value);
+	ActivateStaleTransients(compiled, command_list);
+
+	RenderGraphContext context(*this, command_list);
+	for (const RenderGraph::CompiledPass& pass : compiled.passes)
+	{
+		const Profiler::ScopeId scope = profiler_
+			? profiler_->BeginGpu(profiler_->Intern(graph.GetPassName(pass.pass)))
+			: Profiler::kInvalidScope;
+
+		barriers_.clear();
+		discards_.clear();
+		for (uint32_t i = 0; i < pass.barrier_count; ++i)
+		{
+			AppendBarrier(compiled.barriers[pass.first_barrier + i]);
+		}
+		if (!barriers_.empty())
+		{
+			command_list->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+		}
+
+		// Render targets and depth buffers that take over aliased memory have
+		// undefined contents and must be initialized before anything else
+		for (ID3D12Resource* resource : discards_)
+		{
+			command_list->DiscardResource(resource, nullptr);
+		}
+
+		const RenderGraph::ExecuteFunction& execute = graph.GetExecuteFunction(pass.pass);
+		if (execute)
+		{
+			execute(context);
+		}
+
+		if (profiler_)
+		{
+			profiler_->EndGpu(scope);
+		}
+	}
+
+	barriers_.clear();
+	for (const RenderGraph::Barrier& barrier : compiled.final_barriers)
+	{
+		AppendBarrier(barrier);
+	}
+	if (!barriers_.empty())
+	{
+		command_list->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+	}
+
+	MarkOverwrittenTransients(compiled);
+}
+
+UINT64 RenderGraphExecutor::GetHeapSize() const
+{
+	return heap_size_;
+}
+
+RenderGraphExecutor::Slot& RenderGraphExecutor::GetSlot(RenderGraph::ResourceId resource)
+{
+	if (resource >= slots_.size())
+	{
+		slots_.resize(resource + 1);
+	}
+	return slots_[resource];
+}
+
+void RenderGraphExecutor::ReserveHeap(UINT64 size, UINT64 fence_value)
+{
+	if (size <= heap_size_)
+	{
+		return;
+	}
+
+	// Everything placed in the old heap goes with it
+	for (Slot& slot : slots_)
+	{
+		if (slot.placed)
+		{
+			release_queue_.Release(std::move(slot.placed), fence_value);
+			slot.placed_offset = RenderGraph::kNotPlaced;
+		}
+	}
+	if (heap_)
+	{
+		release_queue_.Release(std::move(heap_), fence_value);
+	}
+
+	constexpr UINT64 kMsaaAlignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	heap_size_ = (size + kMsaaAlignment - 1) & ~(kMsaaAlignment - 1);
+
+	D3D12_HEAP_DESC heap_desc{};
+	heap_desc.SizeInBytes = heap_size_;
+	heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heap_desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heap_desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heap_desc.Properties.CreationNodeMask = 1;
+	heap_desc.Properties.VisibleNodeMask = 1;
+	heap_desc.Alignment = kMsaaAlignment;
+	heap_desc.Flags = heap_tier_ >= D3D12_RESOURCE_HEAP_TIER_2
+		? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES
+		: D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+	ThrowIfFailed(device_->CreateHeap(&heap_desc, IID_PPV_ARGS(heap_.GetAddressOf())));
+}
+
+void RenderGraphExecutor::PlaceTransients(const RenderGraph::CompiledGraph& compiled, UINT64 fence_value)
+{
+	for (RenderGraph::ResourceId r = 0; r < compiled.transient_offsets.size(); ++r)
+	{
+		const UINT64 offset = compiled.transient_offsets[r];
+		const UINT initial_state = compiled.transient_initial_states[r];
+		Slot& slot = slots_[r];
+		if (offset == RenderGraph::kNotPlaced ||
+			(slot.placed && slot.placed_offset == offset && slot.initial_state == initial_state))
+		{
+			continue;
+		}
+
+		if (slot.placed)
+		{
+			release_queue_.Release(std::move(slot.placed), fence_value);
+		}
+
+		// The compiler expects each transient to start out in its first access state
+		ThrowIfFailed(device_->CreatePlacedResource(
+			heap_.Get(),
+			offset,
+			&slot.desc,
+			static_cast<D3D12_RESOURCE_STATES>(initial_state),
+			slot.has_clear_value ? &slot.clear_value : nullptr,
+			IID_PPV_ARGS(slot.placed.ReleaseAndGetAddressOf())));
+		slot.placed_offset = offset;
+		slot.initial_state = initial_state;
+		slot.is_stale = true;
+	}
+}
+
+void RenderGraphExecutor::ActivateStaleTransients(const RenderGraph::CompiledGraph& compiled, ID3D12GraphicsCommandList* command_list)
+{
+	// Resources the graph aliases get their barrier and discard at first use
+	for (const RenderGraph::Barrier& barrier : compiled.barriers)
+	{
+		if (barrier.type == RenderGraph::Barrier::Type::kAliasing)
+		{
+			slots_[barrier.resource].is_stale = false;
+		}
+	}
+
+	// The rest share no memory with anything else this frame, so they can be
+	// activated up front
+	barriers_.clear();
+	discards_.clear();
+	for (RenderGraph::ResourceId r = 0; r < compiled.transient_offsets.size(); ++r)
+	{
+		Slot& slot = slots_[r];
+		if (compiled.transient_offsets[r] != RenderGraph::kNotPlaced && slot.is_stale)
+		{
+			AppendAliasing(nullptr, r);
+			slot.is_stale = false;
+		}
+	}
+	if (!barriers_.empty())
+	{
+		command_list->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+	}
+	for (ID3D12Resource* resource : discards_)
+	{
+		command_list->DiscardResource(resource, nullptr);
+	}
+}
+
+void RenderGraphExecutor::MarkOverwrittenTransients(const RenderGraph::CompiledGraph& compiled)
+{
+	// Every placed resource overlapping one used this frame, other than
+	// itself, no longer holds what it was created with
+	spans_.clear();
+	for (RenderGraph::ResourceId r = 0; r < slots_.size(); ++r)
+	{
+		const Slot& slot = slots_[r];
+		if (slot.placed && slot.placed_offset != RenderGraph::kNotPlaced)
+		{
+			const bool is_used = r < compiled.transient_offsets.size() && compiled.transient_offsets[r] != RenderGraph::kNotPlaced;
+			spans_.push_back(Span{ slot.placed_offset, slot.placed_offset + slot.size, r, is_used });
+		}
+	}
+	std::sort(spans_.begin(), spans_.end(), [](const Span& a, const Span& b) { return a.begin < b.begin; });
+
+	// Used spans starting before each span, then those starting after it
+	UINT64 used_end = 0;
+	for (const Span& span : spans_)
+	{
+		if (used_end > span.begin)
+		{
+			slots_[span.resource].is_stale = true;
+		}
+		if (span.is_used)
+		{
+			used_end = std::max(used_end, span.end);
+		}
+	}
+	UINT64 used_begin = UINT64_MAX;
+	for (auto span = spans_.rbegin(); span != spans_.rend(); ++span)
+	{
+		if (used_begin < span->end)
+		{
+			slots_[span->resource].is_stale = true;
+		}
+		if (span->is_used)
+		{
+			used_begin = span->begin;
+		}
+	}
+}
+
+void RenderGraphExecutor::AppendBarrier(const RenderGraph::Barrier& barrier)
+{
+	D3D12_RESOURCE_BARRIER d3d_barrier{};
+	d3d_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+
+	switch (barrier.type)
+	{
+		case RenderGraph::Barrier::Type::kTransition:
+		{
+			d3d_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			d3d_barrier.Transition.pResource = GetResource(barrier.resource);
+			d3d_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			d3d_barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(barrier.state_before);
+			d3d_barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(barrier.state_after);
+		} break;
+
+		case RenderGraph::Barrier::Type::kAliasing:
+		{
+			// A null 'before' covers whatever was placed there last frame
+			AppendAliasing(barrier.previous != RenderGraph::kInvalidId ? GetResource(barrier.previous) : nullptr, barrier.resource);
+		} return;
+
+		case RenderGraph::Barrier::Type::kUav:
+		{
+			d3d_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			d3d_barrier.UAV.pResource = GetResource(barrier.resource);
+		} break;
+	}
+
+	barriers_.push_back(d3d_barrier);
+}
+
+void RenderGraphExecutor::AppendAliasing(ID3D12Resource* before, RenderGraph::ResourceId resource)
+{
+	const Slot& slot = slots_[resource];
+
+	D3D12_RESOURCE_BARRIER d3d_barrier{};
+	d3d_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+	d3d_barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	d3d_barrier.Aliasing.pResourceBefore = before;
+	d3d_barrier.Aliasing.pResourceAfter = slot.placed.Get();
+	barriers_.push_back(d3d_barrier);
+
+	// Aliasing barriers sit on the first use, where the resource is still
+	// in its initial state; discarding needs it to be a render target or depth write
+	if (slot.initial_state == D3D12_RESOURCE_STATE_RENDER_TARGET ||
+		slot.initial_state == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+	{
+		discards_.push_back(slot.placed.Get());
+	}
+}
+
+ID3D12Resource* RenderGraphExecutor::GetResource(RenderGraph::ResourceId resource) const
+{
+	const Slot& slot = slots_[resource];
+	return slot.imported ? slot.imported : slot.placed.Get();
+}
@@ -0,0 +1,111 @@
+#ifndef RENDER_GRAPH_EXECUTOR_H
+#define RENDER_GRAPH_EXECUTOR_H
+
+#include "LeanWin32.h"
+#include "RenderGraph.h"
+#include "DeferredReleaseQueue.h"
+#include "Profiler.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+// Handed to every pass while the graph is recorded
+class RenderGraphContext
+{
+	friend class RenderGraphExecutor;
+public:
+	ID3D12GraphicsCommandList* GetCommandList() const;
+	// The placed resource behind a transient, or whatever was imported
+	ID3D12Resource* GetResource(RenderGraph::ResourceId resource) const;
+private:
+	RenderGraphContext(const class RenderGraphExecutor& executor, ID3D12GraphicsCommandList* command_list);
+private:
+	const RenderGraphExecutor& executor_;
+	ID3D12GraphicsCommandList* command_list_;
+};
+
+// Records a compiled RenderGraph on D3D12. Transients are placed into a single
+// heap at the offsets the compiler picked, and stay alive between frames as
+// long as the same resource lands at the same offset, so a steady graph creates
+// nothing after the first frame. Heaps and resources that get replaced are
+// parked in the DeferredReleaseQueue until the GPU is done with them.
+//
+// The compiler only knows about aliasing within one frame. A kept resource
+// whose memory another resource used in an earlier frame (because the graph
+// changed shape) is activated with an aliasing barrier, and discarded, at the
+// start of the frame, as is every newly placed resource.
+//
+// On resource heap tier 1 the heap only takes render target and depth stencil
+// textures, which is what transients are in practice.
+class RenderGraphExecutor
+{
+	friend class RenderGraphContext;
+public:
+	RenderGraphExecutor(ID3D12Device* device, D3D12_RESOURCE_HEAP_TIER heap_tier, DeferredReleaseQueue& release_queue);
+	RenderGraphExecutor(const RenderGraphExecutor&) = delete;
+	RenderGraphExecutor& operator=(const RenderGraphExecutor&) = delete;
+
+	// Adds a transient to the graph, sized and aligned as the device would place it
+	RenderGraph::ResourceId CreateTransient(
+		RenderGraph& graph,
+		std::string name,
+		const D3D12_RESOURCE_DESC& desc,
+		const D3D12_CLEAR_VALUE* clear_value = nullptr);
+	// Resource behind a RenderGraph::Import() for this frame
+	void SetImported(RenderGraph::ResourceId resource, ID3D12Resource* d3d_resource);
+	// Wraps every pass in a GPU scope named after it; null turns that off
+	void SetProfiler(Profiler* profiler);
+
+	// The graph must be compiled. fence_value is the value that will be
+	// signalled once command_list has executed.
+	void Execute(const RenderGraph& graph, ID3D12GraphicsCommandList* command_list, UINT64 fence_value);
+
+	UINT64 GetHeapSize() const;
+private:
+	struct Slot
+	{
+		D3D12_RESOURCE_DESC desc{};
+		D3D12_CLEAR_VALUE clear_value{};
+		bool has_clear_value = false;
+		ID3D12Resource* imported = nullptr;
+		ComPtr<ID3D12Resource> placed;
+		UINT64 placed_offset = RenderGraph::kNotPlaced;
+		UINT64 size = 0;
+		UINT initial_state = 0;	// State the placed resource starts each frame in
+		// Newly created, or another resource used its memory since it last ran
+		bool is_stale = false;
+	};
+
+	struct Span
+	{
+		UINT64 begin;
+		UINT64 end;
+		RenderGraph::ResourceId resource;
+		bool is_used;
+	};
+private:
+	Slot& GetSlot(RenderGraph::ResourceId resource);
+	void ReserveHeap(UINT64 size, UINT64 fence_value);
+	void PlaceTransients(const RenderGraph::CompiledGraph& compiled, UINT64 fence_value);
+	void ActivateStaleTransients(const RenderGraph::CompiledGraph& compiled, ID3D12GraphicsCommandList* command_list);
+	void MarkOverwrittenTransients(const RenderGraph::CompiledGraph& compiled);
+	void AppendBarrier(const RenderGraph::Barrier& barrier);
+	void AppendAliasing(ID3D12Resource* before, RenderGraph::ResourceId resource);
+	ID3D12Resource* GetResource(RenderGraph::ResourceId resource) const;
+private:
+	ID3D12Device* device_;
+	DeferredReleaseQueue& release_queue_;
+	Profiler* profiler_ = nullptr;
+	D3D12_RESOURCE_HEAP_TIER heap_tier_;
+	ComPtr<ID3D12Heap> heap_;
+	UINT64 heap_size_ = 0;
+	std::vector<Slot> slots_;
+	std::vector<D3D12_RESOURCE_BARRIER> barriers_;	// Scratch, one batch per pass
+	std::vector<ID3D12Resource*> discards_;
+	std::vector<Span> spans_;
+};
+
+#endif // !RENDER_GRAPH_EXECUTOR_H
@@ -0,0 +1,281 @@
+#include "RootSignatureCache.h"
+#include "Hash.h"
+#include "ThrowIfFailed.h"
+#include <sstream>
+
+RootSignatureCache::RootSignatureCache(ID3D12Device* device, D3D_ROOT_SIGNATURE_VERSION max_version)
+	:
+	device_(device),
+	max_version_(max_version),
+	scratch_(std::make_unique<unsigned char[]>(kScratchSize)),
+	arena_(scratch_.get(), kScratchSize)
+{ }
+
+ID3D12RootSignature* RootSignatureCache::GetOrCreate(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, uint64_t* hash_out)
+{
+	const uint64_t hash = Hash(desc);
+	if (hash_out)
+	{
+		*hash_out = hash;
+	}
+
+	if (ID3D12RootSignature* root_signature = Find(hash))
+	{
+		return root_signature;
+	}
+
+	Entry entry;
+	ComPtr<ID3DBlob> error_blob;
+	const HRESULT hr = Serialize(desc, max_version_, arena_, entry.blob.GetAddressOf(), error_blob.GetAddressOf());
+	if (FAILED(hr))
+	{
+		if (error_blob)
+		{
+			std::ostringstream oss;
+			oss << "Root signature serialization failed: "
+				<< static_cast<const char*>(error_blob->GetBufferPointer());
+			throw Window::Exception(__LINE__, __FILE__, oss.str());
+		}
+		ThrowIfFailed(hr);
+	}
+
+	ThrowIfFailed(device_->CreateRootSignature(
+		0,
+		entry.blob->GetBufferPointer(),
+		entry.blob->GetBufferSize(),
+		IID_PPV_ARGS(entry.root_signature.GetAddressOf())));
+
+	ID3D12RootSignature* result = entry.root_signature.Get();
+	entries_.emplace(hash, std::move(entry));
+	return result;
+}
+
+ID3D12RootSignature* RootSignatureCache::Find(uint64_t hash) const
+{
+	const auto it = entries_.find(hash);
+	return it != entries_.end() ? it->second.root_signature.Get() : nullptr;
+}
+
+ID3DBlob* RootSignatureCache::FindBlob(uint64_t hash) const
+{
+	const auto it = entries_.find(hash);
+	return it != entries_.end() ? it->second.blob.Get() : nullptr;
+}
+
+uint64_t RootSignatureCache::Hash(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc)
+{
+	Hasher hasher;
+	hasher.Add(static_cast<uint64_t>(desc.Version));
+
+	// Both versions share the layout of everything but the ranges and flags
+	const bool is_1_1 = desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_1;
+	const UINT parameter_count = is_1_1 ? desc.Desc_1_1.NumParameters : desc.Desc_1_0.NumParameters;
+	const UINT sampler_count = is_1_1 ? desc.Desc_1_1.NumStaticSamplers : desc.Desc_1_0.NumStaticSamplers;
+	const D3D12_STATIC_SAMPLER_DESC* samplers = is_1_1 ? desc.Desc_1_1.pStaticSamplers : desc.Desc_1_0.pStaticSamplers;
+
+	hasher.Add(static_cast<uint64_t>(is_1_1 ? desc.Desc_1_1.Flags : desc.Desc_1_0.Flags));
+	hasher.Add(static_cast<uint64_t>(parameter_count));
+
+	for (UINT n = 0; n < parameter_count; ++n)
+	{
+		const D3D12_ROOT_PARAMETER_TYPE type = is_1_1 ? desc.Desc_1_1.pParameters[n].ParameterType : desc.Desc_1_0.pParameters[n].ParameterType;
+		const D3D12_SHADER_VISIBILITY visibility = is_1_1 ? desc.Desc_1_1.pParameters[n].ShaderVisibility : desc.Desc_1_0.pParameters[n].ShaderVisibility;
+		hasher.Add(static_cast<uint64_t>(type));
+		hasher.Add(static_cast<uint64_t>(visibility));
+
+		switch (type)
+		{
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			{
+				const D3D12_ROOT_CONSTANTS& constants = is_1_1 ? desc.Desc_1_1.pParameters[n].Constants : desc.Desc_1_0.pParameters[n].Constants;
+				hasher.Add(static_cast<uint64_t>(constants.ShaderRegister));
+				hasher.Add(static_cast<uint64_t>(constants.RegisterSpace));
+				hasher.Add(static_cast<uint64_t>(constants.Num32BitValues));
+			} break;
+
+			case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			case D3D12_ROOT_PARAMETER_TYPE_SRV:
+			case D3D12_ROOT_PARAMETER_TYPE_UAV:
+			{
+				if (is_1_1)
+				{
+					const D3D12_ROOT_DESCRIPTOR1& descriptor = desc.Desc_1_1.pParameters[n].Descriptor;
+					hasher.Add(static_cast<uint64_t>(descriptor.ShaderRegister));
+					hasher.Add(static_cast<uint64_t>(descriptor.RegisterSpace));
+					hasher.Add(static_cast<uint64_t>(descriptor.Flags));
+				}
+				else
+				{
+					const D3D12_ROOT_DESCRIPTOR& descriptor = desc.Desc_1_0.pParameters[n].Descriptor;
+					hasher.Add(static_cast<uint64_t>(descriptor.ShaderRegister));
+					hasher.Add(static_cast<uint64_t>(descriptor.RegisterSpace));
+				}
+			} break;
+
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			{
+				if (is_1_1)
+				{
+					const D3D12_ROOT_DESCRIPTOR_TABLE1& table = desc.Desc_1_1.pParameters[n].DescriptorTable;
+					hasher.Add(static_cast<uint64_t>(table.NumDescriptorRanges));
+					for (UINT x = 0; x < table.NumDescriptorRanges; ++x)
+					{
+						const D3D12_DESCRIPTOR_RANGE1& range = table.pDescriptorRanges[x];
+						hasher.Add(static_cast<uint64_t>(range.RangeType));
+						hasher.Add(static_cast<uint64_t>(range.NumDescriptors));
+						hasher.Add(static_cast<uint64_t>(range.BaseShaderRegister));
+						hasher.Add(static_cast<uint64_t>(range.RegisterSpace));
+						hasher.Add(static_cast<uint64_t>(range.Flags));
+						hasher.Add(static_cast<uint64_t>(range.OffsetInDescriptorsFromTableStart));
+					}
+				}
+				else
+				{
+					const D3D12_ROOT_DESCRIPTOR_TABLE& table = desc.Desc_1_0.pParameters[n].DescriptorTable;
+					hasher.Add(static_cast<uint64_t>(table.NumDescriptorRanges));
+					for (UINT x = 0; x < table.NumDescriptorRanges; ++x)
+					{
+						const D3D12_DESCRIPTOR_RANGE& range = table.pDescriptorRanges[x];
+						hasher.Add(static_cast<uint64_t>(range.RangeType));
+						hasher.Add(static_cast<uint64_t>(range.NumDescriptors));
+						hasher.Add(static_cast<uint64_t>(range.BaseShaderRegister));
+						hasher.Add(static_cast<uint64_t>(range.RegisterSpace));
+						hasher.Add(static_cast<uint64_t>(range.OffsetInDescriptorsFromTableStart));
+					}
+				}
+			} break;
+		}
+	}
+
+	// D3D12_STATIC_SAMPLER_DESC is all 32-bit fields, so it has no padding to skip
+	hasher.Add(static_cast<uint64_t>(sampler_count));
+	if (sampler_count > 0)
+	{
+		hasher.Add(samplers, sizeof(D3D12_STATIC_SAMPLER_DESC) * sampler_count);
+	}
+
+	return hasher.Finish();
+}
+
+HRESULT RootSignatureCache::Serialize(
+	const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+	D3D_ROOT_SIGNATURE_VERSION max_version,
+	LinearArena& arena,
+	ID3DBlob** blob,
+	ID3DBlob** error_blob)
+{
+	if (error_blob)
+	{
+		*error_blob = nullptr;
+	}
+
+	if (max_version >= D3D_ROOT_SIGNATURE_VERSION_1_1)
+	{
+		return D3D12SerializeVersionedRootSignature(&desc, blob, error_blob);
+	}
+	if (desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0)
+	{
+		return D3D12SerializeRootSignature(&desc.Desc_1_0, D3D_ROOT_SIGNATURE_VERSION_1, blob, error_blob);
+	}
+	if (desc.Version != D3D_ROOT_SIGNATURE_VERSION_1_1)
+	{
+		return E_INVALIDARG;
+	}
+
+	// Down-convert 1.1 -> 1.0. Range and descriptor flags have no 1.0
+	// equivalent and are dropped, the same as the d3dx12 helper does.
+	const D3D12_ROOT_SIGNATURE_DESC1& desc_1_1 = desc.Desc_1_1;
+
+	// Everything the conversion allocates, with room for aligning both arrays
+	size_t required = sizeof(D3D12_ROOT_PARAMETER) * desc_1_1.NumParameters + alignof(D3D12_ROOT_PARAMETER);
+	for (UINT n = 0; n < desc_1_1.NumParameters; ++n)
+	{
+		if (desc_1_1.pParameters[n].ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			required += sizeof(D3D12_DESCRIPTOR_RANGE) * desc_1_1.pParameters[n].DescriptorTable.NumDescriptorRanges + alignof(D3D12_DESCRIPTOR_RANGE);
+		}
+	}
+
+	// Descriptions too big for the arena get a heap buffer of their own
+	std::unique_ptr<unsigned char[]> heap_buffer;
+	std::unique_ptr<LinearArena> heap_arena;
+	if (arena.GetCapacity() - arena.GetUsed() < required)
+	{
+		heap_buffer = std::make_unique<unsigned char[]>(required);
+		heap_arena = std::make_unique<LinearArena>(heap_buffer.get(), required);
+	}
+	LinearArena& scratch = heap_arena ? *heap_arena : arena;
+	const size_t marker = scratch.GetMarker();
+
+	D3D12_ROOT_PARAMETER* parameters = nullptr;
+	if (desc_1_1.NumParameters > 0)
+	{
+		parameters = scratch.AllocateArray<D3D12_ROOT_PARAMETER>(desc_1_1.NumParameters);
+		if (!parameters)
+		{
+			return E_OUTOFMEMORY;
+		}
+	}
+
+	for (UINT n = 0; n < desc_1_1.NumParameters; ++n)
+	{
+		const D3D12_ROOT_PARAMETER1& source = desc_1_1.pParameters[n];
+		D3D12_ROOT_PARAMETER& target = parameters[n];
+		target.ParameterType = source.ParameterType;
+		target.ShaderVisibility = source.ShaderVisibility;
+
+		switch (source.ParameterType)
+		{
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			{
+				target.Constants = source.Constants;
+			} break;
+
+			case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			case D3D12_ROOT_PARAMETER_TYPE_SRV:
+			case D3D12_ROOT_PARAMETER_TYPE_UAV:
+			{
+				target.Descriptor.ShaderRegister = source.Descriptor.ShaderRegister;
+				target.Descriptor.RegisterSpace = source.Descriptor.RegisterSpace;
+			} break;
+
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			{
+				const D3D12_ROOT_DESCRIPTOR_TABLE1& table = source.DescriptorTable;
+				D3D12_DESCRIPTOR_RANGE* ranges = nullptr;
+				if (table.NumDescriptorRanges > 0)
+				{
+					ranges = scratch.AllocateArray<D3D12_DESCRIPTOR_RANGE>(table.NumDescriptorRanges);
+					if (!ranges)
+					{
+						scratch.Rewind(marker);
+						return E_OUTOFMEMORY;
+					}
+				}
+
+				for (UINT x = 0; x < table.NumDescriptorRanges; ++x)
+				{
+					ranges[x].RangeType = table.pDescriptorRanges[x].RangeType;
+					ranges[x].NumDescriptors = table.pDescriptorRanges[x].NumDescriptors;
+					ranges[x].BaseShaderRegister = table.pDescriptorRanges[x].BaseShaderRegister;
+					ranges[x].RegisterSpace = table.pDescriptorRanges[x].RegisterSpace;
+					ranges[x].OffsetInDescriptorsFromTableStart = table.pDescriptorRanges[x].OffsetInDescriptorsFromTableStart;
+				}
+
+				target.DescriptorTable.NumDescriptorRanges = table.NumDescriptorRanges;
+				target.DescriptorTable.pDescriptorRanges = ranges;
+			} break;
+		}
+	}
+
+	D3D12_ROOT_SIGNATURE_DESC desc_1_0{};
+	desc_1_0.NumParameters = desc_1_1.NumParameters;
+	desc_1_0.pParameters = parameters;
+	desc_1_0.NumStaticSamplers = desc_1_1.NumStaticSamplers;
+	desc_1_0.pStaticSamplers = desc_1_1.pStaticSamplers;
+	desc_1_0.Flags = desc_1_1.Flags;
+
+	const HRESULT hr = D3D12SerializeRootSignature(&desc_1_0, D3D_ROOT_SIGNATURE_VERSION_1, blob, error_blob);
+	scratch.Rewind(marker);
+	return hr;
+}
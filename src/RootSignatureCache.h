@@ -0,0 +1,62 @@
+#ifndef ROOT_SIGNATURE_CACHE_H
+#define ROOT_SIGNATURE_CACHE_H
+
+#include "LeanWin32.h"
+#include "LinearArena.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+using namespace Microsoft::WRL;
+
+// Builds root signatures once per distinct description. Descriptions are
+// deduplicated by content hash, and both the serialized blob and the
+// ID3D12RootSignature are kept. When the device only supports root signature
+// 1.0, 1.1 descriptions are converted inside a LinearArena instead of with
+// one HeapAlloc per parameter/range array like D3DX12SerializeVersionedRootSignature.
+class RootSignatureCache
+{
+public:
+	// max_version is the device's highest supported root signature version
+	RootSignatureCache(ID3D12Device* device, D3D_ROOT_SIGNATURE_VERSION max_version);
+	RootSignatureCache(const RootSignatureCache&) = delete;
+	RootSignatureCache& operator=(const RootSignatureCache&) = delete;
+
+	// hash_out receives the content hash, e.g. for PipelineStateKey
+	ID3D12RootSignature* GetOrCreate(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, uint64_t* hash_out = nullptr);
+	ID3D12RootSignature* Find(uint64_t hash) const;
+	ID3DBlob* FindBlob(uint64_t hash) const;
+
+	static uint64_t Hash(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc);
+
+	// Same contract as D3DX12SerializeVersionedRootSignature, except that the
+	// 1.1 -> 1.0 conversion arrays come from 'arena', or from one heap
+	// allocation when the arena can't hold them. The arena is rewound before
+	// returning.
+	static HRESULT Serialize(
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc,
+		D3D_ROOT_SIGNATURE_VERSION max_version,
+		LinearArena& arena,
+		ID3DBlob** blob,
+		ID3DBlob** error_blob);
+private:
+	struct Entry
+	{
+		ComPtr<ID3DBlob> blob;
+		ComPtr<ID3D12RootSignature> root_signature;
+	};
+private:
+	// Enough for the 64 DWORD root signature limit with a few hundred ranges;
+	// bigger descriptions fall back to the heap
+	static constexpr size_t kScratchSize = 32 * 1024;
+
+	ID3D12Device* device_;
+	D3D_ROOT_SIGNATURE_VERSION max_version_;
+	std::unique_ptr<unsigned char[]> scratch_;
+	LinearArena arena_;
+	std::unordered_map<uint64_t, Entry> entries_;
+};
+
+#endif // !ROOT_SIGNATURE_CACHE_H
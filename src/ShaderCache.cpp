@@ -0,0 +1,59 @@
+#include "ShaderCache.h"
+
+ShaderCache::ShaderCache(const std::wstring& pack_path)
+{
+	// A missing or broken pack isn't fatal, lookups just miss
+	file_ = CreateFileW(pack_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0)
+	{
+		return;
+	}
+
+	mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_)
+	{
+		return;
+	}
+
+	view_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+	if (!view_)
+	{
+		return;
+	}
+
+	pack_ = ShaderPack(view_, static_cast<size_t>(file_size.QuadPart));
+}
+
+ShaderCache::~ShaderCache()
+{
+	if (view_)
+	{
+		UnmapViewOfFile(view_);
+	}
+	if (mapping_)
+	{
+		CloseHandle(mapping_);
+	}
+	if (file_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_);
+	}
+}
+
+CD3DX12_SHADER_BYTECODE ShaderCache::Find(uint64_t key) const
+{
+	const ShaderPack::Blob blob = pack_.Find(key);
+	return CD3DX12_SHADER_BYTECODE(blob.data, blob.size);
+}
+
+bool ShaderCache::IsLoaded() const
+{
+	return pack_.IsValid();
+}
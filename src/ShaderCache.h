@@ -0,0 +1,31 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "LeanWin32.h"
+#include "ShaderPack.h"
+#include "DirectX12/d3dx12.h"
+#include <string>
+
+// Maps a ShaderPack file into memory once at startup. Lookups return
+// CD3DX12_SHADER_BYTECODE pointing straight into the read-only mapping, so
+// there are no per-shader file opens and no copies; the pointers stay valid
+// for the lifetime of the cache.
+class ShaderCache
+{
+public:
+	ShaderCache(const std::wstring& pack_path);
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+	~ShaderCache();
+
+	// Empty bytecode (null pointer, zero length) if the key isn't in the pack
+	CD3DX12_SHADER_BYTECODE Find(uint64_t key) const;
+	bool IsLoaded() const;
+private:
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE mapping_ = nullptr;
+	const void* view_ = nullptr;
+	ShaderPack pack_;
+};
+
+#endif // !SHADER_CACHE_H
@@ -0,0 +1,151 @@
+#include "ShaderPack.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static_assert(sizeof(ShaderPack::Header) == 24, "Shader pack header layout changed.");
+static_assert(sizeof(ShaderPack::Entry) == 24, "Shader pack entry layout changed.");
+
+ShaderPack::ShaderPack(const void* data, size_t size)
+{
+	if (data == nullptr || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(Header) != 0)
+	{
+		return;
+	}
+
+	const Header* header = static_cast<const Header*>(data);
+	if (header->magic != kMagic || header->version != kVersion || header->file_size != size)
+	{
+		return;
+	}
+	if (header->entry_count > (size - sizeof(Header)) / sizeof(Entry))
+	{
+		return;
+	}
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	const Entry* entries = reinterpret_cast<const Entry*>(bytes + sizeof(Header));
+	for (uint32_t i = 0; i < header->entry_count; ++i)
+	{
+		if (entries[i].offset > size || entries[i].size > size - entries[i].offset)
+		{
+			return;
+		}
+		if (i > 0 && entries[i - 1].key >= entries[i].key)
+		{
+			return;
+		}
+	}
+
+	data_ = bytes;
+	entries_ = entries;
+	entry_count_ = header->entry_count;
+}
+
+ShaderPack::Blob ShaderPack::Find(uint64_t key) const
+{
+	const Entry* end = entries_ + entry_count_;
+	const Entry* it = std::lower_bound(entries_, end, key,
+		[](const Entry& entry, uint64_t k) { return entry.key < k; });
+
+	if (it == end || it->key != key)
+	{
+		return Blob{};
+	}
+	return Blob{ data_ + it->offset, static_cast<size_t>(it->size) };
+}
+
+bool ShaderPack::IsValid() const
+{
+	return data_ != nullptr;
+}
+
+uint32_t ShaderPack::GetEntryCount() const
+{
+	return entry_count_;
+}
+
+bool ShaderPack::Writer::Add(uint64_t key, const void* bytecode, size_t size)
+{
+	if (!keys_.insert(key).second)
+	{
+		return false;
+	}
+
+	// Share storage with identical bytecode added under another key
+	const uint64_t hash = Hash64(bytecode, size);
+	size_t blob = blobs_.size();
+	const auto [first, last] = blobs_by_hash_.equal_range(hash);
+	for (auto it = first; it != last; ++it)
+	{
+		const std::vector<unsigned char>& candidate = blobs_[it->second];
+		if (candidate.size() == size && (size == 0 || std::memcmp(candidate.data(), bytecode, size) == 0))
+		{
+			blob = it->second;
+			break;
+		}
+	}
+	if (blob == blobs_.size())
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(bytecode);
+		blobs_.emplace_back(bytes, bytes + size);
+		blobs_by_hash_.emplace(hash, blob);
+	}
+
+	entries_.push_back(Pending{ key, blob });
+	return true;
+}
+
+std::vector<unsigned char> ShaderPack::Writer::Build() const
+{
+	auto align = [](uint64_t value) { return (value + kBlobAlignment - 1) & ~uint64_t(kBlobAlignment - 1); };
+
+	// Place the blobs after the entry table
+	std::vector<uint64_t> blob_offsets(blobs_.size());
+	uint64_t offset = align(sizeof(Header) + sizeof(Entry) * entries_.size());
+	for (size_t i = 0; i < blobs_.size(); ++i)
+	{
+		blob_offsets[i] = offset;
+		offset = align(offset + blobs_[i].size());
+	}
+
+	std::vector<Entry> entries;
+	entries.reserve(entries_.size());
+	for (const Pending& pending : entries_)
+	{
+		entries.push_back(Entry{ pending.key, blob_offsets[pending.blob], blobs_[pending.blob].size() });
+	}
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+	std::vector<unsigned char> file(static_cast<size_t>(offset), 0);
+
+	Header header{};
+	header.magic = kMagic;
+	header.version = kVersion;
+	header.entry_count = static_cast<uint32_t>(entries.size());
+	header.file_size = offset;
+	std::memcpy(file.data(), &header, sizeof(header));
+	if (!entries.empty())
+	{
+		std::memcpy(file.data() + sizeof(Header), entries.data(), sizeof(Entry) * entries.size());
+	}
+
+	for (size_t i = 0; i < blobs_.size(); ++i)
+	{
+		if (!blobs_[i].empty())
+		{
+			std::memcpy(file.data() + blob_offsets[i], blobs_[i].data(), blobs_[i].size());
+		}
+	}
+
+	return file;
+}
+
+bool ShaderPack::Writer::WriteToFile(const std::wstring& path) const
+{
+	const std::vector<unsigned char> file_data = Build();
+	std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+	return static_cast<bool>(file.write(reinterpret_cast<const char*>(file_data.data()), static_cast<std::streamsize>(file_data.size())));
+}
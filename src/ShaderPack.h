@@ -0,0 +1,87 @@
+#ifndef SHADER_PACK_H
+#define SHADER_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Single-file container for compiled shader bytecode.
+//
+// Layout (little endian):
+//   Header
+//   Entry[entry_count]     sorted by key, for binary search
+//   bytecode blobs         each aligned to kBlobAlignment
+//
+// Keys are content hashes of whatever produced the bytecode (source, entry
+// point, profile, defines); identical bytecode under several keys is stored once.
+// The reader works on a borrowed, read-only view of the whole file, e.g. a
+// memory mapping, and hands out pointers into it without copying.
+class ShaderPack
+{
+public:
+	static constexpr uint32_t kMagic = 0x4b415053;	// 'SPAK'
+	static constexpr uint32_t kVersion = 1;
+	static constexpr size_t kBlobAlignment = 16;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entry_count;
+		uint32_t reserved;
+		uint64_t file_size;
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		uint64_t offset;	// From the start of the file
+		uint64_t size;
+	};
+
+	struct Blob
+	{
+		const void* data = nullptr;
+		size_t size = 0;
+
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	class Writer
+	{
+	public:
+		// Returns false if the key was already added
+		bool Add(uint64_t key, const void* bytecode, size_t size);
+		std::vector<unsigned char> Build() const;
+		bool WriteToFile(const std::wstring& path) const;
+	private:
+		struct Pending
+		{
+			uint64_t key;
+			size_t blob;	// Index into blobs_
+		};
+	private:
+		std::vector<Pending> entries_;
+		std::unordered_set<uint64_t> keys_;
+		std::vector<std::vector<unsigned char>> blobs_;
+		std::unordered_multimap<uint64_t, size_t> blobs_by_hash_;	// Content hash to blob
+	};
+public:
+	ShaderPack() = default;
+	// Validates the header and that every entry lies inside the view.
+	// An invalid pack behaves like an empty one.
+	ShaderPack(const void* data, size_t size);
+
+	Blob Find(uint64_t key) const;
+	bool IsValid() const;
+	uint32_t GetEntryCount() const;
+private:
+	const unsigned char* data_ = nullptr;
+	const Entry* entries_ = nullptr;
+	uint32_t entry_count_ = 0;
+};
+
+#endif // !SHADER_PACK_H
@@ -0,0 +1,843 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include "CpuFeatures.h"
+#include <cmath>
+#include <cstddef>
+
+// Vector math for game code. Vec3, Vec4, Quat and Mat4 are plain aligned
+// structs, constexpr-constructible so constants can live in headers, whose
+// operations go through the 4-wide SimdFloat4 layer: SSE2 on x86, NEON on
+// ARM64, plain floats elsewhere.
+//
+// Conventions match D3D's: row vectors multiplied on the left (p * M), so
+// translation sits in the last row, A * B applies A first, and the projection
+// helpers are left-handed with depth in [0, 1].
+//
+// For bulk work, Vec3x8 holds eight vectors as separate x, y and z arrays
+// (AoSoA): one matrix applies to all of them with no shuffles, four lanes at a
+// time, and the blocks are sized for 8-wide registers where code opts in to
+// AVX.
+
+#if SIMD_X86
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+constexpr float kPi = 3.14159265358979323846f;
+
+constexpr float ToRadians(float degrees)
+{
+	return degrees * (kPi / 180.0f);
+}
+
+// 4-wide registers
+
+#if SIMD_X86
+using SimdFloat4 = __m128;
+#elif SIMD_NEON
+using SimdFloat4 = float32x4_t;
+#else
+struct SimdFloat4
+{
+	float v[4];
+};
+#endif
+
+// 'p' must be 16-byte aligned
+inline SimdFloat4 SimdLoad(const float* p)
+{
+#if SIMD_X86
+	return _mm_load_ps(p);
+#elif SIMD_NEON
+	return vld1q_f32(p);
+#else
+	return { { p[0], p[1], p[2], p[3] } };
+#endif
+}
+
+inline void SimdStore(float* p, SimdFloat4 a)
+{
+#if SIMD_X86
+	_mm_store_ps(p, a);
+#elif SIMD_NEON
+	vst1q_f32(p, a);
+#else
+	for (int i = 0; i < 4; ++i)
+	{
+		p[i] = a.v[i];
+	}
+#endif
+}
+
+inline SimdFloat4 SimdSet(float x, float y, float z, float w)
+{
+#if SIMD_X86
+	return _mm_setr_ps(x, y, z, w);
+#elif SIMD_NEON
+	const float lanes[4] = { x, y, z, w };
+	return vld1q_f32(lanes);
+#else
+	return { { x, y, z, w } };
+#endif
+}
+
+inline SimdFloat4 SimdSplat(float s)
+{
+#if SIMD_X86
+	return _mm_set1_ps(s);
+#elif SIMD_NEON
+	return vdupq_n_f32(s);
+#else
+	return { { s, s, s, s } };
+#endif
+}
+
+#if SIMD_X86
+#define SIMD_LANEWISE(sse, neon, op) return sse(a, b)
+#elif SIMD_NEON
+#define SIMD_LANEWISE(sse, neon, op) return neon(a, b)
+#else
+#define SIMD_LANEWISE(sse, neon, op) return { { op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3]) } }
+#endif
+
+inline float SimdScalarAdd(float a, float b) { return a + b; }
+inline float SimdScalarSub(float a, float b) { return a - b; }
+inline float SimdScalarMul(float a, float b) { return a * b; }
+inline float SimdScalarDiv(float a, float b) { return a / b; }
+inline float SimdScalarMin(float a, float b) { return a < b ? a : b; }
+inline float SimdScalarMax(float a, float b) { return a > b ? a : b; }
+
+#if SIMD_NEON
+// vminq/vmaxq propagate NaN; compare and select instead, like minps/maxps
+inline float32x4_t SimdNeonMin(float32x4_t a, float32x4_t b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+inline float32x4_t SimdNeonMax(float32x4_t a, float32x4_t b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+#endif
+
+inline SimdFloat4 SimdAdd(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_add_ps, vaddq_f32, SimdScalarAdd); }
+inline SimdFloat4 SimdSub(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_sub_ps, vsubq_f32, SimdScalarSub); }
+inline SimdFloat4 SimdMul(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_mul_ps, vmulq_f32, SimdScalarMul); }
+inline SimdFloat4 SimdDiv(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_div_ps, vdivq_f32, SimdScalarDiv); }
+// a < b ? a : b and a > b ? a : b on every backend, as minps/maxps define
+// them: when either lane is NaN, or both are zeros, the result is 'b'
+inline SimdFloat4 SimdMin(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_min_ps, SimdNeonMin, SimdScalarMin); }
+inline SimdFloat4 SimdMax(SimdFloat4 a, SimdFloat4 b) { SIMD_LANEWISE(_mm_max_ps, SimdNeonMax, SimdScalarMax); }
+
+#undef SIMD_LANEWISE
+
+// a * b + c
+inline SimdFloat4 SimdMulAdd(SimdFloat4 a, SimdFloat4 b, SimdFloat4 c)
+{
+#if SIMD_NEON
+	return vfmaq_f32(c, a, b);
+#else
+	return SimdAdd(SimdMul(a, b), c);
+#endif
+}
+
+inline SimdFloat4 SimdSqrt(SimdFloat4 a)
+{
+#if SIMD_X86
+	return _mm_sqrt_ps(a);
+#elif SIMD_NEON
+	return vsqrtq_f32(a);
+#else
+	return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } };
+#endif
+}
+
+inline SimdFloat4 SimdAbs(SimdFloat4 a)
+{
+#if SIMD_X86
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+#elif SIMD_NEON
+	return vabsq_f32(a);
+#else
+	return { { std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3]) } };
+#endif
+}
+
+// Bit i set where lane i of a <= b; NaNs compare false
+inline int SimdLessEqualMask(SimdFloat4 a, SimdFloat4 b)
+{
+#if SIMD_X86
+	return _mm_movemask_ps(_mm_cmple_ps(a, b));
+#elif SIMD_NEON
+	const uint32_t bits[4] = { 1, 2, 4, 8 };
+	return static_cast<int>(vaddvq_u32(vandq_u32(vcleq_f32(a, b), vld1q_u32(bits))));
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		mask |= int(a.v[i] <= b.v[i]) << i;
+	}
+	return mask;
+#endif
+}
+
+// Lane i of the result is lane X, Y, Z or W of a
+template<int X, int Y, int Z, int W>
+inline SimdFloat4 SimdSwizzle(SimdFloat4 a)
+{
+	static_assert(X >= 0 && X < 4 && Y >= 0 && Y < 4 && Z >= 0 && Z < 4 && W >= 0 && W < 4);
+#if SIMD_X86
+	return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X));
+#elif SIMD_NEON
+	float32x4_t result = vdupq_laneq_f32(a, X);
+	result = vsetq_lane_f32(vgetq_lane_f32(a, Y), result, 1);
+	result = vsetq_lane_f32(vgetq_lane_f32(a, Z), result, 2);
+	return vsetq_lane_f32(vgetq_lane_f32(a, W), result, 3);
+#else
+	return { { a.v[X], a.v[Y], a.v[Z], a.v[W] } };
+#endif
+}
+
+inline SimdFloat4 SimdClearW(SimdFloat4 a)
+{
+#if SIMD_X86
+	return _mm_and_ps(a, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+#elif SIMD_NEON
+	return vsetq_lane_f32(0.0f, a, 3);
+#else
+	return { { a.v[0], a.v[1], a.v[2], 0.0f } };
+#endif
+}
+
+template<int Lane>
+inline SimdFloat4 SimdSplatLane(SimdFloat4 a)
+{
+	return SimdSwizzle<Lane, Lane, Lane, Lane>(a);
+}
+
+inline float SimdGetX(SimdFloat4 a)
+{
+#if SIMD_X86
+	return _mm_cvtss_f32(a);
+#elif SIMD_NEON
+	return vgetq_lane_f32(a, 0);
+#else
+	return a.v[0];
+#endif
+}
+
+// Dot products, splatted to every lane
+inline SimdFloat4 SimdDot3(SimdFloat4 a, SimdFloat4 b)
+{
+	const SimdFloat4 products = SimdMul(a, b);
+	return SimdAdd(SimdAdd(SimdSplatLane<0>(products), SimdSplatLane<1>(products)), SimdSplatLane<2>(products));
+}
+
+inline SimdFloat4 SimdDot4(SimdFloat4 a, SimdFloat4 b)
+{
+	const SimdFloat4 products = SimdMul(a, b);
+	const SimdFloat4 pairs = SimdAdd(products, SimdSwizzle<2, 3, 0, 1>(products));
+	return SimdAdd(pairs, SimdSwizzle<1, 0, 3, 2>(pairs));
+}
+
+// Vectors
+
+// Padded to 16 bytes so it loads as one register; the fourth lane is kept 0
+struct alignas(16) Vec3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float padding = 0.0f;
+
+	constexpr Vec3() = default;
+	constexpr Vec3(float vx, float vy, float vz)
+		: x(vx), y(vy), z(vz)
+	{}
+	constexpr explicit Vec3(float s)
+		: x(s), y(s), z(s)
+	{}
+};
+
+struct alignas(16) Vec4
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 0.0f;
+
+	constexpr Vec4() = default;
+	constexpr Vec4(float vx, float vy, float vz, float vw)
+		: x(vx), y(vy), z(vz), w(vw)
+	{}
+	constexpr Vec4(const Vec3& v, float vw)
+		: x(v.x), y(v.y), z(v.z), w(vw)
+	{}
+	constexpr explicit Vec4(float s)
+		: x(s), y(s), z(s), w(s)
+	{}
+};
+
+inline SimdFloat4 SimdLoad(const Vec3& v) { return SimdLoad(&v.x); }
+inline SimdFloat4 SimdLoad(const Vec4& v) { return SimdLoad(&v.x); }
+
+// Clears the fourth lane, which Vec3 keeps at 0. In a register, so the
+// result is written with one store: a separate 4-byte store into the padding
+// would keep the next 16-byte load of it from being forwarded from the store
+// buffer.
+inline Vec3 StoreVec3(SimdFloat4 a)
+{
+	Vec3 result;
+	SimdStore(&result.x, SimdClearW(a));
+	return result;
+}
+
+inline Vec4 StoreVec4(SimdFloat4 a)
+{
+	Vec4 result;
+	SimdStore(&result.x, a);
+	return result;
+}
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return StoreVec3(SimdAdd(SimdLoad(a), SimdLoad(b))); }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return StoreVec3(SimdSub(SimdLoad(a), SimdLoad(b))); }
+inline Vec3 operator*(const Vec3& a, const Vec3& b) { return StoreVec3(SimdMul(SimdLoad(a), SimdLoad(b))); }
+inline Vec3 operator*(const Vec3& a, float s) { return StoreVec3(SimdMul(SimdLoad(a), SimdSplat(s))); }
+inline Vec3 operator*(float s, const Vec3& a) { return a * s; }
+inline Vec3 operator/(const Vec3& a, float s) { return a * (1.0f / s); }
+inline Vec3 operator-(const Vec3& a) { return StoreVec3(SimdSub(SimdSplat(0.0f), SimdLoad(a))); }
+inline Vec3& operator+=(Vec3& a, const Vec3& b) { return a = a + b; }
+inline Vec3& operator-=(Vec3& a, const Vec3& b) { return a = a - b; }
+inline Vec3& operator*=(Vec3& a, float s) { return a = a * s; }
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return StoreVec4(SimdAdd(SimdLoad(a), SimdLoad(b))); }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return StoreVec4(SimdSub(SimdLoad(a), SimdLoad(b))); }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return StoreVec4(SimdMul(SimdLoad(a), SimdLoad(b))); }
+inline Vec4 operator*(const Vec4& a, float s) { return StoreVec4(SimdMul(SimdLoad(a), SimdSplat(s))); }
+inline Vec4 operator*(float s, const Vec4& a) { return a * s; }
+inline Vec4 operator/(const Vec4& a, float s) { return a * (1.0f / s); }
+inline Vec4 operator-(const Vec4& a) { return StoreVec4(SimdSub(SimdSplat(0.0f), SimdLoad(a))); }
+inline Vec4& operator+=(Vec4& a, const Vec4& b) { return a = a + b; }
+inline Vec4& operator-=(Vec4& a, const Vec4& b) { return a = a - b; }
+inline Vec4& operator*=(Vec4& a, float s) { return a = a * s; }
+
+inline float Dot(const Vec3& a, const Vec3& b) { return SimdGetX(SimdDot3(SimdLoad(a), SimdLoad(b))); }
+inline float Dot(const Vec4& a, const Vec4& b) { return SimdGetX(SimdDot4(SimdLoad(a), SimdLoad(b))); }
+inline float LengthSquared(const Vec3& a) { return Dot(a, a); }
+inline float Length(const Vec3& a) { return std::sqrt(Dot(a, a)); }
+inline float Length(const Vec4& a) { return std::sqrt(Dot(a, a)); }
+
+inline Vec3 Min(const Vec3& a, const Vec3& b) { return StoreVec3(SimdMin(SimdLoad(a), SimdLoad(b))); }
+inline Vec3 Max(const Vec3& a, const Vec3& b) { return StoreVec3(SimdMax(SimdLoad(a), SimdLoad(b))); }
+inline Vec3 Abs(const Vec3& a) { return StoreVec3(SimdAbs(SimdLoad(a))); }
+inline Vec4 Min(const Vec4& a, const Vec4& b) { return StoreVec4(SimdMin(SimdLoad(a), SimdLoad(b))); }
+inline Vec4 Max(const Vec4& a, const Vec4& b) { return StoreVec4(SimdMax(SimdLoad(a), SimdLoad(b))); }
+
+// Fourth lane is a.w * b.w - a.w * b.w
+inline SimdFloat4 SimdCross(SimdFloat4 a, SimdFloat4 b)
+{
+	const SimdFloat4 left = SimdMul(SimdSwizzle<1, 2, 0, 3>(a), SimdSwizzle<2, 0, 1, 3>(b));
+	const SimdFloat4 right = SimdMul(SimdSwizzle<2, 0, 1, 3>(a), SimdSwizzle<1, 2, 0, 3>(b));
+	return SimdSub(left, right);
+}
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b)
+{
+	return StoreVec3(SimdCross(SimdLoad(a), SimdLoad(b)));
+}
+
+// Zero-length vectors come back unchanged
+inline Vec3 Normalize(const Vec3& a)
+{
+	const SimdFloat4 v = SimdLoad(a);
+	const float length_squared = SimdGetX(SimdDot3(v, v));
+	return length_squared > 0.0f ? StoreVec3(SimdDiv(v, SimdSqrt(SimdSplat(length_squared)))) : a;
+}
+
+inline Vec4 Normalize(const Vec4& a)
+{
+	const SimdFloat4 v = SimdLoad(a);
+	const float length_squared = SimdGetX(SimdDot4(v, v));
+	return length_squared > 0.0f ? StoreVec4(SimdDiv(v, SimdSqrt(SimdSplat(length_squared)))) : a;
+}
+
+inline Vec3 Lerp(const Vec3& a, const Vec3& b, float t)
+{
+	return StoreVec3(SimdMulAdd(SimdSub(SimdLoad(b), SimdLoad(a)), SimdSplat(t), SimdLoad(a)));
+}
+
+inline Vec4 Lerp(const Vec4& a, const Vec4& b, float t)
+{
+	return StoreVec4(SimdMulAdd(SimdSub(SimdLoad(b), SimdLoad(a)), SimdSplat(t), SimdLoad(a)));
+}
+
+// Quaternions
+
+// Unit quaternion (x, y, z) * sin(angle / 2), w = cos(angle / 2)
+struct alignas(16) Quat
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+	float w = 1.0f;
+
+	constexpr Quat() = default;
+	constexpr Quat(float qx, float qy, float qz, float qw)
+		: x(qx), y(qy), z(qz), w(qw)
+	{}
+};
+
+inline SimdFloat4 SimdLoad(const Quat& q) { return SimdLoad(&q.x); }
+
+inline Quat StoreQuat(SimdFloat4 a)
+{
+	Quat result;
+	SimdStore(&result.x, a);
+	return result;
+}
+
+// 'axis' must be normalized
+inline Quat QuatFromAxisAngle(const Vec3& axis, float angle)
+{
+	const float s = std::sin(angle * 0.5f);
+	return Quat(axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f));
+}
+
+// Hamilton product: rotates by b, then by a
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+	const SimdFloat4 va = SimdLoad(a);
+	const SimdFloat4 vb = SimdLoad(b);
+	// a.w * b + b.w * a (xyz) + cross(a, b), w gets a.w * b.w - dot(a, b)
+	SimdFloat4 result = SimdMul(SimdSplatLane<3>(va), vb);
+	result = SimdMulAdd(SimdSplatLane<0>(va), SimdMul(SimdSwizzle<3, 2, 1, 0>(vb), SimdSet(1.0f, -1.0f, 1.0f, -1.0f)), result);
+	result = SimdMulAdd(SimdSplatLane<1>(va), SimdMul(SimdSwizzle<2, 3, 0, 1>(vb), SimdSet(1.0f, 1.0f, -1.0f, -1.0f)), result);
+	result = SimdMulAdd(SimdSplatLane<2>(va), SimdMul(SimdSwizzle<1, 0, 3, 2>(vb), SimdSet(-1.0f, 1.0f, 1.0f, -1.0f)), result);
+	return StoreQuat(result);
+}
+
+inline Quat Conjugate(const Quat& q)
+{
+	return Quat(-q.x, -q.y, -q.z, q.w);
+}
+
+inline Quat Normalize(const Quat& q)
+{
+	const SimdFloat4 v = SimdLoad(q);
+	const float length_squared = SimdGetX(SimdDot4(v, v));
+	return length_squared > 0.0f ? StoreQuat(SimdDiv(v, SimdSqrt(SimdSplat(length_squared)))) : Quat();
+}
+
+inline Vec3 Rotate(const Vec3& v, const Quat& q)
+{
+	// v + 2w (q x v) + 2 q x (q x v), all in registers
+	const SimdFloat4 vq = SimdLoad(q);
+	const SimdFloat4 axis = SimdClearW(vq);
+	const SimdFloat4 vv = SimdLoad(v);
+	const SimdFloat4 t = SimdMul(SimdCross(axis, vv), SimdSplat(2.0f));
+	return StoreVec3(SimdAdd(SimdMulAdd(t, SimdSplatLane<3>(vq), vv), SimdCross(axis, t)));
+}
+
+// Normalized lerp along the shorter arc; close to Slerp for nearby rotations
+// and much cheaper
+inline Quat Nlerp(const Quat& a, const Quat& b, float t)
+{
+	const SimdFloat4 va = SimdLoad(a);
+	SimdFloat4 vb = SimdLoad(b);
+	if (SimdGetX(SimdDot4(va, vb)) < 0.0f)
+	{
+		vb = SimdSub(SimdSplat(0.0f), vb);
+	}
+	return Normalize(StoreQuat(SimdMulAdd(SimdSub(vb, va), SimdSplat(t), va)));
+}
+
+inline Quat Slerp(const Quat& a, const Quat& b, float t)
+{
+	float cosine = SimdGetX(SimdDot4(SimdLoad(a), SimdLoad(b)));
+	const float sign = cosine < 0.0f ? -1.0f : 1.0f;
+	cosine *= sign;
+	if (cosine > 0.9995f)
+	{
+		return Nlerp(a, b, t);
+	}
+	const float angle = std::acos(cosine);
+	const float inverse_sine = 1.0f / std::sin(angle);
+	const float wa = std::sin((1.0f - t) * angle) * inverse_sine;
+	const float wb = std::sin(t * angle) * inverse_sine * sign;
+	return StoreQuat(SimdMulAdd(SimdLoad(a), SimdSplat(wa), SimdMul(SimdLoad(b), SimdSplat(wb))));
+}
+
+// Matrices
+
+struct alignas(16) Mat4
+{
+	Vec4 rows[4] = {
+		Vec4(1.0f, 0.0f, 0.0f, 0.0f),
+		Vec4(0.0f, 1.0f, 0.0f, 0.0f),
+		Vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		Vec4(0.0f, 0.0f, 0.0f, 1.0f)
+	};
+
+	// Identity
+	constexpr Mat4() = default;
+	constexpr Mat4(const Vec4& r0, const Vec4& r1, const Vec4& r2, const Vec4& r3)
+		: rows{ r0, r1, r2, r3 }
+	{}
+};
+
+inline constexpr Mat4 kIdentityMatrix{};
+
+// Row vector times matrix
+inline SimdFloat4 SimdTransform(SimdFloat4 v, const Mat4& m)
+{
+	SimdFloat4 result = SimdMul(SimdSplatLane<0>(v), SimdLoad(m.rows[0]));
+	result = SimdMulAdd(SimdSplatLane<1>(v), SimdLoad(m.rows[1]), result);
+	result = SimdMulAdd(SimdSplatLane<2>(v), SimdLoad(m.rows[2]), result);
+	return SimdMulAdd(SimdSplatLane<3>(v), SimdLoad(m.rows[3]), result);
+}
+
+inline Vec4 Transform(const Vec4& v, const Mat4& m)
+{
+	return StoreVec4(SimdTransform(SimdLoad(v), m));
+}
+
+// As a point (w = 1) without the perspective divide
+inline Vec3 TransformPoint(const Vec3& p, const Mat4& m)
+{
+	const SimdFloat4 v = SimdLoad(p);
+	SimdFloat4 result = SimdMulAdd(SimdSplatLane<0>(v), SimdLoad(m.rows[0]), SimdLoad(m.rows[3]));
+	result = SimdMulAdd(SimdSplatLane<1>(v), SimdLoad(m.rows[1]), result);
+	return StoreVec3(SimdMulAdd(SimdSplatLane<2>(v), SimdLoad(m.rows[2]), result));
+}
+
+// As a direction (w = 0)
+inline Vec3 TransformVector(const Vec3& d, const Mat4& m)
+{
+	const SimdFloat4 v = SimdLoad(d);
+	SimdFloat4 result = SimdMul(SimdSplatLane<0>(v), SimdLoad(m.rows[0]));
+	result = SimdMulAdd(SimdSplatLane<1>(v), SimdLoad(m.rows[1]), result);
+	return StoreVec3(SimdMulAdd(SimdSplatLane<2>(v), SimdLoad(m.rows[2]), result));
+}
+
+// a applied first, then b
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	Mat4 result;
+	for (int i = 0; i < 4; ++i)
+	{
+		result.rows[i] = StoreVec4(SimdTransform(SimdLoad(a.rows[i]), b));
+	}
+	return result;
+}
+
+inline Mat4 Transpose(const Mat4& m)
+{
+	return Mat4(
+		Vec4(m.rows[0].x, m.rows[1].x, m.rows[2].x, m.rows[3].x),
+		Vec4(m.rows[0].y, m.rows[1].y, m.rows[2].y, m.rows[3].y),
+		Vec4(m.rows[0].z, m.rows[1].z, m.rows[2].z, m.rows[3].z),
+		Vec4(m.rows[0].w, m.rows[1].w, m.rows[2].w, m.rows[3].w));
+}
+
+// General inverse by cofactors; a singular matrix gives non-finite values
+inline Mat4 Inverse(const Mat4& m)
+{
+	const float* a = &m.rows[0].x;
+	float c[16];
+	c[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+	c[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+	c[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+	c[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+	c[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+	c[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+	c[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+	c[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+	c[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+	c[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+	c[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+	c[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+	c[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+	c[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+	c[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+	c[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+	const float inverse_determinant = 1.0f / (a[0] * c[0] + a[1] * c[4] + a[2] * c[8] + a[3] * c[12]);
+	Mat4 result;
+	for (int i = 0; i < 4; ++i)
+	{
+		result.rows[i] = StoreVec4(SimdMul(SimdLoad(c + i * 4), SimdSplat(inverse_determinant)));
+	}
+	return result;
+}
+
+inline Mat4 TranslationMatrix(const Vec3& t)
+{
+	Mat4 result;
+	result.rows[3] = Vec4(t, 1.0f);
+	return result;
+}
+
+inline Mat4 ScalingMatrix(const Vec3& s)
+{
+	Mat4 result;
+	result.rows[0].x = s.x;
+	result.rows[1].y = s.y;
+	result.rows[2].z = s.z;
+	return result;
+}
+
+inline Mat4 RotationMatrix(const Quat& q)
+{
+	const float xx = q.x * q.x;
+	const float yy = q.y * q.y;
+	const float zz = q.z * q.z;
+	const float xy = q.x * q.y;
+	const float xz = q.x * q.z;
+	const float yz = q.y * q.z;
+	const float wx = q.w * q.x;
+	const float wy = q.w * q.y;
+	const float wz = q.w * q.z;
+	return Mat4(
+		Vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f),
+		Vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f),
+		Vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f),
+		Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+// Scale, then rotate, then translate
+inline Mat4 ComposeTransform(const Vec3& translation, const Quat& rotation, const Vec3& scale)
+{
+	Mat4 result = RotationMatrix(rotation);
+	result.rows[0] *= scale.x;
+	result.rows[1] *= scale.y;
+	result.rows[2] *= scale.z;
+	result.rows[3] = Vec4(translation, 1.0f);
+	return result;
+}
+
+inline Mat4 LookAtMatrix(const Vec3& eye, const Vec3& target, const Vec3& up)
+{
+	const Vec3 forward = Normalize(target - eye);
+	const Vec3 right = Normalize(Cross(up, forward));
+	const Vec3 actual_up = Cross(forward, right);
+	return Mat4(
+		Vec4(right.x, actual_up.x, forward.x, 0.0f),
+		Vec4(right.y, actual_up.y, forward.y, 0.0f),
+		Vec4(right.z, actual_up.z, forward.z, 0.0f),
+		Vec4(-Dot(right, eye), -Dot(actual_up, eye), -Dot(forward, eye), 1.0f));
+}
+
+inline Mat4 PerspectiveMatrix(float fov_y, float aspect, float near_z, float far_z)
+{
+	const float y_scale = 1.0f / std::tan(fov_y * 0.5f);
+	const float range = far_z / (far_z - near_z);
+	return Mat4(
+		Vec4(y_scale / aspect, 0.0f, 0.0f, 0.0f),
+		Vec4(0.0f, y_scale, 0.0f, 0.0f),
+		Vec4(0.0f, 0.0f, range, 1.0f),
+		Vec4(0.0f, 0.0f, -range * near_z, 0.0f));
+}
+
+inline Mat4 OrthographicMatrix(float width, float height, float near_z, float far_z)
+{
+	const float range = 1.0f / (far_z - near_z);
+	return Mat4(
+		Vec4(2.0f / width, 0.0f, 0.0f, 0.0f),
+		Vec4(0.0f, 2.0f / height, 0.0f, 0.0f),
+		Vec4(0.0f, 0.0f, range, 0.0f),
+		Vec4(0.0f, 0.0f, -range * near_z, 1.0f));
+}
+
+// Bounds
+
+struct Aabb
+{
+	Vec3 min = Vec3(INFINITY);
+	Vec3 max = Vec3(-INFINITY);
+
+	// Empty: merging anything into it gives that thing
+	constexpr Aabb() = default;
+	constexpr Aabb(const Vec3& lower, const Vec3& upper)
+		: min(lower), max(upper)
+	{}
+};
+
+struct Sphere
+{
+	Vec3 center;
+	float radius = 0.0f;
+
+	constexpr Sphere() = default;
+	constexpr Sphere(const Vec3& c, float r)
+		: center(c), radius(r)
+	{}
+};
+
+inline bool IsEmpty(const Aabb& box)
+{
+	return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+
+inline Aabb Merge(const Aabb& a, const Aabb& b)
+{
+	return Aabb(Min(a.min, b.min), Max(a.max, b.max));
+}
+
+inline Aabb Merge(const Aabb& a, const Vec3& p)
+{
+	return Aabb(Min(a.min, p), Max(a.max, p));
+}
+
+inline Vec3 Center(const Aabb& box)
+{
+	return (box.min + box.max) * 0.5f;
+}
+
+inline Vec3 Extent(const Aabb& box)
+{
+	return (box.max - box.min) * 0.5f;
+}
+
+// 0 for an empty box
+inline float SurfaceArea(const Aabb& box)
+{
+	if (IsEmpty(box))
+	{
+		return 0.0f;
+	}
+	const Vec3 size = box.max - box.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline bool Contains(const Aabb& box, const Vec3& p)
+{
+	return p.x >= box.min.x && p.y >= box.min.y && p.z >= box.min.z &&
+		p.x <= box.max.x && p.y <= box.max.y && p.z <= box.max.z;
+}
+
+inline bool Overlaps(const Aabb& a, const Aabb& b)
+{
+	return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z &&
+		b.min.x <= a.max.x && b.min.y <= a.max.y && b.min.z <= a.max.z;
+}
+
+// Smallest box around the transformed box (Arvo): the center moves as a
+// point, the extent grows by the absolute value of the linear part
+inline Aabb TransformAabb(const Aabb& box, const Mat4& m)
+{
+	if (IsEmpty(box))
+	{
+		return box;
+	}
+	const SimdFloat4 extent = SimdLoad(Extent(box));
+	const SimdFloat4 center = SimdLoad(TransformPoint(Center(box), m));
+	SimdFloat4 new_extent = SimdMul(SimdSplatLane<0>(extent), SimdAbs(SimdLoad(m.rows[0])));
+	new_extent = SimdMulAdd(SimdSplatLane<1>(extent), SimdAbs(SimdLoad(m.rows[1])), new_extent);
+	new_extent = SimdMulAdd(SimdSplatLane<2>(extent), SimdAbs(SimdLoad(m.rows[2])), new_extent);
+	return Aabb(StoreVec3(SimdSub(center, new_extent)), StoreVec3(SimdAdd(center, new_extent)));
+}
+
+inline Sphere BoundingSphere(const Aabb& box)
+{
+	return Sphere(Center(box), Length(Extent(box)));
+}
+
+// Batches of eight
+
+constexpr size_t kBatchWidth = 8;
+
+struct alignas(32) Vec3x8
+{
+	float x[kBatchWidth] = {};
+	float y[kBatchWidth] = {};
+	float z[kBatchWidth] = {};
+};
+
+inline size_t BatchCount(size_t count)
+{
+	return (count + kBatchWidth - 1) / kBatchWidth;
+}
+
+// BatchCount(count) blocks; the tail of the last block repeats the last vector
+// so it transforms and bounds like real data
+inline void PackVec3x8(Vec3x8* dest, const Vec3* src, size_t count)
+{
+	for (size_t i = 0; i < BatchCount(count) * kBatchWidth; ++i)
+	{
+		const Vec3& v = src[i < count ? i : count - 1];
+		Vec3x8& block = dest[i / kBatchWidth];
+		block.x[i % kBatchWidth] = v.x;
+		block.y[i % kBatchWidth] = v.y;
+		block.z[i % kBatchWidth] = v.z;
+	}
+}
+
+inline void UnpackVec3x8(Vec3* dest, const Vec3x8* src, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vec3x8& block = src[i / kBatchWidth];
+		dest[i] = Vec3(block.x[i % kBatchWidth], block.y[i % kBatchWidth], block.z[i % kBatchWidth]);
+	}
+}
+
+// dest may be src
+inline void TransformPoints(Vec3x8* dest, const Vec3x8* src, size_t batch_count, const Mat4& m)
+{
+	// Every matrix element splatted once, outside the loop
+	const SimdFloat4 m00 = SimdSplat(m.rows[0].x), m01 = SimdSplat(m.rows[0].y), m02 = SimdSplat(m.rows[0].z);
+	const SimdFloat4 m10 = SimdSplat(m.rows[1].x), m11 = SimdSplat(m.rows[1].y), m12 = SimdSplat(m.rows[1].z);
+	const SimdFloat4 m20 = SimdSplat(m.rows[2].x), m21 = SimdSplat(m.rows[2].y), m22 = SimdSplat(m.rows[2].z);
+	const SimdFloat4 m30 = SimdSplat(m.rows[3].x), m31 = SimdSplat(m.rows[3].y), m32 = SimdSplat(m.rows[3].z);
+
+	for (size_t b = 0; b < batch_count; ++b)
+	{
+		for (size_t half = 0; half < kBatchWidth; half += 4)
+		{
+			const SimdFloat4 x = SimdLoad(src[b].x + half);
+			const SimdFloat4 y = SimdLoad(src[b].y + half);
+			const SimdFloat4 z = SimdLoad(src[b].z + half);
+			SimdStore(dest[b].x + half, SimdMulAdd(z, m20, SimdMulAdd(y, m10, SimdMulAdd(x, m00, m30))));
+			SimdStore(dest[b].y + half, SimdMulAdd(z, m21, SimdMulAdd(y, m11, SimdMulAdd(x, m01, m31))));
+			SimdStore(dest[b].z + half, SimdMulAdd(z, m22, SimdMulAdd(y, m12, SimdMulAdd(x, m02, m32))));
+		}
+	}
+}
+
+// Bounds of the first 'count' points in the batches
+inline Aabb ComputeBounds(const Vec3x8* src, size_t count)
+{
+	if (count == 0)
+	{
+		return Aabb();
+	}
+	SimdFloat4 low[3] = { SimdSplat(INFINITY), SimdSplat(INFINITY), SimdSplat(INFINITY) };
+	SimdFloat4 high[3] = { SimdSplat(-INFINITY), SimdSplat(-INFINITY), SimdSplat(-INFINITY) };
+	// PackVec3x8's tail repeats a real point, so whole batches can be used
+	for (size_t b = 0; b < BatchCount(count); ++b)
+	{
+		for (size_t half = 0; half < kBatchWidth; half += 4)
+		{
+			const SimdFloat4 values[3] = { SimdLoad(src[b].x + half), SimdLoad(src[b].y + half), SimdLoad(src[b].z + half) };
+			for (int c = 0; c < 3; ++c)
+			{
+				low[c] = SimdMin(low[c], values[c]);
+				high[c] = SimdMax(high[c], values[c]);
+			}
+		}
+	}
+
+	alignas(16) float lanes[2][4];
+	Aabb box;
+	float* min = &box.min.x;
+	float* max = &box.max.x;
+	for (int c = 0; c < 3; ++c)
+	{
+		SimdStore(lanes[0], low[c]);
+		SimdStore(lanes[1], high[c]);
+		for (int i = 0; i < 4; ++i)
+		{
+			min[c] = lanes[0][i] < min[c] ? lanes[0][i] : min[c];
+			max[c] = lanes[1][i] > max[c] ? lanes[1][i] : max[c];
+		}
+	}
+	return box;
+}
+
+#endif // !SIMD_MATH_H
@@ -0,0 +1,152 @@
+#include "SubresourceCopy.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SUBRESOURCE_COPY_SSE2 1
+#endif
+
+namespace
+{
+	// Below this, setting up the streaming loop costs more than it saves
+	constexpr size_t kStreamThreshold = 256;
+	// Smallest amount of work worth handing to another thread
+	constexpr size_t kParallelGrainBytes = 256 * 1024;
+
+	void CopyBytes(void* dest, const void* src, size_t size, bool write_combined)
+	{
+		if (write_combined && size >= kStreamThreshold)
+		{
+			StreamCopy(dest, src, size);
+		}
+		else
+		{
+			std::memcpy(dest, src, size);
+		}
+	}
+
+	void CopyRows(const SubresourceCopy& copy, uint32_t slice, uint32_t first_row, uint32_t row_count, bool write_combined)
+	{
+		auto* dest = static_cast<uint8_t*>(copy.dest) + copy.dest_slice_pitch * slice + copy.dest_row_pitch * first_row;
+		auto* src = static_cast<const uint8_t*>(copy.src) + copy.src_slice_pitch * int64_t(slice) + copy.src_row_pitch * int64_t(first_row);
+
+		// Tightly packed rows on both sides are one block
+		if (copy.dest_row_pitch == copy.row_size && copy.src_row_pitch == int64_t(copy.row_size))
+		{
+			CopyBytes(dest, src, copy.row_size * row_count, write_combined);
+			return;
+		}
+
+		for (uint32_t y = 0; y < row_count; ++y)
+		{
+			CopyBytes(dest, src, copy.row_size, write_combined);
+			dest += copy.dest_row_pitch;
+			src += copy.src_row_pitch;
+		}
+	}
+
+	bool SlicesAreContiguous(const SubresourceCopy& copy)
+	{
+		const uint64_t slice_size = uint64_t(copy.row_size) * copy.row_count;
+		return copy.dest_row_pitch == copy.row_size && copy.src_row_pitch == int64_t(copy.row_size) &&
+			(copy.slice_count == 1 || (copy.dest_slice_pitch == slice_size && copy.src_slice_pitch == int64_t(slice_size)));
+	}
+}
+
+void CopySubresource(const SubresourceCopy& copy, bool write_combined)
+{
+	if (SlicesAreContiguous(copy))
+	{
+		CopyBytes(copy.dest, copy.src, copy.row_size * copy.row_count * copy.slice_count, write_combined);
+	}
+	else
+	{
+		for (uint32_t z = 0; z < copy.slice_count; ++z)
+		{
+			CopyRows(copy, z, 0, copy.row_count, write_combined);
+		}
+	}
+
+	if (write_combined)
+	{
+		StreamFence();
+	}
+}
+
+void CopySubresourceParallel(const SubresourceCopy& copy, ThreadPool& pool, bool write_combined)
+{
+	// Work items are groups of rows; a slice is rows too, with a different stride
+	const uint64_t total_rows = uint64_t(copy.row_count) * copy.slice_count;
+	const uint64_t total_bytes = total_rows * copy.row_size;
+	if (total_bytes < 2 * kParallelGrainBytes || pool.GetThreadCount() == 1 || total_rows > UINT32_MAX)
+	{
+		CopySubresource(copy, write_combined);
+		return;
+	}
+
+	const uint32_t rows_per_item = static_cast<uint32_t>(std::max<uint64_t>(1, kParallelGrainBytes / std::max<size_t>(copy.row_size, 1)));
+	const uint32_t items_per_slice = (copy.row_count + rows_per_item - 1) / rows_per_item;
+	const uint32_t item_count = items_per_slice * copy.slice_count;
+
+	pool.ParallelFor(item_count, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t item = begin; item < end; ++item)
+		{
+			const uint32_t slice = item / items_per_slice;
+			const uint32_t first_row = (item % items_per_slice) * rows_per_item;
+			const uint32_t row_count = std::min(rows_per_item, copy.row_count - first_row);
+			CopyRows(copy, slice, first_row, row_count, write_combined);
+		}
+
+		// Streaming stores are only ordered by a fence on the thread that issued them
+		if (write_combined)
+		{
+			StreamFence();
+		}
+	});
+}
+
+void StreamCopy(void* dest, const void* src, size_t size)
+{
+#if SUBRESOURCE_COPY_SSE2
+	auto* d = static_cast<uint8_t*>(dest);
+	auto* s = static_cast<const uint8_t*>(src);
+
+	// Streaming stores need 16-byte aligned destinations
+	const size_t head = std::min(size, static_cast<size_t>((16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15));
+	std::memcpy(d, s, head);
+	d += head;
+	s += head;
+	size -= head;
+
+	// A full 64-byte line per iteration lets the write-combining buffer flush whole
+	for (; size >= 64; size -= 64, d += 64, s += 64)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+	}
+	for (; size >= 16; size -= 16, d += 16, s += 16)
+	{
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+	}
+
+	std::memcpy(d, s, size);
+#else
+	std::memcpy(dest, src, size);
+#endif
+}
+
+void StreamFence()
+{
+#if SUBRESOURCE_COPY_SSE2
+	_mm_sfence();
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef SUBRESOURCE_COPY_H
+#define SUBRESOURCE_COPY_H
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// One subresource worth of rows, laid out like D3D12_MEMCPY_DEST and
+// D3D12_SUBRESOURCE_DATA: slice_count slices of row_count rows of row_size bytes
+struct SubresourceCopy
+{
+	void* dest = nullptr;
+	uint64_t dest_row_pitch = 0;
+	uint64_t dest_slice_pitch = 0;
+	const void* src = nullptr;
+	int64_t src_row_pitch = 0;
+	int64_t src_slice_pitch = 0;
+	size_t row_size = 0;
+	uint32_t row_count = 0;
+	uint32_t slice_count = 0;
+};
+
+// Drop-in for d3dx12's MemcpySubresource, which issues one memcpy per row:
+//  - rows (and slices) that are contiguous on both sides collapse into one copy
+//  - large copies into write-combined memory (upload heaps) use non-temporal
+//    SSE2 stores, which write whole lines without reading them first and
+//    without evicting the source from the cache
+//  - CopySubresourceParallel() splits big copies over a ThreadPool
+void CopySubresource(const SubresourceCopy& copy, bool write_combined = true);
+void CopySubresourceParallel(const SubresourceCopy& copy, ThreadPool& pool, bool write_combined = true);
+
+// memcpy with streaming stores. Call StreamFence() before handing the memory
+// to another thread or the GPU; CopySubresource*() already do.
+void StreamCopy(void* dest, const void* src, size_t size);
+void StreamFence();
+
+#endif // !SUBRESOURCE_COPY_H
@@ -0,0 +1,169 @@
+#include "SwapChainPresenter.h"
+#include "ThrowIfFailed.h"
+#include <cassert>
+
+SwapChainPresenter::SwapChainPresenter(
+	IDXGIFactory4* factory,
+	ID3D12CommandQueue* queue,
+	HWND handle,
+	UINT width,
+	UINT height,
+	DXGI_FORMAT format,
+	UINT buffer_count,
+	UINT max_frame_latency)
+	:
+	max_frame_latency_(max_frame_latency),
+	last_present_(Clock::now())
+{
+	// Tearing needs DXGI 1.5 and a system that supports it (variable refresh displays)
+	ComPtr<IDXGIFactory5> factory5;
+	if (SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(factory5.GetAddressOf()))))
+	{
+		BOOL allow_tearing = FALSE;
+		if (SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allow_tearing, sizeof(allow_tearing))))
+		{
+			tearing_supported_ = allow_tearing == TRUE;
+		}
+	}
+
+	flags_ = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	if (tearing_supported_)
+	{
+		flags_ |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+	}
+
+	DXGI_SWAP_CHAIN_DESC1 swap_chain_desc{};
+	swap_chain_desc.Width = width;
+	swap_chain_desc.Height = height;
+	swap_chain_desc.Format = format;
+	swap_chain_desc.Stereo = FALSE;
+	// Flip model swap chains can't be multisampled; resolve into the back buffer instead
+	swap_chain_desc.SampleDesc.Count = 1;
+	swap_chain_desc.SampleDesc.Quality = 0;
+	swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	swap_chain_desc.BufferCount = buffer_count;
+	swap_chain_desc.Scaling = DXGI_SCALING_STRETCH;
+	swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	swap_chain_desc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	swap_chain_desc.Flags = flags_;
+
+	// Note: Swap chain uses queue to perform flush.
+	ComPtr<IDXGISwapChain1> swap_chain;
+	ThrowIfFailed(factory->CreateSwapChainForHwnd(
+		queue,
+		handle,
+		&swap_chain_desc,
+		nullptr,
+		nullptr,
+		swap_chain.GetAddressOf()));
+	ThrowIfFailed(swap_chain.As(&swap_chain_));
+
+	// Exclusive fullscreen doesn't mix with tearing presents; stay windowed
+	ThrowIfFailed(factory->MakeWindowAssociation(handle, DXGI_MWA_NO_ALT_ENTER));
+
+	ThrowIfFailed(swap_chain_->SetMaximumFrameLatency(max_frame_latency_));
+	frame_latency_waitable_ = swap_chain_->GetFrameLatencyWaitableObject();
+
+	QueryRefreshInterval();
+}
+
+SwapChainPresenter::~SwapChainPresenter()
+{
+	if (frame_latency_waitable_)
+	{
+		CloseHandle(frame_latency_waitable_);
+	}
+}
+
+double SwapChainPresenter::WaitForFrame()
+{
+	const Clock::time_point start = Clock::now();
+
+	// A second is long enough to mean something went wrong; carry on rather than hang
+	WaitForSingleObjectEx(frame_latency_waitable_, 1000, TRUE);
+
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double SwapChainPresenter::Present()
+{
+	const UINT sync_interval = vsync_ ? 1 : 0;
+	const UINT present_flags = !vsync_ && tearing_supported_ ? DXGI_PRESENT_ALLOW_TEARING : 0;
+	ThrowIfFailed(swap_chain_->Present(sync_interval, present_flags));
+
+	const Clock::time_point now = Clock::now();
+	const double interval_ms = std::chrono::duration<double, std::milli>(now - last_present_).count();
+	last_present_ = now;
+	return interval_ms;
+}
+
+void SwapChainPresenter::SetMaximumFrameLatency(uint32_t latency)
+{
+	assert(latency >= 1 && latency <= DXGI_MAX_SWAP_CHAIN_BUFFERS && "Frame latency out of range.");
+	ThrowIfFailed(swap_chain_->SetMaximumFrameLatency(latency));
+	max_frame_latency_ = latency;
+}
+
+uint32_t SwapChainPresenter::GetMaximumFrameLatency() const
+{
+	return max_frame_latency_;
+}
+
+double SwapChainPresenter::GetRefreshIntervalMs() const
+{
+	return refresh_interval_ms_;
+}
+
+void SwapChainPresenter::SetVSync(bool enabled)
+{
+	vsync_ = enabled;
+}
+
+bool SwapChainPresenter::IsVSyncEnabled() const
+{
+	return vsync_;
+}
+
+bool SwapChainPresenter::IsTearingSupported() const
+{
+	return tearing_supported_;
+}
+
+void SwapChainPresenter::Resize(UINT width, UINT height)
+{
+	// Keep the buffer count and format; the flags must match creation
+	ThrowIfFailed(swap_chain_->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, flags_));
+
+	// The window may have been dragged onto another monitor
+	QueryRefreshInterval();
+}
+
+IDXGISwapChain4* SwapChainPresenter::GetSwapChain() const
+{
+	return swap_chain_.Get();
+}
+
+UINT SwapChainPresenter::GetCurrentBackBufferIndex() const
+{
+	return swap_chain_->GetCurrentBackBufferIndex();
+}
+
+void SwapChainPresenter::QueryRefreshInterval()
+{
+	// Refresh rate of the monitor the window is on; keep 60 Hz if it can't be found
+	ComPtr<IDXGIOutput> output;
+	if (FAILED(swap_chain_->GetContainingOutput(output.GetAddressOf())))
+	{
+		return;
+	}
+
+	DXGI_OUTPUT_DESC output_desc{};
+	DEVMODEW mode{};
+	mode.dmSize = sizeof(mode);
+	if (SUCCEEDED(output->GetDesc(&output_desc)) &&
+		EnumDisplaySettingsW(output_desc.DeviceName, ENUM_CURRENT_SETTINGS, &mode) &&
+		mode.dmDisplayFrequency > 1)
+	{
+		refresh_interval_ms_ = 1000.0 / static_cast<double>(mode.dmDisplayFrequency);
+	}
+}
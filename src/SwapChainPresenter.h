@@ -0,0 +1,64 @@
+#ifndef SWAP_CHAIN_PRESENTER_H
+#define SWAP_CHAIN_PRESENTER_H
+
+#include "LeanWin32.h"
+#include "Presenter.h"
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl.h>
+#include <chrono>
+
+using namespace Microsoft::WRL;
+
+// Flip-model IDXGISwapChain4 with a frame latency waitable object. Waiting on
+// it before reading input keeps the CPU from running ahead of the display, so
+// the frame shown reflects input that is at most GetMaximumFrameLatency()
+// frames old. With vsync off, presents tear when the system allows it instead
+// of being held back by the compositor.
+class SwapChainPresenter : public Presenter
+{
+public:
+	SwapChainPresenter(
+		IDXGIFactory4* factory,
+		ID3D12CommandQueue* queue,
+		HWND handle,
+		UINT width,
+		UINT height,
+		DXGI_FORMAT format,
+		UINT buffer_count,
+		UINT max_frame_latency);
+	SwapChainPresenter(const SwapChainPresenter&) = delete;
+	SwapChainPresenter& operator=(const SwapChainPresenter&) = delete;
+	~SwapChainPresenter();
+
+	double WaitForFrame() override;
+	double Present() override;
+	void SetMaximumFrameLatency(uint32_t latency) override;
+	uint32_t GetMaximumFrameLatency() const override;
+	double GetRefreshIntervalMs() const override;
+
+	void SetVSync(bool enabled);
+	bool IsVSyncEnabled() const;
+	bool IsTearingSupported() const;
+
+	// Every reference to the back buffers must be released and the GPU idle
+	void Resize(UINT width, UINT height);
+
+	IDXGISwapChain4* GetSwapChain() const;
+	UINT GetCurrentBackBufferIndex() const;
+private:
+	void QueryRefreshInterval();
+private:
+	using Clock = std::chrono::steady_clock;
+
+	ComPtr<IDXGISwapChain4> swap_chain_;
+	HANDLE frame_latency_waitable_ = nullptr;
+	UINT max_frame_latency_;
+	UINT flags_ = 0;	// Creation flags, ResizeBuffers has to repeat them
+	bool tearing_supported_ = false;
+	bool vsync_ = true;
+	double refresh_interval_ms_ = 1000.0 / 60.0;
+	Clock::time_point last_present_;
+};
+
+#endif // !SWAP_CHAIN_PRESENTER_H
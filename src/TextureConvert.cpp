@@ -0,0 +1,576 @@
+#include "TextureConvert.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Smallest amount of work worth handing to another thread
+	constexpr size_t kParallelGrainBytes = 128 * 1024;
+
+	// Linear values in the sRGB paths are kept with 14 bits: enough that every
+	// sRGB byte decodes to a distinct value and encodes back to itself, and
+	// four of them still add up inside 16 bits
+	constexpr uint32_t kLinearBits = 14;
+	constexpr uint32_t kLinearMax = (1u << kLinearBits) - 1;
+
+	struct SrgbTables
+	{
+		SrgbTables()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				const double linear = Decode(i / 255.0);
+				to_linear[i] = static_cast<uint16_t>(std::lround(linear * kLinearMax));
+				to_linear8[i] = static_cast<uint8_t>(std::lround(linear * 255.0));
+				from_linear8[i] = static_cast<uint8_t>(std::lround(Encode(i / 255.0) * 255.0));
+			}
+			for (uint32_t i = 0; i <= kLinearMax; ++i)
+			{
+				from_linear[i] = static_cast<uint8_t>(std::lround(Encode(double(i) / kLinearMax) * 255.0));
+			}
+		}
+
+		static double Decode(double x)
+		{
+			return x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+		}
+
+		static double Encode(double x)
+		{
+			return x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+		}
+
+		uint16_t to_linear[256];
+		uint8_t from_linear[kLinearMax + 1];
+		uint8_t to_linear8[256];
+		uint8_t from_linear8[256];
+	};
+
+	const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// round(x * a / 255) for x, a <= 255, without a division
+	inline uint32_t MulDiv255(uint32_t x, uint32_t a)
+	{
+		const uint32_t t = x * a + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	inline uint32_t LoadPixel(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline void StorePixel(uint8_t* p, uint32_t v)
+	{
+		std::memcpy(p, &v, sizeof(v));
+	}
+
+	// Row kernels. 'x' is where the vector versions left off, so they can
+	// hand the tail of a row to the scalar version.
+
+	void SwapRedBlueScalar(uint8_t* dest, const uint8_t* src, uint32_t x, uint32_t width)
+	{
+		for (; x < width; ++x)
+		{
+			const uint32_t v = LoadPixel(src + x * 4);
+			StorePixel(dest + x * 4, (v & 0xff00ff00u) | ((v >> 16) & 0xffu) | ((v & 0xffu) << 16));
+		}
+	}
+
+	void ExpandRgbScalar(uint8_t* dest, const uint8_t* src, uint32_t x, uint32_t width)
+	{
+		for (; x < width; ++x)
+		{
+			dest[x * 4 + 0] = src[x * 3 + 0];
+			dest[x * 4 + 1] = src[x * 3 + 1];
+			dest[x * 4 + 2] = src[x * 3 + 2];
+			dest[x * 4 + 3] = 0xff;
+		}
+	}
+
+	void PremultiplyScalar(uint8_t* dest, const uint8_t* src, uint32_t x, uint32_t width)
+	{
+		for (; x < width; ++x)
+		{
+			const uint32_t a = src[x * 4 + 3];
+			dest[x * 4 + 0] = static_cast<uint8_t>(MulDiv255(src[x * 4 + 0], a));
+			dest[x * 4 + 1] = static_cast<uint8_t>(MulDiv255(src[x * 4 + 1], a));
+			dest[x * 4 + 2] = static_cast<uint8_t>(MulDiv255(src[x * 4 + 2], a));
+			dest[x * 4 + 3] = static_cast<uint8_t>(a);
+		}
+	}
+
+	void PremultiplySrgbScalar(uint8_t* dest, const uint8_t* src, uint32_t x, uint32_t width)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		for (; x < width; ++x)
+		{
+			const uint32_t a = src[x * 4 + 3];
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t linear = (tables.to_linear[src[x * 4 + c]] * a + 127) / 255;
+				dest[x * 4 + c] = tables.from_linear[linear];
+			}
+			dest[x * 4 + 3] = static_cast<uint8_t>(a);
+		}
+	}
+
+	void LookupColorScalar(uint8_t* dest, const uint8_t* src, uint32_t width, const uint8_t* table)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			dest[x * 4 + 0] = table[src[x * 4 + 0]];
+			dest[x * 4 + 1] = table[src[x * 4 + 1]];
+			dest[x * 4 + 2] = table[src[x * 4 + 2]];
+			dest[x * 4 + 3] = src[x * 4 + 3];
+		}
+	}
+
+	// Averages of 2x2 blocks of 16-bit channel values; rows hold src_width
+	// pixels of 4 channels, dest gets dest_width pixels
+	void AverageScalar(uint16_t* dest, const uint16_t* row0, const uint16_t* row1, uint32_t x, uint32_t dest_width, uint32_t src_width)
+	{
+		for (; x < dest_width; ++x)
+		{
+			const uint32_t x0 = x * 2;
+			const uint32_t x1 = std::min(x0 + 1, src_width - 1);
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+				dest[x * 4 + c] = static_cast<uint16_t>((sum + 2) >> 2);
+			}
+		}
+	}
+
+	void DownsampleScalar(uint8_t* dest, const uint8_t* row0, const uint8_t* row1, uint32_t x, uint32_t dest_width, uint32_t src_width)
+	{
+		for (; x < dest_width; ++x)
+		{
+			const uint32_t x0 = x * 2;
+			const uint32_t x1 = std::min(x0 + 1, src_width - 1);
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+				dest[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+
+#if SIMD_X86
+	void SwapRedBlueSse2(uint8_t* dest, const uint8_t* src, uint32_t width)
+	{
+		const __m128i keep = _mm_set1_epi32(static_cast<int>(0xff00ff00u));
+		const __m128i low = _mm_set1_epi32(0xff);
+		uint32_t x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+			const __m128i r = _mm_or_si128(_mm_and_si128(v, keep),
+				_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low), _mm_slli_epi32(_mm_and_si128(v, low), 16)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), r);
+		}
+		SwapRedBlueScalar(dest, src, x, width);
+	}
+
+	// Premultiplies the two pixels in the low or high half of a register,
+	// widened to 16 bits per channel; alpha lanes come out as a * a / 255
+	inline __m128i PremultiplyWideSse2(__m128i pixels)
+	{
+		const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		const __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+	}
+
+	void PremultiplySse2(uint8_t* dest, const uint8_t* src, uint32_t width)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+		uint32_t x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+			const __m128i lo = PremultiplyWideSse2(_mm_unpacklo_epi8(v, zero));
+			const __m128i hi = PremultiplyWideSse2(_mm_unpackhi_epi8(v, zero));
+			const __m128i color = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), _mm_or_si128(color, _mm_and_si128(v, alpha_mask)));
+		}
+		PremultiplyScalar(dest, src, x, width);
+	}
+
+	// Adds horizontally neighbouring pixels: 2 pixels of 16-bit channels in,
+	// their sum in the low 64 bits out
+	inline __m128i AddPixelPairSse2(__m128i pair)
+	{
+		return _mm_add_epi16(pair, _mm_srli_si128(pair, 8));
+	}
+
+	void AverageSse2(uint16_t* dest, const uint16_t* row0, const uint16_t* row1, uint32_t dest_width, uint32_t src_width)
+	{
+		const __m128i rounding = _mm_set1_epi16(2);
+		uint32_t x = 0;
+		if (src_width >= 2)
+		{
+			for (; x + 2 <= dest_width; x += 2)
+			{
+				const __m128i a = _mm_add_epi16(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8)));
+				const __m128i b = _mm_add_epi16(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 8)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 8)));
+				const __m128i sum = _mm_unpacklo_epi64(AddPixelPairSse2(a), AddPixelPairSse2(b));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2));
+			}
+		}
+		AverageScalar(dest, row0, row1, x, dest_width, src_width);
+	}
+
+	void DownsampleSse2(uint8_t* dest, const uint8_t* row0, const uint8_t* row1, uint32_t dest_width, uint32_t src_width)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+		uint32_t x = 0;
+		if (src_width >= 2)
+		{
+			// 8 source pixels per row into 4 destination pixels
+			for (; x + 4 <= dest_width; x += 4)
+			{
+				const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+				const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+				const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+				const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+
+				const __m128i p0 = AddPixelPairSse2(_mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero)));
+				const __m128i p1 = AddPixelPairSse2(_mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero)));
+				const __m128i p2 = AddPixelPairSse2(_mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero)));
+				const __m128i p3 = AddPixelPairSse2(_mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero)));
+
+				const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(p0, p1), rounding), 2);
+				const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(p2, p3), rounding), 2);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x * 4), _mm_packus_epi16(lo, hi));
+			}
+		}
+		DownsampleScalar(dest, row0, row1, x, dest_width, src_width);
+	}
+
+	SIMD_TARGET_AVX2 void SwapRedBlueAvx2(uint8_t* dest, const uint8_t* src, uint32_t width)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		uint32_t x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x * 4), _mm256_shuffle_epi8(v, shuffle));
+		}
+		SwapRedBlueScalar(dest, src, x, width);
+	}
+
+	SIMD_TARGET_AVX2 void ExpandRgbAvx2(uint8_t* dest, const uint8_t* src, uint32_t width)
+	{
+		// 24 bytes of RGB become 32 bytes of RGBA: move source dwords 3-5 to
+		// the upper lane, then spread each lane's 12 bytes over 16
+		const __m256i spread_lanes = _mm256_setr_epi32(0, 1, 2, 2, 3, 4, 5, 5);
+		const __m256i shuffle = _mm256_setr_epi8(
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+		uint32_t x = 0;
+		// Each load reads 32 bytes but uses 24, so stop while 8 more remain
+		for (; x + 11 <= width; x += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 3));
+			const __m256i rgb = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, spread_lanes), shuffle);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x * 4), _mm256_or_si256(rgb, alpha));
+		}
+		ExpandRgbScalar(dest, src, x, width);
+	}
+
+	SIMD_TARGET_AVX2 void PremultiplyAvx2(uint8_t* dest, const uint8_t* src, uint32_t width)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+		const __m256i broadcast_alpha = _mm256_setr_epi8(
+			6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+			6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		const __m256i bias = _mm256_set1_epi16(128);
+		uint32_t x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+			__m256i lo = _mm256_unpacklo_epi8(v, zero);
+			__m256i hi = _mm256_unpackhi_epi8(v, zero);
+			lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, _mm256_shuffle_epi8(lo, broadcast_alpha)), bias);
+			hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, _mm256_shuffle_epi8(hi, broadcast_alpha)), bias);
+			lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+			// Unpack and pack both work per 128-bit lane, so pixel order survives
+			const __m256i color = _mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(lo, hi));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x * 4), _mm256_or_si256(color, _mm256_and_si256(v, alpha_mask)));
+		}
+		PremultiplyScalar(dest, src, x, width);
+	}
+#endif
+
+	void ConvertRow(uint8_t* dest, const uint8_t* src, uint32_t width, PixelOp op, SimdLevel level)
+	{
+		switch (op)
+		{
+			case PixelOp::kSwapRedBlue:
+			{
+#if SIMD_X86
+				if (level == SimdLevel::kAvx2)
+				{
+					SwapRedBlueAvx2(dest, src, width);
+					return;
+				}
+				if (level == SimdLevel::kSse2)
+				{
+					SwapRedBlueSse2(dest, src, width);
+					return;
+				}
+#endif
+				SwapRedBlueScalar(dest, src, 0, width);
+			} break;
+
+			case PixelOp::kExpandRgb:
+			{
+				// Without pshufb there's no cheap SSE2 form of the 3 -> 4 byte spread
+#if SIMD_X86
+				if (level == SimdLevel::kAvx2)
+				{
+					ExpandRgbAvx2(dest, src, width);
+					return;
+				}
+#endif
+				ExpandRgbScalar(dest, src, 0, width);
+			} break;
+
+			case PixelOp::kSrgbToLinear:
+			{
+				LookupColorScalar(dest, src, width, GetSrgbTables().to_linear8);
+			} break;
+
+			case PixelOp::kLinearToSrgb:
+			{
+				LookupColorScalar(dest, src, width, GetSrgbTables().from_linear8);
+			} break;
+
+			case PixelOp::kPremultiplyAlpha:
+			{
+#if SIMD_X86
+				if (level == SimdLevel::kAvx2)
+				{
+					PremultiplyAvx2(dest, src, width);
+					return;
+				}
+				if (level == SimdLevel::kSse2)
+				{
+					PremultiplySse2(dest, src, width);
+					return;
+				}
+#endif
+				PremultiplyScalar(dest, src, 0, width);
+			} break;
+
+			case PixelOp::kPremultiplyAlphaSrgb:
+			{
+				PremultiplySrgbScalar(dest, src, 0, width);
+			} break;
+		}
+	}
+
+	void DecodeRow(uint16_t* dest, const uint8_t* src, uint32_t width)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			dest[x * 4 + 0] = tables.to_linear[src[x * 4 + 0]];
+			dest[x * 4 + 1] = tables.to_linear[src[x * 4 + 1]];
+			dest[x * 4 + 2] = tables.to_linear[src[x * 4 + 2]];
+			dest[x * 4 + 3] = src[x * 4 + 3];
+		}
+	}
+
+	void EncodeRow(uint8_t* dest, const uint16_t* src, uint32_t width)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			dest[x * 4 + 0] = tables.from_linear[src[x * 4 + 0]];
+			dest[x * 4 + 1] = tables.from_linear[src[x * 4 + 1]];
+			dest[x * 4 + 2] = tables.from_linear[src[x * 4 + 2]];
+			dest[x * 4 + 3] = static_cast<uint8_t>(src[x * 4 + 3]);
+		}
+	}
+
+	// Runs body(first_row, row_count) over bands of rows, on the pool if the
+	// image is big enough to be worth it
+	template<typename Body>
+	void ForEachBand(uint32_t height, size_t row_bytes, ThreadPool* pool, const Body& body)
+	{
+		const uint64_t total_bytes = uint64_t(row_bytes) * height;
+		if (!pool || pool->GetThreadCount() == 1 || total_bytes < 2 * kParallelGrainBytes)
+		{
+			body(0, height);
+			return;
+		}
+
+		const uint32_t rows_per_band = static_cast<uint32_t>(std::max<size_t>(1, kParallelGrainBytes / std::max<size_t>(row_bytes, 1)));
+		const uint32_t band_count = (height + rows_per_band - 1) / rows_per_band;
+		pool->ParallelFor(band_count, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t band = begin; band < end; ++band)
+			{
+				const uint32_t first_row = band * rows_per_band;
+				body(first_row, std::min(rows_per_band, height - first_row));
+			}
+		});
+	}
+}
+
+void ConvertPixels(const PixelConversion& conversion, PixelOp op, ThreadPool* pool, SimdLevel level)
+{
+	level = ClampSimdLevel(level);
+	auto* dest = static_cast<uint8_t*>(conversion.dest);
+	auto* src = static_cast<const uint8_t*>(conversion.src);
+
+	ForEachBand(conversion.height, size_t(conversion.width) * 4, pool, [&](uint32_t first_row, uint32_t row_count)
+	{
+		for (uint32_t y = first_row; y < first_row + row_count; ++y)
+		{
+			ConvertRow(dest + conversion.dest_row_pitch * y, src + conversion.src_row_pitch * y, conversion.width, op, level);
+		}
+	});
+}
+
+void DownsampleMip(const PixelConversion& conversion, bool srgb, ThreadPool* pool, SimdLevel level)
+{
+	level = ClampSimdLevel(level);
+	const uint32_t src_width = conversion.width;
+	const uint32_t src_height = conversion.height;
+	const uint32_t dest_width = std::max(1u, src_width / 2);
+	const uint32_t dest_height = std::max(1u, src_height / 2);
+	auto* dest = static_cast<uint8_t*>(conversion.dest);
+	auto* src = static_cast<const uint8_t*>(conversion.src);
+
+	ForEachBand(dest_height, size_t(src_width) * 8, pool, [&](uint32_t first_row, uint32_t row_count)
+	{
+		// Linear light rows for the sRGB path, per band so threads don't share them
+		std::vector<uint16_t> scratch;
+		if (srgb)
+		{
+			scratch.resize(size_t(src_width) * 8 + size_t(dest_width) * 4);
+		}
+
+		for (uint32_t y = first_row; y < first_row + row_count; ++y)
+		{
+			const uint8_t* row0 = src + conversion.src_row_pitch * (y * 2);
+			const uint8_t* row1 = src + conversion.src_row_pitch * std::min(y * 2 + 1, src_height - 1);
+			uint8_t* out = dest + conversion.dest_row_pitch * y;
+
+			if (!srgb)
+			{
+#if SIMD_X86
+				if (level != SimdLevel::kScalar)
+				{
+					DownsampleSse2(out, row0, row1, dest_width, src_width);
+					continue;
+				}
+#endif
+				DownsampleScalar(out, row0, row1, 0, dest_width, src_width);
+				continue;
+			}
+
+			uint16_t* linear0 = scratch.data();
+			uint16_t* linear1 = linear0 + size_t(src_width) * 4;
+			uint16_t* average = linear1 + size_t(src_width) * 4;
+			DecodeRow(linear0, row0, src_width);
+			DecodeRow(linear1, row1, src_width);
+#if SIMD_X86
+			if (level != SimdLevel::kScalar)
+			{
+				AverageSse2(average, linear0, linear1, dest_width, src_width);
+			}
+			else
+#endif
+			{
+				AverageScalar(average, linear0, linear1, 0, dest_width, src_width);
+			}
+			EncodeRow(out, average, dest_width);
+		}
+	});
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+	{
+		++count;
+	}
+	return count;
+}
+
+MipChain GenerateMipChain(
+	const void* src,
+	size_t src_row_pitch,
+	uint32_t width,
+	uint32_t height,
+	bool srgb,
+	uint32_t max_levels,
+	ThreadPool* pool)
+{
+	MipChain chain;
+	const uint32_t full_count = GetMipLevelCount(width, height);
+	const uint32_t level_count = max_levels == 0 ? full_count : std::min(max_levels, full_count);
+
+	size_t total = 0;
+	for (uint32_t i = 0; i < level_count; ++i)
+	{
+		MipChain::Level level;
+		level.width = std::max(1u, width >> i);
+		level.height = std::max(1u, height >> i);
+		level.row_pitch = size_t(level.width) * 4;
+		level.offset = total;
+		total += level.row_pitch * level.height;
+		chain.levels.push_back(level);
+	}
+	chain.data.resize(total);
+
+	const auto* source = static_cast<const uint8_t*>(src);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		std::memcpy(chain.data.data() + size_t(y) * chain.levels[0].row_pitch, source + src_row_pitch * y, chain.levels[0].row_pitch);
+	}
+
+	// Each level from the previous one; the error of a box filter chain is
+	// small next to re-filtering the full image for every level
+	for (uint32_t i = 1; i < level_count; ++i)
+	{
+		const MipChain::Level& parent = chain.levels[i - 1];
+		PixelConversion conversion;
+		conversion.dest = chain.data.data() + chain.levels[i].offset;
+		conversion.dest_row_pitch = chain.levels[i].row_pitch;
+		conversion.src = chain.data.data() + parent.offset;
+		conversion.src_row_pitch = parent.row_pitch;
+		conversion.width = parent.width;
+		conversion.height = parent.height;
+		DownsampleMip(conversion, srgb, pool);
+	}
+
+	return chain;
+}
@@ -0,0 +1,85 @@
+#ifndef TEXTURE_CONVERT_H
+#define TEXTURE_CONVERT_H
+
+#include "CpuFeatures.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// CPU pixel kernels for getting loaded images into R8G8B8A8 textures:
+// channel swizzles, sRGB <-> linear, premultiplied alpha and mip generation.
+// Every kernel has a scalar version, and SSE2/AVX2 versions where the work is
+// arithmetic; all versions produce identical bytes. Conversions that are a
+// table lookup per channel (the sRGB ones) stay scalar at every level: SSE2
+// has no gather, and AVX2's isn't faster than scalar loads from a 256-entry
+// table. With a pool, images are split into bands of rows.
+
+enum class PixelOp
+{
+	kSwapRedBlue,			// BGRA8 <-> RGBA8
+	kExpandRgb,				// RGB8 -> RGBA8 with opaque alpha; src can't alias dest
+	kSrgbToLinear,			// RGBA8 color channels decoded, alpha kept
+	kLinearToSrgb,			// RGBA8 color channels encoded, alpha kept
+	kPremultiplyAlpha,		// color = round(color * alpha / 255)
+	kPremultiplyAlphaSrgb	// Same, but weighted in linear light
+};
+
+// A width x height rectangle of pixels. The source may be the destination,
+// for in-place conversion, as long as the pitches match.
+struct PixelConversion
+{
+	void* dest = nullptr;
+	size_t dest_row_pitch = 0;
+	const void* src = nullptr;
+	size_t src_row_pitch = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+void ConvertPixels(
+	const PixelConversion& conversion,
+	PixelOp op,
+	ThreadPool* pool = nullptr,
+	SimdLevel level = GetSupportedSimdLevel());
+
+// 2x2 box filter from an RGBA8 image (conversion.width x height, the source
+// size) to the next mip, max(1, width / 2) x max(1, height / 2). Odd sizes drop
+// the last row/column, like D3DX's box filter. With 'srgb' the color channels
+// are averaged in linear light (alpha always is linear).
+void DownsampleMip(
+	const PixelConversion& conversion,
+	bool srgb,
+	ThreadPool* pool = nullptr,
+	SimdLevel level = GetSupportedSimdLevel());
+
+// Full mip chain of an RGBA8 image in one tightly packed buffer, ready to
+// point D3D12_SUBRESOURCE_DATA entries at
+struct MipChain
+{
+	struct Level
+	{
+		size_t offset = 0;
+		size_t row_pitch = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	std::vector<unsigned char> data;
+	std::vector<Level> levels;	// levels[0] is a copy of the source
+};
+
+// max_levels 0 means down to 1x1
+MipChain GenerateMipChain(
+	const void* src,
+	size_t src_row_pitch,
+	uint32_t width,
+	uint32_t height,
+	bool srgb,
+	uint32_t max_levels = 0,
+	ThreadPool* pool = nullptr);
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+#endif // !TEXTURE_CONVERT_H
@@ -0,0 +1,141 @@
+#include "TextureFootprint.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+bool GetTextureFormatInfo(uint32_t format, TextureFormatInfo& info)
+{
+	// DXGI_FORMAT values, spelled out so this file doesn't need dxgiformat.h
+	switch (format)
+	{
+		case 2:		// R32G32B32A32_TYPELESS .. _SINT
+		case 1: case 3: case 4:
+		{
+			info = { 16, 1 };
+		} return true;
+
+		case 6: case 7: case 8: case 5:	// R32G32B32
+		{
+			info = { 12, 1 };
+		} return true;
+
+		case 9: case 10: case 11: case 12: case 13: case 14:	// R16G16B16A16
+		case 15: case 16: case 17: case 18:						// R32G32
+		{
+			info = { 8, 1 };
+		} return true;
+
+		case 23: case 24: case 25:				// R10G10B10A2
+		case 26:								// R11G11B10_FLOAT
+		case 27: case 28: case 29: case 30: case 31: case 32:	// R8G8B8A8
+		case 33: case 34: case 35: case 36: case 37: case 38:	// R16G16
+		case 39: case 40: case 41: case 42: case 43:			// R32
+		case 67:								// R9G9B9E5_SHAREDEXP
+		case 87: case 88: case 90: case 91: case 92: case 93:	// B8G8R8A8, B8G8R8X8
+		{
+			info = { 4, 1 };
+		} return true;
+
+		case 48: case 49: case 50: case 51: case 52:			// R8G8
+		case 53: case 54: case 55: case 56: case 57: case 58: case 59:	// R16
+		{
+			info = { 2, 1 };
+		} return true;
+
+		case 60: case 61: case 62: case 63: case 64: case 65:	// R8, A8
+		{
+			info = { 1, 1 };
+		} return true;
+
+		case 70: case 71: case 72:	// BC1
+		case 79: case 80: case 81:	// BC4
+		{
+			info = { 8, 4 };
+		} return true;
+
+		case 73: case 74: case 75:	// BC2
+		case 76: case 77: case 78:	// BC3
+		case 82: case 83: case 84:	// BC5
+		case 94: case 95: case 96:	// BC6H
+		case 97: case 98: case 99:	// BC7
+		{
+			info = { 16, 4 };
+		} return true;
+	}
+
+	return false;
+}
+
+bool ComputeTextureFootprints(
+	const TextureFootprintDesc& desc,
+	uint32_t first,
+	uint32_t count,
+	uint64_t base_offset,
+	SubresourceFootprint* footprints,
+	uint64_t* total_bytes)
+{
+	assert(first + count <= GetSubresourceCount(desc) && "Subresource range out of bounds.");
+
+	// Buffers are one row of bytes
+	TextureFormatInfo info{ 1, 1 };
+	if (desc.dimension != TextureDimension::kBuffer && !GetTextureFormatInfo(desc.format, info))
+	{
+		return false;
+	}
+
+	const uint32_t mip_levels = std::max<uint32_t>(desc.mip_levels, 1);
+	uint64_t offset = base_offset;
+	uint64_t end = base_offset;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t subresource = first + i;
+		const uint32_t mip = subresource % mip_levels;
+
+		uint64_t width = std::max<uint64_t>(desc.width >> mip, 1);
+		uint32_t height = std::max<uint32_t>(desc.height >> mip, 1);
+		uint32_t depth = desc.dimension == TextureDimension::kTexture3D
+			? std::max<uint32_t>(desc.depth_or_array_size >> mip, 1)
+			: 1;
+
+		// Footprint sizes are in whole blocks, so small BC mips still take a 4x4 block
+		width = AlignUp(width, info.block_size);
+		height = static_cast<uint32_t>(AlignUp(height, info.block_size));
+
+		SubresourceFootprint& footprint = footprints[i];
+		offset = AlignUp(offset, desc.dimension == TextureDimension::kBuffer ? 1 : kTexturePlacementAlignment);
+		footprint.offset = offset;
+		footprint.format = desc.dimension == TextureDimension::kBuffer ? 0 : desc.format;
+		footprint.width = static_cast<uint32_t>(width);
+		footprint.height = height;
+		footprint.depth = depth;
+		footprint.row_size = (width / info.block_size) * info.bytes_per_block;
+		footprint.row_count = height / info.block_size;
+		footprint.row_pitch = static_cast<uint32_t>(AlignUp(footprint.row_size, kTexturePitchAlignment));
+
+		// The last row isn't padded out to the pitch
+		const uint64_t rows = uint64_t(footprint.row_count) * depth;
+		end = offset + footprint.row_pitch * (rows - 1) + footprint.row_size;
+		offset += uint64_t(footprint.row_pitch) * rows;
+	}
+
+	if (total_bytes)
+	{
+		*total_bytes = end - base_offset;
+	}
+	return true;
+}
+
+uint32_t GetSubresourceCount(const TextureFootprintDesc& desc)
+{
+	const uint32_t mip_levels = std::max<uint32_t>(desc.mip_levels, 1);
+	const uint32_t array_size = desc.dimension == TextureDimension::kTexture3D ? 1 : std::max<uint32_t>(desc.depth_or_array_size, 1);
+	return mip_levels * array_size;
+}
@@ -0,0 +1,72 @@
+#ifndef TEXTURE_FOOTPRINT_H
+#define TEXTURE_FOOTPRINT_H
+
+#include <cstdint>
+
+// CPU-only stand-in for ID3D12Device::GetCopyableFootprints: where each
+// subresource goes in an upload buffer and how its rows are laid out, using
+// D3D12's placement rules (rows pitched to 256 bytes, subresources placed on
+// 512 byte boundaries, block-compressed formats counted in 4x4 blocks).
+// Formats are DXGI_FORMAT values. Only the formats GetFormatInfo() knows are
+// handled; the rest should go through the device. No D3D headers involved,
+// see D3D12Footprints for the D3D12-typed wrapper.
+
+constexpr uint32_t kTexturePitchAlignment = 256;		// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+constexpr uint32_t kTexturePlacementAlignment = 512;	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+enum class TextureDimension : uint8_t
+{
+	kBuffer,
+	kTexture1D,
+	kTexture2D,
+	kTexture3D
+};
+
+// The parts of D3D12_RESOURCE_DESC a footprint depends on
+struct TextureFootprintDesc
+{
+	TextureDimension dimension = TextureDimension::kTexture2D;
+	uint32_t format = 0;
+	uint64_t width = 0;
+	uint32_t height = 1;
+	uint16_t depth_or_array_size = 1;
+	uint16_t mip_levels = 1;
+};
+
+// D3D12_PLACED_SUBRESOURCE_FOOTPRINT plus the row count and size
+struct SubresourceFootprint
+{
+	uint64_t offset = 0;
+	uint32_t format = 0;
+	uint32_t width = 0;		// Rounded up to whole blocks
+	uint32_t height = 0;
+	uint32_t depth = 0;
+	uint32_t row_pitch = 0;
+	uint32_t row_count = 0;	// Rows of blocks per slice
+	uint64_t row_size = 0;	// Bytes of data per row, without padding
+};
+
+struct TextureFormatInfo
+{
+	uint32_t bytes_per_block = 0;
+	uint32_t block_size = 1;	// 4 for block-compressed formats
+};
+
+bool GetTextureFormatInfo(uint32_t format, TextureFormatInfo& info);
+
+// Fills footprints[0, count) for subresources [first, first + count), placed
+// from base_offset on. Returns false for formats it doesn't know. total_bytes
+// (optional) gets what GetCopyableFootprints reports: the bytes needed from
+// base_offset on, without padding after the last row.
+bool ComputeTextureFootprints(
+	const TextureFootprintDesc& desc,
+	uint32_t first,
+	uint32_t count,
+	uint64_t base_offset,
+	SubresourceFootprint* footprints,
+	uint64_t* total_bytes);
+
+// Every mip of every array slice
+uint32_t GetSubresourceCount(const TextureFootprintDesc& desc);
+
+#endif // !TEXTURE_FOOTPRINT_H
@@ -0,0 +1,188 @@
+#include "TextureUploadBatch.h"
+#include "D3D12Footprints.h"
+#include "SubresourceCopy.h"
+#include "ThreadPool.h"
+#include "ThrowIfFailed.h"
+#include "DirectX12/d3dx12.h"
+#include <cassert>
+
+TextureUploadBatch::TextureUploadBatch(ID3D12Device* device, GpuHeapAllocator& allocator, ThreadPool& pool)
+	:
+	device_(device),
+	allocator_(allocator),
+	pool_(pool)
+{ }
+
+void TextureUploadBatch::Add(
+	ID3D12Resource* resource,
+	UINT first_subresource,
+	UINT count,
+	const D3D12_SUBRESOURCE_DATA* data,
+	D3D12_RESOURCE_STATES state_before,
+	D3D12_RESOURCE_STATES state_after)
+{
+	Texture texture;
+	texture.resource = resource;
+	texture.desc = resource->GetDesc();
+	texture.first_subresource = first_subresource;
+	texture.count = count;
+	texture.first_layout = static_cast<UINT>(layouts_.size());
+	texture.state_before = state_before;
+	texture.state_after = state_after;
+
+	layouts_.resize(layouts_.size() + count);
+	row_counts_.resize(row_counts_.size() + count);
+	row_sizes_.resize(row_sizes_.size() + count);
+	data_.insert(data_.end(), data, data + count);
+
+	// Every texture starts on a placement boundary after the previous one
+	const UINT64 base_offset = (staging_size_ + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~UINT64(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+	UINT64 total_bytes = 0;
+	if (!ComputeCopyableFootprints(
+		device_,
+		texture.desc,
+		first_subresource,
+		count,
+		base_offset,
+		&layouts_[texture.first_layout],
+		&row_counts_[texture.first_layout],
+		&row_sizes_[texture.first_layout],
+		&total_bytes))
+	{
+		// Leave the batch as it was, so the textures added so far still upload
+		layouts_.resize(texture.first_layout);
+		row_counts_.resize(texture.first_layout);
+		row_sizes_.resize(texture.first_layout);
+		data_.resize(texture.first_layout);
+		throw Window::Exception(__LINE__, __FILE__, "Invalid texture description or subresource range.");
+	}
+	staging_size_ = base_offset + total_bytes;
+
+	textures_.push_back(texture);
+}
+
+GpuAllocation TextureUploadBatch::Record(ID3D12GraphicsCommandList* command_list)
+{
+	if (textures_.empty())
+	{
+		return GpuAllocation{};
+	}
+
+	GpuAllocation staging = allocator_.CreateResource(
+		D3D12_HEAP_TYPE_UPLOAD,
+		CD3DX12_RESOURCE_DESC::Buffer(staging_size_),
+		D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Upload heaps are write-combined; the copies below never read them back
+	void* mapped = nullptr;
+	const D3D12_RANGE no_read{ 0, 0 };
+	ThrowIfFailed(staging.Get()->Map(0, &no_read, &mapped));
+
+	const auto fill = [&](UINT i, bool split_rows)
+	{
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts_[i];
+		SubresourceCopy copy;
+		copy.dest = static_cast<BYTE*>(mapped) + layout.Offset;
+		copy.dest_row_pitch = layout.Footprint.RowPitch;
+		copy.dest_slice_pitch = UINT64(layout.Footprint.RowPitch) * row_counts_[i];
+		copy.src = data_[i].pData;
+		copy.src_row_pitch = data_[i].RowPitch;
+		copy.src_slice_pitch = data_[i].SlicePitch;
+		copy.row_size = static_cast<size_t>(row_sizes_[i]);
+		copy.row_count = row_counts_[i];
+		copy.slice_count = layout.Footprint.Depth;
+		if (split_rows)
+		{
+			CopySubresourceParallel(copy, pool_);
+		}
+		else
+		{
+			CopySubresource(copy);
+		}
+	};
+
+	// Plenty of subresources: one per task. Just a few: let each one spread its
+	// rows over the pool instead, so a single big texture still goes wide.
+	const UINT subresource_count = static_cast<UINT>(layouts_.size());
+	if (subresource_count >= pool_.GetThreadCount())
+	{
+		pool_.ParallelFor(subresource_count, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				fill(i, false);
+			}
+		});
+	}
+	else
+	{
+		for (UINT i = 0; i < subresource_count; ++i)
+		{
+			fill(i, true);
+		}
+	}
+
+	staging.Get()->Unmap(0, nullptr);
+
+	barriers_.clear();
+	for (const Texture& texture : textures_)
+	{
+		if (texture.state_before != D3D12_RESOURCE_STATE_COPY_DEST)
+		{
+			barriers_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(texture.resource, texture.state_before, D3D12_RESOURCE_STATE_COPY_DEST));
+		}
+	}
+	if (!barriers_.empty())
+	{
+		command_list->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+	}
+
+	for (const Texture& texture : textures_)
+	{
+		if (texture.desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts_[texture.first_layout];
+			command_list->CopyBufferRegion(texture.resource, 0, staging.Get(), layout.Offset, layout.Footprint.Width);
+			continue;
+		}
+
+		for (UINT i = 0; i < texture.count; ++i)
+		{
+			const CD3DX12_TEXTURE_COPY_LOCATION dest(texture.resource, texture.first_subresource + i);
+			const CD3DX12_TEXTURE_COPY_LOCATION src(staging.Get(), layouts_[texture.first_layout + i]);
+			command_list->CopyTextureRegion(&dest, 0, 0, 0, &src, nullptr);
+		}
+	}
+
+	barriers_.clear();
+	for (const Texture& texture : textures_)
+	{
+		if (texture.state_after != D3D12_RESOURCE_STATE_COPY_DEST)
+		{
+			barriers_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(texture.resource, D3D12_RESOURCE_STATE_COPY_DEST, texture.state_after));
+		}
+	}
+	if (!barriers_.empty())
+	{
+		command_list->ResourceBarrier(static_cast<UINT>(barriers_.size()), barriers_.data());
+	}
+
+	textures_.clear();
+	layouts_.clear();
+	row_counts_.clear();
+	row_sizes_.clear();
+	data_.clear();
+	staging_size_ = 0;
+
+	return staging;
+}
+
+bool TextureUploadBatch::IsEmpty() const
+{
+	return textures_.empty();
+}
+
+UINT64 TextureUploadBatch::GetStagingSize() const
+{
+	return staging_size_;
+}
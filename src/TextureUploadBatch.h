@@ -0,0 +1,70 @@
+#ifndef TEXTURE_UPLOAD_BATCH_H
+#define TEXTURE_UPLOAD_BATCH_H
+
+#include "LeanWin32.h"
+#include "GpuHeapAllocator.h"
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+class ThreadPool;
+
+// Uploads many textures (whole mip chains, arrays) in one go, instead of one
+// UpdateSubresources call per texture:
+//  - footprints for every subresource are planned up front, on the CPU, into
+//    a single staging buffer
+//  - the staging buffer is filled by the ThreadPool with streaming stores
+//  - the command list gets one barrier batch into COPY_DEST, all copies, and
+//    one barrier batch into the final states
+// The D3D12_SUBRESOURCE_DATA pointers must stay valid until Record() returns,
+// and a resource may only be added once per batch.
+class TextureUploadBatch
+{
+public:
+	TextureUploadBatch(ID3D12Device* device, GpuHeapAllocator& allocator, ThreadPool& pool);
+	TextureUploadBatch(const TextureUploadBatch&) = delete;
+	TextureUploadBatch& operator=(const TextureUploadBatch&) = delete;
+
+	// Subresources [first_subresource, first_subresource + count) of 'resource'.
+	// Throws if their footprints can't be computed; the batch is left unchanged.
+	void Add(
+		ID3D12Resource* resource,
+		UINT first_subresource,
+		UINT count,
+		const D3D12_SUBRESOURCE_DATA* data,
+		D3D12_RESOURCE_STATES state_before,
+		D3D12_RESOURCE_STATES state_after);
+
+	// Returns the staging buffer, which has to stay alive until the command
+	// list has executed (e.g. Graphics::DeferRelease). Empties the batch.
+	GpuAllocation Record(ID3D12GraphicsCommandList* command_list);
+
+	bool IsEmpty() const;
+	UINT64 GetStagingSize() const;	// Of the batch as it stands
+private:
+	struct Texture
+	{
+		ID3D12Resource* resource;
+		D3D12_RESOURCE_DESC desc;
+		UINT first_subresource;
+		UINT count;
+		UINT first_layout;	// Into layouts_ and data_
+		D3D12_RESOURCE_STATES state_before;
+		D3D12_RESOURCE_STATES state_after;
+	};
+private:
+	ID3D12Device* device_;
+	GpuHeapAllocator& allocator_;
+	ThreadPool& pool_;
+	std::vector<Texture> textures_;
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts_;
+	std::vector<UINT> row_counts_;
+	std::vector<UINT64> row_sizes_;
+	std::vector<D3D12_SUBRESOURCE_DATA> data_;
+	UINT64 staging_size_ = 0;
+	std::vector<D3D12_RESOURCE_BARRIER> barriers_;
+};
+
+#endif // !TEXTURE_UPLOAD_BATCH_H
@@ -0,0 +1,151 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	thread_local bool t_inside_loop = false;
+}
+
+ThreadPool::ThreadPool(uint32_t worker_count)
+{
+	workers_.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; ++i)
+	{
+		workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	work_ready_.notify_all();
+	for (std::thread& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t grain, const RangeFunction& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grain = std::max(grain, 1u);
+	const uint32_t chunk_count = (count + grain - 1) / grain;
+	if (workers_.empty() || chunk_count == 1 || t_inside_loop)
+	{
+		body(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		body_ = &body;
+		count_ = count;
+		grain_ = grain;
+		chunk_count_ = chunk_count;
+		next_chunk_.store(0, std::memory_order_relaxed);
+		done_chunks_.store(0, std::memory_order_relaxed);
+		++generation_;
+	}
+	work_ready_.notify_all();
+
+	RunChunks();
+
+	// Workers still inside RunChunks() hold a pointer to 'body', even when
+	// the loop was cut short by an exception
+	std::unique_lock<std::mutex> lock(mutex_);
+	work_done_.wait(lock, [this]()
+	{
+		return (done_chunks_.load(std::memory_order_acquire) == chunk_count_ || error_) && active_workers_ == 0;
+	});
+	body_ = nullptr;
+
+	if (error_)
+	{
+		std::exception_ptr error = std::move(error_);
+		error_ = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+uint32_t ThreadPool::GetThreadCount() const
+{
+	return static_cast<uint32_t>(workers_.size()) + 1;
+}
+
+uint32_t ThreadPool::DefaultWorkerCount()
+{
+	// One core stays with the thread issuing the loops
+	const uint32_t cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint64_t seen_generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_ready_.wait(lock, [this, seen_generation]()
+			{
+				return stopping_ || (generation_ != seen_generation && body_ != nullptr);
+			});
+			if (stopping_)
+			{
+				return;
+			}
+			seen_generation = generation_;
+			++active_workers_;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--active_workers_;
+		}
+		work_done_.notify_all();
+	}
+}
+
+void ThreadPool::RunChunks()
+{
+	t_inside_loop = true;
+	for (;;)
+	{
+		const uint32_t chunk = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= chunk_count_)
+		{
+			break;
+		}
+
+		const uint32_t begin = chunk * grain_;
+		const uint32_t end = std::min(begin + grain_, count_);
+		try
+		{
+			(*body_)(begin, end);
+		}
+		catch (...)
+		{
+			// Hand out no more chunks; ParallelFor() rethrows once the others finish
+			next_chunk_.store(chunk_count_, std::memory_order_relaxed);
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!error_)
+			{
+				error_ = std::current_exception();
+			}
+			break;
+		}
+
+		done_chunks_.fetch_add(1, std::memory_order_release);
+	}
+	t_inside_loop = false;
+}
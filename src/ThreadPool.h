@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. ParallelFor() splits
+// [0, count) into chunks of 'grain' items, the calling thread works on chunks
+// too, and the call returns once every chunk is done. One loop runs at a time;
+// a ParallelFor() issued from inside a loop body runs inline.
+//
+// If the body throws, on any thread, no further chunks are started, and once
+// the chunks already running have finished the first exception is rethrown
+// from ParallelFor().
+class ThreadPool
+{
+public:
+	using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+public:
+	// worker_count excludes the calling thread; 0 makes ParallelFor() run inline
+	ThreadPool(uint32_t worker_count = DefaultWorkerCount());
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	void ParallelFor(uint32_t count, uint32_t grain, const RangeFunction& body);
+
+	// Threads a loop can run on, caller included
+	uint32_t GetThreadCount() const;
+
+	static uint32_t DefaultWorkerCount();
+private:
+	void WorkerLoop();
+	// Runs chunks of the current loop until none are left
+	void RunChunks();
+private:
+	std::vector<std::thread> workers_;
+
+	std::mutex submit_mutex_;	// Serializes ParallelFor() callers
+	std::mutex mutex_;
+	std::condition_variable work_ready_;
+	std::condition_variable work_done_;
+	uint64_t generation_ = 0;	// Bumped for every loop, wakes the workers
+	bool stopping_ = false;
+
+	// Current loop
+	const RangeFunction* body_ = nullptr;
+	uint32_t count_ = 0;
+	uint32_t grain_ = 1;
+	uint32_t chunk_count_ = 0;
+	std::atomic<uint32_t> next_chunk_{ 0 };
+	std::atomic<uint32_t> done_chunks_{ 0 };
+	uint32_t active_workers_ = 0;
+	std::exception_ptr error_;	// First exception thrown by the body
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,16 @@
+#ifndef THROW_IF_FAILED_H
+#define THROW_IF_FAILED_H
+
+#include "Window.h"
+
+// HRESULT check for the D3D12 helper classes that live outside of Graphics.
+// Only include this from .cpp files, since Window.h pulls in Graphics.h.
+inline void ThrowIfFailed(HRESULT hr)
+{
+	if (FAILED(hr))
+	{
+		throw Window::Exception(__LINE__, __FILE__, hr);
+	}
+}
+
+#endif // !THROW_IF_FAILED_H
@@ -0,0 +1,333 @@
+#include "TlsfAllocator.h"
+#include <bit>
+#include <cassert>
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+	:
+	capacity_(capacity & ~(granularity - 1)),
+	granularity_(granularity),
+	granularity_log2_(static_cast<uint32_t>(std::countr_zero(granularity)))
+{
+	assert(std::has_single_bit(granularity) && "Granularity must be a power of two.");
+	assert(capacity_ > 0 && "Capacity must hold at least one granule.");
+	Reset();
+}
+
+std::optional<TlsfAllocator::Allocation> TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > capacity_)
+	{
+		return std::nullopt;
+	}
+
+	alignment = alignment < granularity_ ? granularity_ : alignment;
+	assert(std::has_single_bit(alignment) && "Alignment must be a power of two.");
+
+	const uint64_t units = (size + granularity_ - 1) >> granularity_log2_;
+	const uint64_t padding_units = (alignment >> granularity_log2_) - 1;
+
+	// Ask for enough room to align the start inside whatever block comes back.
+	// If that fails, a block of the exact size may still happen to be aligned
+	// (the common case being an empty range starting at offset 0).
+	uint32_t block = FindFreeBlock(units + padding_units);
+	if (block == kInvalidBlock && padding_units > 0)
+	{
+		block = FindFreeBlock(units);
+		if (block != kInvalidBlock && (blocks_[block].offset & (alignment - 1)) != 0)
+		{
+			block = kInvalidBlock;
+		}
+	}
+	if (block == kInvalidBlock)
+	{
+		return std::nullopt;
+	}
+
+	RemoveFreeBlock(block);
+
+	// Give the unaligned front of the block back to the free lists. The
+	// physical neighbour before a free block is never free, so nothing merges.
+	const uint64_t aligned_offset = (blocks_[block].offset + alignment - 1) & ~(alignment - 1);
+	const uint64_t front = aligned_offset - blocks_[block].offset;
+	if (front > 0)
+	{
+		const uint32_t remainder = SplitBlock(block, front);
+		InsertFreeBlock(block);
+		block = remainder;
+	}
+
+	const uint64_t bytes = units << granularity_log2_;
+	if (blocks_[block].size > bytes)
+	{
+		InsertFreeBlock(SplitBlock(block, bytes));
+	}
+
+	blocks_[block].is_free = false;
+	used_bytes_ += bytes;
+	++allocation_count_;
+
+	return Allocation{ blocks_[block].offset, bytes, block };
+}
+
+void TlsfAllocator::Free(const Allocation& allocation)
+{
+	uint32_t block = allocation.block;
+	assert(block < blocks_.size() && !blocks_[block].is_free && "Freeing an invalid allocation.");
+
+	used_bytes_ -= blocks_[block].size;
+	--allocation_count_;
+
+	// Coalesce with free physical neighbours
+	const uint32_t prev = blocks_[block].prev_physical;
+	if (prev != kInvalidBlock && blocks_[prev].is_free)
+	{
+		RemoveFreeBlock(prev);
+		blocks_[prev].size += blocks_[block].size;
+		blocks_[prev].next_physical = blocks_[block].next_physical;
+		if (blocks_[block].next_physical != kInvalidBlock)
+		{
+			blocks_[blocks_[block].next_physical].prev_physical = prev;
+		}
+		ReleaseBlock(block);
+		block = prev;
+	}
+
+	const uint32_t next = blocks_[block].next_physical;
+	if (next != kInvalidBlock && blocks_[next].is_free)
+	{
+		RemoveFreeBlock(next);
+		blocks_[block].size += blocks_[next].size;
+		blocks_[block].next_physical = blocks_[next].next_physical;
+		if (blocks_[next].next_physical != kInvalidBlock)
+		{
+			blocks_[blocks_[next].next_physical].prev_physical = block;
+		}
+		ReleaseBlock(next);
+	}
+
+	InsertFreeBlock(block);
+}
+
+void TlsfAllocator::Reset()
+{
+	blocks_.clear();
+	unused_blocks_.clear();
+	used_bytes_ = 0;
+	allocation_count_ = 0;
+	first_level_bitmap_ = 0;
+	for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+	{
+		second_level_bitmap_[fl] = 0;
+		for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+		{
+			free_heads_[fl][sl] = kInvalidBlock;
+		}
+	}
+
+	const uint32_t block = NewBlock();
+	blocks_[block].offset = 0;
+	blocks_[block].size = capacity_;
+	InsertFreeBlock(block);
+}
+
+TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const
+{
+	Statistics stats;
+	stats.capacity = capacity_;
+	stats.used_bytes = used_bytes_;
+	stats.free_bytes = capacity_ - used_bytes_;
+	stats.allocation_count = allocation_count_;
+
+	for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+	{
+		for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+		{
+			for (uint32_t block = free_heads_[fl][sl]; block != kInvalidBlock; block = blocks_[block].next_free)
+			{
+				++stats.free_block_count;
+				if (blocks_[block].size > stats.largest_free_block)
+				{
+					stats.largest_free_block = blocks_[block].size;
+				}
+			}
+		}
+	}
+
+	if (stats.free_bytes > 0)
+	{
+		stats.fragmentation = 1.0f - static_cast<float>(
+			static_cast<double>(stats.largest_free_block) / static_cast<double>(stats.free_bytes));
+	}
+
+	return stats;
+}
+
+uint64_t TlsfAllocator::GetCapacity() const
+{
+	return capacity_;
+}
+
+uint64_t TlsfAllocator::GetGranularity() const
+{
+	return granularity_;
+}
+
+bool TlsfAllocator::IsEmpty() const
+{
+	return allocation_count_ == 0;
+}
+
+void TlsfAllocator::MapSize(uint64_t units, uint32_t& fl, uint32_t& sl) const
+{
+	// Sizes below kSecondLevelCount granules map linearly into the first row,
+	// everything else gets its power of two subdivided into kSecondLevelCount
+	if (units < kSecondLevelCount)
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>(units);
+	}
+	else
+	{
+		const uint32_t msb = static_cast<uint32_t>(std::bit_width(units)) - 1;
+		fl = msb - kSecondLevelLog2 + 1;
+		sl = static_cast<uint32_t>(units >> (msb - kSecondLevelLog2)) & (kSecondLevelCount - 1);
+	}
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t units) const
+{
+	if ((units << granularity_log2_) > capacity_)
+	{
+		return kInvalidBlock;
+	}
+
+	// Round up to the next list boundary so that any block in the found list
+	// is large enough (good fit rather than exhaustive best fit)
+	if (units >= kSecondLevelCount)
+	{
+		const uint32_t msb = static_cast<uint32_t>(std::bit_width(units)) - 1;
+		units += (uint64_t(1) << (msb - kSecondLevelLog2)) - 1;
+	}
+
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	MapSize(units, fl, sl);
+	if (fl >= kFirstLevelCount)
+	{
+		return kInvalidBlock;
+	}
+
+	uint32_t sl_map = second_level_bitmap_[fl] & (~0u << sl);
+	if (sl_map == 0)
+	{
+		const uint64_t fl_map = fl + 1 < kFirstLevelCount ? first_level_bitmap_ & (~uint64_t(0) << (fl + 1)) : 0;
+		if (fl_map == 0)
+		{
+			return kInvalidBlock;
+		}
+		fl = static_cast<uint32_t>(std::countr_zero(fl_map));
+		sl_map = second_level_bitmap_[fl];
+	}
+	sl = static_cast<uint32_t>(std::countr_zero(sl_map));
+
+	return free_heads_[fl][sl];
+}
+
+void TlsfAllocator::InsertFreeBlock(uint32_t block)
+{
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	MapSize(blocks_[block].size >> granularity_log2_, fl, sl);
+
+	Block& b = blocks_[block];
+	b.is_free = true;
+	b.prev_free = kInvalidBlock;
+	b.next_free = free_heads_[fl][sl];
+	if (b.next_free != kInvalidBlock)
+	{
+		blocks_[b.next_free].prev_free = block;
+	}
+	free_heads_[fl][sl] = block;
+
+	first_level_bitmap_ |= uint64_t(1) << fl;
+	second_level_bitmap_[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFreeBlock(uint32_t block)
+{
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	MapSize(blocks_[block].size >> granularity_log2_, fl, sl);
+
+	Block& b = blocks_[block];
+	if (b.prev_free != kInvalidBlock)
+	{
+		blocks_[b.prev_free].next_free = b.next_free;
+	}
+	else
+	{
+		free_heads_[fl][sl] = b.next_free;
+		if (b.next_free == kInvalidBlock)
+		{
+			second_level_bitmap_[fl] &= ~(1u << sl);
+			if (second_level_bitmap_[fl] == 0)
+			{
+				first_level_bitmap_ &= ~(uint64_t(1) << fl);
+			}
+		}
+	}
+	if (b.next_free != kInvalidBlock)
+	{
+		blocks_[b.next_free].prev_free = b.prev_free;
+	}
+
+	b.is_free = false;
+	b.prev_free = kInvalidBlock;
+	b.next_free = kInvalidBlock;
+}
+
+uint32_t TlsfAllocator::SplitBlock(uint32_t block, uint64_t size)
+{
+	// Keeps the first 'size' bytes in 'block' and returns the remainder
+	// as a new, not yet listed block
+	const uint32_t remainder = NewBlock();
+	Block& b = blocks_[block];
+	Block& r = blocks_[remainder];
+
+	r.offset = b.offset + size;
+	r.size = b.size - size;
+	r.prev_physical = block;
+	r.next_physical = b.next_physical;
+	if (r.next_physical != kInvalidBlock)
+	{
+		blocks_[r.next_physical].prev_physical = remainder;
+	}
+
+	b.size = size;
+	b.next_physical = remainder;
+
+	return remainder;
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+	uint32_t block;
+	if (!unused_blocks_.empty())
+	{
+		block = unused_blocks_.back();
+		unused_blocks_.pop_back();
+		blocks_[block] = Block{};
+	}
+	else
+	{
+		block = static_cast<uint32_t>(blocks_.size());
+		blocks_.emplace_back();
+	}
+	return block;
+}
+
+void TlsfAllocator::ReleaseBlock(uint32_t block)
+{
+	blocks_[block] = Block{};
+	unused_blocks_.push_back(block);
+}
@@ -0,0 +1,90 @@
+#ifndef TLSF_ALLOCATOR_H
+#define TLSF_ALLOCATOR_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Two-level segregated-fit (TLSF) range allocator. It only does the bookkeeping
+// of offsets inside a [0, capacity) range, so it knows nothing about D3D12 and
+// can be used for heaps, descriptor ranges or anything else that is linear.
+// Both Allocate() and Free() are O(1). Block nodes are recycled from a pool,
+// so steady-state churn does not touch the system allocator.
+class TlsfAllocator
+{
+public:
+	static constexpr uint32_t kInvalidBlock = UINT32_MAX;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t block = kInvalidBlock;	// Handle to pass back to Free()
+	};
+
+	struct Statistics
+	{
+		uint64_t capacity = 0;
+		uint64_t used_bytes = 0;
+		uint64_t free_bytes = 0;
+		uint64_t largest_free_block = 0;
+		uint32_t allocation_count = 0;
+		uint32_t free_block_count = 0;
+		// 0 when all free memory is one block, approaching 1 when it is
+		// scattered over many small blocks
+		float fragmentation = 0.0f;
+	};
+public:
+	// granularity must be a power of two; every offset and size handed out is a
+	// multiple of it
+	TlsfAllocator(uint64_t capacity, uint64_t granularity);
+
+	std::optional<Allocation> Allocate(uint64_t size, uint64_t alignment);
+	void Free(const Allocation& allocation);
+	void Reset();
+
+	Statistics GetStatistics() const;
+	uint64_t GetCapacity() const;
+	uint64_t GetGranularity() const;
+	bool IsEmpty() const;
+private:
+	struct Block
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t prev_physical = kInvalidBlock;
+		uint32_t next_physical = kInvalidBlock;
+		uint32_t prev_free = kInvalidBlock;
+		uint32_t next_free = kInvalidBlock;
+		bool is_free = false;
+	};
+private:
+	void MapSize(uint64_t units, uint32_t& fl, uint32_t& sl) const;
+	uint32_t FindFreeBlock(uint64_t units) const;
+	void InsertFreeBlock(uint32_t block);
+	void RemoveFreeBlock(uint32_t block);
+	uint32_t SplitBlock(uint32_t block, uint64_t size);
+	uint32_t NewBlock();
+	void ReleaseBlock(uint32_t block);
+private:
+	// 2^5 = 32 second-level lists per power of two keeps the worst-case
+	// internal fragmentation from rounding below ~3%
+	static constexpr uint32_t kSecondLevelLog2 = 5;
+	static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+	static constexpr uint32_t kFirstLevelCount = 64 - kSecondLevelLog2 + 1;
+
+	uint64_t capacity_;
+	uint64_t granularity_;
+	uint32_t granularity_log2_;
+	uint64_t used_bytes_ = 0;
+	uint32_t allocation_count_ = 0;
+
+	uint64_t first_level_bitmap_ = 0;
+	uint32_t second_level_bitmap_[kFirstLevelCount] = {};
+	uint32_t free_heads_[kFirstLevelCount][kSecondLevelCount];
+
+	std::vector<Block> blocks_;
+	std::vector<uint32_t> unused_blocks_;
+};
+
+#endif // !TLSF_ALLOCATOR_H
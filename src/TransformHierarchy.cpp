@@ -0,0 +1,437 @@
+#include "TransformHierarchy.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <tuple>
+
+namespace
+{
+	// Target nodes per parallel range; subtrees bigger than this are split
+	// below their root. Also the most appended nodes kept out of order.
+	constexpr uint32_t kRangeNodes = 16 * 1024;
+
+	// Applies the same permutation to several arrays by walking its cycles, so
+	// a rebuild doesn't allocate (and page in) a second copy of everything.
+	// Element i takes the value at order[i]; order is left as the identity.
+	template<typename... Arrays>
+	void PermuteInPlace(std::vector<uint32_t>& order, Arrays&... arrays)
+	{
+		for (uint32_t start = 0; start < order.size(); ++start)
+		{
+			if (order[start] == start)
+			{
+				continue;
+			}
+			const std::tuple<typename Arrays::value_type...> saved(arrays[start]...);
+			for (uint32_t i = start;;)
+			{
+				const uint32_t source = order[i];
+				order[i] = i;
+				if (source == start)
+				{
+					std::tie(arrays[i]...) = saved;
+					break;
+				}
+				((arrays[i] = arrays[source]), ...);
+				i = source;
+			}
+		}
+	}
+}
+
+TransformHierarchy::Handle TransformHierarchy::Create(Handle parent, const LocalTransform& local)
+{
+	assert((parent.IsNull() || IsValid(parent)) && "Creating a node under a stale parent.");
+
+	uint32_t slot;
+	if (!free_slots_.empty())
+	{
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(slots_.size());
+		slots_.emplace_back();
+	}
+
+	// Appended after its parent, so the linear pass stays valid
+	const uint32_t index = static_cast<uint32_t>(node_slots_.size());
+	slots_[slot].index = index;
+	slots_[slot].parent_slot = parent.slot;
+
+	positions_.push_back(local.position);
+	rotations_.push_back(local.rotation);
+	scales_.push_back(local.scale);
+	world_.emplace_back();
+	parents_.push_back(parent.IsNull() ? kNoParent : slots_[parent.slot].index);
+	subtree_ends_.push_back(index + 1);
+	node_slots_.push_back(slot);
+	flags_.push_back(kLocalDirty);
+	return { slot, slots_[slot].generation };
+}
+
+void TransformHierarchy::Destroy(Handle node)
+{
+	assert(IsValid(node) && "Destroying a stale node.");
+
+	// Appended descendants are found through parents_, which reparenting
+	// leaves stale until the rebuild
+	if (order_dirty_)
+	{
+		RebuildOrder();
+	}
+
+	const auto kill = [&](uint32_t index)
+	{
+		Slot& slot = slots_[node_slots_[index]];
+		slot.index = kNoParent;
+		slot.parent_slot = kNoParent;
+		++slot.generation;
+		free_slots_.push_back(node_slots_[index]);
+		flags_[index] = kDead;
+		++dead_count_;
+	};
+
+	// Ordered descendants are the node's subtree range, appended ones come
+	// after their parents
+	const uint32_t index = slots_[node.slot].index;
+	const uint32_t end = index < ordered_count_ ? subtree_ends_[index] : index + 1;
+	for (uint32_t i = index; i < end; ++i)
+	{
+		if (!(flags_[i] & kDead))
+		{
+			kill(i);
+		}
+	}
+	const uint32_t count = static_cast<uint32_t>(node_slots_.size());
+	for (uint32_t i = std::max(end, ordered_count_); i < count; ++i)
+	{
+		if (!(flags_[i] & kDead) && parents_[i] != kNoParent && (flags_[parents_[i]] & kDead))
+		{
+			kill(i);
+		}
+	}
+}
+
+void TransformHierarchy::SetParent(Handle node, Handle parent)
+{
+	assert(IsValid(node) && (parent.IsNull() || IsValid(parent)) && "Reparenting a stale node.");
+#ifndef NDEBUG
+	for (uint32_t ancestor = parent.slot; ancestor != kNoParent; ancestor = slots_[ancestor].parent_slot)
+	{
+		assert(ancestor != node.slot && "Parenting a node under itself.");
+	}
+#endif
+
+	slots_[node.slot].parent_slot = parent.slot;
+	flags_[slots_[node.slot].index] |= kLocalDirty;
+	order_dirty_ = true;
+}
+
+bool TransformHierarchy::IsValid(Handle node) const
+{
+	return node.slot < slots_.size() &&
+		slots_[node.slot].generation == node.generation &&
+		slots_[node.slot].index != kNoParent;
+}
+
+void TransformHierarchy::SetLocalTransform(Handle node, const LocalTransform& local)
+{
+	const uint32_t index = IndexOf(node);
+	positions_[index] = local.position;
+	rotations_[index] = local.rotation;
+	scales_[index] = local.scale;
+	flags_[index] |= kLocalDirty;
+}
+
+void TransformHierarchy::SetLocalPosition(Handle node, const Vec3& position)
+{
+	const uint32_t index = IndexOf(node);
+	positions_[index] = position;
+	flags_[index] |= kLocalDirty;
+}
+
+void TransformHierarchy::SetLocalRotation(Handle node, const Quat& rotation)
+{
+	const uint32_t index = IndexOf(node);
+	rotations_[index] = rotation;
+	flags_[index] |= kLocalDirty;
+}
+
+void TransformHierarchy::SetLocalScale(Handle node, const Vec3& scale)
+{
+	const uint32_t index = IndexOf(node);
+	scales_[index] = scale;
+	flags_[index] |= kLocalDirty;
+}
+
+LocalTransform TransformHierarchy::GetLocalTransform(Handle node) const
+{
+	const uint32_t index = IndexOf(node);
+	return { positions_[index], rotations_[index], scales_[index] };
+}
+
+TransformHierarchy::Handle TransformHierarchy::GetParent(Handle node) const
+{
+	assert(IsValid(node) && "Using a stale transform handle.");
+	const uint32_t parent = slots_[node.slot].parent_slot;
+	return parent == kNoParent ? Handle() : Handle{ parent, slots_[parent].generation };
+}
+
+const Mat4& TransformHierarchy::GetWorldMatrix(Handle node) const
+{
+	return world_[IndexOf(node)];
+}
+
+void TransformHierarchy::Update(ThreadPool* pool)
+{
+	uint32_t count = static_cast<uint32_t>(node_slots_.size());
+	if (order_dirty_ || count - ordered_count_ > kRangeNodes || dead_count_ > count / 4)
+	{
+		RebuildOrder();
+		count = ordered_count_;
+	}
+
+	if (!pool || pool->GetThreadCount() == 1 || count < 2 * kRangeNodes)
+	{
+		updated_count_ = UpdateRange(0, count);
+		return;
+	}
+
+	uint32_t updated = 0;
+	for (uint32_t index : serial_nodes_)
+	{
+		updated += UpdateNode(index);
+	}
+
+	std::atomic<uint32_t> range_updated{ 0 };
+	pool->ParallelFor(static_cast<uint32_t>(ranges_.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		uint32_t local_updated = 0;
+		for (uint32_t r = begin; r < end; ++r)
+		{
+			local_updated += UpdateRange(ranges_[r].begin, ranges_[r].end);
+		}
+		range_updated.fetch_add(local_updated, std::memory_order_relaxed);
+	});
+
+	// Appended nodes may hang off any of the above
+	updated += UpdateRange(ordered_count_, count);
+	updated_count_ = updated + range_updated.load(std::memory_order_relaxed);
+}
+
+void TransformHierarchy::Reserve(uint32_t node_count)
+{
+	slots_.reserve(node_count);
+	positions_.reserve(node_count);
+	rotations_.reserve(node_count);
+	scales_.reserve(node_count);
+	world_.reserve(node_count);
+	parents_.reserve(node_count);
+	subtree_ends_.reserve(node_count);
+	node_slots_.reserve(node_count);
+	flags_.reserve(node_count);
+}
+
+uint32_t TransformHierarchy::GetNodeCount() const
+{
+	return static_cast<uint32_t>(slots_.size() - free_slots_.size());
+}
+
+uint32_t TransformHierarchy::GetUpdatedCount() const
+{
+	return updated_count_;
+}
+
+uint32_t TransformHierarchy::IndexOf(Handle node) const
+{
+	assert(IsValid(node) && "Using a stale transform handle.");
+	return slots_[node.slot].index;
+}
+
+void TransformHierarchy::RebuildOrder()
+{
+	const uint32_t old_count = static_cast<uint32_t>(node_slots_.size());
+
+	// Children of each slot, kept in their current relative order
+	child_offsets_.assign(slots_.size() + 1, 0);
+	for (uint32_t i = 0; i < old_count; ++i)
+	{
+		const uint32_t parent = slots_[node_slots_[i]].parent_slot;
+		if (!(flags_[i] & kDead) && parent != kNoParent)
+		{
+			++child_offsets_[parent];
+		}
+	}
+	for (size_t s = 1; s < child_offsets_.size(); ++s)
+	{
+		child_offsets_[s] += child_offsets_[s - 1];
+	}
+	// Filled back to front, which leaves each offset at its first child
+	children_.resize(child_offsets_.back());
+	stack_.clear();
+	for (uint32_t i = old_count; i-- > 0;)
+	{
+		const uint32_t slot = node_slots_[i];
+		const uint32_t parent = slots_[slot].parent_slot;
+		if (flags_[i] & kDead)
+		{
+			continue;
+		}
+		if (parent != kNoParent)
+		{
+			children_[--child_offsets_[parent]] = slot;
+		}
+		else
+		{
+			stack_.push_back(slot);
+		}
+	}
+
+	// Depth-first walk; new_order_[new index] = old index
+	new_order_.clear();
+	while (!stack_.empty())
+	{
+		const uint32_t slot = stack_.back();
+		stack_.pop_back();
+		new_order_.push_back(slots_[slot].index);
+		// Pushed reversed so they come off the stack in order
+		for (uint32_t c = child_offsets_[slot + 1]; c-- > child_offsets_[slot];)
+		{
+			stack_.push_back(children_[c]);
+		}
+	}
+
+	// Dead nodes go last, to be cut off
+	const uint32_t count = static_cast<uint32_t>(new_order_.size());
+	for (uint32_t i = 0; i < old_count; ++i)
+	{
+		if (flags_[i] & kDead)
+		{
+			new_order_.push_back(i);
+		}
+	}
+	PermuteInPlace(new_order_, positions_, rotations_, scales_, world_, node_slots_, flags_);
+	positions_.resize(count);
+	rotations_.resize(count);
+	scales_.resize(count);
+	world_.resize(count);
+	node_slots_.resize(count);
+	flags_.resize(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		slots_[node_slots_[i]].index = i;
+	}
+	parents_.resize(count);
+	subtree_ends_.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t parent = slots_[node_slots_[i]].parent_slot;
+		parents_[i] = parent == kNoParent ? kNoParent : slots_[parent].index;
+		subtree_ends_[i] = i + 1;
+	}
+	// A subtree ends where its last descendant's does
+	for (uint32_t i = count; i-- > 0;)
+	{
+		if (parents_[i] != kNoParent)
+		{
+			subtree_ends_[parents_[i]] = std::max(subtree_ends_[parents_[i]], subtree_ends_[i]);
+		}
+	}
+
+	ordered_count_ = count;
+	dead_count_ = 0;
+	order_dirty_ = false;
+	BuildRanges();
+}
+
+void TransformHierarchy::BuildRanges()
+{
+	serial_nodes_.clear();
+	ranges_.clear();
+
+	// Each entry is a run of sibling subtrees
+	std::vector<Range> pending;
+	pending.push_back({ 0, ordered_count_ });
+	while (!pending.empty())
+	{
+		const Range run = pending.back();
+		pending.pop_back();
+
+		uint32_t range_begin = run.begin;
+		for (uint32_t i = run.begin; i < run.end;)
+		{
+			const uint32_t next = subtree_ends_[i];
+			if (next - i > kRangeNodes)
+			{
+				// Too big for one range: its root goes first on its own and its
+				// children become candidates
+				if (range_begin < i)
+				{
+					ranges_.push_back({ range_begin, i });
+				}
+				serial_nodes_.push_back(i);
+				pending.push_back({ i + 1, next });
+				range_begin = next;
+			}
+			else if (next - range_begin > kRangeNodes && range_begin < i)
+			{
+				ranges_.push_back({ range_begin, i });
+				range_begin = i;
+			}
+			i = next;
+		}
+		if (range_begin < run.end)
+		{
+			ranges_.push_back({ range_begin, run.end });
+		}
+	}
+
+	// Ascending is depth-first order, so ancestors stay ahead of descendants
+	std::sort(serial_nodes_.begin(), serial_nodes_.end());
+}
+
+uint32_t TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end)
+{
+	uint32_t updated = 0;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		updated += UpdateNode(i);
+	}
+	return updated;
+}
+
+bool TransformHierarchy::UpdateNode(uint32_t index)
+{
+	const uint8_t flags = flags_[index];
+	if (flags & kDead)
+	{
+		return false;
+	}
+	const uint32_t parent = parents_[index];
+	const bool dirty = (flags & kLocalDirty) || (parent != kNoParent && (flags_[parent] & kWorldDirty));
+	flags_[index] = dirty ? kWorldDirty : 0;
+	if (!dirty)
+	{
+		return false;
+	}
+
+	// ComposeTransform and the parent multiply, kept in registers
+	const Quat& q = rotations_[index];
+	const SimdFloat4 scale = SimdLoad(scales_[index]);
+	SimdFloat4 rows[4] = {
+		SimdMul(SimdSet(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y), 0.0f), SimdSplatLane<0>(scale)),
+		SimdMul(SimdSet(2.0f * (q.x * q.y - q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x), 0.0f), SimdSplatLane<1>(scale)),
+		SimdMul(SimdSet(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y), 0.0f), SimdSplatLane<2>(scale)),
+		SimdAdd(SimdLoad(positions_[index]), SimdSet(0.0f, 0.0f, 0.0f, 1.0f))
+	};
+	Mat4& world = world_[index];
+	for (int i = 0; i < 4; ++i)
+	{
+		SimdStore(&world.rows[i].x, parent == kNoParent ? rows[i] : SimdTransform(rows[i], world_[parent]));
+	}
+	return true;
+}
@@ -0,0 +1,135 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include "SimdMath.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Scene graph transforms stored as parallel arrays with every parent ahead of
+// its children, so Update() recomputes world matrices in one linear pass:
+// nodes whose local transform changed, and everything under them, are
+// rebuilt; static branches cost a flag check per node.
+//
+// The arrays are kept in depth-first order, where each subtree is one
+// contiguous range. With a pool, large subtrees are split into independent
+// ranges that update in parallel once their ancestors are done.
+//
+// Structural changes are cheap until the order has to be rebuilt (O(node
+// count), in place):
+//  - Create() appends; appended nodes update serially after the ranges, and
+//    the order is rebuilt once there are more than a range's worth
+//  - Destroy() marks the subtree dead; it is compacted away once a quarter
+//    of the nodes are dead
+//  - SetParent() rebuilds at the next Update()
+struct TransformHandle
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool IsNull() const { return slot == UINT32_MAX; }
+
+	bool operator==(const TransformHandle& rhs) const { return slot == rhs.slot && generation == rhs.generation; }
+	bool operator!=(const TransformHandle& rhs) const { return !(*this == rhs); }
+};
+
+struct LocalTransform
+{
+	Vec3 position;
+	Quat rotation;
+	Vec3 scale = Vec3(1.0f);
+};
+
+class TransformHierarchy
+{
+public:
+	using Handle = TransformHandle;
+public:
+	TransformHierarchy() = default;
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	// A null parent makes a root
+	Handle Create(Handle parent = {}, const LocalTransform& local = {});
+	// Destroys the node and everything under it
+	void Destroy(Handle node);
+	// Keeps the local transform, so the node moves with its new parent. The
+	// parent can't be the node or one of its descendants.
+	void SetParent(Handle node, Handle parent);
+	bool IsValid(Handle node) const;
+
+	void SetLocalTransform(Handle node, const LocalTransform& local);
+	void SetLocalPosition(Handle node, const Vec3& position);
+	void SetLocalRotation(Handle node, const Quat& rotation);
+	void SetLocalScale(Handle node, const Vec3& scale);
+	LocalTransform GetLocalTransform(Handle node) const;
+	Handle GetParent(Handle node) const;
+
+	// As of the last Update()
+	const Mat4& GetWorldMatrix(Handle node) const;
+
+	void Update(ThreadPool* pool = nullptr);
+
+	void Reserve(uint32_t node_count);
+	uint32_t GetNodeCount() const;
+	// Nodes whose world matrix the last Update() recomputed
+	uint32_t GetUpdatedCount() const;
+private:
+	static constexpr uint32_t kNoParent = UINT32_MAX;
+
+	// Per-node flags
+	static constexpr uint8_t kLocalDirty = 1;
+	static constexpr uint8_t kWorldDirty = 2;	// Recomputed this update; read by children
+	static constexpr uint8_t kDead = 4;
+
+	// Slots are stable, array positions are not
+	struct Slot
+	{
+		uint32_t index = kNoParent;
+		uint32_t generation = 0;
+		uint32_t parent_slot = kNoParent;
+	};
+
+	// Contiguous run of sibling subtrees whose parent is already up to date
+	struct Range
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+private:
+	uint32_t IndexOf(Handle node) const;
+	void RebuildOrder();
+	void BuildRanges();
+	uint32_t UpdateRange(uint32_t begin, uint32_t end);
+	// True if the world matrix was recomputed
+	bool UpdateNode(uint32_t index);
+private:
+	std::vector<Slot> slots_;
+	std::vector<uint32_t> free_slots_;
+
+	// Per node; depth-first up to ordered_count_, appended after it
+	std::vector<Vec3> positions_;
+	std::vector<Quat> rotations_;
+	std::vector<Vec3> scales_;
+	std::vector<Mat4> world_;
+	std::vector<uint32_t> parents_;
+	std::vector<uint32_t> subtree_ends_;	// One past the last descendant
+	std::vector<uint32_t> node_slots_;
+	std::vector<uint8_t> flags_;
+	uint32_t ordered_count_ = 0;
+	uint32_t dead_count_ = 0;
+	bool order_dirty_ = false;
+
+	std::vector<uint32_t> serial_nodes_;	// Ancestors of the ranges, updated first
+	std::vector<Range> ranges_;
+	uint32_t updated_count_ = 0;
+
+	// Rebuild scratch, kept to avoid reallocating it every time
+	std::vector<uint32_t> child_offsets_;
+	std::vector<uint32_t> children_;
+	std::vector<uint32_t> new_order_;
+	std::vector<uint32_t> stack_;
+};
+
+#endif // !TRANSFORM_HIERARCHY_H
@@ -14,18 +14,19 @@ Window::Window(int width, int height, const wchar_t* title)
 	CreateWindowClass(wc);
 	RegisterClassEx(&wc);
 
+	// width and height are the client area; grow the window to fit its frame
 	RECT wr;
 	wr.left = 350;
-	wr.right = wr.left + Graphics::kScreenWidth;
+	wr.right = wr.left + width_;
 	wr.top = 100;
-	wr.bottom = wr.top + Graphics::kScreenHeight;
+	wr.bottom = wr.top + height_;
 
-	AdjustWindowRect(&wr, WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU, FALSE);
+	AdjustWindowRect(&wr, WS_OVERLAPPEDWINDOW, FALSE);
 
 	// Create window
 	handle_ = CreateWindow(kWindowClassName_, title,
-		WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU,
-		CW_USEDEFAULT, CW_USEDEFAULT, width_, height_,
+		WS_OVERLAPPEDWINDOW,
+		CW_USEDEFAULT, CW_USEDEFAULT, wr.right - wr.left, wr.bottom - wr.top,
 		nullptr, nullptr, instance_, this);
 
 	// Check that handle_ is valid
@@ -70,6 +71,22 @@ bool Window::ProcessMessage()
 	return true;
 }
 
+std::optional<std::pair<int, int>> Window::ConsumeResize()
+{
+	if (!resize_pending_ || in_size_move_ || is_minimized_)
+	{
+		return std::nullopt;
+	}
+
+	resize_pending_ = false;
+	return std::make_pair(width_, height_);
+}
+
+bool Window::IsMinimized() const
+{
+	return is_minimized_;
+}
+
 void Window::SetTitle(const wchar_t& title)
 {
 	SetWindowText(handle_, &title);
@@ -105,6 +122,35 @@ LRESULT Window::WindowProcedure(HWND handle, UINT message, WPARAM wparam, LPARAM
 			return 0;
 		} break;
 
+		// Resizing. Dragging the border sends a stream of WM_SIZE between
+		// WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE; only the final size is reported
+		// (see ConsumeResize). Maximize and restore arrive as a single WM_SIZE.
+		case WM_SIZE:
+		{
+			is_minimized_ = wparam == SIZE_MINIMIZED;
+			if (!is_minimized_)
+			{
+				const int width = LOWORD(lparam);
+				const int height = HIWORD(lparam);
+				if (width != width_ || height != height_)
+				{
+					width_ = width;
+					height_ = height;
+					resize_pending_ = true;
+				}
+			}
+		} break;
+
+		case WM_ENTERSIZEMOVE:
+		{
+			in_size_move_ = true;
+		} break;
+
+		case WM_EXITSIZEMOVE:
+		{
+			in_size_move_ = false;
+		} break;
+
 		// Handle what happens when window goes out of focus
 		case WM_KILLFOCUS:
 		{
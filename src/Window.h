@@ -9,6 +9,8 @@
 #include "Graphics.h"
 #include <string>
 #include <memory>
+#include <optional>
+#include <utility>
 
 // Used to grant Graphics class access to handle to the Win32 window
 class HandleKey
@@ -49,6 +51,10 @@ public:
 	~Window();
 
 	bool ProcessMessage();
+	// New client size once a resize has settled, at most once per size;
+	// sizes seen while the user is still dragging the border are skipped
+	std::optional<std::pair<int, int>> ConsumeResize();
+	bool IsMinimized() const;
 
 	// Helper functions
 	void SetTitle(const wchar_t& title);
@@ -68,6 +74,9 @@ private:
 	static constexpr const wchar_t* kWindowClassName_ = L"My Window Class";
 	int width_;
 	int height_;
+	bool in_size_move_ = false;	// Between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE
+	bool resize_pending_ = false;
+	bool is_minimized_ = false;
 };
 
 #endif // !WINDOW_H
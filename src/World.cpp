@@ -0,0 +1,407 @@
+#include "World.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	struct ComponentType
+	{
+		size_t size;
+		size_t alignment;
+	};
+
+	std::mutex& GetRegistryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	std::vector<ComponentType>& GetRegistry()
+	{
+		static std::vector<ComponentType> registry;
+		return registry;
+	}
+
+	ComponentType GetComponentType(ComponentId component)
+	{
+		std::lock_guard<std::mutex> lock(GetRegistryMutex());
+		return GetRegistry()[component];
+	}
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+ComponentId RegisterComponentType(size_t size, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(GetRegistryMutex());
+	std::vector<ComponentType>& registry = GetRegistry();
+	// Ids index 64-bit masks, so there is no way to carry on past the limit,
+	// in release builds either
+	if (registry.size() >= kMaxComponentTypes)
+	{
+		throw std::length_error("More than kMaxComponentTypes component types registered.");
+	}
+	registry.push_back({ size, alignment });
+	return static_cast<ComponentId>(registry.size() - 1);
+}
+
+World::World()
+{
+	// Entities without components
+	GetArchetype(0);
+}
+
+World::~World() = default;
+
+void World::Destroy(Entity entity)
+{
+	assert(IsAlive(entity) && "Destroying a stale entity.");
+	assert(!running_systems_ && "Destroying an entity while systems run.");
+
+	EntityRecord& record = entities_[entity.index];
+	FreeRow(record.archetype, record.chunk, record.row);
+	record.archetype = kNoArchetype;
+	++record.generation;
+	free_entities_.push_back(entity.index);
+	--entity_count_;
+}
+
+bool World::IsAlive(Entity entity) const
+{
+	return entity.index < entities_.size() &&
+		entities_[entity.index].generation == entity.generation &&
+		entities_[entity.index].archetype != kNoArchetype;
+}
+
+void World::ForEachChunk(ComponentMask required, const ChunkFunction& function)
+{
+	for (Archetype& archetype : archetypes_)
+	{
+		if ((archetype.mask & required) != required)
+		{
+			continue;
+		}
+		for (Chunk& chunk : archetype.chunks)
+		{
+			function(ChunkView(chunk.memory->bytes, chunk.count, archetype.offsets));
+		}
+	}
+}
+
+World::SystemId World::AddSystem(std::string name, ComponentMask required, ComponentMask reads, ComponentMask writes, ChunkFunction function)
+{
+	assert(!running_systems_ && "Adding a system while systems run.");
+	systems_.push_back({ std::move(name), required, reads, writes, std::move(function) });
+	schedule_dirty_ = true;
+	return static_cast<SystemId>(systems_.size() - 1);
+}
+
+void World::RunSystems(ThreadPool* pool)
+{
+	if (schedule_dirty_)
+	{
+		BuildSchedule();
+	}
+
+	running_systems_ = true;
+	for (size_t level_begin = 0; level_begin < system_order_.size();)
+	{
+		const uint32_t level = system_levels_[system_order_[level_begin]];
+		size_t level_end = level_begin;
+		work_items_.clear();
+		for (; level_end < system_order_.size() && system_levels_[system_order_[level_end]] == level; ++level_end)
+		{
+			const SystemId system = system_order_[level_end];
+			for (uint32_t a = 0; a < archetypes_.size(); ++a)
+			{
+				if ((archetypes_[a].mask & systems_[system].required) != systems_[system].required)
+				{
+					continue;
+				}
+				for (uint32_t c = 0; c < archetypes_[a].chunks.size(); ++c)
+				{
+					work_items_.push_back({ system, a, c });
+				}
+			}
+		}
+
+		const auto run = [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const WorkItem& item = work_items_[i];
+				Archetype& archetype = archetypes_[item.archetype];
+				Chunk& chunk = archetype.chunks[item.chunk];
+				systems_[item.system].function(ChunkView(chunk.memory->bytes, chunk.count, archetype.offsets));
+			}
+		};
+		const uint32_t item_count = static_cast<uint32_t>(work_items_.size());
+		if (pool && item_count > 1)
+		{
+			pool->ParallelFor(item_count, 1, run);
+		}
+		else
+		{
+			run(0, item_count);
+		}
+		level_begin = level_end;
+	}
+	running_systems_ = false;
+}
+
+uint32_t World::GetSystemLevel(SystemId system)
+{
+	if (schedule_dirty_)
+	{
+		BuildSchedule();
+	}
+	return system_levels_[system];
+}
+
+const std::string& World::GetSystemName(SystemId system) const
+{
+	return systems_[system].name;
+}
+
+uint32_t World::GetEntityCount() const
+{
+	return entity_count_;
+}
+
+uint32_t World::GetArchetypeCount() const
+{
+	return static_cast<uint32_t>(archetypes_.size());
+}
+
+Entity World::CreateWithMask(ComponentMask mask)
+{
+	assert(!running_systems_ && "Creating an entity while systems run.");
+
+	uint32_t index;
+	if (!free_entities_.empty())
+	{
+		index = free_entities_.back();
+		free_entities_.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(entities_.size());
+		entities_.emplace_back();
+	}
+	AllocateRow(GetArchetype(mask), index);
+	++entity_count_;
+	return { index, entities_[index].generation };
+}
+
+void* World::AddComponent(Entity entity, ComponentId component)
+{
+	assert(IsAlive(entity) && "Adding to a stale entity.");
+	assert(!running_systems_ && "Adding a component while systems run.");
+
+	const uint32_t from = entities_[entity.index].archetype;
+	if (archetypes_[from].mask & (ComponentMask(1) << component))
+	{
+		return GetComponent(entity, component);
+	}
+	uint32_t to = archetypes_[from].add_edges[component];
+	if (to == kNoArchetype)
+	{
+		to = GetArchetype(archetypes_[from].mask | (ComponentMask(1) << component));
+		archetypes_[from].add_edges[component] = to;
+		archetypes_[to].remove_edges[component] = from;
+	}
+
+	const EntityRecord old = entities_[entity.index];
+	AllocateRow(to, entity.index);
+	const EntityRecord& record = entities_[entity.index];
+	CopyRow(archetypes_[from], old.chunk, old.row, archetypes_[to], record.chunk, record.row);
+	FreeRow(from, old.chunk, old.row);
+	return GetComponent(entity, component);
+}
+
+void World::RemoveComponent(Entity entity, ComponentId component)
+{
+	assert(IsAlive(entity) && "Removing from a stale entity.");
+	assert(!running_systems_ && "Removing a component while systems run.");
+
+	const uint32_t from = entities_[entity.index].archetype;
+	if (!(archetypes_[from].mask & (ComponentMask(1) << component)))
+	{
+		return;
+	}
+	uint32_t to = archetypes_[from].remove_edges[component];
+	if (to == kNoArchetype)
+	{
+		to = GetArchetype(archetypes_[from].mask & ~(ComponentMask(1) << component));
+		archetypes_[from].remove_edges[component] = to;
+		archetypes_[to].add_edges[component] = from;
+	}
+
+	const EntityRecord old = entities_[entity.index];
+	AllocateRow(to, entity.index);
+	const EntityRecord& record = entities_[entity.index];
+	CopyRow(archetypes_[from], old.chunk, old.row, archetypes_[to], record.chunk, record.row);
+	FreeRow(from, old.chunk, old.row);
+}
+
+void* World::GetComponent(Entity entity, ComponentId component) const
+{
+	if (!IsAlive(entity))
+	{
+		return nullptr;
+	}
+	const EntityRecord& record = entities_[entity.index];
+	const Archetype& archetype = archetypes_[record.archetype];
+	const uint16_t offset = archetype.offsets[component];
+	if (offset == ChunkView::kAbsent)
+	{
+		return nullptr;
+	}
+	return archetype.chunks[record.chunk].memory->bytes + offset + size_t(component_sizes_[component]) * record.row;
+}
+
+uint32_t World::GetArchetype(ComponentMask mask)
+{
+	if (const auto it = archetype_lookup_.find(mask); it != archetype_lookup_.end())
+	{
+		return it->second;
+	}
+
+	Archetype archetype;
+	archetype.mask = mask;
+	std::fill(std::begin(archetype.offsets), std::end(archetype.offsets), ChunkView::kAbsent);
+	std::fill(std::begin(archetype.add_edges), std::end(archetype.add_edges), kNoArchetype);
+	std::fill(std::begin(archetype.remove_edges), std::end(archetype.remove_edges), kNoArchetype);
+
+	size_t row_size = sizeof(Entity);
+	for (ComponentMask bits = mask; bits != 0; bits &= bits - 1)
+	{
+		const ComponentId component = static_cast<ComponentId>(std::countr_zero(bits));
+		component_sizes_[component] = static_cast<uint32_t>(GetComponentType(component).size);
+		row_size += component_sizes_[component];
+	}
+
+	// Entities first, then one array per component in id order. Aligning the
+	// arrays can push the estimate over the chunk size, so count down from it.
+	for (uint32_t capacity = static_cast<uint32_t>(kChunkSize / row_size); capacity > 0; --capacity)
+	{
+		size_t offset = sizeof(Entity) * capacity;
+		for (ComponentMask bits = mask; bits != 0; bits &= bits - 1)
+		{
+			const ComponentId component = static_cast<ComponentId>(std::countr_zero(bits));
+			offset = AlignUp(offset, GetComponentType(component).alignment);
+			archetype.offsets[component] = static_cast<uint16_t>(offset);
+			offset += size_t(component_sizes_[component]) * capacity;
+		}
+		if (offset <= kChunkSize)
+		{
+			archetype.capacity = capacity;
+			break;
+		}
+	}
+	assert(archetype.capacity > 0 && "Components too large for one chunk.");
+
+	const uint32_t index = static_cast<uint32_t>(archetypes_.size());
+	archetypes_.push_back(std::move(archetype));
+	archetype_lookup_.emplace(mask, index);
+	return index;
+}
+
+void World::AllocateRow(uint32_t archetype_index, uint32_t entity)
+{
+	Archetype& archetype = archetypes_[archetype_index];
+	if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+	{
+		Chunk chunk;
+		if (!free_chunks_.empty())
+		{
+			chunk.memory = std::move(free_chunks_.back());
+			free_chunks_.pop_back();
+		}
+		else
+		{
+			// Not make_unique, which would zero the chunk
+			chunk.memory.reset(new ChunkMemory);
+		}
+		archetype.chunks.push_back(std::move(chunk));
+	}
+
+	Chunk& chunk = archetype.chunks.back();
+	EntityRecord& record = entities_[entity];
+	record.archetype = archetype_index;
+	record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+	record.row = chunk.count++;
+	reinterpret_cast<Entity*>(chunk.memory->bytes)[record.row] = { entity, record.generation };
+}
+
+void World::FreeRow(uint32_t archetype_index, uint32_t chunk_index, uint32_t row)
+{
+	Archetype& archetype = archetypes_[archetype_index];
+	const uint32_t last_chunk_index = static_cast<uint32_t>(archetype.chunks.size() - 1);
+	Chunk& last_chunk = archetype.chunks[last_chunk_index];
+	const uint32_t last_row = last_chunk.count - 1;
+	if (chunk_index != last_chunk_index || row != last_row)
+	{
+		CopyRow(archetype, last_chunk_index, last_row, archetype, chunk_index, row);
+		const Entity moved = reinterpret_cast<const Entity*>(last_chunk.memory->bytes)[last_row];
+		reinterpret_cast<Entity*>(archetype.chunks[chunk_index].memory->bytes)[row] = moved;
+		entities_[moved.index].chunk = chunk_index;
+		entities_[moved.index].row = row;
+	}
+
+	if (--last_chunk.count == 0)
+	{
+		free_chunks_.push_back(std::move(last_chunk.memory));
+		archetype.chunks.pop_back();
+	}
+}
+
+void World::CopyRow(const Archetype& from, uint32_t from_chunk, uint32_t from_row, const Archetype& to, uint32_t to_chunk, uint32_t to_row)
+{
+	const std::byte* source = from.chunks[from_chunk].memory->bytes;
+	std::byte* dest = to.chunks[to_chunk].memory->bytes;
+	for (ComponentMask bits = from.mask & to.mask; bits != 0; bits &= bits - 1)
+	{
+		const ComponentId component = static_cast<ComponentId>(std::countr_zero(bits));
+		const size_t size = component_sizes_[component];
+		std::memcpy(dest + to.offsets[component] + size * to_row, source + from.offsets[component] + size * from_row, size);
+	}
+}
+
+void World::BuildSchedule()
+{
+	// A system goes one level after the last earlier system it conflicts
+	// with: either one writes what the other reads or writes
+	system_levels_.assign(systems_.size(), 0);
+	for (size_t i = 0; i < systems_.size(); ++i)
+	{
+		const System& system = systems_[i];
+		for (size_t j = 0; j < i; ++j)
+		{
+			const System& earlier = systems_[j];
+			if ((system.writes & (earlier.reads | earlier.writes)) || (system.reads & earlier.writes))
+			{
+				system_levels_[i] = std::max(system_levels_[i], system_levels_[j] + 1);
+			}
+		}
+	}
+
+	system_order_.resize(systems_.size());
+	for (SystemId s = 0; s < systems_.size(); ++s)
+	{
+		system_order_[s] = s;
+	}
+	std::stable_sort(system_order_.begin(), system_order_.end(), [this](SystemId a, SystemId b)
+	{
+		return system_levels_[a] < system_levels_[b];
+	});
+	schedule_dirty_ = false;
+}
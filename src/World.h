@@ -0,0 +1,282 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// Entity-component store for game state. Entities with the same set of
+// component types (an archetype) live together in 16 KB chunks, each holding
+// an array per component type, so iterating a component query walks memory
+// linearly instead of chasing heap objects.
+//
+// Components are plain data: trivially copyable, as entities are moved
+// between chunks with memcpy whenever a component is added or removed. Up to
+// kMaxComponentTypes types can be used.
+//
+// Systems declare the components they read and write. RunSystems() orders
+// them by dependency level (declaration order within a level), where a system
+// depends on every earlier one whose writes it touches or that touches its
+// writes, and runs each level's systems over all their chunks in one parallel
+// loop. Entities and components can't be created or destroyed while systems
+// run.
+
+using ComponentId = uint32_t;
+using ComponentMask = uint64_t;
+
+constexpr uint32_t kMaxComponentTypes = 64;
+
+// Ids are handed out on first use, process-wide. Throws std::length_error
+// past kMaxComponentTypes.
+ComponentId RegisterComponentType(size_t size, size_t alignment);
+
+template<typename T>
+ComponentId GetComponentId()
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Components are moved with memcpy.");
+	static const ComponentId id = RegisterComponentType(sizeof(T), alignof(T));
+	return id;
+}
+
+template<typename... Ts>
+ComponentMask GetComponentMask()
+{
+	return (ComponentMask(0) | ... | (ComponentMask(1) << GetComponentId<std::remove_const_t<Ts>>()));
+}
+
+struct Entity
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool IsNull() const { return index == UINT32_MAX; }
+
+	bool operator==(const Entity& rhs) const { return index == rhs.index && generation == rhs.generation; }
+	bool operator!=(const Entity& rhs) const { return !(*this == rhs); }
+};
+
+// The entities of one chunk and their component arrays
+class ChunkView
+{
+public:
+	ChunkView(std::byte* data, uint32_t count, const uint16_t* offsets)
+		:
+		data_(data),
+		count_(count),
+		offsets_(offsets)
+	{}
+
+	uint32_t GetCount() const { return count_; }
+	const Entity* GetEntities() const { return reinterpret_cast<const Entity*>(data_); }
+
+	// nullptr if the chunk's archetype lacks T
+	template<typename T>
+	T* Get() const
+	{
+		const uint16_t offset = offsets_[GetComponentId<std::remove_const_t<T>>()];
+		return offset == kAbsent ? nullptr : reinterpret_cast<T*>(data_ + offset);
+	}
+
+	static constexpr uint16_t kAbsent = UINT16_MAX;
+private:
+	std::byte* data_;
+	uint32_t count_;
+	const uint16_t* offsets_;	// Per component id
+};
+
+class World
+{
+public:
+	using SystemId = uint32_t;
+	using ChunkFunction = std::function<void(const ChunkView&)>;
+
+	static constexpr size_t kChunkSize = 16 * 1024;
+public:
+	World();
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+	~World();
+
+	template<typename... Ts>
+	Entity Create(const Ts&... components)
+	{
+		const Entity entity = CreateWithMask(GetComponentMask<Ts...>());
+		(new (GetComponent(entity, GetComponentId<Ts>())) Ts(components), ...);
+		return entity;
+	}
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	// Replaces the value if the entity already has a T
+	template<typename T>
+	T& Add(Entity entity, const T& value = T())
+	{
+		return *new (AddComponent(entity, GetComponentId<T>())) T(value);
+	}
+	template<typename T>
+	void Remove(Entity entity)
+	{
+		RemoveComponent(entity, GetComponentId<T>());
+	}
+	template<typename T>
+	bool Has(Entity entity) const
+	{
+		return GetComponent(entity, GetComponentId<T>()) != nullptr;
+	}
+	// nullptr if the entity has no T
+	template<typename T>
+	T* Get(Entity entity)
+	{
+		return static_cast<T*>(GetComponent(entity, GetComponentId<T>()));
+	}
+
+	// Calls function(Ts&...) for every entity that has all of Ts; const types
+	// are passed as const references
+	template<typename... Ts, typename Function>
+	void ForEach(Function&& function)
+	{
+		ForEachChunk(GetComponentMask<Ts...>(), [&](const ChunkView& chunk)
+		{
+			ForEachInChunk<Ts...>(chunk, function);
+		});
+	}
+	// Calls function(ChunkView) for every chunk holding all the components in
+	// 'required'
+	void ForEachChunk(ComponentMask required, const ChunkFunction& function);
+
+	// Runs on every entity having all of Ts, reading the const ones and
+	// writing the rest, e.g. AddSystem<const Velocity, Position>(...)
+	template<typename... Ts, typename Function>
+	SystemId AddSystem(std::string name, Function function)
+	{
+		return AddSystem(std::move(name), GetComponentMask<Ts...>(), ReadMask<Ts...>(), WriteMask<Ts...>(),
+			[function](const ChunkView& chunk)
+			{
+				ForEachInChunk<Ts...>(chunk, function);
+			});
+	}
+	// Runs 'function' on every chunk holding all of 'required'
+	SystemId AddSystem(std::string name, ComponentMask required, ComponentMask reads, ComponentMask writes, ChunkFunction function);
+	void RunSystems(ThreadPool* pool = nullptr);
+
+	// Systems in the same level run concurrently
+	uint32_t GetSystemLevel(SystemId system);
+	const std::string& GetSystemName(SystemId system) const;
+	uint32_t GetEntityCount() const;
+	uint32_t GetArchetypeCount() const;
+private:
+	static constexpr uint32_t kNoArchetype = UINT32_MAX;
+
+	struct alignas(64) ChunkMemory
+	{
+		std::byte bytes[kChunkSize];
+	};
+
+	struct Chunk
+	{
+		std::unique_ptr<ChunkMemory> memory;
+		uint32_t count = 0;
+	};
+
+	// Chunks are kept full but for the last one
+	struct Archetype
+	{
+		ComponentMask mask = 0;
+		uint32_t capacity = 0;	// Entities per chunk
+		uint16_t offsets[kMaxComponentTypes];	// ChunkView::kAbsent for missing types
+		std::vector<Chunk> chunks;
+		// Archetype with each component type added or removed, filled on use
+		uint32_t add_edges[kMaxComponentTypes];
+		uint32_t remove_edges[kMaxComponentTypes];
+	};
+
+	struct EntityRecord
+	{
+		uint32_t archetype = kNoArchetype;
+		uint32_t chunk = 0;
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+
+	struct System
+	{
+		std::string name;
+		ComponentMask required;
+		ComponentMask reads;
+		ComponentMask writes;
+		ChunkFunction function;
+	};
+
+	// One system over one chunk
+	struct WorkItem
+	{
+		uint32_t system;
+		uint32_t archetype;
+		uint32_t chunk;
+	};
+private:
+	template<typename... Ts, typename Function>
+	static void ForEachInChunk(const ChunkView& chunk, Function& function)
+	{
+		[&](Ts*... arrays)
+		{
+			for (uint32_t i = 0; i < chunk.GetCount(); ++i)
+			{
+				function(arrays[i]...);
+			}
+		}(chunk.Get<Ts>()...);
+	}
+
+	template<typename... Ts>
+	static ComponentMask ReadMask()
+	{
+		return (ComponentMask(0) | ... | (std::is_const_v<Ts> ? GetComponentMask<Ts>() : 0));
+	}
+	template<typename... Ts>
+	static ComponentMask WriteMask()
+	{
+		return (ComponentMask(0) | ... | (std::is_const_v<Ts> ? 0 : GetComponentMask<Ts>()));
+	}
+
+	Entity CreateWithMask(ComponentMask mask);
+	// Moves the entity to its archetype with the component added; returns the
+	// component's storage, uninitialized if it is new
+	void* AddComponent(Entity entity, ComponentId component);
+	void RemoveComponent(Entity entity, ComponentId component);
+	void* GetComponent(Entity entity, ComponentId component) const;
+
+	uint32_t GetArchetype(ComponentMask mask);
+	// Appends an uninitialized row for 'entity'
+	void AllocateRow(uint32_t archetype, uint32_t entity);
+	// Fills the row's hole with the archetype's last entity
+	void FreeRow(uint32_t archetype, uint32_t chunk, uint32_t row);
+	// Copies the components both archetypes have
+	void CopyRow(const Archetype& from, uint32_t from_chunk, uint32_t from_row, const Archetype& to, uint32_t to_chunk, uint32_t to_row);
+	void BuildSchedule();
+private:
+	std::vector<Archetype> archetypes_;
+	uint32_t component_sizes_[kMaxComponentTypes] = {};	// Of the types archetypes use
+	std::unordered_map<ComponentMask, uint32_t> archetype_lookup_;
+	std::vector<std::unique_ptr<ChunkMemory>> free_chunks_;
+
+	std::vector<EntityRecord> entities_;
+	std::vector<uint32_t> free_entities_;
+	uint32_t entity_count_ = 0;
+
+	std::vector<System> systems_;
+	std::vector<uint32_t> system_levels_;
+	std::vector<SystemId> system_order_;	// By level, then declaration
+	bool schedule_dirty_ = false;
+	bool running_systems_ = false;
+	std::vector<WorkItem> work_items_;
+};
+
+#endif // !WORLD_H
@@ -0,0 +1,125 @@
+#include "DescriptorIndexAllocator.h"
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+TEST(DescriptorIndexAllocator, HandsOutLowIndicesFirst)
+{
+	DescriptorIndexAllocator allocator(8);
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		const DescriptorIndexAllocator::Handle handle = allocator.Allocate();
+		ASSERT_FALSE(handle.IsNull());
+		EXPECT_EQ(handle.Index(), i);
+		EXPECT_EQ(handle.Generation(), 0u);
+		EXPECT_TRUE(allocator.IsValid(handle));
+	}
+	EXPECT_EQ(allocator.GetAllocatedCount(), 8u);
+}
+
+TEST(DescriptorIndexAllocator, ReturnsNullWhenExhausted)
+{
+	DescriptorIndexAllocator allocator(4);
+	std::vector<DescriptorIndexAllocator::Handle> handles;
+	for (int i = 0; i < 4; ++i)
+	{
+		handles.push_back(allocator.Allocate());
+	}
+	const DescriptorIndexAllocator::Handle none = allocator.Allocate();
+	EXPECT_TRUE(none.IsNull());
+	EXPECT_FALSE(allocator.IsValid(none));
+
+	allocator.Free(handles[2]);
+	const DescriptorIndexAllocator::Handle again = allocator.Allocate();
+	ASSERT_FALSE(again.IsNull());
+	EXPECT_EQ(again.Index(), handles[2].Index());
+	EXPECT_TRUE(allocator.Allocate().IsNull());
+}
+
+TEST(DescriptorIndexAllocator, ReusedSlotInvalidatesOldHandle)
+{
+	DescriptorIndexAllocator allocator(4);
+	const DescriptorIndexAllocator::Handle first = allocator.Allocate();
+	allocator.Free(first);
+	EXPECT_FALSE(allocator.IsValid(first));
+
+	const DescriptorIndexAllocator::Handle second = allocator.Allocate();
+	EXPECT_EQ(second.Index(), first.Index());
+	EXPECT_NE(second, first);
+	EXPECT_EQ(second.Generation(), first.Generation() + 1);
+	EXPECT_TRUE(allocator.IsValid(second));
+	EXPECT_FALSE(allocator.IsValid(first));
+}
+
+TEST(DescriptorIndexAllocator, GenerationWrapsWithoutNullHandle)
+{
+	// One slot at the top of the index range, so the wrapped generation would
+	// otherwise produce the all-ones null handle
+	DescriptorIndexAllocator allocator(DescriptorIndexAllocator::kMaxCapacity);
+	std::vector<DescriptorIndexAllocator::Handle> others;
+	for (uint32_t i = 0; i + 1 < DescriptorIndexAllocator::kMaxCapacity; ++i)
+	{
+		others.push_back(allocator.Allocate());
+	}
+
+	std::set<uint32_t> seen;
+	for (int i = 0; i < 5000; ++i)
+	{
+		const DescriptorIndexAllocator::Handle handle = allocator.Allocate();
+		ASSERT_FALSE(handle.IsNull());
+		EXPECT_EQ(handle.Index(), DescriptorIndexAllocator::kMaxCapacity - 1);
+		EXPECT_TRUE(allocator.IsValid(handle));
+		seen.insert(handle.value);
+		allocator.Free(handle);
+	}
+	// Every generation but the one that would make the null handle
+	EXPECT_EQ(seen.size(), (1u << (32 - DescriptorIndexAllocator::kIndexBits)) - 1);
+}
+
+TEST(DescriptorIndexAllocator, TracksAllocatedCount)
+{
+	DescriptorIndexAllocator allocator(16);
+	EXPECT_EQ(allocator.GetCapacity(), 16u);
+	std::vector<DescriptorIndexAllocator::Handle> handles;
+	for (int i = 0; i < 10; ++i)
+	{
+		handles.push_back(allocator.Allocate());
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		allocator.Free(handles[i]);
+	}
+	EXPECT_EQ(allocator.GetAllocatedCount(), 6u);
+}
+
+#ifndef NDEBUG
+TEST(DescriptorIndexAllocatorDeathTest, AssertsOnDoubleFree)
+{
+	DescriptorIndexAllocator allocator(4);
+	const DescriptorIndexAllocator::Handle handle = allocator.Allocate();
+	allocator.Free(handle);
+	EXPECT_DEATH(allocator.Free(handle), "stale or null descriptor handle");
+}
+
+TEST(DescriptorIndexAllocatorDeathTest, AssertsOnStaleFree)
+{
+	DescriptorIndexAllocator allocator(4);
+	const DescriptorIndexAllocator::Handle stale = allocator.Allocate();
+	allocator.Free(stale);
+	const DescriptorIndexAllocator::Handle current = allocator.Allocate();
+	ASSERT_EQ(current.Index(), stale.Index());
+	EXPECT_DEATH(allocator.Free(stale), "stale or null descriptor handle");
+}
+
+TEST(DescriptorIndexAllocatorDeathTest, AssertsOnNullFree)
+{
+	DescriptorIndexAllocator allocator(4);
+	EXPECT_DEATH(allocator.Free(DescriptorIndexAllocator::Handle{}), "stale or null descriptor handle");
+}
+
+TEST(DescriptorIndexAllocatorDeathTest, AssertsOnCapacityOutOfRange)
+{
+	EXPECT_DEATH(DescriptorIndexAllocator(0), "capacity out of range");
+	EXPECT_DEATH(DescriptorIndexAllocator(DescriptorIndexAllocator::kMaxCapacity + 1), "capacity out of range");
+}
+#endif
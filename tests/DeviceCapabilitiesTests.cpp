@@ -0,0 +1,184 @@
+#include "DeviceCapabilities.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t kLuid = 0x0000000100002a4full;
+	constexpr uint64_t kDriver = 0x001f000e000c1f5bull;
+
+	// Every field set to something other than its default
+	DeviceCapabilities MakeCapabilities()
+	{
+		DeviceCapabilities capabilities;
+		capabilities.adapter_luid = kLuid;
+		capabilities.driver_version = kDriver;
+		capabilities.max_feature_level = 0xc200;
+		capabilities.highest_shader_model = 0x66;
+		capabilities.highest_root_signature_version = 0x2;
+		capabilities.resource_binding_tier = 3;
+		capabilities.resource_heap_tier = 2;
+		capabilities.tiled_resources_tier = 4;
+		capabilities.conservative_rasterization_tier = 3;
+		capabilities.raytracing_tier = 11;
+		capabilities.variable_shading_rate_tier = 2;
+		capabilities.mesh_shader_tier = 1;
+		capabilities.sampler_feedback_tier = 100;
+		capabilities.wave_lane_count_min = 32;
+		capabilities.wave_lane_count_max = 64;
+		capabilities.total_lane_count = 10240;
+		capabilities.typed_uav_load_additional_formats = 1;
+		capabilities.rasterizer_ordered_views = 1;
+		capabilities.wave_ops = 1;
+		capabilities.uma = 0;
+		capabilities.cache_coherent_uma = 0;
+		for (uint32_t format = 0; format < DeviceCapabilities::kMsaaFormatCount; ++format)
+		{
+			for (uint32_t samples = 0; samples < DeviceCapabilities::kMsaaSampleCountCount; ++samples)
+			{
+				capabilities.msaa_quality_levels[format][samples] = format * 10 + samples + 1;
+			}
+		}
+		return capabilities;
+	}
+
+	bool SameBytes(const DeviceCapabilities& a, const DeviceCapabilities& b)
+	{
+		return std::memcmp(&a, &b, sizeof(DeviceCapabilities)) == 0;
+	}
+}
+
+TEST(DeviceCapabilities, RoundTrips)
+{
+	const DeviceCapabilities saved = MakeCapabilities();
+	const std::vector<unsigned char> data = SerializeCapabilities(saved);
+
+	DeviceCapabilities loaded;
+	ASSERT_TRUE(DeserializeCapabilities(data.data(), data.size(), kLuid, kDriver, loaded));
+	EXPECT_TRUE(SameBytes(loaded, saved));
+	EXPECT_EQ(loaded.GetMsaaQualityLevels(28, 4), 2u);
+	EXPECT_EQ(loaded.GetMsaaQualityLevels(40, 8), 53u);
+}
+
+TEST(DeviceCapabilities, RejectsAnotherDriverOrAdapter)
+{
+	const DeviceCapabilities saved = MakeCapabilities();
+	const std::vector<unsigned char> data = SerializeCapabilities(saved);
+
+	// A failed load leaves the output alone, so callers keep their defaults
+	DeviceCapabilities loaded;
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size(), kLuid, kDriver + 1, loaded));
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size(), kLuid, 0, loaded));
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size(), kLuid + 1, kDriver, loaded));
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size(), 0, 0, loaded));
+	EXPECT_TRUE(SameBytes(loaded, DeviceCapabilities()));
+}
+
+TEST(DeviceCapabilities, RejectsDamagedData)
+{
+	const std::vector<unsigned char> data = SerializeCapabilities(MakeCapabilities());
+	DeviceCapabilities loaded;
+
+	// Any flipped bit, in the header or the payload, except the header's
+	// reserved word at bytes 12-15, which nothing reads
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		if (i >= 12 && i < 16)
+		{
+			continue;
+		}
+		std::vector<unsigned char> damaged = data;
+		damaged[i] ^= 0x10;
+		EXPECT_FALSE(DeserializeCapabilities(damaged.data(), damaged.size(), kLuid, kDriver, loaded)) << "byte " << i;
+	}
+
+	// Truncated or with trailing bytes
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size() - 1, kLuid, kDriver, loaded));
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), 0, kLuid, kDriver, loaded));
+	std::vector<unsigned char> longer = data;
+	longer.push_back(0);
+	EXPECT_FALSE(DeserializeCapabilities(longer.data(), longer.size(), kLuid, kDriver, loaded));
+	EXPECT_TRUE(SameBytes(loaded, DeviceCapabilities()));
+}
+
+TEST(DeviceCapabilities, RejectsAnotherLayoutVersion)
+{
+	std::vector<unsigned char> data = SerializeCapabilities(MakeCapabilities());
+
+	// The version follows the magic; the payload and its checksum are untouched
+	uint32_t version;
+	std::memcpy(&version, data.data() + sizeof(uint32_t), sizeof(version));
+	++version;
+	std::memcpy(data.data() + sizeof(uint32_t), &version, sizeof(version));
+
+	DeviceCapabilities loaded;
+	EXPECT_FALSE(DeserializeCapabilities(data.data(), data.size(), kLuid, kDriver, loaded));
+}
+
+TEST(DeviceCapabilities, SavesAndLoadsFiles)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "DeviceCapabilitiesTests.bin";
+	const DeviceCapabilities saved = MakeCapabilities();
+	ASSERT_TRUE(SaveCapabilities(path, saved));
+
+	DeviceCapabilities loaded;
+	EXPECT_TRUE(LoadCapabilities(path, kLuid, kDriver, loaded));
+	EXPECT_TRUE(SameBytes(loaded, saved));
+
+	// After a driver update the snapshot on disk is stale
+	DeviceCapabilities updated;
+	EXPECT_FALSE(LoadCapabilities(path, kLuid, kDriver + 0x10000, updated));
+
+	// Overwriting replaces the old contents entirely
+	DeviceCapabilities newer = saved;
+	newer.driver_version = kDriver + 0x10000;
+	newer.raytracing_tier = 12;
+	ASSERT_TRUE(SaveCapabilities(path, newer));
+	EXPECT_TRUE(LoadCapabilities(path, kLuid, kDriver + 0x10000, updated));
+	EXPECT_EQ(updated.raytracing_tier, 12u);
+	EXPECT_FALSE(LoadCapabilities(path, kLuid, kDriver, loaded));
+
+	// The temporary file is renamed over the real one, never left behind
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	EXPECT_FALSE(std::filesystem::exists(temp_path));
+
+	std::filesystem::remove(path);
+	EXPECT_FALSE(LoadCapabilities(path, kLuid, kDriver, loaded));
+}
+
+TEST(DeviceCapabilities, SaveFailureKeepsTheOldFile)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "DeviceCapabilitiesTests.keep.bin";
+	const DeviceCapabilities saved = MakeCapabilities();
+	ASSERT_TRUE(SaveCapabilities(path, saved));
+
+	// A directory where the temporary file should go makes the write fail
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	std::filesystem::create_directory(temp_path);
+	DeviceCapabilities newer = saved;
+	newer.raytracing_tier = 12;
+	EXPECT_FALSE(SaveCapabilities(path, newer));
+
+	DeviceCapabilities loaded;
+	EXPECT_TRUE(LoadCapabilities(path, kLuid, kDriver, loaded));
+	EXPECT_TRUE(SameBytes(loaded, saved));
+
+	std::filesystem::remove(temp_path);
+	std::filesystem::remove(path);
+}
+
+TEST(DeviceCapabilities, LooksUpMsaaQualityLevels)
+{
+	const DeviceCapabilities capabilities = MakeCapabilities();
+	EXPECT_EQ(capabilities.GetMsaaQualityLevels(28, 2), 1u);
+	EXPECT_EQ(capabilities.GetMsaaQualityLevels(87, 8), 13u);
+	// Not captured
+	EXPECT_EQ(capabilities.GetMsaaQualityLevels(28, 1), 0u);
+	EXPECT_EQ(capabilities.GetMsaaQualityLevels(28, 16), 0u);
+	EXPECT_EQ(capabilities.GetMsaaQualityLevels(2, 4), 0u);
+}
@@ -0,0 +1,242 @@
+#include "DrawQueue.h"
+#include "ThreadPool.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Payloads are the push order, so stability can be checked
+	DrawQueue MakeQueue(const std::vector<uint64_t>& keys)
+	{
+		DrawQueue queue;
+		queue.Reserve(uint32_t(keys.size()));
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			queue.Push(keys[i], i);
+		}
+		return queue;
+	}
+
+	std::vector<uint64_t> RandomKeys(size_t count, uint32_t seed)
+	{
+		std::mt19937_64 rng(seed);
+		std::vector<uint64_t> keys(count);
+		for (uint64_t& key : keys)
+		{
+			key = rng();
+		}
+		return keys;
+	}
+
+	// Few distinct states, so most keys have duplicates
+	std::vector<uint64_t> StateKeys(size_t count, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint64_t> keys(count);
+		for (uint64_t& key : keys)
+		{
+			key = DrawKey::Make(rng() % 3, rng() % 64, rng() % 8, rng() % 32, rng() % 100);
+		}
+		return keys;
+	}
+
+	void ExpectMatchesStableSort(const std::vector<uint64_t>& keys, ThreadPool* pool)
+	{
+		DrawQueue queue = MakeQueue(keys);
+		queue.Sort(pool);
+
+		std::vector<DrawQueue::Packet> expected;
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			expected.push_back({ keys[i], i });
+		}
+		std::stable_sort(expected.begin(), expected.end(), [](const DrawQueue::Packet& a, const DrawQueue::Packet& b)
+		{
+			return a.key < b.key;
+		});
+
+		ASSERT_EQ(queue.GetCount(), expected.size());
+		const DrawQueue::Packet* packets = queue.GetPackets();
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			ASSERT_EQ(packets[i].key, expected[i].key) << "packet " << i << " of " << keys.size();
+			ASSERT_EQ(packets[i].payload, expected[i].payload) << "packet " << i << " of " << keys.size();
+		}
+	}
+
+	// Logs every call, for checking what Submit() rebinds
+	class RecordingSubmitter : public DrawSubmitter
+	{
+	public:
+		void SetPass(uint32_t pass) override { calls.push_back("pass " + std::to_string(pass)); }
+		void SetPipeline(uint32_t pipeline) override { calls.push_back("pipeline " + std::to_string(pipeline)); }
+		void SetMaterial(uint32_t material) override { calls.push_back("material " + std::to_string(material)); }
+		void SetMesh(uint32_t mesh) override { calls.push_back("mesh " + std::to_string(mesh)); }
+		void Draw(uint32_t payload) override { calls.push_back("draw " + std::to_string(payload)); }
+
+		std::vector<std::string> calls;
+	};
+}
+
+TEST(DrawQueue, KeyFieldsRoundTrip)
+{
+	const uint64_t key = DrawKey::Make(15, 4095, 65535, 1234, 7);
+	EXPECT_EQ(DrawKey::GetPass(key), 15u);
+	EXPECT_EQ(DrawKey::GetDepthBucket(key), 4095u);
+	EXPECT_EQ(DrawKey::GetPipeline(key), 65535u);
+	EXPECT_EQ(DrawKey::GetMaterial(key), 1234u);
+	EXPECT_EQ(DrawKey::GetMesh(key), 7u);
+
+	// Pass outranks everything, depth outranks state
+	EXPECT_LT(DrawKey::Make(0, 4095, 65535, 65535, 65535), DrawKey::Make(1, 0, 0, 0, 0));
+	EXPECT_LT(DrawKey::Make(0, 0, 65535, 65535, 65535), DrawKey::Make(0, 1, 0, 0, 0));
+}
+
+TEST(DrawQueue, DepthBucketsFollowDepth)
+{
+	uint32_t previous = 0;
+	for (float depth = 0.1f; depth < 1000.0f; depth *= 1.5f)
+	{
+		const uint32_t bucket = DrawKey::DepthBucket(depth, 0.1f, 1000.0f);
+		EXPECT_GE(bucket, previous) << depth;
+		EXPECT_EQ(DrawKey::DepthBucket(depth, 0.1f, 1000.0f, true), (1u << DrawKey::kDepthBits) - 1 - bucket) << depth;
+		previous = bucket;
+	}
+	EXPECT_EQ(DrawKey::DepthBucket(0.0f, 0.1f, 1000.0f), 0u);
+	EXPECT_EQ(DrawKey::DepthBucket(5000.0f, 0.1f, 1000.0f), (1u << DrawKey::kDepthBits) - 1);
+}
+
+TEST(DrawQueue, SortMatchesStableSort)
+{
+	for (size_t count : { 0, 1, 2, 3, 100, 1000, 20000 })
+	{
+		ExpectMatchesStableSort(RandomKeys(count, uint32_t(count)), nullptr);
+		ExpectMatchesStableSort(StateKeys(count, uint32_t(count)), nullptr);
+	}
+}
+
+TEST(DrawQueue, ParallelSortMatchesStableSort)
+{
+	// Large enough to be split into blocks across the pool
+	ThreadPool pool(3);
+	for (size_t count : { 40000, 100000, 250001 })
+	{
+		ExpectMatchesStableSort(RandomKeys(count, uint32_t(count)), &pool);
+		ExpectMatchesStableSort(StateKeys(count, uint32_t(count)), &pool);
+	}
+}
+
+TEST(DrawQueue, SortKeepsOrderOfEqualKeys)
+{
+	// Every digit is the same, so nothing moves at all
+	const std::vector<uint64_t> keys(1000, DrawKey::Make(1, 2, 3, 4, 5));
+	DrawQueue queue = MakeQueue(keys);
+	queue.Sort();
+	for (uint32_t i = 0; i < queue.GetCount(); ++i)
+	{
+		EXPECT_EQ(queue.GetPackets()[i].payload, i);
+	}
+}
+
+TEST(DrawQueue, ResetKeepsSortingCorrect)
+{
+	ThreadPool pool(3);
+	DrawQueue queue;
+	for (uint32_t frame = 0; frame < 3; ++frame)
+	{
+		// A different size each frame, over memory left from the last one
+		const std::vector<uint64_t> keys = StateKeys(60000 - frame * 20000, frame);
+		queue.Reset();
+		for (uint32_t i = 0; i < keys.size(); ++i)
+		{
+			queue.Push(keys[i], i);
+		}
+		queue.Sort(&pool);
+		ASSERT_EQ(queue.GetCount(), keys.size());
+		EXPECT_TRUE(std::is_sorted(queue.GetPackets(), queue.GetPackets() + queue.GetCount(),
+			[](const DrawQueue::Packet& a, const DrawQueue::Packet& b) { return a.key < b.key; }));
+	}
+}
+
+TEST(DrawQueue, SubmitOnlyRebindsChangedState)
+{
+	DrawQueue queue;
+	queue.Push(DrawKey::Make(0, 0, 1, 1, 1), 0);
+	queue.Push(DrawKey::Make(0, 0, 1, 1, 1), 1);
+	queue.Push(DrawKey::Make(0, 0, 1, 1, 2), 2);
+	queue.Push(DrawKey::Make(0, 0, 1, 2, 2), 3);
+	// New pipeline: the material is bound again, the mesh is kept
+	queue.Push(DrawKey::Make(0, 0, 2, 2, 2), 4);
+	// New pass: everything is bound again
+	queue.Push(DrawKey::Make(1, 0, 2, 2, 2), 5);
+
+	RecordingSubmitter submitter;
+	const DrawSubmitStats stats = queue.Submit(submitter);
+	EXPECT_EQ(stats.draws, 6u);
+	EXPECT_EQ(stats.pass_changes, 2u);
+	EXPECT_EQ(stats.pipeline_changes, 3u);
+	EXPECT_EQ(stats.material_changes, 4u);
+	EXPECT_EQ(stats.mesh_changes, 3u);
+
+	const std::vector<std::string> expected =
+	{
+		"pass 0", "pipeline 1", "material 1", "mesh 1", "draw 0",
+		"draw 1",
+		"mesh 2", "draw 2",
+		"material 2", "draw 3",
+		"pipeline 2", "material 2", "draw 4",
+		"pass 1", "pipeline 2", "material 2", "mesh 2", "draw 5",
+	};
+	EXPECT_EQ(submitter.calls, expected);
+}
+
+TEST(DrawQueue, SortedSubmitBindsEachStateOnce)
+{
+	// Depth bucket 0 everywhere: sorted purely by state
+	std::mt19937 rng(7);
+	std::vector<uint64_t> keys(5000);
+	std::set<std::pair<uint32_t, uint32_t>> pipelines;
+	std::set<std::tuple<uint32_t, uint32_t, uint32_t>> materials;
+	std::set<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>> meshes;
+	for (uint64_t& key : keys)
+	{
+		const uint32_t pass = rng() % 2;
+		const uint32_t pipeline = rng() % 6;
+		const uint32_t material = rng() % 10;
+		const uint32_t mesh = rng() % 50;
+		key = DrawKey::Make(pass, 0, pipeline, material, mesh);
+		pipelines.insert({ pass, pipeline });
+		materials.insert({ pass, pipeline, material });
+		meshes.insert({ pass, pipeline, material, mesh });
+	}
+
+	DrawQueue queue = MakeQueue(keys);
+	RecordingSubmitter unsorted_submitter;
+	const DrawSubmitStats unsorted = queue.Submit(unsorted_submitter);
+	queue.Sort();
+	RecordingSubmitter sorted_submitter;
+	const DrawSubmitStats sorted = queue.Submit(sorted_submitter);
+
+	EXPECT_EQ(sorted.draws, keys.size());
+	EXPECT_EQ(sorted.pass_changes, 2u);
+	EXPECT_EQ(sorted.pipeline_changes, pipelines.size());
+	EXPECT_EQ(sorted.material_changes, materials.size());
+	EXPECT_LT(sorted.pipeline_changes * 50, unsorted.pipeline_changes);
+	// A mesh can carry over a material change, so this is only a bound
+	EXPECT_LE(sorted.mesh_changes, meshes.size());
+}
+
+#ifndef NDEBUG
+TEST(DrawQueueDeathTest, AssertsOnFieldsOutOfRange)
+{
+	EXPECT_DEATH(DrawKey::Make(16, 0, 0, 0, 0), "Pass out of key range");
+	EXPECT_DEATH(DrawKey::Make(0, 4096, 0, 0, 0), "Depth bucket out of key range");
+	EXPECT_DEATH(DrawKey::Make(0, 0, 0, 0, 65536), "Mesh out of key range");
+}
+#endif
@@ -0,0 +1,225 @@
+#include "FrameLatencyController.h"
+#include "Presenter.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace
+{
+	constexpr double kRefreshMs = 1000.0 / 60.0;
+
+	// Simulated display. Each frame takes cost_ms to produce, or hitch_ms
+	// every hitch_period frames. With vsync, presents land on refresh
+	// boundaries; the frames queued ahead absorb a hitch as long as it fits in
+	// 'latency' refreshes, and anything longer misses. With tearing, frames go
+	// out as soon as they are ready and the CPU never waits. A timed-out wait
+	// stands in for an occluded window: the waitable object isn't signalled
+	// for a second.
+	class FakePresenter : public Presenter
+	{
+	public:
+		double WaitForFrame() override
+		{
+			if (time_out_next_wait)
+			{
+				time_out_next_wait = false;
+				timed_out_ = true;
+				return 1000.0;
+			}
+			return tearing || cost_ms >= kRefreshMs ? 0.0 : kRefreshMs - cost_ms;
+		}
+
+		double Present() override
+		{
+			++frame_;
+			const bool is_hitch = hitch_period != 0 && frame_ % hitch_period == 0;
+			const double work_ms = is_hitch ? hitch_ms : cost_ms;
+
+			double interval_ms = 0.0;
+			if (tearing)
+			{
+				interval_ms = work_ms;
+			}
+			else if (work_ms <= kRefreshMs * latency)
+			{
+				interval_ms = kRefreshMs;
+			}
+			else
+			{
+				interval_ms = kRefreshMs * std::ceil(work_ms / kRefreshMs);
+			}
+
+			if (timed_out_)
+			{
+				timed_out_ = false;
+				interval_ms += 1000.0;
+			}
+			return interval_ms;
+		}
+
+		void SetMaximumFrameLatency(uint32_t value) override
+		{
+			latency = value;
+			++latency_changes;
+		}
+
+		uint32_t GetMaximumFrameLatency() const override
+		{
+			return latency;
+		}
+
+		double GetRefreshIntervalMs() const override
+		{
+			return kRefreshMs;
+		}
+
+		bool tearing = false;
+		double cost_ms = 8.0;
+		double hitch_ms = 0.0;
+		uint32_t hitch_period = 0;
+		bool time_out_next_wait = false;
+		uint32_t latency = 2;
+		uint32_t latency_changes = 0;
+	private:
+		uint64_t frame_ = 0;
+		bool timed_out_ = false;
+	};
+
+	// One frame of the loop in Graphics: wait, render, present, adjust
+	void RunFrames(FrameLatencyController& controller, FakePresenter& presenter, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const double wait_ms = presenter.WaitForFrame();
+			const double frame_ms = presenter.Present();
+			controller.Update(presenter, wait_ms, frame_ms);
+			ASSERT_EQ(presenter.latency, controller.GetLatency());
+		}
+	}
+
+	void RunWindows(FrameLatencyController& controller, FakePresenter& presenter, uint32_t count)
+	{
+		RunFrames(controller, presenter, count * controller.GetSettings().window_frames);
+	}
+}
+
+TEST(FrameLatencyController, LowersLatencyWhenTheCpuWaits)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	presenter.cost_ms = 4.0;
+
+	RunFrames(controller, presenter, controller.GetSettings().window_frames - 1);
+	EXPECT_EQ(controller.GetLatency(), 2u);
+	RunFrames(controller, presenter, 1);
+	EXPECT_EQ(controller.GetLatency(), 1u);
+
+	RunWindows(controller, presenter, 5);
+	EXPECT_EQ(controller.GetLatency(), controller.GetSettings().min_latency);
+	EXPECT_EQ(presenter.latency_changes, 1u);
+}
+
+TEST(FrameLatencyController, KeepsLatencyWhenBusy)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	presenter.cost_ms = 15.0;
+
+	RunWindows(controller, presenter, 10);
+	EXPECT_EQ(controller.GetLatency(), 2u);
+	EXPECT_EQ(presenter.latency_changes, 0u);
+}
+
+TEST(FrameLatencyController, RaisesLatencyOnMissesAndHolds)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	// Misses at a latency of 2, fits at 3; one frame in ten is over the tolerance
+	presenter.hitch_ms = 40.0;
+	presenter.hitch_period = 10;
+
+	RunWindows(controller, presenter, 1);
+	EXPECT_EQ(controller.GetLatency(), 3u);
+
+	// Plenty of slack now, but the hold keeps it from dropping straight back
+	const uint32_t hold = controller.GetSettings().hold_windows;
+	RunWindows(controller, presenter, hold);
+	EXPECT_EQ(controller.GetLatency(), 3u);
+	EXPECT_EQ(presenter.latency_changes, 1u);
+
+	// Then it tries one frame less, misses again and goes back up
+	RunWindows(controller, presenter, 1);
+	EXPECT_EQ(controller.GetLatency(), 2u);
+	RunWindows(controller, presenter, 1);
+	EXPECT_EQ(controller.GetLatency(), 3u);
+	EXPECT_EQ(presenter.latency_changes, 3u);
+}
+
+TEST(FrameLatencyController, StopsAtMaximumLatency)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	// Too long for any queue depth
+	presenter.hitch_ms = 100.0;
+	presenter.hitch_period = 5;
+
+	RunWindows(controller, presenter, 10);
+	EXPECT_EQ(controller.GetLatency(), controller.GetSettings().max_latency);
+	EXPECT_EQ(presenter.latency_changes, 1u);
+}
+
+TEST(FrameLatencyController, IgnoresOccasionalTimedOutWaits)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	presenter.cost_ms = 15.0;
+
+	// One wait per window runs into the timeout; its second-long wait would
+	// look idle on average, but the frame it belongs to counts as missed
+	for (int window = 0; window < 10; ++window)
+	{
+		presenter.time_out_next_wait = true;
+		RunWindows(controller, presenter, 1);
+		EXPECT_EQ(controller.GetLatency(), 2u) << "window " << window;
+	}
+	EXPECT_EQ(presenter.latency_changes, 0u);
+}
+
+TEST(FrameLatencyController, FollowsTearingToggles)
+{
+	FrameLatencyController controller;
+	FakePresenter presenter;
+	presenter.cost_ms = 10.0;
+
+	// Tearing: frames go out faster than the refresh and nothing waits
+	presenter.tearing = true;
+	RunWindows(controller, presenter, 5);
+	EXPECT_EQ(controller.GetLatency(), 2u);
+	EXPECT_EQ(presenter.latency_changes, 0u);
+
+	// Vsync halfway through a window: the average wait stays under the idle
+	// threshold for that window, and the next full one drops a frame
+	const uint32_t window = controller.GetSettings().window_frames;
+	RunFrames(controller, presenter, window / 2);
+	presenter.tearing = false;
+	RunFrames(controller, presenter, window - window / 2);
+	EXPECT_EQ(controller.GetLatency(), 2u);
+	RunWindows(controller, presenter, 1);
+	EXPECT_EQ(controller.GetLatency(), 1u);
+
+	// Back to tearing: still no misses or waits, so it stays put
+	presenter.tearing = true;
+	RunWindows(controller, presenter, 5);
+	EXPECT_EQ(controller.GetLatency(), 1u);
+	EXPECT_EQ(presenter.latency_changes, 1u);
+}
+
+TEST(FrameLatencyController, ClampsInitialLatency)
+{
+	FrameLatencyController::Settings settings;
+	settings.min_latency = 2;
+	settings.max_latency = 4;
+	settings.initial_latency = 1;
+	EXPECT_EQ(FrameLatencyController(settings).GetLatency(), 2u);
+	settings.initial_latency = 9;
+	EXPECT_EQ(FrameLatencyController(settings).GetLatency(), 4u);
+}
@@ -0,0 +1,310 @@
+#include "MeshEncoding.h"
+#include "Hash.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr SimdLevel kLevels[] = { SimdLevel::kScalar, SimdLevel::kAvx2 };
+
+	// Deltas of every encoded length, including the full 32-bit range
+	std::vector<uint32_t> RandomIndices(size_t count, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint32_t> indices(count);
+		uint32_t previous = 0;
+		for (uint32_t& index : indices)
+		{
+			const uint32_t bits = 8 * (rng() % 4 + 1);
+			const uint32_t delta = bits == 32 ? rng() : rng() & ((1u << bits) - 1);
+			previous = rng() % 2 ? previous + delta : previous - delta;
+			index = previous;
+		}
+		return indices;
+	}
+
+	// Triangles of a grid walked row by row, like an optimized mesh: small deltas
+	std::vector<uint32_t> GridIndices(uint32_t size)
+	{
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y + 1 < size; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < size; ++x)
+			{
+				const uint32_t a = y * size + x;
+				indices.insert(indices.end(), { a, a + size, a + 1, a + 1, a + size, a + size + 1 });
+			}
+		}
+		return indices;
+	}
+
+	std::vector<uint32_t> Decode(const std::vector<unsigned char>& encoded, SimdLevel level, bool& ok)
+	{
+		std::vector<uint32_t> decoded(GetEncodedIndexCount(encoded.data(), encoded.size()));
+		ok = DecodeIndexBuffer(decoded.data(), encoded.data(), encoded.size(), level);
+		return decoded;
+	}
+
+	// The half with these bits, computed without FloatToHalf/HalfToFloat's tricks
+	float ReferenceHalf(uint16_t bits)
+	{
+		const int exponent = (bits >> 10) & 0x1f;
+		const int mantissa = bits & 0x3ff;
+		float magnitude;
+		if (exponent == 0x1f)
+		{
+			magnitude = mantissa ? NAN : INFINITY;
+		}
+		else if (exponent == 0)
+		{
+			magnitude = std::ldexp(float(mantissa), -24);
+		}
+		else
+		{
+			magnitude = std::ldexp(float(1024 + mantissa), exponent - 25);
+		}
+		return (bits & 0x8000) ? -magnitude : magnitude;
+	}
+
+	float AngleDegrees(const float (&a)[3], const float (&b)[3])
+	{
+		const double dot = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+		return float(std::acos(std::min(dot, 1.0)) * 180.0 / 3.14159265358979);
+	}
+}
+
+TEST(MeshEncoding, IndexBuffersRoundTrip)
+{
+	const std::vector<std::vector<uint32_t>> inputs =
+	{
+		{},
+		{ 7 },
+		{ 0, 0xffffffff, 0, 0x80000000, 1 },
+		GridIndices(2),
+		GridIndices(64),
+		RandomIndices(4099, 1),
+	};
+	for (SimdLevel level : kLevels)
+	{
+		if (ClampSimdLevel(level) != level)
+		{
+			continue;
+		}
+		for (const std::vector<uint32_t>& indices : inputs)
+		{
+			const std::vector<unsigned char> encoded = EncodeIndexBuffer(indices.data(), indices.size());
+			ASSERT_EQ(GetEncodedIndexCount(encoded.data(), encoded.size()), indices.size());
+
+			bool ok = false;
+			const std::vector<uint32_t> decoded = Decode(encoded, level, ok);
+			EXPECT_TRUE(ok) << indices.size() << " indices, level " << int(level);
+			EXPECT_EQ(decoded, indices) << indices.size() << " indices, level " << int(level);
+		}
+	}
+}
+
+TEST(MeshEncoding, SmallDeltasTakeOneByte)
+{
+	const std::vector<uint32_t> indices = GridIndices(64);
+	const std::vector<unsigned char> encoded = EncodeIndexBuffer(indices.data(), indices.size());
+	// A control block of 2 bits per index, then about a byte each
+	EXPECT_LT(encoded.size(), indices.size() * 3 / 2);
+}
+
+TEST(MeshEncoding, RejectsTruncatedIndexBuffers)
+{
+	const std::vector<uint32_t> indices = RandomIndices(37, 2);
+	const std::vector<unsigned char> encoded = EncodeIndexBuffer(indices.data(), indices.size());
+	std::vector<uint32_t> decoded(indices.size());
+	for (SimdLevel level : kLevels)
+	{
+		for (size_t size = 0; size < encoded.size(); ++size)
+		{
+			EXPECT_FALSE(DecodeIndexBuffer(decoded.data(), encoded.data(), size, level)) << size << " bytes";
+		}
+	}
+	EXPECT_EQ(GetEncodedIndexCount(encoded.data(), 8), 0u);
+}
+
+TEST(MeshEncoding, RejectsCorruptIndexBuffers)
+{
+	const std::vector<uint32_t> indices = GridIndices(8);
+	const std::vector<unsigned char> encoded = EncodeIndexBuffer(indices.data(), indices.size());
+	std::vector<uint32_t> decoded(indices.size() + 64);
+	for (SimdLevel level : kLevels)
+	{
+		// Every single bit flip, in the header, the control block or the data
+		for (size_t byte = 0; byte < encoded.size(); ++byte)
+		{
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				std::vector<unsigned char> corrupt = encoded;
+				corrupt[byte] ^= static_cast<unsigned char>(1 << bit);
+				// A flipped count must not be trusted for sizing either
+				if (GetEncodedIndexCount(corrupt.data(), corrupt.size()) > decoded.size())
+				{
+					continue;
+				}
+				EXPECT_FALSE(DecodeIndexBuffer(decoded.data(), corrupt.data(), corrupt.size(), level)) << "byte " << byte << " bit " << bit;
+			}
+		}
+	}
+}
+
+TEST(MeshEncoding, RejectsLengthsThatDisagreeWithTheData)
+{
+	// Control bits rewritten and the checksum fixed up, so only the decoder's
+	// own bounds checks stand between it and the end of the buffer
+	constexpr size_t kHeaderSize = 24;
+	constexpr size_t kChecksumOffset = 16;
+	// Mixed lengths, so every uniform control block claims too little or too much data
+	const std::vector<uint32_t> indices = RandomIndices(64, 5);
+	const std::vector<unsigned char> encoded = EncodeIndexBuffer(indices.data(), indices.size());
+	std::vector<uint32_t> decoded(indices.size());
+	for (SimdLevel level : kLevels)
+	{
+		for (unsigned char control : { 0x00, 0x55, 0xff })
+		{
+			std::vector<unsigned char> corrupt = encoded;
+			std::memset(corrupt.data() + kHeaderSize, control, (indices.size() + 3) / 4);
+			const uint64_t checksum = Hash64(corrupt.data() + kHeaderSize, corrupt.size() - kHeaderSize);
+			std::memcpy(corrupt.data() + kChecksumOffset, &checksum, sizeof(checksum));
+			EXPECT_FALSE(DecodeIndexBuffer(decoded.data(), corrupt.data(), corrupt.size(), level)) << int(control);
+		}
+	}
+}
+
+TEST(MeshEncoding, HalfToFloatIsExact)
+{
+	for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+	{
+		const float expected = ReferenceHalf(uint16_t(bits));
+		const float actual = HalfToFloat(uint16_t(bits));
+		if (std::isnan(expected))
+		{
+			EXPECT_TRUE(std::isnan(actual)) << std::hex << bits;
+		}
+		else
+		{
+			EXPECT_EQ(actual, expected) << std::hex << bits;
+			EXPECT_EQ(std::signbit(actual), std::signbit(expected)) << std::hex << bits;
+		}
+	}
+}
+
+TEST(MeshEncoding, FloatToHalfRoundTripsEveryHalf)
+{
+	for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+	{
+		const uint16_t half = uint16_t(bits);
+		const uint16_t round_trip = FloatToHalf(HalfToFloat(half));
+		if ((half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0)
+		{
+			// NaNs stay NaNs with the sign kept, payload aside
+			EXPECT_EQ(round_trip & 0xfc00, half & 0xfc00) << std::hex << bits;
+			EXPECT_NE(round_trip & 0x3ff, 0) << std::hex << bits;
+		}
+		else
+		{
+			EXPECT_EQ(round_trip, half) << std::hex << bits;
+		}
+	}
+}
+
+TEST(MeshEncoding, FloatToHalfRoundsToNearestEven)
+{
+	// Between each pair of neighbouring finite halves: the midpoint goes to the
+	// even one, anything off the midpoint to the nearer one
+	for (uint32_t bits = 0; bits < 0x7bff; ++bits)
+	{
+		const float low = HalfToFloat(uint16_t(bits));
+		const float high = HalfToFloat(uint16_t(bits + 1));
+		const float middle = low + (high - low) / 2.0f;
+		const uint16_t even = uint16_t(bits & 1 ? bits + 1 : bits);
+		EXPECT_EQ(FloatToHalf(middle), even) << std::hex << bits;
+		EXPECT_EQ(FloatToHalf(std::nextafter(middle, 0.0f)), bits) << std::hex << bits;
+		EXPECT_EQ(FloatToHalf(std::nextafter(middle, INFINITY)), bits + 1) << std::hex << bits;
+		EXPECT_EQ(FloatToHalf(-middle), even | 0x8000) << std::hex << bits;
+	}
+
+	// Past the largest half, 65504, rounding goes to infinity from 65520 on
+	EXPECT_EQ(FloatToHalf(65519.996f), 0x7bff);
+	EXPECT_EQ(FloatToHalf(65520.0f), 0x7c00);
+	EXPECT_EQ(FloatToHalf(1e10f), 0x7c00);
+	EXPECT_EQ(FloatToHalf(-INFINITY), 0xfc00);
+	EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -25)), 0);
+	EXPECT_EQ(FloatToHalf(std::nextafter(std::ldexp(1.0f, -25), 1.0f)), 1);
+}
+
+TEST(MeshEncoding, OctahedralNormalsStayWithinBound)
+{
+	std::mt19937 rng(3);
+	std::normal_distribution<float> distribution;
+	float worst = 0.0f;
+	for (int i = 0; i < 200000; ++i)
+	{
+		float normal[3] = { distribution(rng), distribution(rng), distribution(rng) };
+		const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (float& c : normal)
+		{
+			c /= length;
+		}
+		int8_t encoded[2];
+		EncodeOctahedral(normal, encoded);
+		float decoded[3];
+		DecodeOctahedral(encoded, decoded);
+		worst = std::max(worst, AngleDegrees(normal, decoded));
+	}
+	// About 0.64 degrees measured over millions of directions
+	EXPECT_LT(worst, 0.7f);
+
+	// Axes and diagonals, including the folded lower hemisphere
+	const float axes[][3] =
+	{
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 0.57735f, 0.57735f, -0.57735f }, { -0.57735f, -0.57735f, -0.57735f },
+	};
+	for (const float (&axis)[3] : axes)
+	{
+		int8_t encoded[2];
+		EncodeOctahedral(axis, encoded);
+		float decoded[3];
+		DecodeOctahedral(encoded, decoded);
+		EXPECT_LT(AngleDegrees(axis, decoded), 0.7f) << axis[0] << " " << axis[1] << " " << axis[2];
+	}
+}
+
+TEST(MeshEncoding, QuantizedVerticesRoundTrip)
+{
+	std::mt19937 rng(4);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> uv(0.0f, 1.0f);
+	std::vector<MeshVertex> vertices(1000);
+	for (MeshVertex& vertex : vertices)
+	{
+		vertex = { { position(rng), position(rng), position(rng) }, { 0.0f, 0.0f, 1.0f }, { uv(rng), uv(rng) } };
+	}
+
+	const VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), vertices.size());
+	std::vector<QuantizedVertex> quantized(vertices.size());
+	QuantizeVertices(quantized.data(), vertices.data(), vertices.size(), quantization);
+	std::vector<MeshVertex> restored(vertices.size());
+	DequantizeVertices(restored.data(), quantized.data(), quantized.size(), quantization);
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			// Half a step of the extent, plus float rounding
+			EXPECT_NEAR(restored[i].position[c], vertices[i].position[c], quantization.scale[c] / 65535.0f * 0.5f + 1e-4f);
+		}
+		for (int c = 0; c < 2; ++c)
+		{
+			EXPECT_NEAR(restored[i].uv[c], vertices[i].uv[c], 1.0f / 2048.0f);
+		}
+		EXPECT_FLOAT_EQ(restored[i].normal[2], 1.0f);
+	}
+}
@@ -0,0 +1,191 @@
+#include "PipelineStateKey.h"
+#include <gtest/gtest.h>
+#include <string>
+
+namespace
+{
+	const unsigned char kVertexShader[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+	const unsigned char kPixelShader[] = { 0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8 };
+	const unsigned char kComputeShader[] = { 0x44, 0x58, 0x42, 0x43, 9, 10, 11, 12 };
+	const unsigned char kMeshShader[] = { 0x44, 0x58, 0x42, 0x43, 13, 14, 15, 16 };
+
+	constexpr uint64_t kRootSignatureHash = 0x1234;
+
+	const PipelineInputElementDesc kInputElements[] =
+	{
+		{ "POSITION", 0, 6, 0, 0, 0, 0 },
+		{ "TEXCOORD", 0, 16, 0, 12, 0, 0 },
+	};
+
+	PipelineStateDesc GraphicsDesc()
+	{
+		PipelineStateDesc desc;
+		desc.vs = { kVertexShader, sizeof(kVertexShader) };
+		desc.ps = { kPixelShader, sizeof(kPixelShader) };
+		desc.input_elements = kInputElements;
+		desc.primitive_topology_type = 3;
+		desc.render_target_count = 1;
+		desc.render_target_formats[0] = 28;
+		desc.blend[0].write_mask = 15;
+		desc.depth_enable = true;
+		desc.depth_write_mask = 1;
+		desc.depth_func = 2;
+		desc.depth_stencil_format = 40;
+		desc.fill_mode = 3;
+		desc.cull_mode = 3;
+		desc.depth_clip_enable = true;
+		desc.sample_mask = UINT32_MAX;
+		return desc;
+	}
+
+	uint64_t KeyOf(const PipelineStateDesc& desc, uint64_t root_signature_hash = kRootSignatureHash)
+	{
+		return PipelineStateKey::FromDesc(desc, root_signature_hash).value;
+	}
+}
+
+TEST(PipelineStateKey, SameDescriptionSameKey)
+{
+	EXPECT_EQ(KeyOf(GraphicsDesc()), KeyOf(GraphicsDesc()));
+}
+
+TEST(PipelineStateKey, RootSignatureChangesKey)
+{
+	EXPECT_NE(KeyOf(GraphicsDesc(), 1), KeyOf(GraphicsDesc(), 2));
+}
+
+TEST(PipelineStateKey, HashesShaderContentNotAddress)
+{
+	const std::basic_string<unsigned char> copy(kPixelShader, sizeof(kPixelShader));
+	PipelineStateDesc desc = GraphicsDesc();
+	desc.ps = { copy.data(), copy.size() };
+	EXPECT_EQ(KeyOf(desc), KeyOf(GraphicsDesc()));
+
+	desc.ps = { kVertexShader, sizeof(kVertexShader) };
+	EXPECT_NE(KeyOf(desc), KeyOf(GraphicsDesc()));
+}
+
+TEST(PipelineStateKey, EmptyShaderIsAbsent)
+{
+	PipelineStateDesc without = GraphicsDesc();
+	PipelineStateDesc empty = GraphicsDesc();
+	empty.gs = { kPixelShader, 0 };
+	EXPECT_EQ(KeyOf(without), KeyOf(empty));
+}
+
+TEST(PipelineStateKey, HashesSemanticNamesByContent)
+{
+	const std::string position = "POSITION";
+	PipelineInputElementDesc elements[] = { kInputElements[0], kInputElements[1] };
+	elements[0].semantic_name = position.c_str();
+	PipelineStateDesc desc = GraphicsDesc();
+	desc.input_elements = elements;
+	EXPECT_EQ(KeyOf(desc), KeyOf(GraphicsDesc()));
+
+	elements[0].semantic_index = 1;
+	EXPECT_NE(KeyOf(desc), KeyOf(GraphicsDesc()));
+}
+
+TEST(PipelineStateKey, ComputeIgnoresGraphicsState)
+{
+	PipelineStateDesc a;
+	a.cs = { kComputeShader, sizeof(kComputeShader) };
+	PipelineStateDesc b = GraphicsDesc();
+	b.cs = a.cs;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	b.node_mask = 1;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, MeshIgnoresInputAssemblerAndVertexStages)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	a.ms = { kMeshShader, sizeof(kMeshShader) };
+	PipelineStateDesc b = a;
+	b.vs = {};
+	b.input_elements = {};
+	b.strip_cut_value = 1;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	PipelineStateDesc vertex = GraphicsDesc();
+	EXPECT_NE(KeyOf(a), KeyOf(vertex));
+}
+
+TEST(PipelineStateKey, DisabledDepthIgnoresOperands)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	a.depth_enable = false;
+	PipelineStateDesc b = a;
+	b.depth_func = 8;
+	b.depth_write_mask = 0;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	a.depth_enable = true;
+	b.depth_enable = true;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, DisabledStencilIgnoresOperands)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	PipelineStateDesc b = a;
+	b.stencil_read_mask = 0x0f;
+	b.front_face.func = 3;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	a.stencil_enable = true;
+	b.stencil_enable = true;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, DisabledBlendIgnoresOperands)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	PipelineStateDesc b = a;
+	b.blend[0].src_blend = 5;
+	b.blend[0].logic_op = 2;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	a.blend[0].blend_enable = true;
+	b.blend[0].blend_enable = true;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, SharedBlendIgnoresOtherTargets)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	a.render_target_count = 2;
+	a.render_target_formats[1] = 28;
+	PipelineStateDesc b = a;
+	b.blend[1].blend_enable = true;
+	b.blend[1].write_mask = 1;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	a.independent_blend_enable = true;
+	b.independent_blend_enable = true;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, IgnoresFormatsPastRenderTargetCount)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	PipelineStateDesc b = a;
+	b.render_target_formats[3] = 10;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	b.render_target_count = 4;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
+
+TEST(PipelineStateKey, NegativeZeroBiasMatchesZero)
+{
+	PipelineStateDesc a = GraphicsDesc();
+	PipelineStateDesc b = a;
+	b.depth_bias_clamp = -0.0f;
+	b.slope_scaled_depth_bias = -0.0f;
+	EXPECT_EQ(KeyOf(a), KeyOf(b));
+
+	b.slope_scaled_depth_bias = 1.0f;
+	EXPECT_NE(KeyOf(a), KeyOf(b));
+}
@@ -0,0 +1,157 @@
+#include "PipelineStream.h"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	constexpr uint64_t kOpaqueVS = 0x1001;
+	constexpr uint64_t kOpaquePS = 0x1002;
+	constexpr uint64_t kCullCS = 0x2001;
+
+	constexpr D3D12_RT_FORMAT_ARRAY kBackBufferFormats = { { DXGI_FORMAT_R8G8B8A8_UNORM }, 1 };
+
+	constexpr PipelineDesc kOpaque{
+		PsoVS{ kOpaqueVS },
+		PsoPS{ kOpaquePS },
+		PsoTopology{ D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE },
+		PsoRasterizer{ kDefaultRasterizerDesc },
+		PsoBlend{ kDefaultBlendDesc },
+		PsoDepthStencil{ kDefaultDepthStencilDesc },
+		PsoDepthFormat{ DXGI_FORMAT_D32_FLOAT },
+		PsoRenderTargets{ kBackBufferFormats } };
+
+	// Same subobjects, listed in another order
+	constexpr PipelineDesc kOpaqueReordered{
+		PsoRenderTargets{ kBackBufferFormats },
+		PsoDepthFormat{ DXGI_FORMAT_D32_FLOAT },
+		PsoDepthStencil{ kDefaultDepthStencilDesc },
+		PsoBlend{ kDefaultBlendDesc },
+		PsoRasterizer{ kDefaultRasterizerDesc },
+		PsoTopology{ D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE },
+		PsoPS{ kOpaquePS },
+		PsoVS{ kOpaqueVS } };
+
+	constexpr PipelineDesc kCull{ PsoCS{ kCullCS } };
+
+	// No depth stencil subobject means D3D12's default, which tests depth, so
+	// this only compiles with the depth format present
+	constexpr PipelineDesc kDefaultDepth{
+		PsoVS{ kOpaqueVS },
+		PsoTopology{ D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE },
+		PsoDepthFormat{ DXGI_FORMAT_D32_FLOAT } };
+
+	// Pinned, so that changing how keys are hashed (which invalidates the
+	// caches on disk) shows up here together with a kKeyVersion bump
+	static_assert(kOpaque.GetStateHash() == 0x186006f7e5c9584aull);
+	static_assert(kCull.GetStateHash() == 0x9d5d5f42da0ac4f4ull);
+	static_assert(kOpaqueReordered.GetStateHash() == kOpaque.GetStateHash());
+	static_assert(kDefaultDepth.GetStateHash() != kOpaque.GetStateHash());
+	static_assert(kOpaque.GetKey(1).value != kOpaque.GetKey(2).value);
+
+	// Bytecode that points at the key, so the test can tell shaders apart in the stream
+	struct FakeShaders
+	{
+		D3D12_SHADER_BYTECODE Find(uint64_t key) const
+		{
+			return D3D12_SHADER_BYTECODE{ reinterpret_cast<const void*>(static_cast<uintptr_t>(key)), sizeof(key) };
+		}
+	};
+
+	using OpaqueStream = decltype(kOpaque.Build(nullptr, FakeShaders{}));
+	using CullStream = decltype(kCull.Build(nullptr, FakeShaders{}));
+
+	template<typename Subobject>
+	using EntryOf = PipelineStreamEntry<Subobject::kType, typename Subobject::InnerType>;
+	template<typename Subobject>
+	constexpr size_t kEntrySize = sizeof(EntryOf<Subobject>);
+	template<typename Subobject>
+	constexpr size_t kValueOffset = offsetof(EntryOf<Subobject>, inner);
+	using RootEntry = PipelineStreamEntry<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*>;
+	constexpr size_t kRootEntrySize = sizeof(RootEntry);
+
+	// 64-bit layout: each entry is its type tag and value padded to 8 bytes.
+	// Root signature 16, VS 24, PS 24, topology 8, rasterizer 48, blend 336,
+	// depth stencil 64, depth format 8, render targets 40.
+	static_assert(sizeof(void*) != 8 || sizeof(OpaqueStream) == 568);
+	// Root signature 16, CS 24
+	static_assert(sizeof(void*) != 8 || sizeof(CullStream) == 40);
+
+	template<typename T>
+	T ReadAt(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, size_t offset)
+	{
+		T value;
+		std::memcpy(&value, static_cast<const unsigned char*>(desc.pPipelineStateSubobjectStream) + offset, sizeof(T));
+		return value;
+	}
+}
+
+TEST(PipelineStream, BuildsComputeStream)
+{
+	ID3D12RootSignature* const root_signature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(0x5000));
+	const CullStream stream = kCull.Build(root_signature, FakeShaders{});
+	const D3D12_PIPELINE_STATE_STREAM_DESC desc = stream.GetDesc();
+	ASSERT_EQ(desc.SizeInBytes, sizeof(CullStream));
+
+	// The root signature comes first, then the subobjects
+	EXPECT_EQ(ReadAt<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE>(desc, 0), D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE);
+	EXPECT_EQ(ReadAt<ID3D12RootSignature*>(desc, offsetof(RootEntry, inner)), root_signature);
+	EXPECT_EQ(ReadAt<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE>(desc, kRootEntrySize), D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS);
+	const D3D12_SHADER_BYTECODE cs = ReadAt<D3D12_SHADER_BYTECODE>(desc, kRootEntrySize + kValueOffset<PsoCS>);
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(cs.pShaderBytecode), kCullCS);
+}
+
+TEST(PipelineStream, BuildsGraphicsStreamInDeclarationOrder)
+{
+	const OpaqueStream stream = kOpaque.Build(nullptr, FakeShaders{});
+	const D3D12_PIPELINE_STATE_STREAM_DESC desc = stream.GetDesc();
+	ASSERT_EQ(desc.SizeInBytes, sizeof(OpaqueStream));
+
+	const D3D12_PIPELINE_STATE_SUBOBJECT_TYPE expected[] =
+	{
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL1,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT,
+		D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS,
+	};
+	const size_t sizes[] =
+	{
+		kRootEntrySize,
+		kEntrySize<PsoVS>,
+		kEntrySize<PsoPS>,
+		kEntrySize<PsoTopology>,
+		kEntrySize<PsoRasterizer>,
+		kEntrySize<PsoBlend>,
+		kEntrySize<PsoDepthStencil>,
+		kEntrySize<PsoDepthFormat>,
+		kEntrySize<PsoRenderTargets>,
+	};
+
+	size_t offset = 0;
+	for (size_t i = 0; i < std::size(expected); ++i)
+	{
+		EXPECT_EQ(ReadAt<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE>(desc, offset), expected[i]) << "entry " << i;
+		offset += sizes[i];
+	}
+	EXPECT_EQ(offset, desc.SizeInBytes);
+
+	const D3D12_SHADER_BYTECODE ps = ReadAt<D3D12_SHADER_BYTECODE>(desc, kRootEntrySize + kEntrySize<PsoVS> + kValueOffset<PsoPS>);
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(ps.pShaderBytecode), kOpaquePS);
+	EXPECT_EQ(ReadAt<DXGI_FORMAT>(desc, offset - kEntrySize<PsoRenderTargets> - kEntrySize<PsoDepthFormat> + kValueOffset<PsoDepthFormat>), DXGI_FORMAT_D32_FLOAT);
+}
+
+#ifndef NDEBUG
+TEST(PipelineStreamDeathTest, MissingDepthStencilNeedsDepthFormat)
+{
+	// Built at run time, so the error asserts instead of failing the compile
+	EXPECT_DEATH(
+		PipelineDesc(PsoVS{ kOpaqueVS }, PsoTopology{ D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE }),
+		"Invalid pipeline description");
+}
+#endif
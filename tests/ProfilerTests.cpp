@@ -0,0 +1,237 @@
+#include "Profiler.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// GPU clock the test advances by hand, at one tick per microsecond. Query
+	// results only show up in the readback memory once resolved.
+	class FakeTimestampSource : public Profiler::TimestampSource
+	{
+	public:
+		explicit FakeTimestampSource(uint32_t query_count)
+			:
+			queries(query_count, 0),
+			readback(query_count, 0)
+		{ }
+
+		void WriteTimestamp(uint32_t query) override
+		{
+			queries.at(query) = gpu_ticks;
+		}
+
+		void Resolve(uint32_t first, uint32_t count) override
+		{
+			resolves.emplace_back(first, count);
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				readback.at(i) = queries.at(i);
+			}
+		}
+
+		const uint64_t* ReadResults(uint32_t first) override
+		{
+			return readback.data() + first;
+		}
+
+		uint64_t GetFrequency() override
+		{
+			return 1000000;
+		}
+
+		void Calibrate(uint64_t& gpu_ticks_out, Profiler::Clock::time_point& cpu_time_out) override
+		{
+			gpu_ticks_out = calibration_ticks;
+			cpu_time_out = calibration_time;
+		}
+
+		uint64_t gpu_ticks = 0;
+		uint64_t calibration_ticks = 0;
+		Profiler::Clock::time_point calibration_time = Profiler::Clock::now();
+		std::vector<uint64_t> queries;
+		std::vector<uint64_t> readback;
+		std::vector<std::pair<uint32_t, uint32_t>> resolves;
+	};
+
+	constexpr uint32_t kSlotCount = 3;
+	constexpr uint32_t kMaxScopes = 4;
+
+	std::vector<Profiler::Event> EventsOn(const Profiler::Frame& frame, Profiler::Track track)
+	{
+		std::vector<Profiler::Event> events;
+		for (const Profiler::Event& event : frame.events)
+		{
+			if (event.track == track)
+			{
+				events.push_back(event);
+			}
+		}
+		return events;
+	}
+}
+
+TEST(Profiler, PublishesCpuScopesOnceTheFrameCompletes)
+{
+	Profiler profiler(nullptr, kSlotCount, kMaxScopes);
+	profiler.BeginFrame(0);
+	{
+		Profiler::CpuScope outer(profiler, "outer");
+		Profiler::CpuScope inner(profiler, "inner");
+	}
+	profiler.EndFrame(1);
+	EXPECT_TRUE(profiler.GetLastFrame().events.empty());
+
+	// Not published while the GPU is still behind
+	profiler.BeginFrame(0);
+	profiler.EndFrame(2);
+	EXPECT_TRUE(profiler.GetLastFrame().events.empty());
+
+	profiler.BeginFrame(1);
+	const Profiler::Frame& frame = profiler.GetLastFrame();
+	EXPECT_EQ(frame.index, 0u);
+	ASSERT_EQ(frame.events.size(), 2u);
+	EXPECT_STREQ(frame.events[0].name, "outer");
+	EXPECT_EQ(frame.events[0].depth, 0);
+	EXPECT_STREQ(frame.events[1].name, "inner");
+	EXPECT_EQ(frame.events[1].depth, 1);
+	for (const Profiler::Event& event : frame.events)
+	{
+		EXPECT_EQ(event.track, Profiler::Track::kCpu);
+		EXPECT_LE(frame.begin_ms, event.begin_ms);
+		EXPECT_LE(event.begin_ms, event.end_ms);
+		EXPECT_LE(event.end_ms, frame.end_ms);
+	}
+	EXPECT_LE(frame.events[0].begin_ms, frame.events[1].begin_ms);
+	EXPECT_GE(frame.events[0].end_ms, frame.events[1].end_ms);
+}
+
+TEST(Profiler, ConvertsGpuTicksThroughCalibration)
+{
+	FakeTimestampSource source(Profiler::QueryCountFor(kSlotCount, kMaxScopes));
+	Profiler profiler(&source, kSlotCount, kMaxScopes);
+	EXPECT_EQ(profiler.GetQueryCount(), kSlotCount * kMaxScopes * 2);
+
+	profiler.BeginFrame(0);
+	source.gpu_ticks = 1000;
+	const Profiler::ScopeId frame_scope = profiler.BeginGpu("frame");
+	source.gpu_ticks = 1500;
+	const Profiler::ScopeId pass_scope = profiler.BeginGpu("pass");
+	source.gpu_ticks = 3500;
+	profiler.EndGpu(pass_scope);
+	source.gpu_ticks = 4000;
+	profiler.EndGpu(frame_scope);
+	profiler.EndFrame(1);
+
+	ASSERT_EQ(source.resolves.size(), 1u);
+	EXPECT_EQ(source.resolves[0], std::make_pair(0u, 4u));
+
+	// The calibration pair is taken after the scopes ran
+	source.calibration_ticks = 10000;
+	source.calibration_time = Profiler::Clock::now();
+	profiler.BeginFrame(1);
+
+	const std::vector<Profiler::Event> gpu = EventsOn(profiler.GetLastFrame(), Profiler::Track::kGpu);
+	ASSERT_EQ(gpu.size(), 2u);
+	const double calibration_ms = profiler.ToMilliseconds(source.calibration_time);
+	EXPECT_STREQ(gpu[0].name, "frame");
+	EXPECT_EQ(gpu[0].depth, 0);
+	EXPECT_NEAR(gpu[0].begin_ms, calibration_ms - 9.0, 1e-9);
+	EXPECT_NEAR(gpu[0].end_ms, calibration_ms - 6.0, 1e-9);
+	EXPECT_STREQ(gpu[1].name, "pass");
+	EXPECT_EQ(gpu[1].depth, 1);
+	EXPECT_NEAR(gpu[1].end_ms - gpu[1].begin_ms, 2.0, 1e-9);
+}
+
+TEST(Profiler, UsesEachSlotsOwnQueries)
+{
+	FakeTimestampSource source(Profiler::QueryCountFor(kSlotCount, kMaxScopes));
+	Profiler profiler(&source, kSlotCount, kMaxScopes);
+
+	// The GPU keeps up, so every frame gets its GPU scope
+	for (uint64_t frame = 0; frame < 2 * kSlotCount; ++frame)
+	{
+		profiler.BeginFrame(frame);
+		source.gpu_ticks = 100 * frame;
+		const Profiler::ScopeId scope = profiler.BeginGpu("work");
+		ASSERT_NE(scope, Profiler::kInvalidScope);
+		source.gpu_ticks += 10 + frame;
+		profiler.EndGpu(scope);
+		profiler.EndFrame(frame + 1);
+
+		const uint32_t first = static_cast<uint32_t>(frame % kSlotCount) * kMaxScopes * 2;
+		EXPECT_EQ(source.resolves.back(), std::make_pair(first, 2u));
+	}
+
+	profiler.BeginFrame(2 * kSlotCount);
+	const Profiler::Frame& last = profiler.GetLastFrame();
+	EXPECT_EQ(last.index, 2 * kSlotCount - 1);
+	const std::vector<Profiler::Event> gpu = EventsOn(last, Profiler::Track::kGpu);
+	ASSERT_EQ(gpu.size(), 1u);
+	EXPECT_NEAR(gpu[0].end_ms - gpu[0].begin_ms, (10 + 2 * kSlotCount - 1) / 1000.0, 1e-9);
+}
+
+TEST(Profiler, DropsGpuScopesWhenTooFarAhead)
+{
+	FakeTimestampSource source(Profiler::QueryCountFor(kSlotCount, kMaxScopes));
+	Profiler profiler(&source, kSlotCount, kMaxScopes);
+
+	// The GPU never finishes anything, so only the first round of slots is free
+	for (uint64_t frame = 0; frame < kSlotCount + 2; ++frame)
+	{
+		profiler.BeginFrame(0);
+		const Profiler::ScopeId scope = profiler.BeginGpu("work");
+		EXPECT_EQ(scope == Profiler::kInvalidScope, frame >= kSlotCount) << "frame " << frame;
+		profiler.EndGpu(scope);
+		profiler.EndFrame(frame + 1);
+	}
+	EXPECT_EQ(source.resolves.size(), kSlotCount);
+
+	// Frames whose slot got reused are lost; the newest ones still publish
+	profiler.BeginFrame(kSlotCount + 2);
+	EXPECT_EQ(profiler.GetLastFrame().index, kSlotCount + 1);
+	EXPECT_TRUE(EventsOn(profiler.GetLastFrame(), Profiler::Track::kGpu).empty());
+}
+
+TEST(Profiler, CapsGpuScopesPerFrame)
+{
+	FakeTimestampSource source(Profiler::QueryCountFor(kSlotCount, kMaxScopes));
+	Profiler profiler(&source, kSlotCount, kMaxScopes);
+
+	profiler.BeginFrame(0);
+	std::vector<Profiler::ScopeId> scopes;
+	for (uint32_t i = 0; i < kMaxScopes + 2; ++i)
+	{
+		scopes.push_back(profiler.BeginGpu("scope"));
+		EXPECT_EQ(scopes.back() == Profiler::kInvalidScope, i >= kMaxScopes);
+	}
+	for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+	{
+		profiler.EndGpu(*scope);
+	}
+	profiler.EndFrame(1);
+	ASSERT_EQ(source.resolves.size(), 1u);
+	EXPECT_EQ(source.resolves[0].second, kMaxScopes * 2);
+
+	profiler.BeginFrame(1);
+	EXPECT_EQ(EventsOn(profiler.GetLastFrame(), Profiler::Track::kGpu).size(), kMaxScopes);
+}
+
+TEST(Profiler, InternsEqualNamesOnce)
+{
+	Profiler profiler(nullptr, 1, 1);
+	std::string name = "shadow pass";
+	const char* interned = profiler.Intern(name);
+	EXPECT_STREQ(interned, "shadow pass");
+
+	// Stable across growth, and independent of the caller's storage
+	for (int i = 0; i < 1000; ++i)
+	{
+		profiler.Intern("pass " + std::to_string(i));
+	}
+	name[0] = 'S';
+	EXPECT_EQ(profiler.Intern("shadow pass"), interned);
+	EXPECT_STREQ(interned, "shadow pass");
+	EXPECT_NE(profiler.Intern(name), interned);
+}
@@ -0,0 +1,407 @@
+#include "RenderGraph.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Barrier = RenderGraph::Barrier;
+	using ResourceId = RenderGraph::ResourceId;
+
+	constexpr uint64_t kSize = 1 << 20;
+	constexpr uint64_t kAlignment = 64 * 1024;
+
+	std::vector<RenderGraph::PassId> CompiledOrder(const RenderGraph::CompiledGraph& compiled)
+	{
+		std::vector<RenderGraph::PassId> order;
+		for (const RenderGraph::CompiledPass& pass : compiled.passes)
+		{
+			order.push_back(pass.pass);
+		}
+		return order;
+	}
+
+	std::vector<Barrier> BarriersBefore(const RenderGraph::CompiledGraph& compiled, uint32_t position)
+	{
+		const RenderGraph::CompiledPass& pass = compiled.passes[position];
+		return std::vector<Barrier>(
+			compiled.barriers.begin() + pass.first_barrier,
+			compiled.barriers.begin() + pass.first_barrier + pass.barrier_count);
+	}
+
+	bool IsTransition(const Barrier& barrier, ResourceId resource, uint32_t before, uint32_t after)
+	{
+		return barrier.type == Barrier::Type::kTransition && barrier.resource == resource &&
+			barrier.state_before == before && barrier.state_after == after;
+	}
+
+	bool Overlaps(uint64_t a_begin, uint64_t a_end, uint64_t b_begin, uint64_t b_end)
+	{
+		return a_begin < b_end && b_begin < a_end;
+	}
+
+	// Transient t<i> is written by pass i and read by pass i + 1; the last
+	// pass writes the back buffer
+	struct Chain
+	{
+		explicit Chain(uint32_t length)
+		{
+			back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+			for (uint32_t i = 0; i < length; ++i)
+			{
+				transients.push_back(graph.CreateTransient("t" + std::to_string(i), kSize, kAlignment));
+			}
+			for (uint32_t i = 0; i <= length; ++i)
+			{
+				const RenderGraph::PassId pass = graph.AddPass("p" + std::to_string(i));
+				if (i > 0)
+				{
+					graph.Read(pass, transients[i - 1], RenderGraph::kPixelShaderResource);
+				}
+				if (i < length)
+				{
+					graph.Write(pass, transients[i], RenderGraph::kRenderTarget);
+				}
+				else
+				{
+					graph.Write(pass, back_buffer, RenderGraph::kRenderTarget);
+				}
+			}
+		}
+
+		RenderGraph graph;
+		ResourceId back_buffer;
+		std::vector<ResourceId> transients;
+	};
+}
+
+TEST(RenderGraph, CullsPassesThatReachNoOutput)
+{
+	RenderGraph graph;
+	const ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	const ResourceId used = graph.CreateTransient("used", kSize, kAlignment);
+	const ResourceId unused = graph.CreateTransient("unused", kSize, kAlignment);
+
+	const RenderGraph::PassId produce = graph.AddPass("produce");
+	graph.Write(produce, used, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId dead = graph.AddPass("dead");
+	graph.Read(dead, used, RenderGraph::kPixelShaderResource);
+	graph.Write(dead, unused, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId present = graph.AddPass("present");
+	graph.Read(present, used, RenderGraph::kPixelShaderResource);
+	graph.Write(present, back_buffer, RenderGraph::kRenderTarget);
+
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	EXPECT_EQ(compiled.culled_pass_count, 1u);
+	EXPECT_EQ(CompiledOrder(compiled), (std::vector<RenderGraph::PassId>{ produce, present }));
+	EXPECT_EQ(compiled.transient_offsets[unused], RenderGraph::kNotPlaced);
+	EXPECT_NE(compiled.transient_offsets[used], RenderGraph::kNotPlaced);
+}
+
+TEST(RenderGraph, KeepsSideEffectsAndOutputs)
+{
+	RenderGraph graph;
+	const ResourceId readback = graph.CreateTransient("readback", kSize, kAlignment);
+	const ResourceId history = graph.CreateTransient("history", kSize, kAlignment);
+	graph.MarkOutput(history);
+
+	const RenderGraph::PassId produce = graph.AddPass("produce");
+	graph.Write(produce, readback, RenderGraph::kUnorderedAccess);
+	const RenderGraph::PassId copy = graph.AddPass("copy");
+	graph.Read(copy, readback, RenderGraph::kCopySource);
+	graph.SetSideEffect(copy);
+	const RenderGraph::PassId accumulate = graph.AddPass("accumulate");
+	graph.Write(accumulate, history, RenderGraph::kUnorderedAccess);
+	graph.AddPass("idle");
+
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	EXPECT_EQ(compiled.culled_pass_count, 1u);
+	const std::vector<RenderGraph::PassId> order = CompiledOrder(compiled);
+	EXPECT_EQ(order, (std::vector<RenderGraph::PassId>{ produce, accumulate, copy }));
+}
+
+TEST(RenderGraph, OrdersByDependencyLevel)
+{
+	RenderGraph graph;
+	const ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	const ResourceId a = graph.CreateTransient("a", kSize, kAlignment);
+	const ResourceId b = graph.CreateTransient("b", kSize, kAlignment);
+
+	const RenderGraph::PassId make_a = graph.AddPass("make a");
+	graph.Write(make_a, a, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId use_a = graph.AddPass("use a");
+	graph.Read(use_a, a, RenderGraph::kPixelShaderResource);
+	graph.Write(use_a, back_buffer, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId make_b = graph.AddPass("make b");
+	graph.Write(make_b, b, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId use_b = graph.AddPass("use b");
+	graph.Read(use_b, b, RenderGraph::kPixelShaderResource);
+	graph.Write(use_b, back_buffer, RenderGraph::kRenderTarget);
+
+	// Both producers are on level 0; the back buffer writes stay in order
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	EXPECT_EQ(CompiledOrder(compiled), (std::vector<RenderGraph::PassId>{ make_a, make_b, use_a, use_b }));
+}
+
+TEST(RenderGraph, AliasesTransientsWithDisjointLifetimes)
+{
+	Chain chain(4);
+	const RenderGraph::CompiledGraph& compiled = chain.graph.Compile();
+
+	// Only neighbours in the chain are alive together, so two slots are enough
+	EXPECT_EQ(compiled.transient_heap_size, 2 * kSize);
+	for (size_t i = 0; i < chain.transients.size(); ++i)
+	{
+		EXPECT_EQ(compiled.transient_offsets[chain.transients[i]], (i % 2) * kSize) << "t" << i;
+	}
+
+	// t2 takes over t0's memory at its first use, and so on down the chain
+	for (uint32_t position = 0; position < 4; ++position)
+	{
+		const std::vector<Barrier> barriers = BarriersBefore(compiled, position);
+		ASSERT_FALSE(barriers.empty());
+		EXPECT_EQ(barriers[0].type, Barrier::Type::kAliasing);
+		EXPECT_EQ(barriers[0].resource, chain.transients[position]);
+		EXPECT_EQ(barriers[0].previous, position >= 2 ? chain.transients[position - 2] : RenderGraph::kInvalidId);
+	}
+}
+
+TEST(RenderGraph, KeepsLiveTransientsApart)
+{
+	RenderGraph graph;
+	const ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	const ResourceId small = graph.CreateTransient("small", 1000, 256);
+	const ResourceId big = graph.CreateTransient("big", 3 * kAlignment, kAlignment);
+	const ResourceId alone = graph.CreateTransient("alone", kSize, kAlignment);
+
+	const RenderGraph::PassId first = graph.AddPass("first");
+	graph.Write(first, small, RenderGraph::kUnorderedAccess);
+	graph.Write(first, big, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId second = graph.AddPass("second");
+	graph.Read(second, small, RenderGraph::kNonPixelShaderResource);
+	graph.Read(second, big, RenderGraph::kPixelShaderResource);
+	graph.Write(second, alone, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId third = graph.AddPass("third");
+	graph.Read(third, alone, RenderGraph::kPixelShaderResource);
+	graph.Write(third, back_buffer, RenderGraph::kRenderTarget);
+
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	const uint64_t small_offset = compiled.transient_offsets[small];
+	const uint64_t big_offset = compiled.transient_offsets[big];
+	const uint64_t alone_offset = compiled.transient_offsets[alone];
+	EXPECT_EQ(small_offset % 256, 0u);
+	EXPECT_EQ(big_offset % kAlignment, 0u);
+	EXPECT_EQ(alone_offset % kAlignment, 0u);
+	EXPECT_FALSE(Overlaps(small_offset, small_offset + 1000, big_offset, big_offset + 3 * kAlignment));
+	EXPECT_FALSE(Overlaps(small_offset, small_offset + 1000, alone_offset, alone_offset + kSize));
+	EXPECT_FALSE(Overlaps(big_offset, big_offset + 3 * kAlignment, alone_offset, alone_offset + kSize));
+	EXPECT_GE(compiled.transient_heap_size, std::max({ small_offset + 1000, big_offset + 3 * kAlignment, alone_offset + kSize }));
+
+	// Nothing shares memory, so there are no aliasing barriers
+	for (const Barrier& barrier : compiled.barriers)
+	{
+		EXPECT_NE(barrier.type, Barrier::Type::kAliasing);
+	}
+}
+
+TEST(RenderGraph, RandomGraphsPlaceAndAliasConsistently)
+{
+	std::mt19937 rng(7);
+	for (int round = 0; round < 20; ++round)
+	{
+		RenderGraph graph;
+		const uint32_t pass_count = 20 + rng() % 200;
+		std::vector<ResourceId> transients;
+		std::vector<uint64_t> sizes;
+		std::vector<uint64_t> alignments;
+		std::vector<std::vector<RenderGraph::PassId>> readers(pass_count);
+		for (uint32_t p = 0; p < pass_count; ++p)
+		{
+			const RenderGraph::PassId pass = graph.AddPass("p" + std::to_string(p));
+			graph.SetSideEffect(pass);
+			const uint32_t reads = transients.empty() ? 0 : rng() % 3;
+			for (uint32_t i = 0; i < reads; ++i)
+			{
+				// Mostly recent resources, sometimes one from far back
+				const size_t back = rng() % 4 == 0 ? rng() % transients.size() : rng() % std::min<size_t>(transients.size(), 8);
+				const ResourceId read = transients[transients.size() - 1 - back];
+				graph.Read(pass, read, RenderGraph::kPixelShaderResource);
+				readers[read].push_back(pass);
+			}
+			sizes.push_back(1 + rng() % (4 * kSize));
+			alignments.push_back(uint64_t(1) << (8 + rng() % 9));
+			transients.push_back(graph.CreateTransient("t" + std::to_string(p), sizes.back(), alignments.back()));
+			graph.Write(pass, transients.back(), RenderGraph::kRenderTarget);
+		}
+
+		const RenderGraph::CompiledGraph& compiled = graph.Compile();
+		ASSERT_EQ(compiled.passes.size(), pass_count);
+
+		// Lifetimes from the compiled order
+		std::vector<uint32_t> first(transients.size(), UINT32_MAX);
+		std::vector<uint32_t> last(transients.size(), 0);
+		std::vector<uint32_t> position_of(pass_count);
+		for (uint32_t position = 0; position < pass_count; ++position)
+		{
+			position_of[compiled.passes[position].pass] = position;
+		}
+		// Transient t is written by pass t, which is also its first use
+		for (size_t t = 0; t < transients.size(); ++t)
+		{
+			first[t] = last[t] = position_of[t];
+		}
+		for (size_t t = 0; t < transients.size(); ++t)
+		{
+			for (RenderGraph::PassId reader : readers[t])
+			{
+				last[t] = std::max(last[t], position_of[reader]);
+			}
+		}
+
+		std::vector<uint32_t> aliasing_count(transients.size(), 0);
+		std::vector<ResourceId> aliasing_previous(transients.size(), RenderGraph::kInvalidId);
+		for (uint32_t position = 0; position < pass_count; ++position)
+		{
+			for (const Barrier& barrier : BarriersBefore(compiled, position))
+			{
+				if (barrier.type == Barrier::Type::kAliasing)
+				{
+					EXPECT_EQ(first[barrier.resource], position);
+					++aliasing_count[barrier.resource];
+					aliasing_previous[barrier.resource] = barrier.previous;
+				}
+			}
+		}
+
+		for (size_t a = 0; a < transients.size(); ++a)
+		{
+			const uint64_t a_begin = compiled.transient_offsets[a];
+			const uint64_t a_end = a_begin + sizes[a];
+			ASSERT_NE(a_begin, RenderGraph::kNotPlaced);
+			EXPECT_EQ(a_begin % alignments[a], 0u);
+			EXPECT_LE(a_end, compiled.transient_heap_size);
+
+			bool shares_memory = false;
+			ResourceId previous = RenderGraph::kInvalidId;
+			for (size_t b = 0; b < transients.size(); ++b)
+			{
+				const uint64_t b_begin = compiled.transient_offsets[b];
+				if (a == b || !Overlaps(a_begin, a_end, b_begin, b_begin + sizes[b]))
+				{
+					continue;
+				}
+				ASSERT_FALSE(first[a] <= last[b] && first[b] <= last[a])
+					<< "t" << a << " and t" << b << " are alive together but share memory";
+				shares_memory = true;
+				if (last[b] < first[a] && (previous == RenderGraph::kInvalidId || last[b] > last[previous]))
+				{
+					previous = static_cast<ResourceId>(b);
+				}
+			}
+			EXPECT_EQ(aliasing_count[a], shares_memory ? 1u : 0u) << "t" << a;
+			// Any of the resources that finished last will do
+			if (previous == RenderGraph::kInvalidId || aliasing_previous[a] == RenderGraph::kInvalidId)
+			{
+				EXPECT_EQ(aliasing_previous[a], previous) << "t" << a;
+			}
+			else
+			{
+				const ResourceId named = aliasing_previous[a];
+				const uint64_t named_begin = compiled.transient_offsets[named];
+				EXPECT_TRUE(Overlaps(a_begin, a_end, named_begin, named_begin + sizes[named])) << "t" << a;
+				EXPECT_EQ(last[named], last[previous]) << "t" << a;
+			}
+		}
+	}
+}
+
+TEST(RenderGraph, BuildsTransitionsAndUavBarriers)
+{
+	RenderGraph graph;
+	const ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	const ResourceId color = graph.CreateTransient("color", kSize, kAlignment);
+	const ResourceId buffer = graph.CreateTransient("buffer", kSize, kAlignment);
+
+	const RenderGraph::PassId draw = graph.AddPass("draw");
+	graph.Write(draw, color, RenderGraph::kRenderTarget);
+	const RenderGraph::PassId simulate = graph.AddPass("simulate");
+	graph.Read(simulate, color, RenderGraph::kNonPixelShaderResource);
+	graph.Write(simulate, buffer, RenderGraph::kUnorderedAccess);
+	const RenderGraph::PassId resolve = graph.AddPass("resolve");
+	graph.Write(resolve, buffer, RenderGraph::kUnorderedAccess);
+	const RenderGraph::PassId composite = graph.AddPass("composite");
+	graph.Read(composite, color, RenderGraph::kNonPixelShaderResource | RenderGraph::kPixelShaderResource);
+	graph.Read(composite, buffer, RenderGraph::kPixelShaderResource);
+	graph.Write(composite, back_buffer, RenderGraph::kRenderTarget);
+
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	ASSERT_EQ(CompiledOrder(compiled), (std::vector<RenderGraph::PassId>{ draw, simulate, resolve, composite }));
+
+	// Transients start in their first state, so the first pass needs nothing
+	EXPECT_TRUE(BarriersBefore(compiled, 0).empty());
+	EXPECT_EQ(compiled.transient_initial_states[color], RenderGraph::kRenderTarget);
+	EXPECT_EQ(compiled.transient_initial_states[buffer], RenderGraph::kUnorderedAccess);
+
+	const std::vector<Barrier> before_simulate = BarriersBefore(compiled, 1);
+	ASSERT_EQ(before_simulate.size(), 1u);
+	EXPECT_TRUE(IsTransition(before_simulate[0], color, RenderGraph::kRenderTarget, RenderGraph::kNonPixelShaderResource));
+
+	const std::vector<Barrier> before_resolve = BarriersBefore(compiled, 2);
+	ASSERT_EQ(before_resolve.size(), 1u);
+	EXPECT_EQ(before_resolve[0].type, Barrier::Type::kUav);
+	EXPECT_EQ(before_resolve[0].resource, buffer);
+
+	const std::vector<Barrier> before_composite = BarriersBefore(compiled, 3);
+	ASSERT_EQ(before_composite.size(), 3u);
+	EXPECT_TRUE(IsTransition(before_composite[0], color, RenderGraph::kNonPixelShaderResource,
+		RenderGraph::kNonPixelShaderResource | RenderGraph::kPixelShaderResource));
+	EXPECT_TRUE(IsTransition(before_composite[1], buffer, RenderGraph::kUnorderedAccess, RenderGraph::kPixelShaderResource));
+	EXPECT_TRUE(IsTransition(before_composite[2], back_buffer, RenderGraph::kPresent, RenderGraph::kRenderTarget));
+
+	// Imports go to their final state, transients back to where they start next frame
+	ASSERT_EQ(compiled.final_barriers.size(), 3u);
+	EXPECT_TRUE(IsTransition(compiled.final_barriers[0], back_buffer, RenderGraph::kRenderTarget, RenderGraph::kPresent));
+	EXPECT_TRUE(IsTransition(compiled.final_barriers[1], color,
+		RenderGraph::kNonPixelShaderResource | RenderGraph::kPixelShaderResource, RenderGraph::kRenderTarget));
+	EXPECT_TRUE(IsTransition(compiled.final_barriers[2], buffer, RenderGraph::kPixelShaderResource, RenderGraph::kUnorderedAccess));
+}
+
+TEST(RenderGraph, SkipsTransitionsIntoContainedReadStates)
+{
+	RenderGraph graph;
+	const ResourceId back_buffer = graph.Import("back buffer", RenderGraph::kPresent, RenderGraph::kPresent);
+	const ResourceId texture = graph.CreateTransient("texture", kSize, kAlignment);
+
+	const RenderGraph::PassId upload = graph.AddPass("upload");
+	graph.Write(upload, texture, RenderGraph::kCopyDest);
+	const RenderGraph::PassId both = graph.AddPass("both");
+	graph.Read(both, texture, RenderGraph::kNonPixelShaderResource | RenderGraph::kPixelShaderResource);
+	graph.SetSideEffect(both);
+	const RenderGraph::PassId pixel = graph.AddPass("pixel");
+	graph.Read(pixel, texture, RenderGraph::kPixelShaderResource);
+	graph.Write(pixel, back_buffer, RenderGraph::kRenderTarget);
+
+	const RenderGraph::CompiledGraph& compiled = graph.Compile();
+	ASSERT_EQ(compiled.passes.size(), 3u);
+	const std::vector<Barrier> before_pixel = BarriersBefore(compiled, 2);
+	ASSERT_EQ(before_pixel.size(), 1u);
+	EXPECT_EQ(before_pixel[0].resource, back_buffer);
+}
+
+TEST(RenderGraph, RecompilesAfterReset)
+{
+	Chain chain(3);
+	const RenderGraph::CompiledGraph first = chain.graph.Compile();
+	const RenderGraph::CompiledGraph& second = chain.graph.Compile();
+	EXPECT_EQ(first.transient_offsets, second.transient_offsets);
+	EXPECT_EQ(first.barriers.size(), second.barriers.size());
+
+	chain.graph.Reset();
+	EXPECT_EQ(chain.graph.GetPassCount(), 0u);
+	EXPECT_EQ(chain.graph.GetResourceCount(), 0u);
+	const RenderGraph::CompiledGraph& empty = chain.graph.Compile();
+	EXPECT_TRUE(empty.passes.empty());
+	EXPECT_EQ(empty.transient_heap_size, 0u);
+}
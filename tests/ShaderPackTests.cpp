@@ -0,0 +1,223 @@
+#include "ShaderPack.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<unsigned char> RandomBytecode(std::mt19937& rng, size_t size)
+	{
+		std::vector<unsigned char> bytes(size);
+		for (unsigned char& byte : bytes)
+		{
+			byte = static_cast<unsigned char>(rng());
+		}
+		return bytes;
+	}
+
+	// Copies into 8-byte aligned storage, as a file mapping would be
+	struct AlignedCopy
+	{
+		explicit AlignedCopy(const std::vector<unsigned char>& bytes)
+			:
+			words((bytes.size() + 7) / 8)
+		{
+			if (!bytes.empty())
+			{
+				std::memcpy(words.data(), bytes.data(), bytes.size());
+			}
+		}
+
+		std::vector<uint64_t> words;
+	};
+
+	ShaderPack::Header& HeaderOf(std::vector<unsigned char>& file)
+	{
+		return *reinterpret_cast<ShaderPack::Header*>(file.data());
+	}
+
+	ShaderPack::Entry* EntriesOf(std::vector<unsigned char>& file)
+	{
+		return reinterpret_cast<ShaderPack::Entry*>(file.data() + sizeof(ShaderPack::Header));
+	}
+
+	bool IsValidPack(const std::vector<unsigned char>& file, size_t size)
+	{
+		const AlignedCopy copy(file);
+		return ShaderPack(copy.words.data(), size).IsValid();
+	}
+
+	// Three keys, two of them sharing bytecode
+	ShaderPack::Writer SmallPackWriter()
+	{
+		const unsigned char a[] = { 1, 2, 3 };
+		const unsigned char b[] = { 4, 5, 6, 7, 8 };
+		ShaderPack::Writer writer;
+		writer.Add(30, a, sizeof(a));
+		writer.Add(10, b, sizeof(b));
+		writer.Add(20, a, sizeof(a));
+		return writer;
+	}
+
+	std::vector<unsigned char> SmallPack()
+	{
+		return SmallPackWriter().Build();
+	}
+}
+
+TEST(ShaderPack, RoundTripsBytecode)
+{
+	std::mt19937 rng(5);
+	std::vector<std::vector<unsigned char>> shaders;
+	std::vector<uint64_t> keys;
+	ShaderPack::Writer writer;
+	for (int i = 0; i < 200; ++i)
+	{
+		shaders.push_back(RandomBytecode(rng, 1 + rng() % 3000));
+		keys.push_back((uint64_t(rng()) << 32) | rng());
+		ASSERT_TRUE(writer.Add(keys.back(), shaders.back().data(), shaders.back().size()));
+	}
+
+	const std::vector<unsigned char> file = writer.Build();
+	const AlignedCopy copy(file);
+	const ShaderPack pack(copy.words.data(), file.size());
+	ASSERT_TRUE(pack.IsValid());
+	EXPECT_EQ(pack.GetEntryCount(), shaders.size());
+
+	const unsigned char* base = reinterpret_cast<const unsigned char*>(copy.words.data());
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		const ShaderPack::Blob blob = pack.Find(keys[i]);
+		ASSERT_TRUE(blob);
+		ASSERT_EQ(blob.size, shaders[i].size());
+		EXPECT_EQ(std::memcmp(blob.data, shaders[i].data(), blob.size), 0);
+		EXPECT_EQ((static_cast<const unsigned char*>(blob.data) - base) % ShaderPack::kBlobAlignment, 0);
+	}
+	EXPECT_FALSE(pack.Find(0x5eed));
+}
+
+TEST(ShaderPack, RoundTripsThroughFile)
+{
+	const ShaderPack::Writer writer = SmallPackWriter();
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "shader_pack_test.spak";
+	ASSERT_TRUE(writer.WriteToFile(path.wstring()));
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<unsigned char> read((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	std::filesystem::remove(path);
+
+	EXPECT_EQ(read, writer.Build());
+	EXPECT_TRUE(IsValidPack(read, read.size()));
+}
+
+TEST(ShaderPack, SharesIdenticalBytecode)
+{
+	std::vector<unsigned char> file = SmallPack();
+	const AlignedCopy copy(file);
+	const ShaderPack pack(copy.words.data(), file.size());
+	ASSERT_TRUE(pack.IsValid());
+	EXPECT_EQ(pack.GetEntryCount(), 3u);
+	EXPECT_EQ(pack.Find(20).data, pack.Find(30).data);
+	EXPECT_NE(pack.Find(10).data, pack.Find(20).data);
+}
+
+TEST(ShaderPack, RejectsDuplicateKeys)
+{
+	const unsigned char a[] = { 1 };
+	const unsigned char b[] = { 2 };
+	ShaderPack::Writer writer;
+	EXPECT_TRUE(writer.Add(1, a, sizeof(a)));
+	EXPECT_FALSE(writer.Add(1, b, sizeof(b)));
+}
+
+TEST(ShaderPack, EmptyPackIsValid)
+{
+	const std::vector<unsigned char> file = ShaderPack::Writer().Build();
+	const AlignedCopy copy(file);
+	const ShaderPack pack(copy.words.data(), file.size());
+	EXPECT_TRUE(pack.IsValid());
+	EXPECT_EQ(pack.GetEntryCount(), 0u);
+	EXPECT_FALSE(pack.Find(1));
+}
+
+TEST(ShaderPack, RejectsCorruptHeader)
+{
+	const std::vector<unsigned char> good = SmallPack();
+	ASSERT_TRUE(IsValidPack(good, good.size()));
+
+	std::vector<unsigned char> file = good;
+	HeaderOf(file).magic ^= 1;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+
+	file = good;
+	HeaderOf(file).version = ShaderPack::kVersion + 1;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+
+	file = good;
+	HeaderOf(file).file_size += 16;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+
+	file = good;
+	HeaderOf(file).entry_count = 1000000;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+}
+
+TEST(ShaderPack, RejectsCorruptEntries)
+{
+	const std::vector<unsigned char> good = SmallPack();
+
+	std::vector<unsigned char> file = good;
+	EntriesOf(file)[1].offset = file.size() + 1;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+
+	file = good;
+	EntriesOf(file)[2].size = UINT64_MAX;
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+
+	file = good;
+	std::swap(EntriesOf(file)[0], EntriesOf(file)[1]);
+	EXPECT_FALSE(IsValidPack(file, file.size()));
+}
+
+TEST(ShaderPack, RejectsTruncatedFile)
+{
+	const std::vector<unsigned char> good = SmallPack();
+	for (size_t size = 0; size < good.size(); ++size)
+	{
+		EXPECT_FALSE(IsValidPack(good, size)) << "truncated to " << size << " bytes";
+
+		// Also with the header patched to claim the truncated size
+		std::vector<unsigned char> file(good.begin(), good.begin() + size);
+		if (size >= sizeof(ShaderPack::Header))
+		{
+			HeaderOf(file).file_size = size;
+			const AlignedCopy copy(file);
+			const ShaderPack pack(copy.words.data(), size);
+			for (uint64_t key : { 10, 20, 30 })
+			{
+				const ShaderPack::Blob blob = pack.Find(key);
+				if (blob)
+				{
+					EXPECT_LE(static_cast<const unsigned char*>(blob.data) + blob.size,
+						reinterpret_cast<const unsigned char*>(copy.words.data()) + size);
+				}
+			}
+		}
+	}
+}
+
+TEST(ShaderPack, RejectsMisalignedView)
+{
+	const std::vector<unsigned char> good = SmallPack();
+	std::vector<uint64_t> words(good.size() / 8 + 2);
+	unsigned char* misaligned = reinterpret_cast<unsigned char*>(words.data()) + 1;
+	std::memcpy(misaligned, good.data(), good.size());
+	EXPECT_FALSE(ShaderPack(misaligned, good.size()).IsValid());
+	EXPECT_FALSE(ShaderPack(nullptr, good.size()).IsValid());
+}
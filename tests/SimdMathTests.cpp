@@ -0,0 +1,71 @@
+#include "SimdMath.h"
+#include <gtest/gtest.h>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+	constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+	// Compared bit for bit, so NaN and the sign of zero count
+	void ExpectLanes(SimdFloat4 actual, float x, float y, float z, float w)
+	{
+		alignas(16) float lanes[4];
+		SimdStore(lanes, actual);
+		const float expected[4] = { x, y, z, w };
+		for (int i = 0; i < 4; ++i)
+		{
+			if (std::isnan(expected[i]))
+			{
+				EXPECT_TRUE(std::isnan(lanes[i])) << "lane " << i;
+			}
+			else
+			{
+				EXPECT_EQ(std::bit_cast<uint32_t>(lanes[i]), std::bit_cast<uint32_t>(expected[i])) << "lane " << i << ": " << lanes[i];
+			}
+		}
+	}
+}
+
+// SimdMin/SimdMax on whichever backend this build uses (SSE2, NEON or scalar):
+// a NaN in either operand, or two zeros, give the second operand
+TEST(SimdMath, MinMaxReturnSecondOperandForNaN)
+{
+	const SimdFloat4 a = SimdSet(kNaN, 1.0f, kNaN, -0.0f);
+	const SimdFloat4 b = SimdSet(2.0f, kNaN, kNaN, 0.0f);
+	ExpectLanes(SimdMin(a, b), 2.0f, kNaN, kNaN, 0.0f);
+	ExpectLanes(SimdMax(a, b), 2.0f, kNaN, kNaN, 0.0f);
+	ExpectLanes(SimdMin(b, a), kNaN, 1.0f, kNaN, -0.0f);
+	ExpectLanes(SimdMax(b, a), kNaN, 1.0f, kNaN, -0.0f);
+
+	ExpectLanes(SimdMin(SimdSet(1.0f, 5.0f, -3.0f, 0.0f), SimdSet(2.0f, 4.0f, -4.0f, 1.0f)), 1.0f, 4.0f, -4.0f, 0.0f);
+	ExpectLanes(SimdMax(SimdSet(1.0f, 5.0f, -3.0f, 0.0f), SimdSet(2.0f, 4.0f, -4.0f, 1.0f)), 2.0f, 5.0f, -3.0f, 1.0f);
+}
+
+// The scalar backend's lane operations, which every build has
+TEST(SimdMath, ScalarMinMaxReturnSecondOperandForNaN)
+{
+	EXPECT_EQ(SimdScalarMin(kNaN, 2.0f), 2.0f);
+	EXPECT_EQ(SimdScalarMax(kNaN, 2.0f), 2.0f);
+	EXPECT_TRUE(std::isnan(SimdScalarMin(1.0f, kNaN)));
+	EXPECT_TRUE(std::isnan(SimdScalarMax(1.0f, kNaN)));
+	EXPECT_FALSE(std::signbit(SimdScalarMin(-0.0f, 0.0f)));
+	EXPECT_TRUE(std::signbit(SimdScalarMax(0.0f, -0.0f)));
+	EXPECT_EQ(SimdScalarMin(1.0f, 2.0f), 1.0f);
+	EXPECT_EQ(SimdScalarMax(1.0f, 2.0f), 2.0f);
+}
+
+// Vec3/Vec4 Min and Max go through the same lanes
+TEST(SimdMath, VectorMinMaxSkipNaNInFirstOperand)
+{
+	const Vec3 low = Min(Vec3(kNaN, kNaN, 1.0f), Vec3(-1.0f, 2.0f, 3.0f));
+	EXPECT_EQ(low.x, -1.0f);
+	EXPECT_EQ(low.y, 2.0f);
+	EXPECT_EQ(low.z, 1.0f);
+
+	const Vec3 high = Max(Vec3(kNaN, 5.0f, kNaN), Vec3(-1.0f, 2.0f, 3.0f));
+	EXPECT_EQ(high.x, -1.0f);
+	EXPECT_EQ(high.y, 5.0f);
+	EXPECT_EQ(high.z, 3.0f);
+}
@@ -0,0 +1,278 @@
+#include "TextureConvert.h"
+#include "ThreadPool.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr SimdLevel kLevels[] = { SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2 };
+	constexpr PixelOp kOps[] =
+	{
+		PixelOp::kSwapRedBlue,
+		PixelOp::kExpandRgb,
+		PixelOp::kSrgbToLinear,
+		PixelOp::kLinearToSrgb,
+		PixelOp::kPremultiplyAlpha,
+		PixelOp::kPremultiplyAlphaSrgb
+	};
+
+	// Rows are padded past the pixels, with the padding filled in too, so
+	// writes outside the rectangle show up as differences
+	struct Image
+	{
+		Image(uint32_t image_width, uint32_t image_height, uint32_t bytes_per_pixel, uint32_t padding, std::mt19937& random)
+			:
+			width(image_width),
+			height(image_height),
+			row_pitch(size_t(image_width) * bytes_per_pixel + padding),
+			bytes(row_pitch * image_height)
+		{
+			for (uint8_t& byte : bytes)
+			{
+				byte = static_cast<uint8_t>(random());
+			}
+		}
+
+		uint32_t width;
+		uint32_t height;
+		size_t row_pitch;
+		std::vector<uint8_t> bytes;
+	};
+
+	PixelConversion Conversion(Image& dest, const Image& src)
+	{
+		PixelConversion conversion;
+		conversion.dest = dest.bytes.data();
+		conversion.dest_row_pitch = dest.row_pitch;
+		conversion.src = src.bytes.data();
+		conversion.src_row_pitch = src.row_pitch;
+		conversion.width = src.width;
+		conversion.height = src.height;
+		return conversion;
+	}
+
+	std::string Describe(PixelOp op, SimdLevel level, uint32_t width, uint32_t height)
+	{
+		return "op " + std::to_string(int(op)) + ", level " + std::to_string(int(level)) +
+			", " + std::to_string(width) + "x" + std::to_string(height);
+	}
+
+	uint8_t ApplyScalarReference(PixelOp op, const uint8_t* pixel, uint32_t channel)
+	{
+		switch (op)
+		{
+			case PixelOp::kSwapRedBlue: return pixel[channel == 0 ? 2 : channel == 2 ? 0 : channel];
+			case PixelOp::kPremultiplyAlpha: return channel == 3 ? pixel[3] : static_cast<uint8_t>((pixel[channel] * pixel[3] + 127) / 255);
+			default: return 0;
+		}
+	}
+}
+
+TEST(TextureConvert, SimdLevelsMatchScalar)
+{
+	std::mt19937 random(41);
+	for (int round = 0; round < 200; ++round)
+	{
+		// Widths around every vector width and tail length
+		const uint32_t width = 1 + random() % (round < 100 ? 40 : 300);
+		const uint32_t height = 1 + random() % 12;
+		for (PixelOp op : kOps)
+		{
+			const uint32_t src_bytes = op == PixelOp::kExpandRgb ? 3 : 4;
+			const Image src(width, height, src_bytes, random() % 16, random);
+			const Image initial(width, height, 4, random() % 16, random);
+
+			Image expected = initial;
+			ConvertPixels(Conversion(expected, src), op, nullptr, SimdLevel::kScalar);
+			for (SimdLevel level : kLevels)
+			{
+				SCOPED_TRACE(Describe(op, level, width, height));
+				Image actual = initial;
+				ConvertPixels(Conversion(actual, src), op, nullptr, level);
+				ASSERT_EQ(actual.bytes, expected.bytes);
+
+				// In place gives the same pixels
+				if (op != PixelOp::kExpandRgb)
+				{
+					Image in_place = src;
+					ConvertPixels(Conversion(in_place, in_place), op, nullptr, level);
+					for (uint32_t y = 0; y < height; ++y)
+					{
+						ASSERT_TRUE(std::equal(
+							in_place.bytes.begin() + y * in_place.row_pitch,
+							in_place.bytes.begin() + y * in_place.row_pitch + width * 4,
+							expected.bytes.begin() + y * expected.row_pitch)) << "row " << y;
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(TextureConvert, DownsampleSimdLevelsMatchScalar)
+{
+	std::mt19937 random(42);
+	for (int round = 0; round < 200; ++round)
+	{
+		// Odd sizes and 1-pixel edges included
+		const uint32_t width = 1 + random() % (round < 100 ? 40 : 300);
+		const uint32_t height = 1 + random() % 12;
+		const Image src(width, height, 4, random() % 16, random);
+		const Image initial(std::max(1u, width / 2), std::max(1u, height / 2), 4, random() % 16, random);
+
+		for (bool srgb : { false, true })
+		{
+			Image expected = initial;
+			DownsampleMip(Conversion(expected, src), srgb, nullptr, SimdLevel::kScalar);
+			for (SimdLevel level : kLevels)
+			{
+				Image actual = initial;
+				DownsampleMip(Conversion(actual, src), srgb, nullptr, level);
+				ASSERT_EQ(actual.bytes, expected.bytes) << (srgb ? "srgb, " : "linear, ") << Describe(PixelOp(0), level, width, height);
+			}
+		}
+	}
+}
+
+TEST(TextureConvert, PoolMatchesSingleThread)
+{
+	// Big enough to be split into bands
+	std::mt19937 random(43);
+	const Image src(1000, 700, 4, 24, random);
+	const Image initial(1000, 700, 4, 24, random);
+	ThreadPool pool(3);
+
+	for (PixelOp op : { PixelOp::kSwapRedBlue, PixelOp::kLinearToSrgb, PixelOp::kPremultiplyAlphaSrgb })
+	{
+		Image expected = initial;
+		ConvertPixels(Conversion(expected, src), op, nullptr);
+		Image actual = initial;
+		ConvertPixels(Conversion(actual, src), op, &pool);
+		EXPECT_EQ(actual.bytes, expected.bytes) << "op " << int(op);
+	}
+
+	for (bool srgb : { false, true })
+	{
+		const Image half(500, 350, 4, 0, random);
+		Image expected = half;
+		DownsampleMip(Conversion(expected, src), srgb, nullptr);
+		Image actual = half;
+		DownsampleMip(Conversion(actual, src), srgb, &pool);
+		EXPECT_EQ(actual.bytes, expected.bytes) << (srgb ? "srgb" : "linear");
+	}
+}
+
+TEST(TextureConvert, MatchesReferenceFormulas)
+{
+	std::mt19937 random(44);
+	const Image src(37, 5, 4, 0, random);
+	for (PixelOp op : { PixelOp::kSwapRedBlue, PixelOp::kPremultiplyAlpha })
+	{
+		for (SimdLevel level : kLevels)
+		{
+			Image dest(37, 5, 4, 0, random);
+			ConvertPixels(Conversion(dest, src), op, nullptr, level);
+			for (size_t i = 0; i < src.bytes.size(); ++i)
+			{
+				ASSERT_EQ(dest.bytes[i], ApplyScalarReference(op, &src.bytes[i & ~size_t(3)], uint32_t(i & 3))) << Describe(op, level, 37, 5) << ", byte " << i;
+			}
+		}
+	}
+
+	// RGB -> RGBA keeps the color and makes it opaque
+	const uint8_t rgb[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27 };
+	const uint8_t rgba[] = { 1, 2, 3, 255, 4, 5, 6, 255, 7, 8, 9, 255, 10, 11, 12, 255, 13, 14, 15, 255, 16, 17, 18, 255, 19, 20, 21, 255, 22, 23, 24, 255, 25, 26, 27, 255 };
+	for (SimdLevel level : kLevels)
+	{
+		uint8_t out[sizeof(rgba)] = {};
+		PixelConversion conversion;
+		conversion.dest = out;
+		conversion.dest_row_pitch = sizeof(out);
+		conversion.src = rgb;
+		conversion.src_row_pitch = sizeof(rgb);
+		conversion.width = 9;
+		conversion.height = 1;
+		ConvertPixels(conversion, PixelOp::kExpandRgb, nullptr, level);
+		EXPECT_TRUE(std::equal(std::begin(out), std::end(out), std::begin(rgba))) << "level " << int(level);
+	}
+}
+
+TEST(TextureConvert, SrgbEndpointsAndMidpoint)
+{
+	// sRGB 188 is linear 0.5; alpha passes through
+	uint8_t pixels[] = { 0, 188, 255, 77 };
+	PixelConversion conversion;
+	conversion.dest = pixels;
+	conversion.dest_row_pitch = sizeof(pixels);
+	conversion.src = pixels;
+	conversion.src_row_pitch = sizeof(pixels);
+	conversion.width = 1;
+	conversion.height = 1;
+	ConvertPixels(conversion, PixelOp::kSrgbToLinear);
+	EXPECT_EQ(pixels[0], 0);
+	EXPECT_EQ(pixels[1], 128);
+	EXPECT_EQ(pixels[2], 255);
+	EXPECT_EQ(pixels[3], 77);
+	ConvertPixels(conversion, PixelOp::kLinearToSrgb);
+	EXPECT_EQ(pixels[0], 0);
+	EXPECT_EQ(pixels[1], 188);
+	EXPECT_EQ(pixels[2], 255);
+	EXPECT_EQ(pixels[3], 77);
+}
+
+TEST(TextureConvert, DownsamplesInLinearLight)
+{
+	// Black and white checker: a linear average is 128, in linear light it is
+	// half the intensity, sRGB 188
+	const uint8_t checker[] =
+	{
+		0, 0, 0, 0, 255, 255, 255, 255,
+		255, 255, 255, 255, 0, 0, 0, 0
+	};
+	for (SimdLevel level : kLevels)
+	{
+		uint8_t mip[4] = {};
+		PixelConversion conversion;
+		conversion.dest = mip;
+		conversion.dest_row_pitch = sizeof(mip);
+		conversion.src = checker;
+		conversion.src_row_pitch = 8;
+		conversion.width = 2;
+		conversion.height = 2;
+		DownsampleMip(conversion, false, nullptr, level);
+		EXPECT_EQ(mip[0], 128);
+		EXPECT_EQ(mip[3], 128);
+		DownsampleMip(conversion, true, nullptr, level);
+		EXPECT_EQ(mip[0], 188);
+		EXPECT_EQ(mip[3], 128);
+	}
+}
+
+TEST(TextureConvert, GeneratesFullMipChains)
+{
+	EXPECT_EQ(GetMipLevelCount(1, 1), 1u);
+	EXPECT_EQ(GetMipLevelCount(256, 256), 9u);
+	EXPECT_EQ(GetMipLevelCount(300, 17), 9u);
+
+	std::mt19937 random(45);
+	const Image src(300, 17, 4, 8, random);
+	const MipChain chain = GenerateMipChain(src.bytes.data(), src.row_pitch, 300, 17, true);
+	ASSERT_EQ(chain.levels.size(), 9u);
+	size_t offset = 0;
+	for (size_t i = 0; i < chain.levels.size(); ++i)
+	{
+		const MipChain::Level& level = chain.levels[i];
+		EXPECT_EQ(level.offset, offset);
+		EXPECT_EQ(level.width, std::max(1u, 300u >> i));
+		EXPECT_EQ(level.height, std::max(1u, 17u >> i));
+		EXPECT_EQ(level.row_pitch, level.width * 4u);
+		offset += level.row_pitch * level.height;
+	}
+	EXPECT_EQ(chain.data.size(), offset);
+	EXPECT_TRUE(std::equal(chain.data.begin(), chain.data.begin() + 1200, src.bytes.begin()));
+
+	EXPECT_EQ(GenerateMipChain(src.bytes.data(), src.row_pitch, 300, 17, false, 3).levels.size(), 3u);
+}
@@ -0,0 +1,227 @@
+#include "TextureFootprint.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// DXGI_FORMAT values
+	constexpr uint32_t kR32G32B32Float = 6;
+	constexpr uint32_t kR16G16B16A16Float = 10;
+	constexpr uint32_t kR8G8B8A8Unorm = 28;
+	constexpr uint32_t kR8Unorm = 61;
+	constexpr uint32_t kBc1Unorm = 71;
+	constexpr uint32_t kBc7Unorm = 98;
+
+	struct ExpectedFootprint
+	{
+		uint64_t offset;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t row_pitch;
+		uint32_t row_count;
+		uint64_t row_size;
+	};
+
+	struct FootprintCase
+	{
+		const char* name;
+		TextureFootprintDesc desc;
+		std::vector<ExpectedFootprint> footprints;	// Every subresource, from offset 0
+		uint64_t total_bytes;
+	};
+
+	TextureFootprintDesc Desc(TextureDimension dimension, uint32_t format, uint64_t width, uint32_t height, uint16_t depth_or_array_size, uint16_t mip_levels)
+	{
+		TextureFootprintDesc desc;
+		desc.dimension = dimension;
+		desc.format = format;
+		desc.width = width;
+		desc.height = height;
+		desc.depth_or_array_size = depth_or_array_size;
+		desc.mip_levels = mip_levels;
+		return desc;
+	}
+
+	// What ID3D12Device::GetCopyableFootprints reports for these descriptions:
+	// rows pitched to 256 bytes, subresources placed on 512 bytes, sizes in
+	// whole blocks, and no padding after the last row in the total
+	const FootprintCase kCases[] =
+	{
+		{
+			"RGBA8 256x256",
+			Desc(TextureDimension::kTexture2D, kR8G8B8A8Unorm, 256, 256, 1, 1),
+			{ { 0, 256, 256, 1, 1024, 256, 1024 } },
+			262144
+		},
+		{
+			"RGBA8 100x100, padded rows",
+			Desc(TextureDimension::kTexture2D, kR8G8B8A8Unorm, 100, 100, 1, 1),
+			{ { 0, 100, 100, 1, 512, 100, 400 } },
+			51088
+		},
+		{
+			"RGBA8 64x64, full mip chain",
+			Desc(TextureDimension::kTexture2D, kR8G8B8A8Unorm, 64, 64, 1, 7),
+			{
+				{ 0, 64, 64, 1, 256, 64, 256 },
+				{ 16384, 32, 32, 1, 256, 32, 128 },
+				{ 24576, 16, 16, 1, 256, 16, 64 },
+				{ 28672, 8, 8, 1, 256, 8, 32 },
+				{ 30720, 4, 4, 1, 256, 4, 16 },
+				{ 31744, 2, 2, 1, 256, 2, 8 },
+				{ 32256, 1, 1, 1, 256, 1, 4 },
+			},
+			32260
+		},
+		{
+			"BC1 256x256, full mip chain",
+			Desc(TextureDimension::kTexture2D, kBc1Unorm, 256, 256, 1, 9),
+			{
+				{ 0, 256, 256, 1, 512, 64, 512 },
+				{ 32768, 128, 128, 1, 256, 32, 256 },
+				{ 40960, 64, 64, 1, 256, 16, 128 },
+				{ 45056, 32, 32, 1, 256, 8, 64 },
+				{ 47104, 16, 16, 1, 256, 4, 32 },
+				{ 48128, 8, 8, 1, 256, 2, 16 },
+				{ 48640, 4, 4, 1, 256, 1, 8 },
+				{ 49152, 4, 4, 1, 256, 1, 8 },
+				{ 49664, 4, 4, 1, 256, 1, 8 },
+			},
+			49672
+		},
+		{
+			"BC7 10x6, partial blocks",
+			Desc(TextureDimension::kTexture2D, kBc7Unorm, 10, 6, 1, 1),
+			{ { 0, 12, 8, 1, 256, 2, 48 } },
+			304
+		},
+		{
+			"RGB32F 3x3",
+			Desc(TextureDimension::kTexture2D, kR32G32B32Float, 3, 3, 1, 1),
+			{ { 0, 3, 3, 1, 256, 3, 36 } },
+			548
+		},
+		{
+			"R8 10x10, 3 slices of 2 mips",
+			Desc(TextureDimension::kTexture2D, kR8Unorm, 10, 10, 3, 2),
+			{
+				{ 0, 10, 10, 1, 256, 10, 10 },
+				{ 2560, 5, 5, 1, 256, 5, 5 },
+				{ 4096, 10, 10, 1, 256, 10, 10 },
+				{ 6656, 5, 5, 1, 256, 5, 5 },
+				{ 8192, 10, 10, 1, 256, 10, 10 },
+				{ 10752, 5, 5, 1, 256, 5, 5 },
+			},
+			11781
+		},
+		{
+			"RGBA16F 32x32x8 volume, 2 mips",
+			Desc(TextureDimension::kTexture3D, kR16G16B16A16Float, 32, 32, 8, 2),
+			{
+				{ 0, 32, 32, 8, 256, 32, 256 },
+				{ 65536, 16, 16, 4, 256, 16, 128 },
+			},
+			81792
+		},
+		{
+			"1D RGBA8 1000, 2 mips",
+			Desc(TextureDimension::kTexture1D, kR8G8B8A8Unorm, 1000, 1, 1, 2),
+			{
+				{ 0, 1000, 1, 1, 4096, 1, 4000 },
+				{ 4096, 500, 1, 1, 2048, 1, 2000 },
+			},
+			6096
+		},
+		{
+			"Buffer of 1000 bytes",
+			Desc(TextureDimension::kBuffer, 0, 1000, 1, 1, 1),
+			{ { 0, 1000, 1, 1, 1024, 1, 1000 } },
+			1000
+		},
+	};
+}
+
+TEST(TextureFootprint, MatchesKnownFootprints)
+{
+	for (const FootprintCase& test : kCases)
+	{
+		SCOPED_TRACE(test.name);
+		const uint32_t count = GetSubresourceCount(test.desc);
+		ASSERT_EQ(count, test.footprints.size());
+
+		std::vector<SubresourceFootprint> footprints(count);
+		uint64_t total_bytes = 0;
+		ASSERT_TRUE(ComputeTextureFootprints(test.desc, 0, count, 0, footprints.data(), &total_bytes));
+		EXPECT_EQ(total_bytes, test.total_bytes);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			SCOPED_TRACE("subresource " + std::to_string(i));
+			const ExpectedFootprint& expected = test.footprints[i];
+			const SubresourceFootprint& actual = footprints[i];
+			EXPECT_EQ(actual.offset, expected.offset);
+			EXPECT_EQ(actual.format, test.desc.dimension == TextureDimension::kBuffer ? 0u : test.desc.format);
+			EXPECT_EQ(actual.width, expected.width);
+			EXPECT_EQ(actual.height, expected.height);
+			EXPECT_EQ(actual.depth, expected.depth);
+			EXPECT_EQ(actual.row_pitch, expected.row_pitch);
+			EXPECT_EQ(actual.row_count, expected.row_count);
+			EXPECT_EQ(actual.row_size, expected.row_size);
+		}
+	}
+}
+
+TEST(TextureFootprint, PlacesSubrangesFromTheBaseOffset)
+{
+	const TextureFootprintDesc desc = Desc(TextureDimension::kTexture2D, kR8G8B8A8Unorm, 64, 64, 1, 7);
+
+	// The first requested subresource starts at the base offset, rounded up to the placement alignment
+	SubresourceFootprint footprints[2];
+	uint64_t total_bytes = 0;
+	ASSERT_TRUE(ComputeTextureFootprints(desc, 2, 2, 700, footprints, &total_bytes));
+	EXPECT_EQ(footprints[0].offset, 1024u);
+	EXPECT_EQ(footprints[0].width, 16u);
+	EXPECT_EQ(footprints[1].offset, 1024u + 4096u);
+	EXPECT_EQ(footprints[1].width, 8u);
+	EXPECT_EQ(total_bytes, 1024u + 4096u + 256u * 7u + 32u - 700u);
+
+	// Total bytes are optional
+	EXPECT_TRUE(ComputeTextureFootprints(desc, 6, 1, 0, footprints, nullptr));
+	EXPECT_EQ(footprints[0].offset, 0u);
+	EXPECT_EQ(footprints[0].row_size, 4u);
+}
+
+TEST(TextureFootprint, RejectsUnknownFormats)
+{
+	TextureFormatInfo info;
+	EXPECT_FALSE(GetTextureFormatInfo(0, info));
+	EXPECT_FALSE(GetTextureFormatInfo(100, info));
+
+	SubresourceFootprint footprint;
+	EXPECT_FALSE(ComputeTextureFootprints(Desc(TextureDimension::kTexture2D, 0, 16, 16, 1, 1), 0, 1, 0, &footprint, nullptr));
+}
+
+TEST(TextureFootprint, KnowsBlockSizes)
+{
+	TextureFormatInfo info;
+	ASSERT_TRUE(GetTextureFormatInfo(kR8G8B8A8Unorm, info));
+	EXPECT_EQ(info.bytes_per_block, 4u);
+	EXPECT_EQ(info.block_size, 1u);
+	ASSERT_TRUE(GetTextureFormatInfo(kBc1Unorm, info));
+	EXPECT_EQ(info.bytes_per_block, 8u);
+	EXPECT_EQ(info.block_size, 4u);
+	ASSERT_TRUE(GetTextureFormatInfo(kBc7Unorm, info));
+	EXPECT_EQ(info.bytes_per_block, 16u);
+	EXPECT_EQ(info.block_size, 4u);
+	ASSERT_TRUE(GetTextureFormatInfo(kR32G32B32Float, info));
+	EXPECT_EQ(info.bytes_per_block, 12u);
+}
+
+TEST(TextureFootprint, CountsSubresources)
+{
+	EXPECT_EQ(GetSubresourceCount(Desc(TextureDimension::kTexture2D, kR8Unorm, 16, 16, 6, 5)), 30u);
+	EXPECT_EQ(GetSubresourceCount(Desc(TextureDimension::kTexture3D, kR8Unorm, 16, 16, 16, 5)), 5u);
+	EXPECT_EQ(GetSubresourceCount(Desc(TextureDimension::kTexture2D, kR8Unorm, 16, 16, 1, 0)), 1u);
+}
@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPool, VisitsEveryIndexOnce)
+{
+	ThreadPool pool(3);
+	EXPECT_EQ(pool.GetThreadCount(), 4u);
+	for (uint32_t grain : { 1u, 7u, 64u, 1000u })
+	{
+		std::vector<std::atomic<uint32_t>> visits(1000);
+		pool.ParallelFor(static_cast<uint32_t>(visits.size()), grain, [&visits, grain](uint32_t begin, uint32_t end)
+		{
+			EXPECT_LE(end - begin, grain);
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				visits[i].fetch_add(1);
+			}
+		});
+		for (const std::atomic<uint32_t>& count : visits)
+		{
+			EXPECT_EQ(count.load(), 1u) << "grain " << grain;
+		}
+	}
+}
+
+TEST(ThreadPool, RunsInlineWithoutWorkers)
+{
+	ThreadPool pool(0);
+	const std::thread::id caller = std::this_thread::get_id();
+	uint32_t covered = 0;
+	pool.ParallelFor(100, 1, [&](uint32_t begin, uint32_t end)
+	{
+		EXPECT_EQ(std::this_thread::get_id(), caller);
+		covered += end - begin;
+	});
+	EXPECT_EQ(covered, 100u);
+}
+
+TEST(ThreadPool, NestedLoopsRunInline)
+{
+	ThreadPool pool(2);
+	std::atomic<uint32_t> total{ 0 };
+	pool.ParallelFor(8, 1, [&](uint32_t, uint32_t)
+	{
+		const std::thread::id outer = std::this_thread::get_id();
+		pool.ParallelFor(10, 1, [&](uint32_t begin, uint32_t end)
+		{
+			EXPECT_EQ(std::this_thread::get_id(), outer);
+			total.fetch_add(end - begin);
+		});
+	});
+	EXPECT_EQ(total.load(), 80u);
+}
+
+TEST(ThreadPool, RethrowsAfterRunningChunksFinish)
+{
+	ThreadPool pool(3);
+	for (int round = 0; round < 20; ++round)
+	{
+		const std::thread::id caller = std::this_thread::get_id();
+		const bool throw_on_caller = round % 2 == 0;
+		std::atomic<uint32_t> running{ 0 };
+		std::atomic<uint32_t> started{ 0 };
+
+		// Chunks keep running for a while, so other threads are mid-chunk when one throws
+		auto body = [&](uint32_t begin, uint32_t)
+		{
+			running.fetch_add(1);
+			started.fetch_add(1);
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			const bool on_caller = std::this_thread::get_id() == caller;
+			if (begin >= 4 && on_caller == throw_on_caller)
+			{
+				running.fetch_sub(1);
+				throw std::runtime_error("chunk failed");
+			}
+			running.fetch_sub(1);
+		};
+		EXPECT_THROW(pool.ParallelFor(1000, 1, body), std::runtime_error);
+
+		// Nothing touches the body after ParallelFor() has returned
+		EXPECT_EQ(running.load(), 0u);
+		const uint32_t started_by_return = started.load();
+		EXPECT_LT(started_by_return, 1000u);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		EXPECT_EQ(started.load(), started_by_return);
+	}
+
+	// Still usable afterwards
+	std::atomic<uint32_t> covered{ 0 };
+	pool.ParallelFor(1000, 10, [&](uint32_t begin, uint32_t end) { covered.fetch_add(end - begin); });
+	EXPECT_EQ(covered.load(), 1000u);
+}
+
+TEST(ThreadPool, PropagatesInlineExceptions)
+{
+	ThreadPool pool(2);
+	EXPECT_THROW(pool.ParallelFor(5, 10, [](uint32_t, uint32_t) { throw std::logic_error("inline"); }), std::logic_error);
+
+	// Still usable afterwards
+	std::atomic<uint32_t> covered{ 0 };
+	pool.ParallelFor(100, 1, [&](uint32_t begin, uint32_t end) { covered.fetch_add(end - begin); });
+	EXPECT_EQ(covered.load(), 100u);
+}
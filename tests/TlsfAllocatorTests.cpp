@@ -0,0 +1,166 @@
+#include "TlsfAllocator.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t kCapacity = 64ull * 1024 * 1024;
+	constexpr uint64_t kGranularity = 256;
+
+	// Fails if any two live allocations share a byte or one leaves the range
+	void ExpectDisjoint(std::vector<TlsfAllocator::Allocation> allocations, uint64_t capacity)
+	{
+		std::sort(allocations.begin(), allocations.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+		for (size_t i = 0; i < allocations.size(); ++i)
+		{
+			EXPECT_LE(allocations[i].offset + allocations[i].size, capacity);
+			if (i > 0)
+			{
+				EXPECT_LE(allocations[i - 1].offset + allocations[i - 1].size, allocations[i].offset);
+			}
+		}
+	}
+}
+
+TEST(TlsfAllocator, StartsAsOneFreeBlock)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	const TlsfAllocator::Statistics stats = allocator.GetStatistics();
+	EXPECT_TRUE(allocator.IsEmpty());
+	EXPECT_EQ(stats.capacity, kCapacity);
+	EXPECT_EQ(stats.free_bytes, kCapacity);
+	EXPECT_EQ(stats.largest_free_block, kCapacity);
+	EXPECT_EQ(stats.free_block_count, 1u);
+	EXPECT_EQ(stats.fragmentation, 0.0f);
+}
+
+TEST(TlsfAllocator, RoundsSizesToGranularity)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	const auto allocation = allocator.Allocate(1, 1);
+	ASSERT_TRUE(allocation);
+	EXPECT_EQ(allocation->size, kGranularity);
+	EXPECT_EQ(allocator.GetStatistics().used_bytes, kGranularity);
+}
+
+TEST(TlsfAllocator, AlignsOffsets)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	std::mt19937 rng(7);
+	for (int i = 0; i < 2000; ++i)
+	{
+		// Unaligned sizes in between push later offsets off every alignment
+		const uint64_t alignment = uint64_t(1) << (8 + rng() % 9);
+		const auto allocation = allocator.Allocate(1 + rng() % 10000, alignment);
+		ASSERT_TRUE(allocation);
+		EXPECT_EQ(allocation->offset % alignment, 0u) << "alignment " << alignment;
+		EXPECT_EQ(allocation->offset % kGranularity, 0u);
+	}
+}
+
+TEST(TlsfAllocator, FailsWhenExhausted)
+{
+	TlsfAllocator allocator(16 * kGranularity, kGranularity);
+	EXPECT_FALSE(allocator.Allocate(0, 1));
+	EXPECT_FALSE(allocator.Allocate(17 * kGranularity, 1));
+
+	std::vector<TlsfAllocator::Allocation> allocations;
+	for (int i = 0; i < 16; ++i)
+	{
+		const auto allocation = allocator.Allocate(kGranularity, 1);
+		ASSERT_TRUE(allocation);
+		allocations.push_back(*allocation);
+	}
+	EXPECT_FALSE(allocator.Allocate(kGranularity, 1));
+	ExpectDisjoint(allocations, allocator.GetCapacity());
+
+	allocator.Free(allocations[5]);
+	const auto reused = allocator.Allocate(kGranularity, 1);
+	ASSERT_TRUE(reused);
+	EXPECT_EQ(reused->offset, allocations[5].offset);
+}
+
+TEST(TlsfAllocator, FullyCoalescesAfterRandomChurn)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	std::mt19937 rng(1234);
+	std::vector<TlsfAllocator::Allocation> live;
+	for (int step = 0; step < 50000; ++step)
+	{
+		if (live.empty() || rng() % 3 != 0)
+		{
+			const uint64_t size = 1 + rng() % (rng() % 8 == 0 ? 4 * 1024 * 1024 : 64 * 1024);
+			const uint64_t alignment = uint64_t(1) << (rng() % 17);
+			if (const auto allocation = allocator.Allocate(size, alignment))
+			{
+				EXPECT_GE(allocation->size, size);
+				EXPECT_EQ(allocation->offset % std::max(alignment, kGranularity), 0u);
+				live.push_back(*allocation);
+			}
+		}
+		else
+		{
+			const size_t index = rng() % live.size();
+			allocator.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+
+		if (step % 5000 == 0)
+		{
+			ExpectDisjoint(live, allocator.GetCapacity());
+		}
+	}
+
+	uint64_t live_bytes = 0;
+	for (const TlsfAllocator::Allocation& allocation : live)
+	{
+		live_bytes += allocation.size;
+	}
+	EXPECT_EQ(allocator.GetStatistics().used_bytes, live_bytes);
+	EXPECT_EQ(allocator.GetStatistics().allocation_count, live.size());
+	ExpectDisjoint(live, allocator.GetCapacity());
+
+	std::shuffle(live.begin(), live.end(), rng);
+	for (const TlsfAllocator::Allocation& allocation : live)
+	{
+		allocator.Free(allocation);
+	}
+
+	const TlsfAllocator::Statistics stats = allocator.GetStatistics();
+	EXPECT_TRUE(allocator.IsEmpty());
+	EXPECT_EQ(stats.used_bytes, 0u);
+	EXPECT_EQ(stats.free_block_count, 1u);
+	EXPECT_EQ(stats.largest_free_block, kCapacity);
+	EXPECT_EQ(stats.fragmentation, 0.0f);
+
+	// Everything merged back, so the whole range is available again
+	const auto whole = allocator.Allocate(kCapacity, 1);
+	ASSERT_TRUE(whole);
+	EXPECT_EQ(whole->offset, 0u);
+}
+
+TEST(TlsfAllocator, ResetDropsAllocations)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	for (int i = 0; i < 100; ++i)
+	{
+		ASSERT_TRUE(allocator.Allocate(10000, 4096));
+	}
+	allocator.Reset();
+	EXPECT_TRUE(allocator.IsEmpty());
+	EXPECT_EQ(allocator.GetStatistics().free_block_count, 1u);
+}
+
+#ifndef NDEBUG
+TEST(TlsfAllocatorDeathTest, AssertsOnDoubleFree)
+{
+	TlsfAllocator allocator(kCapacity, kGranularity);
+	const auto allocation = allocator.Allocate(1024, 1);
+	ASSERT_TRUE(allocation);
+	allocator.Free(*allocation);
+	EXPECT_DEATH(allocator.Free(*allocation), "Freeing an invalid allocation");
+}
+#endif
@@ -0,0 +1,32 @@
+#include "World.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+}
+
+// Fills the process-wide registry, so it has to stay the only World test
+// that registers types directly
+TEST(World, ThrowsPastTheComponentTypeLimit)
+{
+	const ComponentId position = GetComponentId<Position>();
+	ComponentId last = position;
+	while (last + 1 < kMaxComponentTypes)
+	{
+		last = RegisterComponentType(4, 4);
+	}
+	EXPECT_EQ(last, kMaxComponentTypes - 1);
+	EXPECT_THROW(RegisterComponentType(4, 4), std::length_error);
+	EXPECT_THROW(RegisterComponentType(4, 4), std::length_error);
+
+	// Types registered before the limit keep working
+	World world;
+	const Entity entity = world.Create(Position{ 1.0f, 2.0f, 3.0f });
+	ASSERT_NE(world.Get<Position>(entity), nullptr);
+	EXPECT_EQ(world.Get<Position>(entity)->y, 2.0f);
+}